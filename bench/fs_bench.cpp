@@ -0,0 +1,345 @@
+#include "fs/filesystem.hpp"
+#include "fs/disk.hpp"
+#include "fs/block_group_manager.hpp"
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+// ==========================================
+// FS_BENCH
+// ==========================================
+// Microbenchmarks for the individual paths (allocation, lookup, path walk,
+// read / write, format / mount) and a few macro workloads built from them.
+// Every benchmark works on its own image in the current directory on the
+// default mmap backend and removes it afterwards. Setup (formatting,
+// populating) is outside the timed loop.
+//
+//   ./fs_bench --benchmark_filter=Lookup --benchmark_repetitions=5
+
+static const size_t MB = 1024 * 1024;
+
+// One formatted image per benchmark run
+struct BenchImage {
+    std::string filename;
+    Disk disk;
+    FileSystem fs;
+
+    BenchImage(const std::string& name, size_t bytes, bool lazy = true)
+        : filename(fresh_image_name(name)), disk(bytes, filename.c_str()), fs(disk) {
+        fs.format(lazy);
+    }
+    ~BenchImage() { std::remove(filename.c_str()); }
+
+    // Left over from an interrupted run otherwise
+    static std::string fresh_image_name(const std::string& name) {
+        std::string filename = "bench_" + name + ".img";
+        std::remove(filename.c_str());
+        return filename;
+    }
+};
+
+static std::vector<std::string> numbered_names(const std::string& prefix, size_t n) {
+    std::vector<std::string> names;
+    names.reserve(n);
+    for (size_t i = 0; i < n; i++) names.push_back(prefix + std::to_string(i));
+    return names;
+}
+
+// ==========================================
+// MICROBENCHMARKS
+// ==========================================
+
+// Allocate + free one block in a group that is Arg(0)% full. The used
+// blocks are spread evenly, so the scan has to skip over them.
+static void BM_AllocateBlock(benchmark::State& state) {
+    BenchImage img("alloc", 16 * MB);
+    SuperBlock* sb = reinterpret_cast<SuperBlock*>(img.disk.get_ptr(0));
+    BlockGroupManager bgm(img.disk, sb, 0);
+
+    std::vector<int> held;
+    for (int b; (b = bgm.allocate_block()) != -1; ) held.push_back(b);
+    const size_t percent = static_cast<size_t>(state.range(0));
+    for (size_t i = 0; i < held.size(); i++) {
+        if (i % 100 >= percent) bgm.free_block(held[i]);
+    }
+
+    for (auto _ : state) {
+        int b = bgm.allocate_block();
+        if (b == -1) {
+            state.SkipWithError("group is full");
+            break;
+        }
+        bgm.free_block(b);
+    }
+    state.counters["free_blocks"] = static_cast<double>(bgm.get_free_blocks_count());
+}
+BENCHMARK(BM_AllocateBlock)->Arg(0)->Arg(50)->Arg(90)->Arg(99);
+
+// get_stats of a random entry in a directory of Arg(0) files
+static void BM_LookupInDir(benchmark::State& state) {
+    BenchImage img("lookup", 64 * MB);
+    const size_t entries = static_cast<size_t>(state.range(0));
+    img.fs.create_dir("/d");
+    std::vector<std::string> names = numbered_names("file_", entries);
+    img.fs.create_many("/d", names);
+
+    std::vector<std::string> paths;
+    for (const std::string& n : names) paths.push_back("/d/" + n);
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<size_t> pick(0, entries - 1);
+
+    for (auto _ : state) {
+        FileStats st = img.fs.get_stats(paths[pick(gen)]);
+        benchmark::DoNotOptimize(st.inode_id);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LookupInDir)->RangeMultiplier(4)->Range(16, 8192);
+
+// get_stats of a file Arg(0) directories deep
+static void BM_PathDepth(benchmark::State& state) {
+    BenchImage img("depth", 16 * MB);
+    std::string path;
+    for (int64_t i = 0; i < state.range(0); i++) {
+        path += "/dir" + std::to_string(i);
+        img.fs.create_dir(path);
+    }
+    path += "/leaf";
+    img.fs.create_file(path);
+
+    for (auto _ : state) {
+        FileStats st = img.fs.get_stats(path);
+        benchmark::DoNotOptimize(st.inode_id);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PathDepth)->Arg(1)->Arg(4)->Arg(16)->Arg(64);
+
+// Overwrite Arg(0) bytes at offset 0 through a handle
+static void BM_Write(benchmark::State& state) {
+    BenchImage img("write", 64 * MB);
+    const size_t len = static_cast<size_t>(state.range(0));
+    std::vector<uint8_t> buf(len, 0xAB);
+    img.fs.create_file("/f");
+    int fd = img.fs.open("/f", FS_OPEN_READ | FS_OPEN_WRITE);
+    img.fs.write_at(fd, 0, buf.data(), len); // Blocks allocated outside the loop
+
+    for (auto _ : state) {
+        img.fs.write_at(fd, 0, buf.data(), len);
+    }
+    img.fs.close(fd);
+    state.SetBytesProcessed(state.iterations() * len);
+}
+BENCHMARK(BM_Write)->Arg(512)->Arg(4096)->Arg(64 * 1024)->Arg(1024 * 1024)->Arg(8 * 1024 * 1024);
+
+// Read Arg(0) bytes at offset 0 through a handle
+static void BM_Read(benchmark::State& state) {
+    BenchImage img("read", 64 * MB);
+    const size_t len = static_cast<size_t>(state.range(0));
+    std::vector<uint8_t> buf(len, 0xCD);
+    img.fs.create_file("/f");
+    int fd = img.fs.open("/f", FS_OPEN_READ | FS_OPEN_WRITE);
+    img.fs.write_at(fd, 0, buf.data(), len);
+
+    for (auto _ : state) {
+        size_t n = img.fs.read_at(fd, 0, buf.data(), len);
+        benchmark::DoNotOptimize(n);
+    }
+    img.fs.close(fd);
+    state.SetBytesProcessed(state.iterations() * len);
+}
+BENCHMARK(BM_Read)->Arg(512)->Arg(4096)->Arg(64 * 1024)->Arg(1024 * 1024)->Arg(8 * 1024 * 1024);
+
+// The same ranges as zero-copy views (lease taken and released)
+static void BM_ReadView(benchmark::State& state) {
+    BenchImage img("readview", 64 * MB);
+    const size_t len = static_cast<size_t>(state.range(0));
+    std::vector<uint8_t> buf(len, 0xCD);
+    img.fs.create_file("/f");
+    int fd = img.fs.open("/f", FS_OPEN_READ | FS_OPEN_WRITE);
+    img.fs.write_at(fd, 0, buf.data(), len);
+
+    for (auto _ : state) {
+        ReadLease lease = img.fs.read_view(fd, 0, len);
+        benchmark::DoNotOptimize(lease.iovecs().data());
+    }
+    img.fs.close(fd);
+    state.SetBytesProcessed(state.iterations() * len);
+}
+BENCHMARK(BM_ReadView)->Arg(512)->Arg(4096)->Arg(64 * 1024)->Arg(1024 * 1024)->Arg(8 * 1024 * 1024);
+
+// 16 MB read 4 KB at a time through a handle, every iteration from a
+// freshly opened disk: mmap (0) or pread behind a cold 8192-block cache (1)
+static void BM_SequentialRead(benchmark::State& state) {
+    const std::string filename = BenchImage::fresh_image_name("seqread");
+    const size_t bytes = 64 * MB;
+    const size_t file_size = 16 * MB;
+    {
+        Disk disk(bytes, filename.c_str());
+        FileSystem fs(disk);
+        fs.format(true);
+        fs.create_file("/f");
+        fs.write_file("/f", std::vector<uint8_t>(file_size, 0x5E));
+    }
+
+    const bool cached = state.range(0) != 0;
+    std::vector<uint8_t> buf(4096);
+    for (auto _ : state) {
+        state.PauseTiming();
+        {
+            Disk disk(bytes, filename.c_str(), cached ? DiskBackendType::Pread : DiskBackendType::Mmap, cached ? 8192 : 0);
+            FileSystem fs(disk);
+            fs.mount();
+            int fd = fs.open("/f", FS_OPEN_READ);
+            state.ResumeTiming();
+
+            while (fs.read(fd, buf.data(), buf.size()) > 0) {}
+
+            state.PauseTiming();
+            fs.close(fd);
+        }
+        state.ResumeTiming();
+    }
+    std::remove(filename.c_str());
+    state.SetBytesProcessed(state.iterations() * file_size);
+}
+BENCHMARK(BM_SequentialRead)->ArgName("cold_cache")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// format() of an Arg(0) MB image; Arg(1) selects a lazy format
+static void BM_Format(benchmark::State& state) {
+    BenchImage img("format", static_cast<size_t>(state.range(0)) * MB);
+    const bool lazy = state.range(1) != 0;
+    for (auto _ : state) {
+        FileSystem fs(img.disk);
+        fs.format(lazy);
+    }
+}
+BENCHMARK(BM_Format)->ArgsProduct({{16, 256}, {0, 1}})->Unit(benchmark::kMillisecond);
+
+// mount() of an Arg(0) MB image holding 2048 files; Arg(1) selects a warm mount
+static void BM_Mount(benchmark::State& state) {
+    BenchImage img("mount", static_cast<size_t>(state.range(0)) * MB);
+    img.fs.create_dir("/d");
+    img.fs.create_many("/d", numbered_names("file_", 2048));
+    img.fs.sync();
+    const MountMode mode = state.range(1) != 0 ? MountMode::Warm : MountMode::Fast;
+
+    for (auto _ : state) {
+        FileSystem fs(img.disk);
+        fs.mount(mode);
+    }
+}
+BENCHMARK(BM_Mount)->ArgsProduct({{16, 256}, {0, 1}})->Unit(benchmark::kMillisecond);
+
+// ==========================================
+// MACRO WORKLOADS
+// ==========================================
+
+// Unpacking an archive: 16 directories of 64 small files each, one
+// create + write per file, on a freshly formatted image every iteration
+static void BM_Untar(benchmark::State& state) {
+    BenchImage img("untar", 64 * MB);
+    const int dirs = 16;
+    const int files_per_dir = 64;
+    std::vector<uint8_t> contents(static_cast<size_t>(state.range(0)), 'x');
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        img.fs.format(true);
+        state.ResumeTiming();
+
+        for (int d = 0; d < dirs; d++) {
+            std::string dir = "/pkg" + std::to_string(d);
+            img.fs.create_dir(dir);
+            for (int f = 0; f < files_per_dir; f++) {
+                std::string path = dir + "/file" + std::to_string(f);
+                img.fs.create_file(path);
+                img.fs.write_file(path, contents);
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * dirs * files_per_dir);
+    state.SetBytesProcessed(state.iterations() * dirs * files_per_dir * contents.size());
+}
+BENCHMARK(BM_Untar)->Arg(256)->Arg(8 * 1024)->Unit(benchmark::kMillisecond);
+
+// rm -r of 16 directories x 64 files of 64 KB: the caller-visible cost of
+// delete_dir alone (0) or with reclaiming the tree (1). Setup dominates, so
+// the iteration count is fixed.
+static void BM_DeleteTree(benchmark::State& state) {
+    BenchImage img("rmtree", 256 * MB);
+    std::vector<uint8_t> contents(64 * 1024, 'r');
+    for (auto _ : state) {
+        state.PauseTiming();
+        img.fs.create_dir("/victim");
+        for (int d = 0; d < 16; d++) {
+            std::string dir = "/victim/d" + std::to_string(d);
+            img.fs.create_dir(dir);
+            for (int f = 0; f < 64; f++) {
+                std::string path = dir + "/f" + std::to_string(f);
+                img.fs.create_file(path);
+                img.fs.write_file(path, contents);
+            }
+        }
+        state.ResumeTiming();
+
+        img.fs.delete_dir("/victim");
+        if (state.range(0) != 0) img.fs.reclaim_deferred_frees();
+
+        state.PauseTiming();
+        img.fs.reclaim_deferred_frees();
+        state.ResumeTiming();
+    }
+}
+BENCHMARK(BM_DeleteTree)->ArgName("with_reclaim")->Arg(0)->Arg(1)->Iterations(5)->Unit(benchmark::kMillisecond);
+
+// Appending Arg(0)-byte records to one log file; the file is truncated
+// (untimed) whenever it reaches 16 MB
+static void BM_LogAppend(benchmark::State& state) {
+    BenchImage img("log", 64 * MB);
+    const size_t record = static_cast<size_t>(state.range(0));
+    const size_t max_size = 16 * MB;
+    std::vector<uint8_t> line(record, 'l');
+    img.fs.create_file("/app.log");
+    int fd = img.fs.open("/app.log", FS_OPEN_WRITE | FS_OPEN_APPEND);
+
+    size_t size = 0;
+    for (auto _ : state) {
+        if (size + record > max_size) {
+            state.PauseTiming();
+            img.fs.truncate("/app.log", 0);
+            size = 0;
+            state.ResumeTiming();
+        }
+        size += img.fs.write(fd, line.data(), record);
+    }
+    img.fs.close(fd);
+    state.SetBytesProcessed(state.iterations() * record);
+}
+BENCHMARK(BM_LogAppend)->Arg(64)->Arg(512)->Arg(4096);
+
+// get_stats of random paths over 16 directories of 512 files
+static void BM_RandomStat(benchmark::State& state) {
+    BenchImage img("stat", 64 * MB);
+    std::vector<std::string> paths;
+    for (int d = 0; d < 16; d++) {
+        std::string dir = "/dir" + std::to_string(d);
+        img.fs.create_dir(dir);
+        std::vector<std::string> names = numbered_names("f", 512);
+        img.fs.create_many(dir, names);
+        for (const std::string& n : names) paths.push_back(dir + "/" + n);
+    }
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<size_t> pick(0, paths.size() - 1);
+
+    for (auto _ : state) {
+        FileStats st = img.fs.get_stats(paths[pick(gen)]);
+        benchmark::DoNotOptimize(st.file_size);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RandomStat);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+
+// ==========================================
+// BITMAP SCANNING ENGINE
+// ==========================================
+// Bitmaps use the on-disk convention of BlockGroupManager: bit i lives in
+// byte (i / 8) at position (i % 8). All scanners return the index of the
+// first CLEAR bit in [start_bit, max_bits), or -1 if every bit is set.
+
+// Portable path: skips full 64-bit words and uses count-trailing-zeros.
+int bitmap_find_first_zero_scalar(const uint8_t* bitmap, int max_bits, int start_bit = 0);
+
+// Dispatched path: picks the fastest engine supported by the running CPU
+// (AVX2 when available, otherwise the scalar word scanner).
+int bitmap_find_first_zero(const uint8_t* bitmap, int max_bits, int start_bit = 0);
+
+// Name of the engine selected by bitmap_find_first_zero ("avx2" / "scalar").
+const char* bitmap_scan_engine_name();
+
+// Number of CLEAR bits in [start_bit, max_bits), counted a word at a time.
+int bitmap_count_zeros(const uint8_t* bitmap, int max_bits, int start_bit = 0);
+
+// ==========================================
+// ATOMIC (LOCK-FREE) OPERATIONS
+// ==========================================
+// For bitmaps shared between threads without a lock. Every access is an
+// atomic op on the aligned 64-bit word holding the bit, so the bitmap must
+// be 8-byte aligned (block-aligned bitmaps always are). Bits at or past
+// max_bits are never touched.
+
+// Like bitmap_find_first_zero, but safe against concurrent claims: the
+// scalar engine loads every word atomically, the AVX2 engine skips full
+// 256-bit lanes and re-reads a candidate lane atomically. The answer is
+// only a candidate: another thread may claim the bit right after.
+int bitmap_find_first_zero_atomic(const uint8_t* bitmap, int max_bits, int start_bit = 0);
+int bitmap_find_first_zero_atomic_scalar(const uint8_t* bitmap, int max_bits, int start_bit = 0);
+
+// Atomically sets the run of CLEAR bits starting exactly at start_bit, up
+// to max_len bits, with one compare-exchange per word. Returns how many
+// bits this call now owns (0 if start_bit was already set).
+int bitmap_claim_run(uint8_t* bitmap, int max_bits, int start_bit, int max_len);
+
+bool bitmap_test_bit_atomic(const uint8_t* bitmap, int bit);
+
+// Atomically clears one bit; returns whether it was set.
+bool bitmap_release_bit(uint8_t* bitmap, int bit);
+
+// Clears bits [start_bit, start_bit + count) with one atomic op per word;
+// returns how many of them were set.
+int bitmap_release_run(uint8_t* bitmap, int start_bit, int count);
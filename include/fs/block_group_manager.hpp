@@ -1,40 +1,121 @@
 #pragma once
 #include "fs/disk.hpp"
 #include "fs/disk_datastructures.hpp"
+#include "fs/fs_stats.hpp"
+#include "fs/journal.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A physically contiguous range of global block ids
+struct BlockRun {
+    size_t start;
+    size_t length;
+};
 
 class BlockGroupManager {
 private:
     Disk& disk;
     SuperBlock* sb;
     int group_id;
+    Journal* journal; // Told about every bitmap / descriptor change (may be null)
+    FsStats* stats;   // Allocation latencies and scan lengths (may be null)
 
     // Relative Offsets (Valid for ANY group)
     const int INODE_BITMAP_OFFSET = 1;
     const int BLOCK_BITMAP_OFFSET = 2;
     const int INODE_TABLE_OFFSET  = 3;
 
+    // Byte offset of the GroupDescriptor inside the group's block 0
+    // (keeps clear of the SuperBlock, which sits at offset 0 of group 0).
+    const int GROUP_DESC_BYTE_OFFSET = 1024;
+
     // Helpers
     uint8_t* get_inode_bitmap_ptr();
     uint8_t* get_block_bitmap_ptr();
     uint8_t* get_inode_table_start();
+    GroupDescriptor* get_descriptor();
+    void journal_bitmap(int bitmap_offset);
+    // Through the journal when there is one, else straight to the Disk
+    void mark_dirty(size_t block_id) {
+        if (journal != nullptr) journal->mark_dirty(block_id);
+        else disk.mark_dirty(block_id);
+    }
+
+    // Lock-free access to the descriptor counters and hints
+    enum DescriptorField {
+        FREE_BLOCKS = offsetof(GroupDescriptor, free_blocks_count),
+        FREE_INODES = offsetof(GroupDescriptor, free_inodes_count),
+        BLOCK_HINT  = offsetof(GroupDescriptor, block_alloc_hint),
+        INODE_HINT  = offsetof(GroupDescriptor, inode_alloc_hint),
+        FLAGS       = offsetof(GroupDescriptor, flags)
+    };
+    uint32_t* descriptor_field(DescriptorField field);
+    uint32_t load_counter(DescriptorField field);
+    void add_counter(DescriptorField field, int delta);
+    void store_counter(DescriptorField field, uint32_t value);
+
+    // Lazy format: an uninitialized group is set up before its first
+    // allocation. Once per group, under a lock.
+    void ensure_initialized();
 
-    // Bitwise Ops
-    bool get_bit(uint8_t* bitmap, int local_index);
-    void set_bit(uint8_t* bitmap, int local_index);
-    void clear_bit(uint8_t* bitmap, int local_index);
+    // Bitmap scans (the bits themselves change via bitmap_claim_run /
+    // bitmap_release_bit, so allocation needs no group lock)
     int find_first_free_bit(uint8_t* bitmap, int max_bits, int start_bit = 0);
+    int find_free_bit_from_hint(uint8_t* bitmap, int max_bits, int start_bit, int hint);
 
 public:
-    BlockGroupManager(Disk& d, SuperBlock* sb, int id)
-        : disk(d), sb(sb), group_id(id) {}
+    BlockGroupManager(Disk& d, SuperBlock* sb, int id, Journal* journal = nullptr, FsStats* stats = nullptr)
+        : disk(d), sb(sb), group_id(id), journal(journal), stats(stats) {}
+
+    // Keeps the inode table resident under a buffer cache: get_inode
+    // indexes from the table's first block, so the table must stay mapped
+    // as one contiguous run (mount)
+    void pin_inode_table();
+
+    // Group descriptor maintenance (format / mount). A lazy descriptor marks
+    // the group GROUP_FLAG_UNINIT and derives its counters from the geometry
+    // instead of the (unwritten) bitmaps.
+    void init_descriptor(bool lazy = false);
+    bool is_initialized();
+    // Zeroes both bitmaps and the inode table
+    void init_metadata();
+    bool has_valid_descriptor();
+    void rebuild_descriptor();
+    // True when the free counters agree with the bitmaps (always for an
+    // uninitialized group, whose counters come from the geometry)
+    bool descriptor_matches_bitmaps();
+    // Warm mount: pins the inode table and faults in the group's header,
+    // bitmaps and table, so the first operations on it do not wait for I/O
+    void warm_metadata();
+
+    size_t get_free_blocks_count();
+    size_t get_free_inodes_count();
+
+    // Geometry: usable bit ranges of the two bitmaps
+    int first_data_block_bit();
+    int first_inode_bit();
+    int blocks_in_group();
+
+    // Raw bitmaps, for FileSystem::check only: it owns the whole file
+    // system while it reads (and on repair rewrites) them
+    uint8_t* block_bitmap() { return get_block_bitmap_ptr(); }
+    uint8_t* inode_bitmap() { return get_inode_bitmap_ptr(); }
 
     int allocate_inode();
+    int allocate_inode_run(int max_len, int* run_len);
     void free_inode(int global_inode_id);
 
     int allocate_block();
+    int allocate_block_run(int max_len, int goal_block, int* run_len, bool zero_fill = true);
+    std::vector<BlockRun> allocate_blocks(size_t n, int goal_block = -1, bool zero_fill = true);
     void free_block(int global_block_id);
+    // [first_block, first_block + count) must lie inside this group
+    void free_block_run(int first_block, int count);
 
     Inode* get_inode(int global_inode_id);
+    // Marks the inode table block(s) holding this inode dirty (journal / Disk)
+    void journal_inode(int global_inode_id);
     bool is_inode_allocated(int global_inode_id);
 
     // GEMINI FIX: Added this helper here as requested
@@ -0,0 +1,134 @@
+#pragma once
+#include "fs/disk_backend.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// ==========================================
+// BUFFER CACHE
+// ==========================================
+// Fixed-capacity block cache for the backends that do not keep the whole
+// image in memory (pread / io_uring). Disk routes get_ptr and the byte
+// helpers through it, so FileSystem and BlockGroupManager code is unchanged.
+//
+// Frames are pinned while in use and never evicted while pinned. A frame
+// is written back when it is evicted, flushed or released, but only if its
+// contents changed since it was loaded or last written. A content hash
+// decides that, so writers that never mark their blocks dirty are handled.
+//
+// Victims are picked by CLOCK: a frame's reference bit is set on every pin,
+// and the hand clears bits until it finds an unpinned frame without one.
+// When every frame is pinned an overflow frame is allocated, and it is
+// released again as soon as it is unpinned. Memory stays at the capacity
+// unless more blocks than that are in use at once.
+//
+// prefetch() loads blocks that are about to be read into unpinned frames
+// with one backend request (queued reads on io_uring), so the pins that
+// follow hit. It never takes more than a quarter of the frames and never
+// allocates overflow frames for it.
+//
+// Blocks the hold check reports (Disk::hold) are never written: they are
+// not evicted, not released from overflow frames, and skipped by the
+// flushes until release_held() runs after the hold ends.
+//
+// Regions are contiguous block ranges that stay resident in one buffer
+// (inode tables, whose inodes may straddle blocks). They are outside the
+// capacity and never evicted.
+//
+// Pin scopes: a pointer from pin_scoped() stays valid until the innermost
+// scope open on the calling thread ends (see Disk::PinScope). Outside any
+// scope the block stays pinned until the cache is destroyed.
+//
+// Thread-safe: one mutex guards the frame table; block I/O on a miss or an
+// eviction happens under it. Regions are read outside it, so several can be
+// loaded at once.
+class BufferCache {
+private:
+    struct Frame {
+        size_t block_id = 0;
+        uint8_t* data = nullptr;
+        uint32_t pins = 0;
+        bool referenced = false;
+        bool valid = false;
+        uint64_t hash = 0; // Of the contents as last read or written
+    };
+
+    struct Region {
+        size_t first_block;
+        size_t count;
+        uint8_t* data;
+        std::vector<uint64_t> hashes;
+    };
+
+    DiskBackend& backend;
+    size_t block_size;
+    size_t capacity;
+
+    uint8_t* arena = nullptr;        // capacity frames, page aligned
+    std::vector<Frame> frames;          // [0, capacity) in the arena, then overflow
+    std::vector<size_t> free_frames;    // Unused arena slots
+    std::vector<size_t> free_overflow;  // Released overflow slots (no memory)
+    std::unordered_map<size_t, size_t> index; // block -> frame
+    std::vector<Region> regions;     // Sorted by first_block
+    size_t clock_hand = 0;
+    std::function<bool(size_t)> is_held;
+    std::mutex lock;
+
+    std::atomic<size_t> hits{0};
+    std::atomic<size_t> misses{0};
+    std::atomic<size_t> evictions{0};
+    std::atomic<size_t> writes{0};
+    std::atomic<size_t> prefetched{0};
+
+    static constexpr size_t NO_FRAME = static_cast<size_t>(-1);
+
+    uint64_t content_hash(const uint8_t* data) const;
+    bool held(size_t block_id) const { return is_held && is_held(block_id); }
+    Region* find_region(size_t block_id);
+    // NO_FRAME instead of an overflow frame when allow_overflow is false
+    size_t grab_frame(bool allow_overflow = true);
+    void release_frame(size_t slot); // Writes back if changed, then frees the slot
+    void collect_changed(size_t block_id, std::vector<std::pair<size_t, const uint8_t*>>& out);
+
+public:
+    BufferCache(DiskBackend& backend, size_t block_size, size_t capacity);
+    ~BufferCache();
+    BufferCache(const BufferCache&) = delete;
+    BufferCache& operator=(const BufferCache&) = delete;
+
+    uint8_t* pin(size_t block_id);
+    void unpin(size_t block_id);
+    uint8_t* pin_scoped(size_t block_id);
+
+    // Scopes nest per thread: end_scope(mark) unpins what pin_scoped pinned
+    // since the begin_scope() that returned `mark`
+    static size_t begin_scope();
+    static void end_scope(size_t mark);
+
+    // Set once, before the cache is used
+    void set_hold_check(std::function<bool(size_t)> check) { is_held = std::move(check); }
+    // Frees the unpinned overflow frames kept back while their block was held
+    void release_held();
+    // Writes `data` as block_id's disk copy without changing its resident copy
+    void write_through(size_t block_id, const uint8_t* data);
+
+    void add_region(size_t first_block, size_t count);
+    // Only a hint: read errors are dropped and surface on the real read
+    void prefetch(const std::vector<DiskRun>& runs);
+
+    // Writes back the changed, unheld resident blocks among `runs` / all of them
+    void write_back(const std::vector<DiskRun>& runs);
+    void write_back_all();
+
+    size_t get_capacity() const { return capacity; }
+    size_t get_resident();
+    size_t get_hits() const { return hits; }
+    size_t get_misses() const { return misses; }
+    size_t get_evictions() const { return evictions; }
+    size_t get_writes() const { return writes; }
+    size_t get_prefetched() const { return prefetched; }
+};
@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// ==========================================
+// DENTRY CACHE
+// ==========================================
+// Bounded in-memory cache of (parent inode, name) -> child inode lookups.
+// A child id of 0 is a NEGATIVE entry ("name is known to be absent"), so
+// repeated misses skip the directory scan too.
+//
+// Layout: set-associative table (WAYS entries per set); a CLOCK reference
+// bit picks the victim inside a set, so memory use is fixed at construction.
+//
+// Thread-safe: sets are guarded by a fixed array of striped mutexes, so
+// lookups under different parents rarely contend.
+class DentryCache {
+private:
+    static const size_t WAYS = 4;
+    static const size_t LOCK_STRIPES = 64;
+
+    struct Entry {
+        bool valid = false;
+        bool referenced = false;
+        uint32_t hash = 0;
+        size_t parent_id = 0;
+        size_t child_id = 0;
+        std::string name;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<uint8_t> clock_hands; // Per set
+    size_t set_mask;
+    std::vector<std::mutex> set_locks; // Set i is guarded by set_locks[i % LOCK_STRIPES]
+
+    std::atomic<size_t> hits{0};
+    std::atomic<size_t> misses{0};
+
+    static uint32_t key_hash(size_t parent_id, std::string_view name);
+    Entry* find_entry(size_t parent_id, std::string_view name, uint32_t hash);
+    std::mutex& lock_for(uint32_t hash) { return set_locks[(hash & set_mask) % LOCK_STRIPES]; }
+
+public:
+    // capacity is rounded up to a power-of-two number of sets
+    explicit DentryCache(size_t capacity = 8192);
+
+    // Returns true on a hit and stores the cached child (0 = negative).
+    bool lookup(size_t parent_id, std::string_view name, size_t* child_id);
+
+    // Records a positive (child_id != 0) or negative (child_id == 0) entry.
+    void insert(size_t parent_id, std::string_view name, size_t child_id);
+
+    void invalidate(size_t parent_id, std::string_view name);
+    void clear();
+
+    size_t get_hits() const { return hits; }
+    size_t get_misses() const { return misses; }
+    void reset_counters() {
+        hits = 0;
+        misses = 0;
+    }
+    size_t get_capacity() const { return entries.size(); }
+};
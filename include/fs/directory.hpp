@@ -0,0 +1,33 @@
+#pragma once
+#include "fs/disk_datastructures.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+
+// ==========================================
+// DIRECTORY BLOCK HELPERS
+// ==========================================
+// Operations on a single 4KB block of variable-length DirRecords.
+// FileSystem decides WHICH block to use (linear scan or hashed index);
+// these only know how records are laid out inside one block.
+
+// Hash of an entry name, used to pick the bucket in an indexed directory.
+uint32_t dir_name_hash(const char* name, size_t len);
+
+// Formats a freshly allocated block as one free record spanning the block.
+void dir_block_init(uint8_t* block);
+
+// Returns the record named `name`, or nullptr.
+DirRecord* dir_block_find(uint8_t* block, std::string_view name);
+
+// Stores (inode_id, name) in the first record with enough slack, splitting
+// it if needed. Returns false if the block has no room.
+bool dir_block_insert(uint8_t* block, size_t inode_id, std::string_view name);
+
+// Removes the record named `name`, merging its space into the previous
+// record. Returns its inode id, or 0 if absent.
+size_t dir_block_remove(uint8_t* block, std::string_view name);
+
+// Calls fn(record) for every used record in the block.
+void dir_block_for_each(uint8_t* block, const std::function<void(DirRecord&)>& fn);
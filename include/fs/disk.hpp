@@ -1,5 +1,9 @@
 #pragma once
+#include "fs/buffer_cache.hpp"
+#include "fs/disk_backend.hpp"
+#include <atomic>
 #include <cstdint>
+#include <memory>
 #include <vector>
 #include <cstring>
 #include <stdexcept>
@@ -13,21 +17,130 @@ private:
 
     // --- NEW ABSTRACTION (Memory Mapped File) ---
     uint8_t* mapped_data; // Pointer to the file contents in RAM
-    int fd;               // File Descriptor
+
+    // Where mapped_data comes from and how it is written back (disk_backend.hpp)
+    std::unique_ptr<DiskBackend> backend;
+
+    // Set instead of mapped_data when a pread / io_uring disk is opened with
+    // a cache capacity: blocks are then loaded on demand (buffer_cache.hpp).
+    // Declared after backend, so it is destroyed first.
+    std::unique_ptr<BufferCache> cache;
 
     const size_t BLOCK_SIZE = 4096;
     size_t BLOCK_COUNT = 0;
 
+    // One bit per block written since it was last flushed. write_block sets
+    // it; code writing through get_ptr calls mark_dirty. Lock-free.
+    std::vector<std::atomic<uint64_t>> dirty_bits;
+    std::atomic<size_t> dirty_count{0};
+
+    // One bit per block that must not reach the image file yet (see hold)
+    std::vector<std::atomic<uint64_t>> held_bits;
+    std::atomic<size_t> held_count{0};
+
+    // One bit per block written back since the last drop_written
+    std::vector<std::atomic<uint64_t>> written_bits;
+
+    bool take_dirty(size_t block_id);
+    // Dirty bits of the unheld blocks in word `w`
+    uint64_t flushable_bits(size_t w) const {
+        return dirty_bits[w].load(std::memory_order_relaxed) & ~held_bits[w].load(std::memory_order_relaxed);
+    }
+
 public:
     // GEMINI FIX: Added filename parameter with default for persistence
-    Disk(size_t capacity_bytes, const char* filename = "disk.img");
+    // cache_blocks > 0 bounds the memory of the pread and io_uring backends
+    // to that many cached blocks (plus the inode tables, see pin_region)
+    // instead of holding the whole image. Ignored for mmap.
+    Disk(size_t capacity_bytes, const char* filename = "disk.img", DiskBackendType backend_type = DiskBackendType::Mmap,
+         size_t cache_blocks = 0);
 
     // GEMINI FIX: Added destructor to close/sync the file
     ~Disk();
 
     void read_block(int block_id, void* buffer);
     void write_block(int block_id, const void* buffer);
+    // With a cache, the pointer stays valid until the innermost PinScope on
+    // this thread ends
     uint8_t* get_ptr(int block_id);
+    void mark_dirty(size_t first_block, size_t count = 1);
+    // A pointer that stays valid, outside any PinScope, until the matching
+    // unpin_block. Both are free on a resident image.
+    const uint8_t* pin_block(size_t block_id);
+    void unpin_block(size_t block_id);
+
+    // Byte ranges starting at `offset` inside `first_block` and running on
+    // through the following blocks. One memcpy on a mapped image; block by
+    // block, without keeping anything pinned, through a cache. The writers
+    // mark what they touch dirty.
+    void read_bytes(size_t first_block, size_t offset, void* dst, size_t len);
+    void write_bytes(size_t first_block, size_t offset, const void* src, size_t len);
+    void zero_bytes(size_t first_block, size_t offset, size_t len);
+    void copy_block(size_t dst_block, size_t src_block);
+
+    // Hint that the runs are about to be read: madvise on a mapped image,
+    // a batched load into the cache otherwise. Runs are clipped to the disk.
+    void prefetch(std::vector<DiskRun> runs);
+    // Loads the runs before returning: page faults on a mapped image, the
+    // same batched load as prefetch into a cache (pinned regions skipped)
+    void prefault(std::vector<DiskRun> runs);
+
+    // Keeps [first_block, first_block + count) resident and contiguous, so
+    // structures straddling block boundaries can be used through get_ptr.
+    // No-op without a cache.
+    void pin_region(size_t first_block, size_t count);
+
+    // Brackets an operation that holds get_ptr pointers (no-op without a
+    // cache). Scopes nest; each one releases only its own pins.
+    class PinScope {
+    private:
+        bool active;
+        size_t mark = 0;
+
+    public:
+        explicit PinScope(Disk& disk) : active(disk.cache != nullptr) {
+            if (active) mark = BufferCache::begin_scope();
+        }
+        ~PinScope() {
+            if (active) BufferCache::end_scope(mark);
+        }
+        PinScope(const PinScope&) = delete;
+        PinScope& operator=(const PinScope&) = delete;
+    };
+
+    // Write-ahead support for the journal: a held block keeps its changes in
+    // memory until the hold is released. Every flush skips it and a cache
+    // keeps it resident; it stays dirty, so the flush after the release
+    // writes it. Dropping the Disk with holds left loses those changes, as a
+    // crash would. hold / is_held are lock-free.
+    void hold(size_t block_id);
+    bool is_held(size_t block_id) const {
+        return held_bits[block_id / 64].load(std::memory_order_relaxed) & (1ULL << (block_id % 64));
+    }
+    void release_holds(const std::vector<size_t>& blocks);
+    void release_all_holds();
+    size_t get_held_count() const { return held_count; }
+    // Writes each (block, data) pair to the block's place in the image file
+    // and waits for it. The in-memory blocks are left alone: this is how a
+    // held block's last committed contents reach the file.
+    void write_through(const std::vector<std::pair<size_t, const uint8_t*>>& blocks);
+
+    // Flushes the dirty, unheld blocks in [first_block, first_block + count),
+    // one backend request per contiguous run, and returns how many were
+    // flushed. Clean blocks cost a bit test, so the price follows what was
+    // written.
+    size_t sync_range(size_t first_block, size_t count, SyncMode mode = SyncMode::Wait);
+    // sync_range over the whole image; with a cache also the resident
+    // blocks that changed without being marked
+    void sync_all(SyncMode mode = SyncMode::Wait);
+    // Lets the backend drop its in-memory copy of the blocks in the range
+    // that were written back and are clean and unheld since (mmap keeps
+    // written pages as private memory until then). The caller makes sure
+    // nothing writes to those blocks meanwhile.
+    void drop_written(size_t first_block, size_t count);
+    size_t get_dirty_count() const { return dirty_count; }
+    const char* get_backend_name() const { return backend->name(); }
+    BufferCache* get_cache() { return cache.get(); } // nullptr when the image is resident
     void hex_dump(int block_id);
 
     size_t get_block_count() const { return BLOCK_COUNT; }
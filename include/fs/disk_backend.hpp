@@ -0,0 +1,177 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// How sync_range waits: Async only starts the writeback, Wait returns once
+// the blocks are on stable storage.
+enum class SyncMode { Async, Wait };
+
+enum class DiskBackendType {
+    Mmap,    // MAP_PRIVATE mapping of the image file, written back with pwrite (the default)
+    Pread,   // In-memory image written back with pwrite, O_DIRECT if possible
+    IoUring  // Like Pread, but reads/writes are queued and submitted in batches
+};
+
+// Parses "mmap" / "pread" / "uring"; throws on anything else
+DiskBackendType parse_disk_backend(const std::string& name);
+
+// A contiguous range of blocks handed to the backend in one request
+struct DiskRun {
+    size_t first_block;
+    size_t count;
+};
+
+// ==========================================
+// DISK BACKEND
+// ==========================================
+// Owns the image file and the memory Disk hands out through get_ptr.
+// open() returns that memory, already holding the file's contents; the
+// backend decides how changes travel back, but always as explicit writes
+// of the runs Disk hands it: nothing reaches the file on its own, which the
+// journal relies on (see Disk::hold).
+//
+// With load_image == false (pread / io_uring under a BufferCache) no image
+// is kept and open() returns nullptr; blocks then move through read_block /
+// write_blocks one buffer at a time.
+class DiskBackend {
+public:
+    virtual ~DiskBackend() = default;
+
+    virtual uint8_t* open(const char* filename, size_t bytes, size_t block_size, bool load_image = true) = 0;
+    // Makes the given runs of `image` durable (Wait) or start their write
+    virtual void write_back(const std::vector<DiskRun>& runs, SyncMode mode) = 0;
+    // Runs of `image` that may differ from the file, marked dirty or not.
+    // Written back at shutdown, so writers that never marked their blocks
+    // dirty do not lose data.
+    virtual std::vector<DiskRun> written_runs() const = 0;
+    // Runs just written back, with no writer active in them: a backend
+    // holding private copies may drop them and read the file again
+    virtual void release(const std::vector<DiskRun>& runs) { (void)runs; }
+    virtual const char* name() const = 0;
+
+    // Block I/O for a cache; buffers are block sized and page aligned.
+    // read_blocks defaults to one read_block per block.
+    virtual void read_block(size_t block_id, uint8_t* buf);
+    virtual void read_blocks(const std::vector<std::pair<size_t, uint8_t*>>& blocks);
+    virtual void write_blocks(const std::vector<std::pair<size_t, const uint8_t*>>& blocks);
+    virtual void sync_data() = 0;
+
+    // Hint that `runs` of the image are about to be read. Only the mmap
+    // backend has anything to do; a loaded image is already in memory.
+    virtual void prefetch(const std::vector<DiskRun>& runs) { (void)runs; }
+    // Like prefetch, but returns only once the runs are mapped in, so first
+    // accesses take no page faults at all
+    virtual void populate(const std::vector<DiskRun>& runs) { (void)runs; }
+};
+
+std::unique_ptr<DiskBackend> make_disk_backend(DiskBackendType type);
+
+// The mapping is private, so the kernel never writes a page back by itself
+// (MAP_SHARED would, at any time). Written pages become private copies
+// until release() drops them once written back; written_runs finds the
+// remaining ones through /proc/self/pagemap instead of naming the whole
+// image.
+class MmapBackend : public DiskBackend {
+private:
+    int fd = -1;
+    uint8_t* image = nullptr;
+    size_t bytes = 0;
+    size_t block_size = 0;
+
+public:
+    ~MmapBackend() override;
+    uint8_t* open(const char* filename, size_t bytes, size_t block_size, bool load_image = true) override;
+    void write_back(const std::vector<DiskRun>& runs, SyncMode mode) override;
+    // Private copies left; the whole image when pagemap cannot be read
+    std::vector<DiskRun> written_runs() const override;
+    void release(const std::vector<DiskRun>& runs) override;
+    const char* name() const override { return "mmap"; }
+
+    void write_blocks(const std::vector<std::pair<size_t, const uint8_t*>>& blocks) override;
+    void sync_data() override;
+    void prefetch(const std::vector<DiskRun>& runs) override;
+    void populate(const std::vector<DiskRun>& runs) override;
+};
+
+// The image lives in anonymous, page-aligned memory, so block-sized writes
+// satisfy O_DIRECT's alignment rules. File systems that refuse O_DIRECT
+// (tmpfs) get buffered I/O with an fdatasync instead.
+class PreadBackend : public DiskBackend {
+protected:
+    int fd = -1;
+    uint8_t* image = nullptr;
+    size_t bytes = 0;
+    size_t block_size = 0;
+    bool direct = false;
+
+    void open_file(const char* filename, size_t bytes, size_t block_size);
+    void allocate_image();
+    void transfer(bool write, uint8_t* buf, size_t offset, size_t len);
+
+public:
+    ~PreadBackend() override;
+    uint8_t* open(const char* filename, size_t bytes, size_t block_size, bool load_image = true) override;
+    void write_back(const std::vector<DiskRun>& runs, SyncMode mode) override;
+    std::vector<DiskRun> written_runs() const override; // The whole image
+    const char* name() const override { return direct ? "pread (O_DIRECT)" : "pread"; }
+
+    void read_block(size_t block_id, uint8_t* buf) override;
+    void read_blocks(const std::vector<std::pair<size_t, uint8_t*>>& blocks) override;
+    void write_blocks(const std::vector<std::pair<size_t, const uint8_t*>>& blocks) override;
+    void sync_data() override;
+};
+
+// io_uring through the raw system calls (no liburing): every run of a
+// write_back becomes one queued write, the queue is submitted in batches of
+// QUEUE_DEPTH, and Wait adds a single datasync. Throws from open() when the
+// kernel does not allow io_uring.
+class IoUringBackend : public PreadBackend {
+private:
+    static constexpr unsigned QUEUE_DEPTH = 64;
+    static constexpr size_t MAX_IO_BYTES = 1 << 20; // Longer runs are split
+
+    int ring_fd = -1;
+    void* sq_ring = nullptr;
+    void* cq_ring = nullptr;
+    size_t sq_ring_bytes = 0;
+    size_t cq_ring_bytes = 0;
+    void* sqes = nullptr;
+    size_t sqes_bytes = 0;
+
+    // Ring fields, pointing into the shared mappings
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_mask = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned* cq_mask = nullptr;
+    void* cqes = nullptr;
+
+    std::mutex ring_lock; // One submitter at a time
+
+    void setup_ring();
+    // Queues (opcode, file offset, len, buffer) requests and waits for all
+    // of them; short transfers are finished with plain pread/pwrite.
+    struct Request {
+        uint8_t opcode;
+        size_t offset;
+        size_t len;
+        uint8_t* buf;
+    };
+    void submit_and_wait(const std::vector<Request>& requests);
+
+public:
+    ~IoUringBackend() override;
+    uint8_t* open(const char* filename, size_t bytes, size_t block_size, bool load_image = true) override;
+    void write_back(const std::vector<DiskRun>& runs, SyncMode mode) override;
+    const char* name() const override { return direct ? "io_uring (O_DIRECT)" : "io_uring"; }
+
+    void read_blocks(const std::vector<std::pair<size_t, uint8_t*>>& blocks) override;
+    void write_blocks(const std::vector<std::pair<size_t, const uint8_t*>>& blocks) override;
+    void sync_data() override;
+};
@@ -4,13 +4,26 @@
 #include <cstdint> // for uint8_t
 #include <algorithm> // GEMINI FIX: Added for std::min
 
-enum FS_FILE_TYPES {
+enum FS_FILE_TYPES : uint32_t {
     FS_FREE = 0,
     FS_FILE = 1,
     FS_DIRECTORY = 2,
     FS_SYMLINK = 3
 };
 
+// On-disk layout revision, stored in SuperBlock::format_version.
+//   1 (stored as 0): fixed 264-byte DirEntry slots
+//   2: variable-length DirRecord entries
+//   3: Inode::flags (extent-mapped files)
+//   4: metadata journal (SuperBlock::journal_start / journal_blocks)
+//   5: lazily initialized groups (GROUP_FLAG_UNINIT)
+//   6: inline data for small files and symlinks (INODE_FLAG_INLINE)
+//   7: 256-byte naturally aligned Inode with timestamp fields
+//   8: orphan chain (SuperBlock::orphan_head / Inode::next_orphan)
+const size_t FS_FORMAT_VERSION = 8;
+
+static_assert(sizeof(size_t) == 8, "On-disk structures assume a 64-bit size_t");
+
 #pragma pack(push, 1)
 
 struct SuperBlock {
@@ -20,6 +33,10 @@ struct SuperBlock {
     size_t inodes_per_group;
     size_t blocks_per_group;
     size_t home_dir_inode;
+    size_t format_version;
+    size_t journal_start;   // First block of the journal region (0 = none)
+    size_t journal_blocks;  // Length of the journal region
+    size_t orphan_head;     // First unlinked inode awaiting reclaim (0 = none)
 
     // Default Constructor
     SuperBlock() :
@@ -28,7 +45,11 @@ struct SuperBlock {
         total_blocks(0),
         inodes_per_group(4096),
         blocks_per_group(4096),
-        home_dir_inode(0) {} // GEMINI FIX: Initialize home_dir_inode
+        home_dir_inode(0), // GEMINI FIX: Initialize home_dir_inode
+        format_version(FS_FORMAT_VERSION),
+        journal_start(0),
+        journal_blocks(0),
+        orphan_head(0) {}
 
     // Parameterized Constructor
     SuperBlock(size_t t_inodes, size_t t_blocks) :
@@ -37,17 +58,30 @@ struct SuperBlock {
         total_blocks(t_blocks),
         inodes_per_group(4096),
         blocks_per_group(4096),
-        home_dir_inode(0) {}
+        home_dir_inode(0),
+        format_version(FS_FORMAT_VERSION),
+        journal_start(0),
+        journal_blocks(0),
+        orphan_head(0) {}
 };
 
+#pragma pack(pop)
+
+// Every field sits at its natural alignment and the struct is exactly
+// INODE_SIZE bytes, so a table block holds a whole number of inodes, each
+// inode covers four cache lines and never straddles a block, and table
+// offsets are shifts. Declared outside the packed section so the compiler
+// knows it too.
 struct Inode {
     size_t id;
-    FS_FILE_TYPES file_type;
     size_t file_size;
+    FS_FILE_TYPES file_type;
+    uint32_t flags;           // INODE_FLAG_* bits
     // --- NEW PERMISSION FIELDS ---
     uint16_t uid;         // User ID of the owner
     uint16_t gid;         // Group ID
     uint16_t permissions;  // e.g., 0755 (rwxr-xr-x)
+    uint16_t reserved16;
     size_t direct_blocks[12];
     
     // Indirect block pointers
@@ -55,37 +89,175 @@ struct Inode {
     size_t double_indirect;   // Level 2: points to blocks containing single indirect blocks
     size_t triple_indirect;   // Level 3: points to blocks containing double indirect blocks
 
+    // Room for timestamps (not maintained yet; zero)
+    uint64_t atime;
+    uint64_t mtime;
+    uint64_t ctime;
+
+    uint64_t next_orphan;     // Next inode on the orphan chain (0 ends it)
+
+    uint8_t reserved[72];     // Pads to INODE_SIZE; zero
+
     Inode() {
-        id = 0;
-        file_type = FS_FREE;
-        file_size = 0;
-        uid = 0;          // Default to Root
-        gid = 0;          // Default to Root
+        std::memset(this, 0, sizeof(Inode));
         permissions = 0644; // Default: Owner can read/write, others read only
-        std::memset(direct_blocks, 0, sizeof(direct_blocks));
-        single_indirect = 0;
-        double_indirect = 0;
-        triple_indirect = 0;
     }
 };
 
-struct DirEntry {
-    size_t inode_id;
-    uint8_t name_len;
-    char name[255];
+const size_t INODE_SIZE_SHIFT = 8;
+const size_t INODE_SIZE = size_t(1) << INODE_SIZE_SHIFT;
+const size_t INODES_PER_BLOCK_SHIFT = 12 - INODE_SIZE_SHIFT; // 16 per 4096-byte block
+static_assert(sizeof(Inode) == INODE_SIZE, "Inode must be exactly INODE_SIZE bytes");
+static_assert(offsetof(Inode, direct_blocks) % sizeof(size_t) == 0, "Block pointers must be naturally aligned");
+static_assert(offsetof(Inode, atime) % sizeof(uint64_t) == 0, "Timestamps must be naturally aligned");
+static_assert(alignof(Inode) == 8, "Inode must be naturally aligned");
 
-    DirEntry() : inode_id(0), name_len(0) {
-        std::memset(name, 0, 255);
-    }
+#pragma pack(push, 1)
 
-    DirEntry(size_t id, const char* filename) {
-        inode_id = id;
-        size_t len = std::strlen(filename);
-        if (len > 255) len = 255;
-        name_len = static_cast<uint8_t>(len);
-        std::memset(name, 0, 255);
-        std::memcpy(name, filename, len);
-    }
+// Inode::flags
+const uint32_t INODE_FLAG_EXTENTS = 0x1; // Block pointers hold an InodeExtentTable
+const uint32_t INODE_FLAG_INLINE  = 0x2; // Block pointers hold the contents themselves
+
+// Inline files and fast symlinks keep up to this many bytes in the 15
+// block-pointer words; bytes past file_size stay zero. Regular files start
+// inline (unless extent-mapped) and move to blocks when they outgrow it.
+const size_t INODE_INLINE_CAPACITY = 15 * sizeof(size_t);
+static_assert(offsetof(Inode, triple_indirect) - offsetof(Inode, direct_blocks) == 14 * sizeof(size_t),
+              "Block pointers must be contiguous");
+
+// Extent-mapped files reuse the 15 block-pointer words (direct_blocks and
+// the three indirect roots) as a small table of runs, so a contiguous file
+// needs no pointer blocks at all.
+struct InodeExtent {
+    uint32_t logical;  // First logical block of the run
+    uint32_t length;   // Blocks in the run
+    uint64_t physical; // First physical block of the run
+};
+
+const size_t INODE_MAX_EXTENTS = 7;
+
+struct InodeExtentTable {
+    uint32_t count;    // Live extents, sorted by logical and never overlapping
+    uint32_t reserved;
+    InodeExtent extents[INODE_MAX_EXTENTS];
+};
+
+static_assert(sizeof(InodeExtentTable) <= 15 * sizeof(size_t), "Extent table must fit in the block pointers");
+
+// Per-group allocation summary. Lives in block 0 of every group (group 0
+// shares that block with the SuperBlock) and is kept in sync by
+// BlockGroupManager so the allocator never has to rescan a full group.
+struct GroupDescriptor {
+    uint32_t magic;             // GROUP_DESC_MAGIC once initialized
+    uint32_t flags;             // GROUP_FLAG_* bits
+    uint32_t free_blocks_count; // Free data blocks in this group
+    uint32_t free_inodes_count; // Free inodes in this group
+    uint32_t block_alloc_hint;  // Local bit to resume block scans from
+    uint32_t inode_alloc_hint;  // Local bit to resume inode scans from
+
+    GroupDescriptor() :
+        magic(0),
+        flags(0),
+        free_blocks_count(0),
+        free_inodes_count(0),
+        block_alloc_hint(0),
+        inode_alloc_hint(0) {}
+};
+
+const uint32_t GROUP_DESC_MAGIC = 0x47445343; // "GDSC"
+
+// Lazy format: the group's bitmaps and inode table still hold whatever the
+// image held before. The counters are exact; the group is initialized the
+// first time something is allocated from it.
+const uint32_t GROUP_FLAG_UNINIT = 0x1;
+
+// Variable-length directory record (ext2 style). Records tile the whole
+// block: rec_len is the distance to the next record, so a short name costs
+// only its own bytes and any slack after a record is free space. A record
+// with inode_id == 0 is a free slot.
+struct DirRecord {
+    uint64_t inode_id;
+    uint16_t rec_len;   // Bytes from this record to the next one
+    uint8_t  name_len;
+    uint8_t  reserved;
+    // char name[name_len] follows (not NUL-terminated)
+
+    char* name() { return reinterpret_cast<char*>(this + 1); }
+    const char* name() const { return reinterpret_cast<const char*>(this + 1); }
+};
+
+// Bytes a record needs for a name of `name_len`, rounded up so the next
+// record's inode_id stays 8-byte aligned.
+inline size_t dir_record_size(size_t name_len) {
+    return (sizeof(DirRecord) + name_len + 7) & ~static_cast<size_t>(7);
+}
+
+// Hashed directory index (extendible hashing). Once a directory outgrows
+// one block, its logical block 0 becomes this index and entries move into
+// bucket blocks (logical 1..bucket_count) chosen by the low bits of the
+// name hash. `magic` overlays the first DirRecord's inode_id, so a linear
+// directory (whose first entry is ".") is never mistaken for an index.
+const uint64_t DIR_INDEX_MAGIC = 0x58444E4948534148ULL; // "HASHINDX"
+const uint32_t DIR_INDEX_MAX_DEPTH = 9;
+const uint32_t DIR_INDEX_MAX_SLOTS = 1u << DIR_INDEX_MAX_DEPTH;
+
+struct DirIndexBlock {
+    uint64_t magic;
+    uint32_t global_depth;   // bucket_table has (1 << global_depth) live slots
+    uint32_t bucket_count;   // Buckets occupy logical blocks 1..bucket_count
+    uint32_t entry_count;
+    uint32_t reserved;
+    uint32_t bucket_table[DIR_INDEX_MAX_SLOTS];     // hash slot -> logical block
+    uint8_t  local_depth[DIR_INDEX_MAX_SLOTS + 1];  // indexed by logical block
+};
+
+static_assert(sizeof(DirIndexBlock) <= 4096, "DirIndexBlock must fit in one block");
+
+// Metadata journal (redo log of whole block images). Region layout:
+//   block 0      JournalSuper
+//   block 1..    transactions, each
+//                  [tag block: DESCRIPTOR, then its images] ...
+//                  [tag block: REVOKE] ...
+//                  COMMIT
+// Every record carries the transaction's sequence number; replay starts at
+// block 1 expecting JournalSuper::first_sequence and stops at the first
+// record that does not match or a commit whose checksum fails.
+const uint32_t JOURNAL_MAGIC = 0x4A524E4C; // "JRNL"
+
+enum JOURNAL_BLOCK_TYPES {
+    JOURNAL_SUPER = 1,
+    JOURNAL_DESCRIPTOR = 2, // Home block ids of the images that follow
+    JOURNAL_REVOKE = 3,     // Blocks freed in this transaction
+    JOURNAL_COMMIT = 4
+};
+
+struct JournalBlockHeader {
+    uint32_t magic;
+    uint32_t type;     // JOURNAL_BLOCK_TYPES
+    uint64_t sequence;
 };
 
+struct JournalSuper {
+    JournalBlockHeader header;
+    uint64_t first_sequence; // Sequence of the first live transaction
+};
+
+const size_t JOURNAL_TAGS_PER_BLOCK = (4096 - sizeof(JournalBlockHeader) - 8) / sizeof(uint64_t);
+
+struct JournalTagBlock {
+    JournalBlockHeader header;
+    uint32_t count;
+    uint32_t reserved;
+    uint64_t blocks[JOURNAL_TAGS_PER_BLOCK];
+};
+
+struct JournalCommit {
+    JournalBlockHeader header;
+    uint32_t image_count;
+    uint32_t revoke_count;
+    uint64_t checksum; // FNV-1a over every tag and image of the transaction
+};
+
+static_assert(sizeof(JournalTagBlock) <= 4096, "JournalTagBlock must fit in one block");
+
 #pragma pack(pop)
@@ -0,0 +1,61 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// ==========================================
+// EXTENT CACHE
+// ==========================================
+// Per-inode logical -> physical block map, kept as sorted runs
+// (logical, physical, length). Sequentially allocated files collapse into
+// a handful of runs, so a lookup is a binary search instead of a walk down
+// the indirect tree.
+//
+// Layout: direct-mapped on the inode id; a colliding inode replaces the
+// slot's previous owner, and a slot that grows past MAX_EXTENTS is reset,
+// so memory stays bounded however many large files are touched. Each slot
+// carries its own mutex, so threads working on different files do not
+// serialise on the cache.
+class ExtentCache {
+private:
+    static const size_t MAX_EXTENTS = 1024;
+
+    struct Extent {
+        size_t logical;
+        size_t physical;
+        size_t length;
+    };
+
+    struct Slot {
+        std::mutex lock;
+        bool valid = false;
+        size_t inode_id = 0;
+        std::vector<Extent> extents; // Sorted by logical, never overlapping
+    };
+
+    std::vector<Slot> slots;
+
+    std::atomic<size_t> hits{0};
+    std::atomic<size_t> misses{0};
+
+    Slot& slot_for(size_t inode_id) { return slots[inode_id % slots.size()]; }
+
+public:
+    explicit ExtentCache(size_t slot_count = 256);
+
+    // On a hit stores the physical block and, if run is non-null, how many
+    // blocks from `logical` on are known to be physically contiguous.
+    bool lookup(size_t inode_id, size_t logical, size_t* physical, size_t* run = nullptr);
+
+    // Records that `length` logical blocks from `logical` map to the
+    // contiguous physical blocks starting at `physical`.
+    void insert(size_t inode_id, size_t logical, size_t physical, size_t length = 1);
+
+    void invalidate(size_t inode_id);
+    void clear();
+
+    size_t get_hits() const { return hits; }
+    size_t get_misses() const { return misses; }
+};
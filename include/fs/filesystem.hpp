@@ -1,11 +1,38 @@
 #pragma once
 #include "fs/block_group_manager.hpp"
+#include "fs/dentry_cache.hpp"
 #include "fs/disk.hpp"
+#include "fs/extent_cache.hpp"
+#include "fs/fs_stats.hpp"
 #include "fs/disk_datastructures.hpp"
+#include "fs/inode_locks.hpp"
+#include "fs/journal.hpp"
+#include <atomic>
+#include <condition_variable>
 #include <cstddef>
+#include <functional>
 #include <cstdint>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
+#include <sys/uio.h>
+
+// Flags for FileSystem::open
+enum FS_OPEN_FLAGS {
+    FS_OPEN_READ = 1,
+    FS_OPEN_WRITE = 2,
+    FS_OPEN_APPEND = 4   // write() always lands at the current end of file
+};
+
+// How much of the group metadata mount() touches before returning
+enum class MountMode {
+    Fast, // Superblock, journal replay and descriptor magic; the rest faults in on first use
+    Warm  // Also, per group in parallel: descriptors checked against the bitmaps (and
+          // rebuilt if stale), inode tables pinned, bitmaps and tables faulted in
+};
 
 struct FileEntry {
     std::string name;
@@ -23,60 +50,397 @@ struct FileStats {
     uint16_t permissions;
     size_t file_size;
     FS_FILE_TYPES file_type;
+    uint32_t flags;             // INODE_FLAG_* bits
     std::string symlink_target;
 };
 
+// Result of FileSystem::check. Counts are of problems found before any
+// repair; `repaired` says whether they were then fixed.
+struct CheckReport {
+    size_t groups_checked = 0;   // Initialized groups (lazy ones hold nothing)
+    size_t inodes_in_use = 0;
+    size_t blocks_in_use = 0;    // Data and pointer blocks owned by inodes, plus the journal
+    size_t leaked_blocks = 0;    // Marked used, owned by nothing
+    size_t missing_blocks = 0;   // Owned by an inode, marked free
+    size_t duplicate_blocks = 0; // Claims on a block already owned by another inode
+    size_t bad_pointers = 0;     // Past the disk, into group metadata or an uninitialized group
+    size_t dangling_entries = 0; // Directory entries naming a free inode
+    size_t orphan_inodes = 0;    // Allocated, named by no directory entry
+    size_t bad_counters = 0;     // Groups whose descriptor free counts disagree with the bitmaps
+    bool root_ok = true;         // The root inode is an allocated directory
+    bool repaired = false;
+    double seconds = 0;
+
+    bool clean() const {
+        return root_ok && leaked_blocks == 0 && missing_blocks == 0 && duplicate_blocks == 0 &&
+               bad_pointers == 0 && dangling_entries == 0 && orphan_inodes == 0 && bad_counters == 0;
+    }
+};
+
+// Zero-copy view of a file range (FileSystem::read_view): iovecs pointing
+// straight into the disk image, or into the cache frames holding it, ready
+// for writev / sendmsg. They must not be written through. Holes point at a
+// shared block of zeros.
+//
+// The views stay valid, and the file unchanged, until the lease is released
+// or destroyed: it holds the tree lock and the file's inode lock shared and,
+// behind a buffer cache, a pin on every block it points into. The holding
+// thread must not call into the FileSystem while it holds a lease.
+class ReadLease {
+private:
+    friend class FileSystem;
+    std::shared_lock<std::shared_mutex> tree;
+    InodeGuard guard;
+    Disk* disk = nullptr;
+    std::vector<size_t> pinned; // Cache blocks to unpin
+    std::vector<iovec> views;
+    size_t bytes = 0;
+
+public:
+    ReadLease() = default;
+    ~ReadLease() { release(); }
+    ReadLease(ReadLease&& other) noexcept { *this = std::move(other); } // Leaves `other` empty
+    ReadLease& operator=(ReadLease&& other) noexcept;
+    ReadLease(const ReadLease&) = delete;
+    ReadLease& operator=(const ReadLease&) = delete;
+
+    const std::vector<iovec>& iovecs() const { return views; }
+    size_t size() const { return bytes; }
+    void release();
+};
+
+// Thread safety: every public method may be called concurrently. Operations
+// in different directories / files only meet on the shared tree lock; the
+// block/inode allocators are lock-free. See inode_locks.hpp for the order.
 class FileSystem {
 private:
     Disk& disk;
     SuperBlock* sb;
+    Journal journal;
     std::vector<BlockGroupManager> block_group_managers;
 
+    // (parent, name) -> child lookups, kept coherent by add/remove_entry
+    DentryCache dcache;
+
+    // Sequential-read detection for one handle (see plan_readahead)
+    struct Readahead {
+        size_t next = 0;   // Where a sequential read would start
+        size_t start = 0;  // [start, end): the range hinted so far
+        size_t end = 0;
+        size_t window = 0; // Bytes hinted per step; 0 until reads are sequential
+    };
+
+    // Open-file table; a handle is an index into it
+    struct OpenFile {
+        bool in_use = false;
+        size_t inode_id = 0;
+        int flags = 0;
+        size_t offset = 0; // Position for read()/write()
+        Readahead ra;
+    };
+    std::vector<OpenFile> open_files;
+    std::mutex open_files_lock;
+
+    // logical -> physical runs of file data, shared by paths and handles
+    ExtentCache extent_cache;
+
+    // Counters and latency histograms (compiled out without FS_STATS)
+    FsStats op_stats;
+
+    // Concurrency control
+    std::shared_mutex tree_lock;
+    InodeLockTable inode_locks;
+
+    // Resolves `path` and locks the parent directory in parent_mode and the
+    // entry in target_mode, retrying if the entry changed while unlocked.
+    // Returns the entry's inode, or 0 (parent still locked) when it does not
+    // exist. An empty leaf ("/") never exists.
+    size_t lock_entry(std::string_view path, LockMode parent_mode, LockMode target_mode, InodeGuard& guard,
+                      size_t* parent_id = nullptr, std::string_view* leaf = nullptr);
+    // The same for a parent already resolved (path is only for messages)
+    size_t lock_entry_at(size_t dir_id, std::string_view name, std::string_view path, LockMode parent_mode,
+                         LockMode target_mode, InodeGuard& guard);
+    // One directory lookup under the directory's shared lock; false if
+    // dir_id is not a directory.
+    bool lookup_in_dir(size_t dir_id, std::string_view name, size_t* child_id);
+    bool read_symlink_target(size_t inode_id, std::string& target);
+    // Caller holds the link's lock
+    std::string symlink_target(Inode* link);
+
+    // Caller holds open_files_lock
+    OpenFile& get_open_file(int handle);
+    // Locks the handle's inode and re-checks the handle under that lock
+    Inode* lock_handle(int handle, int required_flag, LockMode mode, InodeGuard& guard, size_t* offset = nullptr);
+    void set_handle_offset(int handle, size_t offset);
+    void invalidate_block_maps(size_t inode_id);
+    void drop_open_handles(size_t inode_id);
+
     // Helpers
     Inode* get_global_inode_ptr(size_t global_id);
-    size_t find_inode_in_dir(Inode* parent_inode, const std::string& name);
-    size_t traverse_path_till_parent(std::vector<std::string>& tokenized_path);
-    void read_direct_block_to_buffer(Inode* file, uint8_t* buffer);
-    void release_file_resources(size_t inode_id, bool free_inode_too);
-    void recursive_resource_release(size_t dir_inode_id);
-    void add_entry_to_dir(Inode* parent_inode, size_t newfile_id, std::string filename);
+    size_t find_inode_in_dir(Inode* parent_inode, std::string_view name);
+    size_t scan_dir_for_name(Inode* parent_inode, std::string_view name);
+    // Resolves every component but the last; `leaf` is set to the last one
+    // (empty for "/"). Views point into `path`, nothing is copied.
+    size_t traverse_path_till_parent(std::string_view path, std::string_view& leaf);
+    size_t parent_of_dir(size_t dir_id);
+
+    // Deletes collect what they free and return it to the bitmaps in bulk:
+    // block ids sorted and coalesced into runs, one bitmap pass per run.
+    struct FreeBatch {
+        std::vector<size_t> blocks;
+        std::vector<size_t> inodes;
+    };
+    void free_batch(FreeBatch& batch);
+    void free_block_range(size_t first_block, size_t count); // May cross groups
+    // With batch == nullptr the resources are freed before returning
+    void release_file_resources(size_t inode_id, bool free_inode_too, FreeBatch* batch = nullptr);
+    void collect_block_tree(size_t block_id, int depth, size_t blocks_left, FreeBatch& batch);
+    void add_entry_to_dir(Inode* parent_inode, size_t newfile_id, std::string_view filename);
+    size_t remove_entry_from_dir(Inode* parent_inode, std::string_view filename);
+
+    // Logical -> physical block mapping shared by files and directories
+    size_t pointers_per_block();
+    size_t max_data_blocks();
+    size_t* get_block_slot(Inode* node, size_t logical_index, bool allocate, size_t* run = nullptr);
+    bool prune_block_tree(size_t* slot, int depth);
+    size_t get_data_block(Inode* node, size_t logical_index, bool allocate);
+
+    // Offset I/O on a resolved inode: only the blocks in range are touched.
+    // `access` may combine read (4) and write (2); the file stays locked in
+    // `mode` for as long as `guard` lives.
+    Inode* resolve_regular_file(std::string_view path, uint16_t access, LockMode mode, InodeGuard& guard);
+    size_t map_file_block(Inode* file, size_t logical_index, size_t* run);
+    std::vector<BlockRun> allocate_file_blocks(Inode* file, size_t logical_index, size_t want, bool zero_fill);
+
+    // Extent-mapped files (INODE_FLAG_EXTENTS)
+    InodeExtentTable* extent_table(Inode* file);
+    size_t extent_lookup(Inode* file, size_t logical_index, size_t* run, uint32_t* pos);
+    size_t extent_allocate(Inode* file, size_t logical_index, size_t want, size_t* run, bool zero_fill);
+    void convert_extents_to_blocks(Inode* file);
+    void truncate_extents(Inode* file, size_t keep_blocks);
+
+    // Inline files and fast symlinks (INODE_FLAG_INLINE)
+    uint8_t* inline_data(Inode* node) { return reinterpret_cast<uint8_t*>(node->direct_blocks); }
+    void convert_inline_to_blocks(Inode* file);
+
+    // Readahead: sequential handle reads hint a window that doubles from
+    // READAHEAD_MIN_BLOCKS to READAHEAD_MAX_BLOCKS; any read of at least
+    // READAHEAD_LARGE_BLOCKS hints its own range.
+    static constexpr size_t READAHEAD_MIN_BLOCKS = 4;
+    static constexpr size_t READAHEAD_MAX_BLOCKS = 256;
+    static constexpr size_t READAHEAD_LARGE_BLOCKS = 64;
+    size_t plan_readahead(int handle, Inode* file, size_t offset, size_t len, size_t* hint_start);
+    size_t plan_large_read(Inode* file, size_t offset, size_t len);
+    void prefetch_file_range(Inode* file, size_t start, size_t end);
+
+    size_t read_inode_range(Inode* file, size_t offset, uint8_t* buf, size_t len);
+    void fill_read_lease(ReadLease& lease, Inode* file, size_t offset, size_t len);
+    size_t write_inode_iovecs(Inode* file, size_t offset, const iovec* iov, int iovcnt);
+    size_t write_inode_range(Inode* file, size_t offset, const uint8_t* buf, size_t len);
+    void truncate_inode(Inode* file, size_t new_size);
+
+    // Directory layout: small directories are a linear run of entry blocks;
+    // larger ones carry a hashed index in logical block 0 (see DirIndexBlock).
+    size_t get_dir_block(Inode* dir, size_t logical_index, bool allocate);
+    DirIndexBlock* get_dir_index(Inode* dir);
+    uint8_t* get_dir_bucket(Inode* dir, DirIndexBlock* index, std::string_view name, size_t* block_id = nullptr);
+    void convert_dir_to_indexed(Inode* dir);
+    void index_insert(Inode* dir, DirIndexBlock* index, size_t inode_id, std::string_view name);
+    void split_dir_bucket(Inode* dir, DirIndexBlock* index, uint32_t bucket);
+    void for_each_dir_entry(Inode* dir, const std::function<void(DirRecord&)>& fn);
+    void release_dir_blocks(Inode* dir, FreeBatch& batch);
+
+    // Allocation across groups: starts at the preferred group (shifted by
+    // the calling thread's affinity, see start_group) and skips any group
+    // whose descriptor reports no free space.
+    int allocate_inode_any(size_t preferred_group);
+    int allocate_block_any(size_t preferred_group);
+    int allocate_run_any(size_t preferred_group, size_t max_len, size_t goal_block, int* run_len, bool zero_fill = true);
+    std::vector<BlockRun> allocate_blocks_any(size_t preferred_group, size_t n, size_t goal_block, bool zero_fill = true);
+    size_t group_of_inode(size_t inode_id) { return inode_id / sb->inodes_per_group; }
+    size_t start_group(size_t preferred_group);
 
     // GEMINI FIX: Added this signature so create_file/dir can use it
-    void create_fs_entry(std::string path, FS_FILE_TYPES type);
+    void create_fs_entry(std::string_view path, FS_FILE_TYPES type, uint32_t flags = 0);
+    void link_new_inode(Inode* parent_inode, size_t new_id, FS_FILE_TYPES type, uint32_t flags, std::string_view filename);
+    FileStats fill_stats(Inode* inode);
+
+    // Batch operations work in chunks: one lock hold, one journal operation
+    // and one walk to the directory per BATCH_CHUNK entries
+    static constexpr size_t BATCH_CHUNK = 256;
+    Inode* lock_batch_dir(std::string_view path, LockMode mode, InodeGuard& guard);
+    std::vector<int> allocate_inodes_any(size_t preferred_group, size_t n);
+
+    // Deferred reclaim: delete_dir only unlinks the tree. Its inodes wait on
+    // the orphan chain (SuperBlock::orphan_head, linked through
+    // Inode::next_orphan) and are reclaimed RECLAIM_CHUNK at a time under
+    // the exclusive tree lock, by the metadata operations that follow or by
+    // a background thread. The chain is journaled with the unlink and with
+    // every chunk, so after a crash mount() finishes the work. Lock order:
+    // tree_lock, then deferred_lock.
+    static constexpr size_t RECLAIM_CHUNK = 256;
+    std::mutex deferred_lock; // Guards the reclaimer's wait
+    std::condition_variable deferred_cv;
+    std::atomic<bool> reclaim_pending{false}; // The orphan chain is not empty
+    std::atomic<bool> background_reclaim{false};
+    bool reclaimer_stop = false;
+    std::thread reclaimer;
+
+    // Caller holds tree_lock exclusively
+    void push_orphan(size_t inode_id);
+    size_t pop_orphan();
+    void set_orphan_head(size_t inode_id);
+    void defer_tree(size_t dir_id);
+    // Caller holds tree_lock exclusively; returns how many inodes it freed
+    size_t reclaim_deferred(size_t max_inodes);
+    void reclaim_all_locked();
+    void finish_orphans_locked(); // mount()
+    void drain_deferred(); // Caller holds no tree lock
+    void reclaimer_loop();
+
+    std::atomic<uint16_t> current_uid{0}; // Default to root (0)
+    std::atomic<uint16_t> current_gid{0};
 
-    uint16_t current_uid = 0; // Default to root (0)
-    uint16_t current_gid = 0;
+    void mount_locked(MountMode mode = MountMode::Fast);
+    void attach_groups_locked();
+    // Runs fn(task) for every task in [0, tasks) on up to one thread per
+    // core; the first exception is rethrown once every task has finished.
+    // Workers that use get_ptr open their own PinScope.
+    static void parallel_for(size_t tasks, const std::function<void(size_t)>& fn);
+
+    // Consistency check (fs_check.cpp): per-group passes on worker threads
+    struct CheckState;
+    bool check_block_pointer(size_t block_id);
+    size_t check_block_tree(CheckState& state, size_t block_id, int depth);
+    size_t check_inode_blocks(CheckState& state, Inode* node);
+    void check_dir_entries(CheckState& state, Inode* dir);
+    void check_group_inodes(CheckState& state, size_t group);
+    void check_group_bitmaps(CheckState& state, size_t group);
+    void repair_check(CheckState& state, CheckReport& report);
+
+    // Journaling: metadata blocks are marked dirty as they are modified;
+    // metadata-changing operations call begin_metadata_op() before taking
+    // the tree lock, which commits the running transaction when it is due.
+    void begin_metadata_op();
+    void journal_inode(size_t inode_id);
+    uint8_t* meta_ptr(size_t block_id); // get_ptr for a block about to be modified
 
     // The core "Gatekeeper" function
     bool check_permission(Inode* node, uint16_t required_bit);
 
 public:
     FileSystem(Disk& disk);
-    ~FileSystem() { delete this->sb; }
+    ~FileSystem();
+
+    // A lazy format writes only the superblock, group 0, the journal and the
+    // root directory; every other group gets an uninitialized descriptor and
+    // is set up on first use. A full format zeroes the whole image first.
+    void format(bool lazy = false);
+    // The time taken is recorded as FsOp::Mount
+    void mount(MountMode mode = MountMode::Fast);
+
+    // The allocation and directory invariants of docs/invariants.md, checked
+    // across every group (one task per group on a pool of worker threads):
+    // bitmaps rebuilt from the inode tables against the ones on disk, the
+    // descriptor counters, and directory entries against the inode bitmaps.
+    // Runs with the whole file system locked, after any deferred frees.
+    //
+    // repair rewrites the bitmaps and counters to match what the inodes own
+    // and drops dangling entries. Orphans (with everything under them) are
+    // freed too, unless a block map was damaged or shared: those are only
+    // reported. The result is checkpointed before check() returns.
+    CheckReport check(bool repair = false);
+
+    // Commits the running journal transaction and flushes every dirty block,
+    // none of them ahead of its commit: every operation that returned before
+    // sync() survives a crash.
+    void sync(SyncMode mode = SyncMode::Wait);
+    // Flushes only this file's dirty data blocks, then commits the journal
+    // (which holds its inode). Async schedules the data writeback without
+    // waiting; the commit itself is always synchronous.
+    void fsync(std::string_view path, SyncMode mode = SyncMode::Wait);
+
+    // use_extents maps the file by (start, length) runs instead of block
+    // pointers; see InodeExtentTable.
+    void create_file(std::string_view path, bool use_extents = false);
+    void write_file(std::string_view path, const std::vector<uint8_t>& data);
+    void delete_file(std::string_view path);
+    std::vector<uint8_t> read_file(std::string_view path);
 
-    void format();
-    void mount();
+    // pread/pwrite-style access: read_at stops at EOF and returns the bytes
+    // copied; write_at may extend the file, leaving a hole before offset.
+    size_t read_at(std::string_view path, size_t offset, uint8_t* buf, size_t len);
+    size_t write_at(std::string_view path, size_t offset, const uint8_t* buf, size_t len);
+    size_t append(std::string_view path, const uint8_t* buf, size_t len);
+    void truncate(std::string_view path, size_t new_size);
 
-    void create_file(std::string path);
-    void write_file(std::string path, const std::vector<uint8_t>& data);
-    void delete_file(std::string path);
-    std::vector<uint8_t> read_file(std::string path);
+    // Handles: the path is resolved and permissions are checked once, at
+    // open(); I/O through the handle reuses the inode and its block map.
+    int open(std::string_view path, int flags);
+    void close(int handle);
+    size_t read(int handle, uint8_t* buf, size_t len);
+    size_t write(int handle, const uint8_t* buf, size_t len);
+    size_t read_at(int handle, size_t offset, uint8_t* buf, size_t len);
+    size_t write_at(int handle, size_t offset, const uint8_t* buf, size_t len);
+    void seek(int handle, size_t offset);
 
-    void create_dir(std::string path);
-    void delete_dir(std::string path);
-    void create_symlink(std::string target, std::string link_path);
-    FileStats get_stats(std::string path);
+    // Zero-copy reads: up to len bytes from offset (stopping at EOF) as
+    // views into the image, held by the returned lease (see ReadLease). The
+    // handle form leaves the handle's offset alone, like read_at.
+    ReadLease read_view(std::string_view path, size_t offset = 0, size_t len = SIZE_MAX);
+    ReadLease read_view(int handle, size_t offset, size_t len);
+    // Gather writes: the iovecs land back to back as one range, under one
+    // lock and one journal operation. writev advances the handle's offset
+    // (or appends, with FS_OPEN_APPEND); pwritev leaves it alone.
+    size_t writev(int handle, const iovec* iov, int iovcnt);
+    size_t pwritev(int handle, size_t offset, const iovec* iov, int iovcnt);
+
+    void create_dir(std::string_view path);
+    void delete_dir(std::string_view path);
+    void create_symlink(std::string_view target, std::string_view link_path);
+    FileStats get_stats(std::string_view path);
 
     // CHANGE THE RETURN TYPE HERE
     // From std::vector<std::string> to std::vector<FileEntry>
-    std::vector<FileEntry> list_dir(std::string path, bool include_special = false);
+    std::vector<FileEntry> list_dir(std::string_view path, bool include_special = false);
+
+    // Batch metadata operations for bulk restores: no per-entry output,
+    // inodes claimed in runs, the directory resolved once per chunk.
+    // create_many adds `names` (plain entry names) to the directory at
+    // `parent` and returns their inode ids in order. Needs write permission
+    // on `parent`. It stops at the first name that is invalid or exists and
+    // throws; the entries before it stay created.
+    std::vector<size_t> create_many(std::string_view parent, const std::vector<std::string>& names,
+                                    FS_FILE_TYPES type = FS_FILE);
+    // One FileStats per path; a path whose last component does not exist
+    // yields inode_id 0 instead of an exception
+    std::vector<FileStats> stat_many(const std::vector<std::string>& paths);
+    // Removes files and symlinks by name, skipping names that do not exist;
+    // returns how many were removed
+    size_t unlink_many(std::string_view parent, const std::vector<std::string>& names);
+
+    // Operation counters and latency histograms since construction (or the
+    // last reset_stats); enabled == false when built without FS_STATS
+    FsStatsSnapshot stats();
+    void reset_stats();
+
+    // Removed trees are reclaimed after delete_dir returns: inline, a chunk
+    // per later metadata operation, or on a background thread when enabled.
+    // sync(), mount(), unmount and the free counters wait for all of it; a
+    // crash before then leaves the tree's space allocated but unreferenced.
+    void set_background_reclaim(bool enabled);
+    void reclaim_deferred_frees();
+
+    // Free space summary (from the group descriptors)
+    size_t get_free_block_count();
+    size_t get_free_inode_count();
 
     // Session Management
     void login(uint16_t uid, uint16_t gid);
     void logout();
     uint16_t get_current_user() { return current_uid; }
 
-    void chmod(std::string path, uint16_t mode);
-    void chown(std::string path, uint16_t uid);
-    void chgrp(std::string path, uint16_t gid);
+    void chmod(std::string_view path, uint16_t mode);
+    void chown(std::string_view path, uint16_t uid);
+    void chgrp(std::string_view path, uint16_t gid);
 };
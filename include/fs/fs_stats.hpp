@@ -0,0 +1,132 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Set by the FS_STATS CMake option (ON by default). With it off the
+// recording macros below expand to nothing and snapshots report
+// enabled == false.
+#ifndef FS_ENABLE_STATS
+#define FS_ENABLE_STATS 0
+#endif
+
+// ==========================================
+// OPERATION STATISTICS
+// ==========================================
+// Per-operation counters and latency histograms kept by FileSystem, plus
+// bitmap scan lengths from the block group allocators. Recording is a few
+// relaxed atomic adds; FileSystem::stats() takes a snapshot.
+
+enum class FsOp {
+    Lookup,        // One name in one directory (dentry cache or scan)
+    PathWalk,      // Every component but the last of a path
+    AllocateInode, // One run of inodes claimed in a group
+    AllocateBlock, // One run of blocks claimed in a group
+    Read,          // One read of a file range
+    Write,         // One write of a file range
+    Mount,         // One mount(), journal replay and warm-up included
+    Count
+};
+
+const char* fs_op_name(FsOp op);
+
+// Power-of-two buckets: bucket i counts values in [2^i, 2^(i+1)), with 0
+// and 1 both in bucket 0.
+struct HistogramSnapshot {
+    static constexpr size_t BUCKETS = 48;
+
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+    uint64_t buckets[BUCKETS] = {};
+
+    double mean() const { return count == 0 ? 0.0 : static_cast<double>(sum) / count; }
+    // Upper bound of the bucket holding the p-th percentile (0 < p <= 100),
+    // capped at the largest value seen
+    uint64_t percentile(double p) const;
+};
+
+class Log2Histogram {
+private:
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> max{0};
+    std::atomic<uint64_t> buckets[HistogramSnapshot::BUCKETS] = {};
+
+public:
+    void record(uint64_t value);
+    HistogramSnapshot snapshot() const;
+    void reset();
+};
+
+struct FsStatsSnapshot {
+    bool enabled = false;
+    HistogramSnapshot ops[static_cast<size_t>(FsOp::Count)]; // Latencies in nanoseconds
+    uint64_t bytes_read = 0;
+    uint64_t bytes_written = 0;
+    uint64_t readahead_blocks = 0;      // Blocks hinted ahead of a read
+    uint64_t descriptors_rebuilt = 0;   // Group descriptors a mount found stale
+    HistogramSnapshot bitmap_scan_bits; // Bits examined per free-bit search
+    uint64_t dentry_hits = 0;
+    uint64_t dentry_misses = 0;
+
+    const HistogramSnapshot& op(FsOp o) const { return ops[static_cast<size_t>(o)]; }
+    double dentry_hit_rate() const {
+        uint64_t total = dentry_hits + dentry_misses;
+        return total == 0 ? 0.0 : static_cast<double>(dentry_hits) / total;
+    }
+};
+
+class FsStats {
+private:
+    Log2Histogram ops[static_cast<size_t>(FsOp::Count)];
+    std::atomic<uint64_t> bytes_read{0};
+    std::atomic<uint64_t> bytes_written{0};
+    std::atomic<uint64_t> readahead_blocks{0};
+    std::atomic<uint64_t> descriptors_rebuilt{0};
+    Log2Histogram bitmap_scan_bits;
+
+public:
+    void record_op(FsOp op, uint64_t nanoseconds) { ops[static_cast<size_t>(op)].record(nanoseconds); }
+    void add_bytes_read(uint64_t n) { bytes_read.fetch_add(n, std::memory_order_relaxed); }
+    void add_bytes_written(uint64_t n) { bytes_written.fetch_add(n, std::memory_order_relaxed); }
+    void add_readahead(uint64_t blocks) { readahead_blocks.fetch_add(blocks, std::memory_order_relaxed); }
+    void add_descriptors_rebuilt(uint64_t n) { descriptors_rebuilt.fetch_add(n, std::memory_order_relaxed); }
+    void record_bitmap_scan(uint64_t bits) { bitmap_scan_bits.record(bits); }
+
+    // Dentry counters live in the DentryCache; the caller fills them in
+    FsStatsSnapshot snapshot() const;
+    void reset();
+};
+
+// Times the enclosing scope into stats (may be null)
+class FsOpTimer {
+private:
+    FsStats* stats;
+    FsOp op;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    FsOpTimer(FsStats* stats, FsOp op) : stats(stats), op(op) {
+        if (stats != nullptr) start = std::chrono::steady_clock::now();
+    }
+    ~FsOpTimer() {
+        if (stats == nullptr) return;
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        stats->record_op(op, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+    FsOpTimer(const FsOpTimer&) = delete;
+    FsOpTimer& operator=(const FsOpTimer&) = delete;
+};
+
+#define FS_STATS_CONCAT_(a, b) a##b
+#define FS_STATS_CONCAT(a, b) FS_STATS_CONCAT_(a, b)
+
+#if FS_ENABLE_STATS
+#define FS_STATS_TIMER(stats, op) FsOpTimer FS_STATS_CONCAT(fs_op_timer_, __LINE__)((stats), (op))
+#define FS_STATS_RECORD(stats, call) do { if ((stats) != nullptr) (stats)->call; } while (0)
+#else
+#define FS_STATS_TIMER(stats, op) ((void)0)
+#define FS_STATS_RECORD(stats, call) ((void)0)
+#endif
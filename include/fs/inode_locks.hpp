@@ -0,0 +1,67 @@
+#pragma once
+#include <cstddef>
+#include <shared_mutex>
+#include <vector>
+
+// ==========================================
+// INODE LOCKS
+// ==========================================
+// Reader/writer locks for inode contents (file data, directory entries,
+// size and mode). Locks are striped: inode ids hash onto a fixed table, so
+// memory does not grow with the inode count, at the cost of two inodes
+// sometimes sharing a lock.
+//
+// Lock order inside FileSystem (outermost first):
+//   1. FileSystem::tree_lock   - shared by every operation, exclusive for
+//                                format/mount/delete_dir
+//   2. inode stripes           - a path walk holds one stripe at a time;
+//                                an operation needing two inodes takes both
+//                                through one InodeGuard (lower stripe first)
+//                                and re-validates what it looked up unlocked
+//   3. leaf mutexes            - DentryCache / ExtentCache / open-file table
+// Block and inode allocation takes no lock at all (atomic bitmap words in
+// BlockGroupManager), so it may run under any of the above.
+class InodeLockTable {
+private:
+    std::vector<std::shared_mutex> stripes;
+
+public:
+    explicit InodeLockTable(size_t stripe_count = 1024);
+
+    size_t stripe_of(size_t inode_id) const { return inode_id % stripes.size(); }
+    std::shared_mutex& lock_for(size_t inode_id) { return stripes[stripe_of(inode_id)]; }
+};
+
+enum class LockMode { Shared, Exclusive };
+
+// Holds the locks of one or two inodes. Two inodes are locked in stripe
+// order so concurrent guards cannot deadlock; inodes sharing a stripe lock
+// it once, in the stronger of the two modes.
+class InodeGuard {
+private:
+    struct Held {
+        std::shared_mutex* lock = nullptr;
+        bool exclusive = false;
+        size_t stripe = 0;
+    };
+    Held held[2];
+
+    static void acquire(Held& h);
+    static void release(Held& h);
+
+public:
+    InodeGuard() = default;
+    InodeGuard(InodeLockTable& table, size_t inode_id, LockMode mode);
+    InodeGuard(InodeLockTable& table, size_t a, LockMode mode_a, size_t b, LockMode mode_b);
+    ~InodeGuard() { unlock(); }
+
+    InodeGuard(InodeGuard&& other) noexcept;
+    InodeGuard& operator=(InodeGuard&& other) noexcept;
+    InodeGuard(const InodeGuard&) = delete;
+    InodeGuard& operator=(const InodeGuard&) = delete;
+
+    // Drops the stripe of one inode early (e.g. a parent directory once the
+    // target is pinned). A no-op if the other inode shares that stripe.
+    void unlock_inode(InodeLockTable& table, size_t inode_id);
+    void unlock();
+};
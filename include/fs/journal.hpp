@@ -0,0 +1,99 @@
+#pragma once
+#include "fs/disk.hpp"
+#include "fs/disk_datastructures.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// ==========================================
+// METADATA JOURNAL
+// ==========================================
+// Write-ahead redo log for metadata blocks (bitmaps, group descriptors,
+// inode tables, directory and indirect blocks). Operations keep updating
+// blocks in place and only mark them dirty here; commit() then logs the
+// current image of every dirty block, plus the blocks freed meanwhile, as
+// one transaction behind a checksummed commit record, and syncs just the
+// journal range. Many operations share one transaction and one sync
+// (group commit). mount() replays committed transactions, so bitmaps and
+// directories come back consistent with the last commit.
+//
+// Write-ahead order: every block of the running transaction is held on the
+// Disk (Disk::hold), so no flush or eviction can write it home before the
+// commit record is durable. Home blocks therefore only ever hold committed
+// contents, and replay never lays an older image over a newer block.
+//
+// File data is not journaled (like data=writeback).
+//
+// Freed blocks are logged as revokes: an image from an earlier transaction
+// is not replayed over a block freed later, which may hold file data by
+// then. The last event wins inside one transaction: a block freed and then
+// reused as metadata is logged as an image; freed and left free, or reused
+// as data, as a revoke.
+//
+// mark_dirty / revoke / note_operation are lock-free; everything else
+// expects the caller to have stopped all metadata updates (FileSystem holds
+// its tree lock exclusively).
+class Journal {
+private:
+    Disk& disk;
+    size_t start = 0;        // First block of the region
+    size_t capacity = 0;     // Blocks in the region (0 = no journal)
+    size_t head = 1;         // Next free block, relative to start
+    uint64_t sequence = 1;   // Sequence of the next transaction
+    uint64_t first_sequence = 1;
+
+    // One bit per disk block for the running transaction
+    std::vector<std::atomic<uint64_t>> dirty;
+    std::vector<std::atomic<uint64_t>> revoked;
+    std::atomic<size_t> dirty_count{0};
+    std::atomic<size_t> pending_ops{0};
+
+    // Home block -> journal block (relative) of its newest image in the log
+    std::unordered_map<size_t, size_t> logged;
+
+    size_t commit_count = 0;
+    size_t logged_blocks = 0;
+
+    void reset_tracking(size_t total_blocks);
+    std::vector<size_t> drain(std::vector<std::atomic<uint64_t>>& bits);
+    void write_super();
+    // Makes the home blocks hold everything committed, then empties the log.
+    // `running` is the transaction being committed: its blocks are still
+    // held, so their logged images are written home instead of memory.
+    void checkpoint_committed(const std::vector<size_t>& running);
+    bool in_region(size_t block) const { return block >= start && block < start + capacity; }
+
+public:
+    // Commit once this many operations or this share of the region is pending
+    static const size_t COMMIT_OPS = 64;
+    static const size_t COMMIT_FILL_DIVISOR = 4;
+
+    explicit Journal(Disk& disk) : disk(disk) {}
+
+    // format(): lays out an empty journal in [start_block, start_block + blocks)
+    void create(size_t start_block, size_t blocks);
+    // mount(): attaches to the region and replays committed transactions onto
+    // their home blocks. Returns how many transactions were replayed.
+    size_t recover(size_t start_block, size_t blocks);
+
+    bool enabled() const { return capacity > 0; }
+
+    void mark_dirty(size_t block_id);
+    void revoke(size_t block_id);
+    void note_operation() { pending_ops.fetch_add(1, std::memory_order_relaxed); }
+    bool should_commit() const;
+
+    // Logs the running transaction, syncs it and releases its holds. When
+    // the region is full the earlier transactions are checkpointed first. A
+    // transaction larger than the whole region is written in place instead,
+    // which is not atomic.
+    void commit();
+    // Commits the running transaction, flushes every home block, then
+    // empties the journal.
+    void checkpoint();
+
+    size_t get_commit_count() const { return commit_count; }
+    size_t get_logged_blocks() const { return logged_blocks; }
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <sstream>
+#include <string>
+
+enum class LogLevel { Debug, Info, Warning, Error, Silent };
+
+// ==========================================
+// LOGGER
+// ==========================================
+// Where fs_core reports what it did ("File 'a' created.", mount summaries,
+// journal replays, shutdown errors). No sink is installed by default, so
+// the library is silent; an application (the fs_sim REPL) subscribes one.
+//
+// A message below the threshold costs one relaxed atomic load: its text is
+// only formatted when it is going to be delivered. Sinks are called one at
+// a time, under a mutex, from whichever thread logged.
+class Logger {
+public:
+    using Sink = std::function<void(LogLevel, const std::string&)>;
+
+    static void set_sink(Sink sink, LogLevel min_level = LogLevel::Info);
+    static void clear_sink();
+
+    static bool enabled(LogLevel level) {
+        return static_cast<int>(level) >= threshold.load(std::memory_order_relaxed);
+    }
+
+    // Streams the arguments into one message: Logger::log(LogLevel::Info, "Deleted ", name)
+    template <typename... Args>
+    static void log(LogLevel level, const Args&... args) {
+        if (!enabled(level)) return;
+        std::ostringstream out;
+        (out << ... << args);
+        deliver(level, out.str());
+    }
+
+private:
+    static inline std::atomic<int> threshold{static_cast<int>(LogLevel::Silent)};
+    static void deliver(LogLevel level, const std::string& message);
+};
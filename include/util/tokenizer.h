@@ -1,4 +1,33 @@
+#pragma once
+#include <algorithm>
 #include <string>
+#include <string_view>
 #include <vector>
 
-std::vector<std::string> tokenize_path(const std::string& input, char delimiter);
+// Walks the components of a delimited path in place. Components are views
+// into the caller's string, so the string must outlive the iterator; empty
+// components ("//", leading or trailing '/') are skipped.
+class PathIterator {
+private:
+    std::string_view rest;
+    char delimiter;
+
+public:
+    explicit PathIterator(std::string_view path, char delimiter = '/')
+        : rest(path), delimiter(delimiter) {}
+
+    // Stores the next component and returns true, or returns false at the end.
+    bool next(std::string_view& component) {
+        while (!rest.empty()) {
+            size_t end = rest.find(delimiter);
+            if (end == std::string_view::npos) end = rest.size();
+            component = rest.substr(0, end);
+            rest.remove_prefix(std::min(end + 1, rest.size()));
+            if (!component.empty()) return true;
+        }
+        return false;
+    }
+};
+
+// Allocating convenience wrapper, same component rules as PathIterator.
+std::vector<std::string> tokenize_path(std::string_view input, char delimiter);
@@ -0,0 +1,310 @@
+#include "fs/bitmap_scan.hpp"
+#include <cstring> // for memcpy
+#include <algorithm> // for std::min
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FS_HAVE_AVX2_SCAN 1
+#endif
+
+// The atomic AVX2 scan reads lanes with plain vector loads, which
+// ThreadSanitizer reports as races with the compare-exchanges
+#if defined(__SANITIZE_THREAD__)
+#define FS_TSAN_BUILD 1
+#elif defined(__has_feature)
+#if __has_feature(thread_sanitizer)
+#define FS_TSAN_BUILD 1
+#endif
+#endif
+
+// ==========================================
+// WORD HELPERS
+// ==========================================
+// Loads 64 bitmap bits starting at bit (word_index * 64). memcpy keeps the
+// load legal for any alignment; compilers turn it into a single mov.
+static inline uint64_t load_word(const uint8_t* bitmap, int word_index) {
+    uint64_t word;
+    std::memcpy(&word, bitmap + (word_index * 8), sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+}
+
+// Scans whole words in [first_word, last_word) and returns the first clear
+// bit index (unbounded by max_bits; the caller clamps it).
+static inline int scan_words(const uint8_t* bitmap, int first_word, int last_word) {
+    for (int w = first_word; w < last_word; w++) {
+        uint64_t free_bits = ~load_word(bitmap, w);
+        if (free_bits != 0) {
+            return (w * 64) + __builtin_ctzll(free_bits);
+        }
+    }
+    return -1;
+}
+
+// Handles the partial first word (bits below start_bit are masked off) and
+// returns either a hit or the index of the next word to scan via *next_word.
+static inline int scan_head(const uint8_t* bitmap, int start_bit, int* next_word) {
+    int w = start_bit / 64;
+    uint64_t free_bits = ~load_word(bitmap, w) & (~0ULL << (start_bit % 64));
+    *next_word = w + 1;
+    if (free_bits != 0) return (w * 64) + __builtin_ctzll(free_bits);
+    return -1;
+}
+
+static inline int clamp_result(int bit, int max_bits) {
+    return (bit >= 0 && bit < max_bits) ? bit : -1;
+}
+
+// Atomic counterparts for bitmaps shared without a lock (8-byte aligned).
+// Word w holds bits [w * 64, w * 64 + 64) in the byte order described in
+// bitmap_scan.hpp, i.e. a little-endian 64-bit integer.
+static inline uint64_t atomic_load_word(const uint8_t* bitmap, int word_index) {
+    uint64_t word = __atomic_load_n(reinterpret_cast<const uint64_t*>(bitmap) + word_index, __ATOMIC_ACQUIRE);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+}
+
+// Bits of word w that lie below max_bits
+static inline uint64_t valid_bits(int word_index, int max_bits) {
+    int remaining = max_bits - word_index * 64;
+    return remaining >= 64 ? ~0ULL : ((1ULL << remaining) - 1);
+}
+
+// Atomic loads of words [first_word, last_word); `mask` applies to the
+// first of them. Never reports a bit at or past max_bits.
+static inline int atomic_scan_words(const uint8_t* bitmap, int first_word, int last_word, int max_bits,
+                                    uint64_t mask) {
+    for (int w = first_word; w < last_word; w++) {
+        uint64_t free_bits = ~atomic_load_word(bitmap, w) & mask & valid_bits(w, max_bits);
+        if (free_bits != 0) return (w * 64) + __builtin_ctzll(free_bits);
+        mask = ~0ULL;
+    }
+    return -1;
+}
+
+// ==========================================
+// SCALAR ENGINE
+// ==========================================
+int bitmap_find_first_zero_scalar(const uint8_t* bitmap, int max_bits, int start_bit) {
+    if (start_bit < 0) start_bit = 0;
+    if (start_bit >= max_bits) return -1;
+
+    int total_words = (max_bits + 63) / 64;
+    int next_word = 0;
+
+    int hit = scan_head(bitmap, start_bit, &next_word);
+    if (hit != -1) return clamp_result(hit, max_bits);
+
+    return clamp_result(scan_words(bitmap, next_word, total_words), max_bits);
+}
+
+int bitmap_find_first_zero_atomic_scalar(const uint8_t* bitmap, int max_bits, int start_bit) {
+    if (start_bit < 0) start_bit = 0;
+    if (start_bit >= max_bits) return -1;
+    return atomic_scan_words(bitmap, start_bit / 64, (max_bits + 63) / 64, max_bits, ~0ULL << (start_bit % 64));
+}
+
+// ==========================================
+// AVX2 ENGINE
+// ==========================================
+#ifdef FS_HAVE_AVX2_SCAN
+__attribute__((target("avx2")))
+static int bitmap_find_first_zero_avx2(const uint8_t* bitmap, int max_bits, int start_bit) {
+    if (start_bit < 0) start_bit = 0;
+    if (start_bit >= max_bits) return -1;
+
+    int total_words = (max_bits + 63) / 64;
+    int next_word = 0;
+
+    int hit = scan_head(bitmap, start_bit, &next_word);
+    if (hit != -1) return clamp_result(hit, max_bits);
+
+    // Walk single words until we reach a 256-bit (4 word) lane boundary.
+    int lane_start = (next_word + 3) & ~3;
+    if (lane_start > total_words) lane_start = total_words;
+    hit = scan_words(bitmap, next_word, lane_start);
+    if (hit != -1) return clamp_result(hit, max_bits);
+
+    // Skip fully allocated 256-bit lanes; testc is 1 when every bit is set.
+    const __m256i all_ones = _mm256_set1_epi8(static_cast<char>(0xFF));
+    int w = lane_start;
+    for (; w + 4 <= total_words; w += 4) {
+        __m256i lane = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bitmap + (w * 8)));
+        if (!_mm256_testc_si256(lane, all_ones)) {
+            return clamp_result(scan_words(bitmap, w, w + 4), max_bits);
+        }
+    }
+
+    return clamp_result(scan_words(bitmap, w, total_words), max_bits);
+}
+
+// Full lanes are skipped with one vector load each; the lane holding a
+// candidate is re-read word by word with atomic loads, so the bit reported
+// was clear when it was looked at, as with the scalar scan. The vector
+// loads themselves are not atomic: a bit freed while its lane is read may
+// be missed, which a candidate scan allows anyway (a rescan finds it).
+__attribute__((target("avx2")))
+static int bitmap_find_first_zero_atomic_avx2(const uint8_t* bitmap, int max_bits, int start_bit) {
+    if (start_bit < 0) start_bit = 0;
+    if (start_bit >= max_bits) return -1;
+
+    int total_words = (max_bits + 63) / 64;
+    int first_word = start_bit / 64;
+
+    // The partial first word, then single words up to a lane boundary
+    int lane_start = std::min((first_word + 4) & ~3, total_words);
+    int hit = atomic_scan_words(bitmap, first_word, lane_start, max_bits, ~0ULL << (start_bit % 64));
+    if (hit != -1) return hit;
+
+    const __m256i all_ones = _mm256_set1_epi8(static_cast<char>(0xFF));
+    int w = lane_start;
+    for (; w + 4 <= total_words; w += 4) {
+        __m256i lane = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bitmap + (w * 8)));
+        if (_mm256_testc_si256(lane, all_ones)) continue;
+        hit = atomic_scan_words(bitmap, w, w + 4, max_bits, ~0ULL);
+        if (hit != -1) return hit; // Otherwise claimed since the vector load
+    }
+    return atomic_scan_words(bitmap, w, total_words, max_bits, ~0ULL);
+}
+#endif
+
+// ==========================================
+// RUNTIME DISPATCH
+// ==========================================
+using ScanFn = int (*)(const uint8_t*, int, int);
+
+struct ScanEngine {
+    ScanFn fn;
+    ScanFn atomic_fn;
+    const char* name;
+};
+
+static ScanEngine select_engine() {
+#ifdef FS_HAVE_AVX2_SCAN
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+#ifdef FS_TSAN_BUILD
+        return {bitmap_find_first_zero_avx2, bitmap_find_first_zero_atomic_scalar, "avx2"};
+#else
+        return {bitmap_find_first_zero_avx2, bitmap_find_first_zero_atomic_avx2, "avx2"};
+#endif
+    }
+#endif
+    return {bitmap_find_first_zero_scalar, bitmap_find_first_zero_atomic_scalar, "scalar"};
+}
+
+static const ScanEngine& engine() {
+    static const ScanEngine selected = select_engine();
+    return selected;
+}
+
+int bitmap_find_first_zero(const uint8_t* bitmap, int max_bits, int start_bit) {
+    return engine().fn(bitmap, max_bits, start_bit);
+}
+
+int bitmap_find_first_zero_atomic(const uint8_t* bitmap, int max_bits, int start_bit) {
+    return engine().atomic_fn(bitmap, max_bits, start_bit);
+}
+
+const char* bitmap_scan_engine_name() {
+    return engine().name;
+}
+
+// ==========================================
+// COUNTING
+// ==========================================
+int bitmap_count_zeros(const uint8_t* bitmap, int max_bits, int start_bit) {
+    if (start_bit < 0) start_bit = 0;
+    if (start_bit >= max_bits) return 0;
+
+    int first_word = start_bit / 64;
+    int last_word  = (max_bits - 1) / 64;
+    int zeros = 0;
+
+    for (int w = first_word; w <= last_word; w++) {
+        uint64_t free_bits = ~load_word(bitmap, w);
+        if (w == first_word) free_bits &= (~0ULL << (start_bit % 64));
+        if (w == last_word && (max_bits % 64) != 0) free_bits &= (~0ULL >> (64 - (max_bits % 64)));
+        zeros += __builtin_popcountll(free_bits);
+    }
+    return zeros;
+}
+
+// ==========================================
+// ATOMIC OPERATIONS
+// ==========================================
+static inline uint64_t* word_ptr(uint8_t* bitmap, int word_index) {
+    return reinterpret_cast<uint64_t*>(bitmap) + word_index;
+}
+
+// Bit mask in the word's in-memory representation
+static inline uint64_t native_mask(uint64_t mask) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    mask = __builtin_bswap64(mask);
+#endif
+    return mask;
+}
+
+int bitmap_claim_run(uint8_t* bitmap, int max_bits, int start_bit, int max_len) {
+    if (start_bit < 0 || start_bit >= max_bits || max_len <= 0) return 0;
+    max_len = std::min(max_len, max_bits - start_bit);
+
+    int claimed = 0;
+    int bit = start_bit;
+    while (claimed < max_len) {
+        int w = bit / 64;
+        int pos = bit % 64;
+        uint64_t* target = word_ptr(bitmap, w);
+        uint64_t expected = __atomic_load_n(target, __ATOMIC_RELAXED);
+
+        while (true) {
+            uint64_t word = native_mask(expected); // Back to logical bit order
+            // Clear bits from pos upward, capped by the word and the request
+            uint64_t above = word >> pos;
+            int len = (above == 0) ? 64 - pos : __builtin_ctzll(above);
+            len = std::min(len, max_len - claimed);
+            if (len == 0) return claimed;
+
+            uint64_t run = (len == 64) ? ~0ULL : (((1ULL << len) - 1) << pos);
+            uint64_t desired = expected | native_mask(run);
+            if (__atomic_compare_exchange_n(target, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                claimed += len;
+                bit += len;
+                break;
+            }
+            // Lost a race on this word: `expected` now holds the fresh value
+        }
+
+        // The run only continues into the next word from its bit 0
+        if (bit % 64 != 0) break;
+    }
+    return claimed;
+}
+
+bool bitmap_test_bit_atomic(const uint8_t* bitmap, int bit) {
+    return (atomic_load_word(bitmap, bit / 64) >> (bit % 64)) & 1;
+}
+
+bool bitmap_release_bit(uint8_t* bitmap, int bit) {
+    uint64_t mask = native_mask(1ULL << (bit % 64));
+    uint64_t before = __atomic_fetch_and(word_ptr(bitmap, bit / 64), ~mask, __ATOMIC_ACQ_REL);
+    return (before & mask) != 0;
+}
+
+int bitmap_release_run(uint8_t* bitmap, int start_bit, int count) {
+    int released = 0;
+    for (int bit = start_bit; bit < start_bit + count; ) {
+        int pos = bit % 64;
+        int len = std::min(64 - pos, start_bit + count - bit);
+        uint64_t run = (len == 64) ? ~0ULL : (((1ULL << len) - 1) << pos);
+        uint64_t mask = native_mask(run);
+        uint64_t before = __atomic_fetch_and(word_ptr(bitmap, bit / 64), ~mask, __ATOMIC_ACQ_REL);
+        released += __builtin_popcountll(before & mask);
+        bit += len;
+    }
+    return released;
+}
@@ -1,6 +1,13 @@
 #include "fs/block_group_manager.hpp"
+#include "fs/bitmap_scan.hpp"
 #include <stdexcept>
 #include <cstring> // for memset
+#include <algorithm> // for std::min
+#include <mutex>
+
+// Serializes lazy group initialization; groups share stripes
+static const size_t LAZY_INIT_STRIPES = 16;
+static std::mutex lazy_init_locks[LAZY_INIT_STRIPES];
 
 // ==========================================
 // POINTER HELPERS
@@ -20,6 +27,14 @@ uint8_t* BlockGroupManager::get_inode_table_start() {
     return disk.get_ptr(block_id);
 }
 
+void BlockGroupManager::pin_inode_table() {
+    if (!is_initialized()) return; // Pinned when the group is initialized
+    size_t first = static_cast<size_t>(group_id) * sb->blocks_per_group + INODE_TABLE_OFFSET;
+    size_t count = first_data_block_bit() - INODE_TABLE_OFFSET;
+    if (first >= disk.get_block_count()) return;
+    disk.pin_region(first, std::min(count, disk.get_block_count() - first));
+}
+
 // ==========================================
 // INODE LOGIC
 // ==========================================
@@ -34,101 +49,370 @@ Inode* BlockGroupManager::get_inode(int inode_id) {
 
     int local_index = inode_id % inodes_per_group;
     uint8_t* table_start = get_inode_table_start();
-    size_t byte_offset = local_index * sizeof(Inode);
+    size_t byte_offset = static_cast<size_t>(local_index) << INODE_SIZE_SHIFT;
 
     return reinterpret_cast<Inode*>(table_start + byte_offset);
 }
 
+// Inodes never straddle table blocks (INODE_SIZE divides the block size)
+void BlockGroupManager::journal_inode(int global_inode_id) {
+    mark_dirty(get_block_id_for_inode(global_inode_id));
+}
+
+// The bitmap block and the descriptor (group block 0) change together
+void BlockGroupManager::journal_bitmap(int bitmap_offset) {
+    size_t group_start = group_id * sb->blocks_per_group;
+    mark_dirty(group_start + bitmap_offset);
+    mark_dirty(group_start);
+}
+
 int BlockGroupManager::allocate_inode() {
+    int len = 0;
+    return allocate_inode_run(1, &len);
+}
+
+// Claims up to max_len consecutive inodes with one bitmap scan and one
+// counter update (batch creates); each inode comes back zeroed with its id.
+int BlockGroupManager::allocate_inode_run(int max_len, int* run_len) {
+    *run_len = 0;
+    if (max_len <= 0 || load_counter(FREE_INODES) == 0) return -1; // Skip full groups without scanning
+    FS_STATS_TIMER(stats, FsOp::AllocateInode);
+    ensure_initialized();
+
     uint8_t* bitmap = get_inode_bitmap_ptr();
 
     // GEMINI FIX: Inode 0 (Global) is usually reserved.
-    int start_bit = (group_id == 0) ? 1 : 0;
+    int start_bit = first_inode_bit();
 
-    int local_index = find_first_free_bit(bitmap, sb->inodes_per_group, start_bit);
-    if (local_index == -1) return -1;
+    // Lock-free: find a candidate, then claim it with a CAS on its word. A
+    // lost race just means looking again from the same place.
+    int local_index = -1;
+    int len = 0;
+    int hint = static_cast<int>(load_counter(INODE_HINT));
+    while (len == 0) {
+        local_index = find_free_bit_from_hint(bitmap, sb->inodes_per_group, start_bit, hint);
+        if (local_index == -1) return -1;
+        len = bitmap_claim_run(bitmap, sb->inodes_per_group, local_index, max_len);
+        hint = local_index;
+    }
 
-    set_bit(bitmap, local_index);
+    add_counter(FREE_INODES, -len);
+    store_counter(INODE_HINT, local_index + len);
+    journal_bitmap(INODE_BITMAP_OFFSET);
 
-    int global_id = (group_id * sb->inodes_per_group) + local_index;
-    Inode* node = get_inode(global_id);
-    std::memset(node, 0, sizeof(Inode));
-    node->id = global_id;
+    int first_id = (group_id * sb->inodes_per_group) + local_index;
+    for (int global_id = first_id; global_id < first_id + len; global_id++) {
+        journal_inode(global_id);
+        Inode* node = get_inode(global_id);
+        std::memset(node, 0, sizeof(Inode));
+        node->id = global_id;
+    }
 
-    return global_id;
+    *run_len = len;
+    return first_id;
 }
 
 void BlockGroupManager::free_inode(int global_inode_id) {
     int local_index = global_inode_id % sb->inodes_per_group;
-    clear_bit(get_inode_bitmap_ptr(), local_index);
+    // Count first, clear second: the counter may briefly overstate the free
+    // space but never understates (or wraps) it.
+    add_counter(FREE_INODES, 1);
+    if (!bitmap_release_bit(get_inode_bitmap_ptr(), local_index)) {
+        add_counter(FREE_INODES, -1); // Already free: keep the counter honest
+        return;
+    }
+    journal_bitmap(INODE_BITMAP_OFFSET);
 }
 
 bool BlockGroupManager::is_inode_allocated(int global_inode_id) {
+    if (!is_initialized()) return false;
     int local_index = global_inode_id % sb->inodes_per_group;
-    return get_bit(get_inode_bitmap_ptr(), local_index);
+    return bitmap_test_bit_atomic(get_inode_bitmap_ptr(), local_index);
 }
 
 // ==========================================
 // BLOCK LOGIC
 // ==========================================
 int BlockGroupManager::allocate_block() {
-    uint8_t* bitmap = get_block_bitmap_ptr();
+    int len = 0;
+    return allocate_block_run(1, -1, &len, true);
+}
+
+// Hands out up to max_len physically contiguous blocks. A free goal block
+// (e.g. the one right after a file's last extent) is tried first so runs can
+// keep growing; otherwise the run starts at the first free bit after the
+// hint. Returns the first global block and stores the run length, or -1.
+// Callers that overwrite every byte pass zero_fill = false.
+//
+// No lock is taken: the run is claimed word by word with compare-exchange,
+// so the bits returned are exactly the ones this call flipped.
+int BlockGroupManager::allocate_block_run(int max_len, int goal_block, int* run_len, bool zero_fill) {
+    *run_len = 0;
+    if (max_len <= 0 || load_counter(FREE_BLOCKS) == 0) return -1;
+    FS_STATS_TIMER(stats, FsOp::AllocateBlock);
+    ensure_initialized();
 
+    uint8_t* bitmap = get_block_bitmap_ptr();
     // GEMINI FIX: In Group 0, we must skip the Metadata blocks (SB + Bitmaps + Table)
-    int start_bit = 0;
-    if (group_id == 0) {
-        // Calculate how many blocks the Inode Table takes
-        int table_size_blocks = (sb->inodes_per_group * sizeof(Inode)) / disk.get_block_size();
-        // Offset = 1(SB) + 1(IBMap) + 1(BBMap) + TableSize
-        start_bit = INODE_TABLE_OFFSET + table_size_blocks;
+    int start_bit = first_data_block_bit();
+    int max_bits = blocks_in_group();
+    int group_start = group_id * sb->blocks_per_group;
+
+    int local_index = -1;
+    int len = 0;
+    int goal_local = goal_block - group_start;
+    if (goal_block >= 0 && goal_local >= start_bit && goal_local < max_bits) {
+        len = bitmap_claim_run(bitmap, max_bits, goal_local, max_len);
+        if (len > 0) local_index = goal_local;
     }
 
-    int local_index = find_first_free_bit(bitmap, sb->blocks_per_group, start_bit);
-    if (local_index == -1) return -1;
+    int hint = static_cast<int>(load_counter(BLOCK_HINT));
+    while (len == 0) {
+        local_index = find_free_bit_from_hint(bitmap, max_bits, start_bit, hint);
+        if (local_index == -1) return -1;
+        len = bitmap_claim_run(bitmap, max_bits, local_index, max_len);
+        hint = local_index; // Lost the race for this bit: rescan from here
+    }
 
-    set_bit(bitmap, local_index);
-    int global_block_id = (group_id * sb->blocks_per_group) + local_index;
+    add_counter(FREE_BLOCKS, -len);
+    store_counter(BLOCK_HINT, local_index + len);
+    journal_bitmap(BLOCK_BITMAP_OFFSET);
 
-    // Zero out the new block
-    std::memset(disk.get_ptr(global_block_id), 0, disk.get_block_size());
+    int global_block_id = group_start + local_index;
+    if (zero_fill) {
+        disk.zero_bytes(global_block_id, 0, static_cast<size_t>(len) * disk.get_block_size());
+    }
 
+    *run_len = len;
     return global_block_id;
 }
 
+// Up to n blocks from this group as a short list of runs, the first one at
+// the goal block when it is free. Stops early when the group runs out.
+std::vector<BlockRun> BlockGroupManager::allocate_blocks(size_t n, int goal_block, bool zero_fill) {
+    std::vector<BlockRun> runs;
+    size_t remaining = n;
+    while (remaining > 0) {
+        int len = 0;
+        int want = static_cast<int>(std::min<size_t>(remaining, sb->blocks_per_group));
+        int start = allocate_block_run(want, goal_block, &len, zero_fill);
+        if (start == -1) break;
+
+        runs.push_back({static_cast<size_t>(start), static_cast<size_t>(len)});
+        remaining -= len;
+        goal_block = start + len; // Keep the next run adjacent if the bitmap allows
+    }
+    return runs;
+}
+
 void BlockGroupManager::free_block(int global_block_id) {
     int local_index = global_block_id % sb->blocks_per_group;
-    clear_bit(get_block_bitmap_ptr(), local_index);
+    // Older logged images of this block must not be replayed over its next
+    // use. Revoked before the bit is released, so a new owner's mark_dirty
+    // is always the later event.
+    if (journal != nullptr) journal->revoke(global_block_id);
+
+    add_counter(FREE_BLOCKS, 1); // See free_inode for the ordering
+    if (!bitmap_release_bit(get_block_bitmap_ptr(), local_index)) {
+        add_counter(FREE_BLOCKS, -1); // Already free: keep the counter honest
+        return;
+    }
+    journal_bitmap(BLOCK_BITMAP_OFFSET);
+}
+
+// The bulk form of free_block: one counter update, one bitmap pass and one
+// journal mark for a whole run inside this group.
+void BlockGroupManager::free_block_run(int first_block, int count) {
+    if (count <= 0) return;
+    if (journal != nullptr) {
+        for (int b = first_block; b < first_block + count; b++) journal->revoke(b);
+    }
+
+    add_counter(FREE_BLOCKS, count);
+    int released = bitmap_release_run(get_block_bitmap_ptr(), first_block % sb->blocks_per_group, count);
+    if (released != count) add_counter(FREE_BLOCKS, released - count);
+    if (released > 0) journal_bitmap(BLOCK_BITMAP_OFFSET);
 }
 
 // ==========================================
-// BITWISE HELPERS
+// GROUP DESCRIPTOR
 // ==========================================
-bool BlockGroupManager::get_bit(uint8_t* bitmap, int index) {
-    return (bitmap[index / 8] & (1 << (index % 8))) != 0;
+GroupDescriptor* BlockGroupManager::get_descriptor() {
+    int block_id = group_id * sb->blocks_per_group;
+    return reinterpret_cast<GroupDescriptor*>(disk.get_ptr(block_id) + GROUP_DESC_BYTE_OFFSET);
+}
+
+// Every group reserves its own header block, both bitmaps and the inode
+// table, so data allocation starts after them (rounded UP to whole blocks).
+int BlockGroupManager::first_data_block_bit() {
+    size_t block_size = disk.get_block_size();
+    int table_size_blocks = ((sb->inodes_per_group << INODE_SIZE_SHIFT) + block_size - 1) / block_size;
+    // Offset = 1(SB / group header) + 1(IBMap) + 1(BBMap) + TableSize
+    return INODE_TABLE_OFFSET + table_size_blocks;
+}
+
+int BlockGroupManager::first_inode_bit() {
+    return (group_id == 0) ? 1 : 0;
+}
+
+// The last group may be cut short by the end of the disk.
+int BlockGroupManager::blocks_in_group() {
+    size_t group_start = group_id * sb->blocks_per_group;
+    size_t remaining = sb->total_blocks - group_start;
+    return static_cast<int>(std::min(remaining, sb->blocks_per_group));
+}
+
+// Descriptor fields used by the lock-free paths. The descriptor sits at a
+// 4-byte aligned offset, so its uint32 fields are naturally aligned even
+// though the struct itself is packed.
+uint32_t* BlockGroupManager::descriptor_field(DescriptorField field) {
+    return reinterpret_cast<uint32_t*>(reinterpret_cast<uint8_t*>(get_descriptor()) + field);
+}
+
+uint32_t BlockGroupManager::load_counter(DescriptorField field) {
+    return __atomic_load_n(descriptor_field(field), __ATOMIC_RELAXED);
+}
+
+void BlockGroupManager::add_counter(DescriptorField field, int delta) {
+    __atomic_fetch_add(descriptor_field(field), static_cast<uint32_t>(delta), __ATOMIC_RELAXED);
 }
 
-void BlockGroupManager::set_bit(uint8_t* bitmap, int index) {
-    bitmap[index / 8] |= (1 << (index % 8));
+// Hints are advisory: a racing store only costs a slightly longer scan
+void BlockGroupManager::store_counter(DescriptorField field, uint32_t value) {
+    __atomic_store_n(descriptor_field(field), value, __ATOMIC_RELAXED);
 }
 
-void BlockGroupManager::clear_bit(uint8_t* bitmap, int index) {
-    bitmap[index / 8] &= ~(1 << (index % 8));
+// init / has_valid / rebuild only run from format() and mount(), which own
+// the whole file system, so they use plain accesses.
+void BlockGroupManager::init_descriptor(bool lazy) {
+    GroupDescriptor fresh;
+    fresh.magic = GROUP_DESC_MAGIC;
+    fresh.block_alloc_hint = first_data_block_bit();
+    fresh.inode_alloc_hint = first_inode_bit();
+    if (lazy) {
+        // Nothing is allocated yet, so the free counts follow from the
+        // geometry alone
+        fresh.flags = GROUP_FLAG_UNINIT;
+        fresh.free_blocks_count = static_cast<uint32_t>(std::max(0, blocks_in_group() - first_data_block_bit()));
+        fresh.free_inodes_count = static_cast<uint32_t>(sb->inodes_per_group - first_inode_bit());
+        std::memcpy(get_descriptor(), &fresh, sizeof(GroupDescriptor));
+        return;
+    }
+    std::memcpy(get_descriptor(), &fresh, sizeof(GroupDescriptor));
+    rebuild_descriptor();
+}
+
+bool BlockGroupManager::is_initialized() {
+    return !(__atomic_load_n(descriptor_field(FLAGS), __ATOMIC_ACQUIRE) & GROUP_FLAG_UNINIT);
+}
+
+void BlockGroupManager::init_metadata() {
+    size_t block_size = disk.get_block_size();
+    size_t group_start = static_cast<size_t>(group_id) * sb->blocks_per_group;
+    disk.zero_bytes(group_start + INODE_BITMAP_OFFSET, 0, block_size);
+    disk.zero_bytes(group_start + BLOCK_BITMAP_OFFSET, 0, block_size);
+    disk.zero_bytes(group_start + INODE_TABLE_OFFSET, 0,
+                    static_cast<size_t>(first_data_block_bit() - INODE_TABLE_OFFSET) * block_size);
 }
 
+// The zeroed bitmaps are journaled with the cleared flag: after a crash the
+// group is either still uninitialized or has clean bitmaps. Stale inode
+// table slots are harmless, allocate_inode clears each inode it hands out.
+void BlockGroupManager::ensure_initialized() {
+    if (is_initialized()) return;
+    std::lock_guard<std::mutex> guard(lazy_init_locks[group_id % LAZY_INIT_STRIPES]);
+    if (is_initialized()) return;
+
+    init_metadata();
+    journal_bitmap(INODE_BITMAP_OFFSET);
+    journal_bitmap(BLOCK_BITMAP_OFFSET);
+    __atomic_fetch_and(descriptor_field(FLAGS), ~GROUP_FLAG_UNINIT, __ATOMIC_RELEASE);
+    pin_inode_table();
+}
+
+bool BlockGroupManager::has_valid_descriptor() {
+    return get_descriptor()->magic == GROUP_DESC_MAGIC;
+}
+
+// Recomputes the free counters from the bitmaps. Used by format() and by a
+// warm mount that finds the counters stale.
+void BlockGroupManager::rebuild_descriptor() {
+    GroupDescriptor* gd = get_descriptor();
+    int data_start = first_data_block_bit();
+    int block_bits = blocks_in_group();
+    int free_blocks = (data_start < block_bits)
+        ? bitmap_count_zeros(get_block_bitmap_ptr(), block_bits, data_start) : 0;
+    int free_inodes = bitmap_count_zeros(get_inode_bitmap_ptr(), sb->inodes_per_group, first_inode_bit());
+
+    gd->magic = GROUP_DESC_MAGIC;
+    gd->free_blocks_count = static_cast<uint32_t>(free_blocks);
+    gd->free_inodes_count = static_cast<uint32_t>(free_inodes);
+    if (gd->block_alloc_hint < static_cast<uint32_t>(data_start)) gd->block_alloc_hint = data_start;
+    if (gd->inode_alloc_hint < static_cast<uint32_t>(first_inode_bit())) gd->inode_alloc_hint = first_inode_bit();
+}
+
+bool BlockGroupManager::descriptor_matches_bitmaps() {
+    if (!is_initialized()) return true;
+    int data_start = first_data_block_bit();
+    int block_bits = blocks_in_group();
+    int free_blocks = (data_start < block_bits)
+        ? bitmap_count_zeros(get_block_bitmap_ptr(), block_bits, data_start) : 0;
+    int free_inodes = bitmap_count_zeros(get_inode_bitmap_ptr(), sb->inodes_per_group, first_inode_bit());
+    return get_free_blocks_count() == static_cast<size_t>(free_blocks) &&
+           get_free_inodes_count() == static_cast<size_t>(free_inodes);
+}
+
+// The table is pinned first: prefault skips pinned regions, so a cached
+// disk reads the table once, into the region
+void BlockGroupManager::warm_metadata() {
+    pin_inode_table();
+    size_t group_start = static_cast<size_t>(group_id) * sb->blocks_per_group;
+    size_t count = is_initialized() ? first_data_block_bit() : 1; // Only the descriptor is in use otherwise
+    disk.prefault({DiskRun{group_start, count}});
+}
+
+size_t BlockGroupManager::get_free_blocks_count() {
+    return load_counter(FREE_BLOCKS);
+}
+
+size_t BlockGroupManager::get_free_inodes_count() {
+    return load_counter(FREE_INODES);
+}
+
+// ==========================================
+// BITWISE HELPERS
+// ==========================================
 int BlockGroupManager::find_first_free_bit(uint8_t* bitmap, int max_bits, int start_bit) {
-    for (int i = start_bit; i < max_bits; i++) {
-        if (!get_bit(bitmap, i)) {
-            return i;
+    // Runtime-dispatched scan (AVX2 lane skipping where the CPU has it) that
+    // tolerates other threads claiming bits in the same words
+    return bitmap_find_first_zero_atomic(bitmap, max_bits, start_bit);
+}
+
+// Resumes scanning at the descriptor hint and wraps around to start_bit, so
+// sequential allocations do not rescan the already-full prefix of the group.
+// The scan length recorded is the number of bits examined, counting the
+// found bit.
+int BlockGroupManager::find_free_bit_from_hint(uint8_t* bitmap, int max_bits, int start_bit, int hint) {
+    if (hint > start_bit && hint < max_bits) {
+        int found = find_first_free_bit(bitmap, max_bits, hint);
+        if (found != -1) {
+            FS_STATS_RECORD(stats, record_bitmap_scan(found - hint + 1));
+            return found;
         }
+        found = find_first_free_bit(bitmap, hint, start_bit);
+        FS_STATS_RECORD(stats, record_bitmap_scan(max_bits - hint +
+                                                  (found == -1 ? hint - start_bit : found - start_bit + 1)));
+        return found;
     }
-    return -1;
+    int found = find_first_free_bit(bitmap, max_bits, start_bit);
+    FS_STATS_RECORD(stats, record_bitmap_scan(found == -1 ? max_bits - start_bit : found - start_bit + 1));
+    return found;
 }
 
 int BlockGroupManager::get_block_id_for_inode(int inode_id) {
     int group_id = inode_id / sb->inodes_per_group;
     int local_index = inode_id % sb->inodes_per_group;
-    int inodes_per_block = 4096 / sizeof(Inode);
-    int block_offset = local_index / inodes_per_block;
+    int block_offset = local_index >> INODES_PER_BLOCK_SHIFT;
     int group_start = group_id * sb->blocks_per_group;
     return group_start + INODE_TABLE_OFFSET + block_offset;
 }
@@ -0,0 +1,362 @@
+#include "fs/buffer_cache.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+// Blocks pinned by get_ptr on this thread, released as their scopes end
+struct PinScopeState {
+    int depth = 0;
+    std::vector<std::pair<BufferCache*, size_t>> pins;
+};
+thread_local PinScopeState scope_state;
+
+uint8_t* allocate_aligned(size_t bytes) {
+    void* p = std::aligned_alloc(4096, bytes);
+    if (p == nullptr) throw std::bad_alloc();
+    return static_cast<uint8_t*>(p);
+}
+}
+
+BufferCache::BufferCache(DiskBackend& backend, size_t block_size, size_t capacity)
+    : backend(backend), block_size(block_size), capacity(capacity) {
+    if (capacity == 0) throw std::invalid_argument("Buffer cache needs at least one frame");
+    arena = allocate_aligned(capacity * block_size);
+    frames.resize(capacity);
+    for (size_t i = 0; i < capacity; i++) {
+        frames[i].data = arena + i * block_size;
+        free_frames.push_back(capacity - 1 - i);
+    }
+}
+
+BufferCache::~BufferCache() {
+    for (size_t i = capacity; i < frames.size(); i++) std::free(frames[i].data);
+    for (Region& r : regions) std::free(r.data);
+    std::free(arena);
+}
+
+uint64_t BufferCache::content_hash(const uint8_t* data) const {
+    // FNV-1a over 64-bit words: only has to notice that a block changed
+    const uint64_t* words = reinterpret_cast<const uint64_t*>(data);
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < block_size / sizeof(uint64_t); i++) {
+        hash ^= words[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+BufferCache::Region* BufferCache::find_region(size_t block_id) {
+    if (regions.empty()) return nullptr;
+    auto it = std::upper_bound(regions.begin(), regions.end(), block_id,
+                               [](size_t id, const Region& r) { return id < r.first_block; });
+    if (it == regions.begin()) return nullptr;
+    --it;
+    return (block_id < it->first_block + it->count) ? &*it : nullptr;
+}
+
+// A free arena frame, else a CLOCK victim, else an overflow frame
+size_t BufferCache::grab_frame(bool allow_overflow) {
+    if (!free_frames.empty()) {
+        size_t slot = free_frames.back();
+        free_frames.pop_back();
+        return slot;
+    }
+
+    for (size_t step = 0; step < 2 * capacity; step++) {
+        size_t slot = clock_hand;
+        clock_hand = (clock_hand + 1) % capacity;
+        Frame& f = frames[slot];
+        if (!f.valid || f.pins > 0 || held(f.block_id)) continue;
+        if (f.referenced) {
+            f.referenced = false;
+            continue;
+        }
+
+        uint64_t hash = content_hash(f.data);
+        if (hash != f.hash) {
+            backend.write_blocks({{f.block_id, f.data}});
+            writes++;
+        }
+        index.erase(f.block_id);
+        f.valid = false;
+        evictions++;
+        return slot;
+    }
+    if (!allow_overflow) return NO_FRAME;
+
+    size_t slot;
+    if (!free_overflow.empty()) {
+        slot = free_overflow.back();
+        free_overflow.pop_back();
+    } else {
+        slot = frames.size();
+        frames.emplace_back();
+    }
+    frames[slot].data = allocate_aligned(block_size);
+    return slot;
+}
+
+void BufferCache::release_frame(size_t slot) {
+    Frame& f = frames[slot];
+    if (held(f.block_id)) return; // Stays resident until release_held()
+    if (content_hash(f.data) != f.hash) {
+        // Runs from unpin, which must not throw: on failure the block stays
+        // resident and the next flush reports the error
+        try {
+            backend.write_blocks({{f.block_id, f.data}});
+        } catch (const std::exception&) {
+            return;
+        }
+        writes++;
+    }
+    index.erase(f.block_id);
+    f.valid = false;
+    std::free(f.data);
+    f.data = nullptr;
+    free_overflow.push_back(slot);
+}
+
+void BufferCache::release_held() {
+    std::lock_guard<std::mutex> guard(lock);
+    for (size_t slot = capacity; slot < frames.size(); slot++) {
+        if (frames[slot].valid && frames[slot].pins == 0) release_frame(slot);
+    }
+}
+
+void BufferCache::write_through(size_t block_id, const uint8_t* data) {
+    std::lock_guard<std::mutex> guard(lock);
+    backend.write_blocks({{block_id, data}});
+    writes++;
+    // The stored hash describes the disk copy: the resident one now differs
+    // from it and is written when its turn comes
+    if (Region* r = find_region(block_id)) {
+        r->hashes[block_id - r->first_block] = content_hash(data);
+    } else {
+        auto it = index.find(block_id);
+        if (it != index.end()) frames[it->second].hash = content_hash(data);
+    }
+}
+
+uint8_t* BufferCache::pin(size_t block_id) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (Region* r = find_region(block_id)) return r->data + (block_id - r->first_block) * block_size;
+
+    auto it = index.find(block_id);
+    if (it != index.end()) {
+        Frame& f = frames[it->second];
+        f.pins++;
+        f.referenced = true;
+        hits++;
+        return f.data;
+    }
+
+    misses++;
+    size_t slot = grab_frame();
+    Frame& f = frames[slot];
+    try {
+        backend.read_block(block_id, f.data);
+    } catch (...) {
+        if (slot < capacity) free_frames.push_back(slot);
+        else {
+            std::free(f.data);
+            f.data = nullptr;
+            free_overflow.push_back(slot);
+        }
+        throw;
+    }
+    f.block_id = block_id;
+    f.pins = 1;
+    f.referenced = true;
+    f.valid = true;
+    f.hash = content_hash(f.data);
+    index[block_id] = slot;
+    return f.data;
+}
+
+void BufferCache::unpin(size_t block_id) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = index.find(block_id);
+    if (it == index.end()) return; // Region blocks are never pinned
+
+    size_t slot = it->second;
+    Frame& f = frames[slot];
+    if (f.pins > 0) f.pins--;
+    if (f.pins == 0 && slot >= capacity) release_frame(slot);
+}
+
+uint8_t* BufferCache::pin_scoped(size_t block_id) {
+    uint8_t* data = pin(block_id);
+    if (scope_state.depth > 0) scope_state.pins.emplace_back(this, block_id);
+    return data;
+}
+
+size_t BufferCache::begin_scope() {
+    scope_state.depth++;
+    return scope_state.pins.size();
+}
+
+void BufferCache::end_scope(size_t mark) {
+    scope_state.depth--;
+    while (scope_state.pins.size() > mark) {
+        auto pin = scope_state.pins.back();
+        scope_state.pins.pop_back();
+        pin.first->unpin(pin.second);
+    }
+}
+
+// The region is read outside the lock in one batched request, so groups
+// can be pinned from several threads at once (a warm mount). Blocks that
+// were resident meanwhile are taken from their frames: those may be newer
+// than the disk, and their hashes still describe what the disk holds.
+void BufferCache::add_region(size_t first_block, size_t count) {
+    auto overlaps = [&](const Region& r) { return first_block < r.first_block + r.count && r.first_block < first_block + count; };
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for (const Region& r : regions) {
+            if (r.first_block == first_block && r.count == count) return; // Mounted again
+            if (overlaps(r)) throw std::logic_error("Buffer cache regions overlap");
+        }
+    }
+
+    Region region{first_block, count, allocate_aligned(count * block_size), {}};
+    std::vector<std::pair<size_t, uint8_t*>> reads;
+    for (size_t i = 0; i < count; i++) reads.emplace_back(first_block + i, region.data + i * block_size);
+    size_t writes_before = writes;
+    try {
+        backend.read_blocks(reads);
+    } catch (...) {
+        std::free(region.data);
+        throw;
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    for (const Region& r : regions) {
+        if (overlaps(r)) {
+            std::free(region.data);
+            if (r.first_block == first_block && r.count == count) return; // Lost a race to pin it
+            throw std::logic_error("Buffer cache regions overlap");
+        }
+    }
+    // Rare: something was written back while we read, maybe into the range
+    if (writes != writes_before) {
+        try {
+            backend.read_blocks(reads);
+        } catch (...) {
+            std::free(region.data);
+            throw;
+        }
+    }
+    for (size_t i = 0; i < count; i++) region.hashes.push_back(content_hash(region.data + i * block_size));
+    for (size_t b = first_block; b < first_block + count; b++) {
+        auto it = index.find(b);
+        if (it == index.end()) continue;
+        size_t slot = it->second;
+        Frame& f = frames[slot];
+        if (f.pins > 0) {
+            std::free(region.data);
+            throw std::logic_error("Buffer cache region covers a pinned block");
+        }
+        std::memcpy(region.data + (b - first_block) * block_size, f.data, block_size);
+        region.hashes[b - first_block] = f.hash;
+        index.erase(it);
+        f.valid = false;
+        if (slot < capacity) free_frames.push_back(slot);
+        else {
+            std::free(f.data);
+            f.data = nullptr;
+            free_overflow.push_back(slot);
+        }
+    }
+
+    auto pos = std::upper_bound(regions.begin(), regions.end(), first_block,
+                                [](size_t id, const Region& r) { return id < r.first_block; });
+    regions.insert(pos, std::move(region));
+}
+
+void BufferCache::prefetch(const std::vector<DiskRun>& runs) {
+    std::lock_guard<std::mutex> guard(lock);
+    const size_t budget = std::max<size_t>(1, capacity / 4);
+    std::vector<std::pair<size_t, uint8_t*>> reads;
+    std::vector<size_t> slots;
+
+    for (const DiskRun& run : runs) {
+        for (size_t b = run.first_block; b < run.first_block + run.count && reads.size() < budget; b++) {
+            if (find_region(b) != nullptr || index.count(b) != 0) continue;
+            size_t slot = grab_frame(false);
+            if (slot == NO_FRAME) break;
+            reads.emplace_back(b, frames[slot].data);
+            slots.push_back(slot);
+        }
+    }
+    if (reads.empty()) return;
+
+    try {
+        backend.read_blocks(reads);
+    } catch (const std::exception&) {
+        for (size_t slot : slots) free_frames.push_back(slot);
+        return;
+    }
+
+    // Unpinned but referenced, so they survive one pass of the hand
+    for (size_t i = 0; i < reads.size(); i++) {
+        Frame& f = frames[slots[i]];
+        f.block_id = reads[i].first;
+        f.pins = 0;
+        f.referenced = true;
+        f.valid = true;
+        f.hash = content_hash(f.data);
+        index[f.block_id] = slots[i];
+    }
+    prefetched += reads.size();
+}
+
+// Queues block_id if its resident copy changed; hashes are updated by the
+// caller once the write succeeded
+void BufferCache::collect_changed(size_t block_id, std::vector<std::pair<size_t, const uint8_t*>>& out) {
+    if (held(block_id)) return;
+    const uint8_t* data = nullptr;
+    uint64_t stored = 0;
+    if (Region* r = find_region(block_id)) {
+        data = r->data + (block_id - r->first_block) * block_size;
+        stored = r->hashes[block_id - r->first_block];
+    } else {
+        auto it = index.find(block_id);
+        if (it == index.end()) return; // Not resident: written when it was evicted
+        data = frames[it->second].data;
+        stored = frames[it->second].hash;
+    }
+    if (content_hash(data) != stored) out.emplace_back(block_id, data);
+}
+
+void BufferCache::write_back(const std::vector<DiskRun>& runs) {
+    std::lock_guard<std::mutex> guard(lock);
+    std::vector<std::pair<size_t, const uint8_t*>> changed;
+    for (const DiskRun& run : runs) {
+        for (size_t b = run.first_block; b < run.first_block + run.count; b++) collect_changed(b, changed);
+    }
+    if (changed.empty()) return;
+
+    backend.write_blocks(changed);
+    writes += changed.size();
+    for (const auto& c : changed) {
+        if (Region* r = find_region(c.first)) r->hashes[c.first - r->first_block] = content_hash(c.second);
+        else frames[index[c.first]].hash = content_hash(c.second);
+    }
+}
+
+void BufferCache::write_back_all() {
+    std::vector<DiskRun> runs;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for (const auto& entry : index) runs.push_back({entry.first, 1});
+        for (const Region& r : regions) runs.push_back({r.first_block, r.count});
+    }
+    write_back(runs);
+}
+
+size_t BufferCache::get_resident() {
+    std::lock_guard<std::mutex> guard(lock);
+    return index.size();
+}
@@ -0,0 +1,91 @@
+#include "fs/dentry_cache.hpp"
+#include "fs/directory.hpp"
+
+DentryCache::DentryCache(size_t capacity) : set_locks(LOCK_STRIPES) {
+    size_t sets = 1;
+    while (sets * WAYS < capacity) sets <<= 1;
+
+    entries.resize(sets * WAYS);
+    clock_hands.assign(sets, 0);
+    set_mask = sets - 1;
+}
+
+// Mixes the parent id into the directory name hash so siblings of
+// different parents land in different sets.
+uint32_t DentryCache::key_hash(size_t parent_id, std::string_view name) {
+    uint64_t mixed = dir_name_hash(name.data(), name.size()) ^ (parent_id * 0x9E3779B97F4A7C15ULL);
+    return static_cast<uint32_t>(mixed ^ (mixed >> 32));
+}
+
+DentryCache::Entry* DentryCache::find_entry(size_t parent_id, std::string_view name, uint32_t hash) {
+    Entry* set = &entries[(hash & set_mask) * WAYS];
+    for (size_t way = 0; way < WAYS; way++) {
+        Entry& e = set[way];
+        if (e.valid && e.hash == hash && e.parent_id == parent_id && e.name == name) {
+            return &e;
+        }
+    }
+    return nullptr;
+}
+
+bool DentryCache::lookup(size_t parent_id, std::string_view name, size_t* child_id) {
+    uint32_t hash = key_hash(parent_id, name);
+    std::lock_guard<std::mutex> guard(lock_for(hash));
+    Entry* e = find_entry(parent_id, name, hash);
+    if (e == nullptr) {
+        misses++;
+        return false;
+    }
+    e->referenced = true;
+    *child_id = e->child_id;
+    hits++;
+    return true;
+}
+
+void DentryCache::insert(size_t parent_id, std::string_view name, size_t child_id) {
+    uint32_t hash = key_hash(parent_id, name);
+    std::lock_guard<std::mutex> guard(lock_for(hash));
+    Entry* e = find_entry(parent_id, name, hash);
+
+    if (e == nullptr) {
+        // CLOCK sweep inside the set: an empty way wins, otherwise the first
+        // way whose reference bit is already clear.
+        size_t set_index = hash & set_mask;
+        Entry* set = &entries[set_index * WAYS];
+        uint8_t& hand = clock_hands[set_index];
+        while (true) {
+            Entry& candidate = set[hand];
+            hand = (hand + 1) % WAYS;
+            if (!candidate.valid || !candidate.referenced) {
+                e = &candidate;
+                break;
+            }
+            candidate.referenced = false;
+        }
+    }
+
+    e->valid = true;
+    e->referenced = true;
+    e->hash = hash;
+    e->parent_id = parent_id;
+    e->child_id = child_id;
+    e->name = name;
+}
+
+void DentryCache::invalidate(size_t parent_id, std::string_view name) {
+    uint32_t hash = key_hash(parent_id, name);
+    std::lock_guard<std::mutex> guard(lock_for(hash));
+    Entry* e = find_entry(parent_id, name, hash);
+    if (e != nullptr) e->valid = false;
+}
+
+void DentryCache::clear() {
+    // One stripe at a time; lookups in other stripes keep going meanwhile
+    size_t sets = set_mask + 1;
+    for (size_t stripe = 0; stripe < LOCK_STRIPES; stripe++) {
+        std::lock_guard<std::mutex> guard(set_locks[stripe]);
+        for (size_t set = stripe; set < sets; set += LOCK_STRIPES) {
+            for (size_t way = 0; way < WAYS; way++) entries[set * WAYS + way].valid = false;
+        }
+    }
+}
@@ -0,0 +1,103 @@
+#include "fs/directory.hpp"
+#include <cstring>
+#include <algorithm>
+
+static const size_t DIR_BLOCK_SIZE = 4096;
+static const size_t MAX_NAME_LEN = 255;
+
+static DirRecord* record_at(uint8_t* block, size_t offset) {
+    return reinterpret_cast<DirRecord*>(block + offset);
+}
+
+static bool record_matches(const DirRecord* rec, std::string_view name) {
+    return rec->inode_id != 0 &&
+           rec->name_len == name.size() &&
+           std::memcmp(rec->name(), name.data(), name.size()) == 0;
+}
+
+// 32-bit FNV-1a: cheap, and its low bits spread well enough for bucket
+// selection by mask.
+uint32_t dir_name_hash(const char* name, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= static_cast<uint8_t>(name[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void dir_block_init(uint8_t* block) {
+    std::memset(block, 0, sizeof(DirRecord));
+    record_at(block, 0)->rec_len = DIR_BLOCK_SIZE;
+}
+
+DirRecord* dir_block_find(uint8_t* block, std::string_view name) {
+    for (size_t offset = 0; offset < DIR_BLOCK_SIZE; ) {
+        DirRecord* rec = record_at(block, offset);
+        if (rec->rec_len == 0) break; // Corrupt / uninitialized block guard
+        if (record_matches(rec, name)) return rec;
+        offset += rec->rec_len;
+    }
+    return nullptr;
+}
+
+bool dir_block_insert(uint8_t* block, size_t inode_id, std::string_view name) {
+    size_t name_len = std::min(name.size(), MAX_NAME_LEN);
+    size_t needed = dir_record_size(name_len);
+
+    for (size_t offset = 0; offset < DIR_BLOCK_SIZE; ) {
+        DirRecord* rec = record_at(block, offset);
+        if (rec->rec_len == 0) break;
+
+        size_t used = (rec->inode_id != 0) ? dir_record_size(rec->name_len) : 0;
+        if (rec->rec_len - used >= needed) {
+            // Carve the new record out of this record's slack
+            DirRecord* target = rec;
+            if (used != 0) {
+                target = record_at(block, offset + used);
+                target->rec_len = rec->rec_len - used;
+                rec->rec_len = used;
+            }
+            target->inode_id = inode_id;
+            target->name_len = static_cast<uint8_t>(name_len);
+            target->reserved = 0;
+            std::memcpy(target->name(), name.data(), name_len);
+            return true;
+        }
+        offset += rec->rec_len;
+    }
+    return false;
+}
+
+size_t dir_block_remove(uint8_t* block, std::string_view name) {
+    DirRecord* prev = nullptr;
+    for (size_t offset = 0; offset < DIR_BLOCK_SIZE; ) {
+        DirRecord* rec = record_at(block, offset);
+        if (rec->rec_len == 0) break;
+
+        if (record_matches(rec, name)) {
+            size_t id = rec->inode_id;
+            if (prev != nullptr) {
+                prev->rec_len += rec->rec_len; // Merge into the previous record
+            } else {
+                rec->inode_id = 0;             // First record: just mark it free
+                rec->name_len = 0;
+            }
+            return id;
+        }
+        prev = rec;
+        offset += rec->rec_len;
+    }
+    return 0;
+}
+
+void dir_block_for_each(uint8_t* block, const std::function<void(DirRecord&)>& fn) {
+    for (size_t offset = 0; offset < DIR_BLOCK_SIZE; ) {
+        DirRecord* rec = record_at(block, offset);
+        if (rec->rec_len == 0) break;
+        // Take the next offset before calling fn so the walk never depends on it
+        size_t next = offset + rec->rec_len;
+        if (rec->inode_id != 0) fn(*rec);
+        offset = next;
+    }
+}
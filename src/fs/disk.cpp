@@ -1,17 +1,12 @@
 #include "fs/disk.hpp"
+#include "fs/logger.hpp"
 #include <cstring>
 #include <iostream>
 #include <stdexcept>
 #include <iomanip>
+#include <algorithm>
 
-// GEMINI FIX: Required for mmap, open, close
-#include <sys/mman.h>
-#include <fcntl.h>
-#include <unistd.h>
-#include <sys/stat.h>
-#include <sys/types.h>
-
-Disk::Disk(size_t capacity_bytes, const char* filename) {
+Disk::Disk(size_t capacity_bytes, const char* filename, DiskBackendType backend_type, size_t cache_blocks) {
     if (capacity_bytes % BLOCK_SIZE != 0) {
         throw std::invalid_argument("Disk capacity must be multiple of 4096");
     }
@@ -21,40 +16,49 @@ Disk::Disk(size_t capacity_bytes, const char* filename) {
     // -----------------------
 
     // --- NEW ABSTRACTION ---
-    // 1. Open File (Create if doesn't exist)
-    this->fd = open(filename, O_RDWR | O_CREAT, 0666);
-    if (this->fd == -1) {
-        throw std::runtime_error("Failed to open disk image file");
-    }
-
-    // 2. Resize File to match disk capacity (Physical Allocation)
-    if (ftruncate(this->fd, capacity_bytes) == -1) {
-        close(this->fd);
-        throw std::runtime_error("Failed to resize disk image");
-    }
-
-    // 3. Map File to Memory (The "Magic" Link)
-    this->mapped_data = (uint8_t*)mmap(NULL, capacity_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0);
-
-    if (this->mapped_data == MAP_FAILED) {
-        close(this->fd);
-        throw std::runtime_error("Failed to mmap disk image");
-    }
+    // The backend opens/sizes the image file and provides the memory view
+    // (a MAP_PRIVATE mapping for the default mmap backend)
+    this->backend = make_disk_backend(backend_type);
+    bool cached = cache_blocks > 0 && backend_type != DiskBackendType::Mmap;
+    this->mapped_data = backend->open(filename, capacity_bytes, BLOCK_SIZE, !cached);
+    if (cached) this->cache = std::make_unique<BufferCache>(*backend, BLOCK_SIZE, cache_blocks);
     // -----------------------
 
     this->BLOCK_COUNT = capacity_bytes / BLOCK_SIZE;
+    this->dirty_bits = std::vector<std::atomic<uint64_t>>((BLOCK_COUNT + 63) / 64);
+    this->held_bits = std::vector<std::atomic<uint64_t>>((BLOCK_COUNT + 63) / 64);
+    this->written_bits = std::vector<std::atomic<uint64_t>>((BLOCK_COUNT + 63) / 64);
+    if (cache) cache->set_hold_check([this](size_t block_id) { return is_held(block_id); });
 }
 
 Disk::~Disk() {
     // --- NEW ABSTRACTION ---
-    if (this->mapped_data != MAP_FAILED) {
-        // Force OS to write "Dirty Pages" to physical disk
-        msync(this->mapped_data, BLOCK_COUNT * BLOCK_SIZE, MS_SYNC);
-        // Unmap memory
-        munmap(this->mapped_data, BLOCK_COUNT * BLOCK_SIZE);
-    }
-    if (this->fd != -1) {
-        close(this->fd);
+    // Force out everything the backend may hold, not just the marked
+    // blocks: writers that bypass mark_dirty must not lose data at shutdown.
+    // Held blocks are dropped (see hold). The backend then unmaps and closes.
+    try {
+        if (cache) {
+            cache->write_back_all(); // Skips held blocks by itself
+            backend->sync_data();
+        } else {
+            std::vector<DiskRun> runs;
+            for (const DiskRun& run : backend->written_runs()) {
+                size_t end = run.first_block + run.count;
+                for (size_t b = run.first_block; b < end; ) {
+                    if (is_held(b)) {
+                        b++;
+                        continue;
+                    }
+                    size_t run_end = b + 1;
+                    while (run_end < end && !is_held(run_end)) run_end++;
+                    runs.push_back({b, run_end - b});
+                    b = run_end;
+                }
+            }
+            backend->write_back(runs, SyncMode::Wait);
+        }
+    } catch (const std::exception& e) {
+        Logger::log(LogLevel::Error, "Disk shutdown: ", e.what());
     }
 }
 
@@ -68,6 +72,11 @@ void Disk::read_block(int block_id, void* buffer) {
     // std::memcpy(buffer, &memory[offset], BLOCK_SIZE);
 
     // --- NEW ABSTRACTION ---
+    if (cache) {
+        std::memcpy(buffer, cache->pin(block_id), BLOCK_SIZE);
+        cache->unpin(block_id);
+        return;
+    }
     std::memcpy(buffer, this->mapped_data + offset, BLOCK_SIZE);
 }
 
@@ -81,7 +90,13 @@ void Disk::write_block(int block_id, const void* buffer) {
     // std::memcpy(&memory[offset], buffer, BLOCK_SIZE);
 
     // --- NEW ABSTRACTION ---
-    std::memcpy(this->mapped_data + offset, buffer, BLOCK_SIZE);
+    if (cache) {
+        std::memcpy(cache->pin(block_id), buffer, BLOCK_SIZE);
+        cache->unpin(block_id);
+    } else {
+        std::memcpy(this->mapped_data + offset, buffer, BLOCK_SIZE);
+    }
+    mark_dirty(block_id);
 }
 
 uint8_t* Disk::get_ptr(int block_id) {
@@ -94,27 +109,308 @@ uint8_t* Disk::get_ptr(int block_id) {
     // return &memory[offset];
 
     // --- NEW ABSTRACTION ---
+    if (cache) return cache->pin_scoped(block_id);
     return this->mapped_data + offset;
 }
 
+const uint8_t* Disk::pin_block(size_t block_id) {
+    if (block_id >= BLOCK_COUNT) throw std::out_of_range("Disk Access Error: Block ID out of bounds");
+    if (cache) return cache->pin(block_id);
+    return mapped_data + block_id * BLOCK_SIZE;
+}
+
+void Disk::unpin_block(size_t block_id) {
+    if (cache) cache->unpin(block_id);
+}
+
+// Splits [offset, offset + len) of the range starting at first_block into
+// per-block pieces: fn(block, offset in block, bytes, position in range)
+template <typename Fn>
+static void for_each_block_piece(size_t first_block, size_t offset, size_t len, size_t block_size, Fn fn) {
+    size_t block = first_block + offset / block_size;
+    size_t in_block = offset % block_size;
+    for (size_t done = 0; done < len; block++, in_block = 0) {
+        size_t chunk = std::min(block_size - in_block, len - done);
+        fn(block, in_block, chunk, done);
+        done += chunk;
+    }
+}
+
+void Disk::read_bytes(size_t first_block, size_t offset, void* dst, size_t len) {
+    if (len == 0) return;
+    if (first_block * BLOCK_SIZE + offset + len > BLOCK_COUNT * BLOCK_SIZE) {
+        throw std::out_of_range("Disk Read Error: Byte range out of bounds");
+    }
+    uint8_t* out = static_cast<uint8_t*>(dst);
+    if (!cache) {
+        std::memcpy(out, mapped_data + first_block * BLOCK_SIZE + offset, len);
+        return;
+    }
+    for_each_block_piece(first_block, offset, len, BLOCK_SIZE, [&](size_t block, size_t at, size_t n, size_t pos) {
+        std::memcpy(out + pos, cache->pin(block) + at, n);
+        cache->unpin(block);
+    });
+}
+
+void Disk::write_bytes(size_t first_block, size_t offset, const void* src, size_t len) {
+    if (len == 0) return;
+    if (first_block * BLOCK_SIZE + offset + len > BLOCK_COUNT * BLOCK_SIZE) {
+        throw std::out_of_range("Disk Write Error: Byte range out of bounds");
+    }
+    const uint8_t* in = static_cast<const uint8_t*>(src);
+    size_t first = first_block + offset / BLOCK_SIZE;
+    size_t last = first_block + (offset + len - 1) / BLOCK_SIZE;
+    if (!cache) {
+        std::memcpy(mapped_data + first_block * BLOCK_SIZE + offset, in, len);
+    } else {
+        for_each_block_piece(first_block, offset, len, BLOCK_SIZE, [&](size_t block, size_t at, size_t n, size_t pos) {
+            std::memcpy(cache->pin(block) + at, in + pos, n);
+            cache->unpin(block);
+        });
+    }
+    mark_dirty(first, last - first + 1);
+}
+
+void Disk::zero_bytes(size_t first_block, size_t offset, size_t len) {
+    if (len == 0) return;
+    if (first_block * BLOCK_SIZE + offset + len > BLOCK_COUNT * BLOCK_SIZE) {
+        throw std::out_of_range("Disk Write Error: Byte range out of bounds");
+    }
+    size_t first = first_block + offset / BLOCK_SIZE;
+    size_t last = first_block + (offset + len - 1) / BLOCK_SIZE;
+    if (!cache) {
+        std::memset(mapped_data + first_block * BLOCK_SIZE + offset, 0, len);
+    } else {
+        for_each_block_piece(first_block, offset, len, BLOCK_SIZE, [&](size_t block, size_t at, size_t n, size_t) {
+            std::memset(cache->pin(block) + at, 0, n);
+            cache->unpin(block);
+        });
+    }
+    mark_dirty(first, last - first + 1);
+}
+
+void Disk::copy_block(size_t dst_block, size_t src_block) {
+    if (dst_block >= BLOCK_COUNT || src_block >= BLOCK_COUNT) {
+        throw std::out_of_range("Disk Copy Error: Block ID out of bounds");
+    }
+    if (!cache) {
+        std::memcpy(mapped_data + dst_block * BLOCK_SIZE, mapped_data + src_block * BLOCK_SIZE, BLOCK_SIZE);
+    } else {
+        const uint8_t* src = cache->pin(src_block);
+        try {
+            std::memcpy(cache->pin(dst_block), src, BLOCK_SIZE);
+        } catch (...) {
+            cache->unpin(src_block);
+            throw;
+        }
+        cache->unpin(dst_block);
+        cache->unpin(src_block);
+    }
+    mark_dirty(dst_block);
+}
+
+static void clip_runs(std::vector<DiskRun>& runs, size_t block_count) {
+    size_t kept = 0;
+    for (DiskRun run : runs) {
+        if (run.first_block >= block_count) continue;
+        run.count = std::min(run.count, block_count - run.first_block);
+        if (run.count > 0) runs[kept++] = run;
+    }
+    runs.resize(kept);
+}
+
+void Disk::prefetch(std::vector<DiskRun> runs) {
+    clip_runs(runs, BLOCK_COUNT);
+    if (runs.empty()) return;
+
+    if (cache) cache->prefetch(runs);
+    else backend->prefetch(runs);
+}
+
+void Disk::prefault(std::vector<DiskRun> runs) {
+    clip_runs(runs, BLOCK_COUNT);
+    if (runs.empty()) return;
+
+    if (cache) cache->prefetch(runs);
+    else backend->populate(runs);
+}
+
+void Disk::pin_region(size_t first_block, size_t count) {
+    if (!cache || count == 0) return;
+    if (first_block + count > BLOCK_COUNT) throw std::out_of_range("Disk Pin Error: Region out of bounds");
+    cache->add_region(first_block, count);
+}
+
+void Disk::mark_dirty(size_t first_block, size_t count) {
+    size_t end = std::min(first_block + count, BLOCK_COUNT);
+    for (size_t b = first_block; b < end; b++) {
+        uint64_t bit = 1ULL << (b % 64);
+        if (!(dirty_bits[b / 64].fetch_or(bit, std::memory_order_relaxed) & bit)) {
+            dirty_count.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+// Clears the block's bit; true if it was set. The bit is dropped before the
+// flush, so a write racing with it is either flushed or stays marked.
+bool Disk::take_dirty(size_t block_id) {
+    uint64_t bit = 1ULL << (block_id % 64);
+    if (!(dirty_bits[block_id / 64].fetch_and(~bit, std::memory_order_relaxed) & bit)) return false;
+    dirty_count.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+void Disk::hold(size_t block_id) {
+    if (block_id >= BLOCK_COUNT) return;
+    uint64_t bit = 1ULL << (block_id % 64);
+    if (!(held_bits[block_id / 64].fetch_or(bit, std::memory_order_relaxed) & bit)) {
+        held_count.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Disk::release_holds(const std::vector<size_t>& blocks) {
+    for (size_t b : blocks) {
+        if (b >= BLOCK_COUNT) continue;
+        uint64_t bit = 1ULL << (b % 64);
+        if (held_bits[b / 64].fetch_and(~bit, std::memory_order_relaxed) & bit) {
+            held_count.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+    if (cache) cache->release_held();
+}
+
+void Disk::release_all_holds() {
+    for (auto& word : held_bits) word.store(0, std::memory_order_relaxed);
+    held_count = 0;
+    if (cache) cache->release_held();
+}
+
+void Disk::write_through(const std::vector<std::pair<size_t, const uint8_t*>>& blocks) {
+    if (blocks.empty()) return;
+    for (const auto& b : blocks) {
+        if (b.first >= BLOCK_COUNT) throw std::out_of_range("Disk Write Error: Block ID out of bounds");
+    }
+    if (cache) {
+        for (const auto& b : blocks) cache->write_through(b.first, b.second);
+    } else {
+        backend->write_blocks(blocks);
+    }
+    backend->sync_data();
+}
+
+size_t Disk::sync_range(size_t first_block, size_t count, SyncMode mode) {
+    if (first_block >= BLOCK_COUNT || count == 0) return 0;
+    size_t end = first_block + std::min(count, BLOCK_COUNT - first_block);
+
+    // Collect the dirty runs, then hand them to the backend in one batch
+    std::vector<DiskRun> runs;
+    size_t flushed = 0;
+    size_t b = first_block;
+    auto take = [&](size_t block) { return !is_held(block) && take_dirty(block); };
+    while (b < end) {
+        // Skip words with nothing to flush without touching their bits
+        if (b % 64 == 0 && flushable_bits(b / 64) == 0) {
+            b += 64;
+            continue;
+        }
+        if (!take(b)) {
+            b++;
+            continue;
+        }
+
+        size_t run_end = b + 1;
+        while (run_end < end && take(run_end)) run_end++;
+        runs.push_back({b, run_end - b});
+        flushed += run_end - b;
+        b = run_end;
+    }
+    if (runs.empty()) return 0;
+
+    try {
+        if (cache) {
+            cache->write_back(runs);
+            if (mode == SyncMode::Wait) backend->sync_data();
+        } else {
+            backend->write_back(runs, mode);
+        }
+    } catch (...) {
+        for (const DiskRun& run : runs) mark_dirty(run.first_block, run.count);
+        throw;
+    }
+    if (!cache) {
+        for (const DiskRun& run : runs) {
+            for (size_t i = run.first_block; i < run.first_block + run.count; i++) {
+                written_bits[i / 64].fetch_or(1ULL << (i % 64), std::memory_order_relaxed);
+            }
+        }
+    }
+    return flushed;
+}
+
+void Disk::sync_all(SyncMode mode) {
+    if (!cache) {
+        sync_range(0, BLOCK_COUNT, mode);
+        return;
+    }
+    for (size_t b = 0; b < BLOCK_COUNT; b += 64) {
+        uint64_t bits = flushable_bits(b / 64);
+        while (bits != 0) {
+            take_dirty(b + __builtin_ctzll(bits));
+            bits &= bits - 1;
+        }
+    }
+    cache->write_back_all(); // Skips held blocks by itself
+    if (mode == SyncMode::Wait) backend->sync_data();
+}
+
+void Disk::drop_written(size_t first_block, size_t count) {
+    if (cache || first_block >= BLOCK_COUNT) return;
+    size_t end = first_block + std::min(count, BLOCK_COUNT - first_block);
+    auto droppable = [&](size_t b) {
+        uint64_t bit = 1ULL << (b % 64);
+        return (written_bits[b / 64].load(std::memory_order_relaxed) & bit) &&
+               !(dirty_bits[b / 64].load(std::memory_order_relaxed) & bit) && !is_held(b);
+    };
+
+    std::vector<DiskRun> runs;
+    for (size_t b = first_block; b < end; ) {
+        if (b % 64 == 0 && written_bits[b / 64].load(std::memory_order_relaxed) == 0) {
+            b += 64;
+            continue;
+        }
+        if (!droppable(b)) {
+            b++;
+            continue;
+        }
+        size_t run_end = b + 1;
+        while (run_end < end && droppable(run_end)) run_end++;
+        for (size_t i = b; i < run_end; i++) {
+            written_bits[i / 64].fetch_and(~(1ULL << (i % 64)), std::memory_order_relaxed);
+        }
+        runs.push_back({b, run_end - b});
+        b = run_end;
+    }
+    if (!runs.empty()) backend->release(runs);
+}
+
 void Disk::hex_dump(int block_id) {
     if (block_id < 0 || block_id >= BLOCK_COUNT) {
         throw std::out_of_range("Disk Dump Error: Block ID out of bounds");
     }
     std::cout << "--- Hex Dump of Block " << block_id << " ---\n";
-    size_t start_offset = block_id * BLOCK_SIZE;
-    size_t end_offset = start_offset + BLOCK_SIZE;
+    std::vector<uint8_t> block(BLOCK_SIZE);
+    read_block(block_id, block.data());
 
-    for (size_t i = start_offset; i < end_offset; i++) {
+    for (size_t i = 0; i < BLOCK_SIZE; i++) {
         // --- OLD ABSTRACTION ---
         // int val = static_cast<int>(memory[i]);
 
         // --- NEW ABSTRACTION ---
-        int val = static_cast<int>(this->mapped_data[i]);
+        int val = static_cast<int>(block[i]);
 
         std::cout << std::hex << std::setw(2) << std::setfill('0')
                   << val << " ";
-        if ((i - start_offset + 1) % 16 == 0) {
+        if ((i + 1) % 16 == 0) {
             std::cout << "\n";
         }
     }
@@ -0,0 +1,247 @@
+#include "fs/disk_backend.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+
+#include <climits>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+DiskBackendType parse_disk_backend(const std::string& name) {
+    if (name == "mmap") return DiskBackendType::Mmap;
+    if (name == "pread") return DiskBackendType::Pread;
+    if (name == "uring" || name == "io_uring") return DiskBackendType::IoUring;
+    throw std::invalid_argument("Unknown disk backend: " + name + " (use mmap, pread or uring)");
+}
+
+std::unique_ptr<DiskBackend> make_disk_backend(DiskBackendType type) {
+    switch (type) {
+        case DiskBackendType::Pread: return std::make_unique<PreadBackend>();
+        case DiskBackendType::IoUring: return std::make_unique<IoUringBackend>();
+        case DiskBackendType::Mmap: break;
+    }
+    return std::make_unique<MmapBackend>();
+}
+
+void DiskBackend::read_block(size_t, uint8_t*) {
+    throw std::logic_error(std::string(name()) + " backend has no block I/O");
+}
+
+void DiskBackend::read_blocks(const std::vector<std::pair<size_t, uint8_t*>>& blocks) {
+    for (const auto& b : blocks) read_block(b.first, b.second);
+}
+
+void DiskBackend::write_blocks(const std::vector<std::pair<size_t, const uint8_t*>>&) {
+    throw std::logic_error(std::string(name()) + " backend has no block I/O");
+}
+
+// Loops until the whole range has moved; throws on errors and EOF
+static void transfer_fd(int fd, bool write, uint8_t* buf, size_t offset, size_t len) {
+    for (size_t done = 0; done < len; ) {
+        ssize_t n = write ? pwrite(fd, buf + done, len - done, offset + done)
+                          : pread(fd, buf + done, len - done, offset + done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) throw std::runtime_error(write ? "Disk Sync Error: pwrite failed" : "Failed to read disk image");
+        done += n;
+    }
+}
+
+// ==========================================
+// MMAP
+// ==========================================
+MmapBackend::~MmapBackend() {
+    if (image != nullptr) munmap(image, bytes);
+    if (fd != -1) close(fd);
+}
+
+uint8_t* MmapBackend::open(const char* filename, size_t bytes, size_t block_size, bool) {
+    this->bytes = bytes;
+    this->block_size = block_size;
+
+    // 1. Open File (Create if doesn't exist)
+    fd = ::open(filename, O_RDWR | O_CREAT, 0666);
+    if (fd == -1) throw std::runtime_error("Failed to open disk image file");
+
+    // 2. Resize File to match disk capacity (Physical Allocation)
+    if (ftruncate(fd, bytes) == -1) throw std::runtime_error("Failed to resize disk image");
+
+    // 3. Map File to Memory (The "Magic" Link). Private: changes reach the
+    // file only through write_back, never behind the journal's back.
+    void* mapped = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) throw std::runtime_error("Failed to mmap disk image");
+    image = static_cast<uint8_t*>(mapped);
+    return image;
+}
+
+void MmapBackend::write_back(const std::vector<DiskRun>& runs, SyncMode mode) {
+    for (const DiskRun& run : runs) {
+        size_t offset = run.first_block * block_size;
+        transfer_fd(fd, true, image + offset, offset, run.count * block_size);
+    }
+    if (mode == SyncMode::Wait && !runs.empty()) sync_data();
+}
+
+// A written page of a private file mapping is an anonymous copy: present or
+// swapped out, but no longer a file page (pagemap bits 63, 62 and 61)
+std::vector<DiskRun> MmapBackend::written_runs() const {
+    const size_t block_count = bytes / block_size;
+    int pagemap = ::open("/proc/self/pagemap", O_RDONLY);
+    if (pagemap == -1) return {DiskRun{0, block_count}};
+
+    std::vector<DiskRun> runs;
+    const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t pages = (bytes + page_size - 1) / page_size;
+    const size_t first_page = reinterpret_cast<uintptr_t>(image) / page_size;
+    std::vector<uint64_t> entries(512);
+    for (size_t page = 0; page < pages; ) {
+        size_t n = std::min(entries.size(), pages - page);
+        ssize_t got = pread(pagemap, entries.data(), n * sizeof(uint64_t), (first_page + page) * sizeof(uint64_t));
+        if (got != static_cast<ssize_t>(n * sizeof(uint64_t))) {
+            close(pagemap);
+            return {DiskRun{0, block_count}};
+        }
+        for (size_t i = 0; i < n; i++, page++) {
+            uint64_t e = entries[i];
+            if (!(e >> 63 & 1) && !(e >> 62 & 1)) continue; // Never touched
+            if (e >> 61 & 1) continue;                       // Still the file's page
+            size_t first = page * page_size / block_size;
+            size_t end = std::min(block_count, ((page + 1) * page_size + block_size - 1) / block_size);
+            if (!runs.empty() && runs.back().first_block + runs.back().count >= first) {
+                runs.back().count = end - runs.back().first_block;
+            } else {
+                runs.push_back({first, end - first});
+            }
+        }
+    }
+    close(pagemap);
+    return runs;
+}
+
+// Only whole pages inside a run are dropped: a page shared with a block
+// outside it may hold that block's unwritten changes
+void MmapBackend::release(const std::vector<DiskRun>& runs) {
+    const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    for (const DiskRun& run : runs) {
+        size_t begin = (run.first_block * block_size + page_size - 1) / page_size * page_size;
+        size_t end = (run.first_block + run.count) * block_size / page_size * page_size;
+        if (begin < end) madvise(image + begin, end - begin, MADV_DONTNEED);
+    }
+}
+
+void MmapBackend::write_blocks(const std::vector<std::pair<size_t, const uint8_t*>>& blocks) {
+    for (const auto& b : blocks) transfer_fd(fd, true, const_cast<uint8_t*>(b.second), b.first * block_size, block_size);
+}
+
+void MmapBackend::sync_data() {
+    if (fdatasync(fd) == -1) throw std::runtime_error("Disk Sync Error: fdatasync failed");
+}
+
+// Starts the page cache reading the runs in, so the copy that follows takes
+// minor faults instead of waiting on the device page by page. Only a hint:
+// failures are ignored. MADV_SEQUENTIAL is left out because it also lets the
+// kernel drop the pages early, and data read once is often read again.
+void MmapBackend::prefetch(const std::vector<DiskRun>& runs) {
+    for (const DiskRun& run : runs) {
+        madvise(image + run.first_block * block_size, run.count * block_size, MADV_WILLNEED);
+    }
+}
+
+// MADV_POPULATE_READ (Linux 5.14) faults the whole run in with one call;
+// older kernels get one read per page instead. Read faults only: write
+// faults would copy every page and make the shutdown flush write them all.
+void MmapBackend::populate(const std::vector<DiskRun>& runs) {
+    for (const DiskRun& run : runs) {
+        uint8_t* start = image + run.first_block * block_size;
+        size_t len = run.count * block_size;
+#ifdef MADV_POPULATE_READ
+        if (madvise(start, len, MADV_POPULATE_READ) == 0) continue;
+#endif
+        for (size_t off = 0; off < len; off += 4096) (void)*static_cast<volatile uint8_t*>(start + off);
+    }
+}
+
+// ==========================================
+// PREAD / PWRITE
+// ==========================================
+PreadBackend::~PreadBackend() {
+    if (image != nullptr) munmap(image, bytes);
+    if (fd != -1) close(fd);
+}
+
+void PreadBackend::open_file(const char* filename, size_t bytes, size_t block_size) {
+    this->bytes = bytes;
+    this->block_size = block_size;
+
+    fd = ::open(filename, O_RDWR | O_CREAT | O_DIRECT, 0666);
+    direct = fd != -1;
+    if (fd == -1 && errno == EINVAL) fd = ::open(filename, O_RDWR | O_CREAT, 0666);
+    if (fd == -1) throw std::runtime_error("Failed to open disk image file");
+    if (ftruncate(fd, bytes) == -1) throw std::runtime_error("Failed to resize disk image");
+}
+
+void PreadBackend::allocate_image() {
+    void* mapped = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED) throw std::runtime_error("Failed to allocate disk image memory");
+    image = static_cast<uint8_t*>(mapped);
+}
+
+uint8_t* PreadBackend::open(const char* filename, size_t bytes, size_t block_size, bool load_image) {
+    open_file(filename, bytes, block_size);
+    if (!load_image) return nullptr;
+    allocate_image();
+    transfer(false, image, 0, bytes);
+    return image;
+}
+
+void PreadBackend::transfer(bool write, uint8_t* buf, size_t offset, size_t len) {
+    transfer_fd(fd, write, buf, offset, len);
+}
+
+void PreadBackend::write_back(const std::vector<DiskRun>& runs, SyncMode mode) {
+    for (const DiskRun& run : runs) {
+        size_t offset = run.first_block * block_size;
+        transfer(true, image + offset, offset, run.count * block_size);
+    }
+    if (mode == SyncMode::Wait && !runs.empty()) sync_data();
+}
+
+void PreadBackend::read_block(size_t block_id, uint8_t* buf) {
+    transfer(false, buf, block_id * block_size, block_size);
+}
+
+// Consecutive block ids become one preadv into their separate buffers
+void PreadBackend::read_blocks(const std::vector<std::pair<size_t, uint8_t*>>& blocks) {
+    std::vector<iovec> iov;
+    for (size_t i = 0; i < blocks.size(); ) {
+        size_t first = blocks[i].first;
+        iov.clear();
+        while (i < blocks.size() && blocks[i].first == first + iov.size() && iov.size() < IOV_MAX) {
+            iov.push_back({blocks[i].second, block_size});
+            i++;
+        }
+
+        ssize_t n;
+        do {
+            n = preadv(fd, iov.data(), static_cast<int>(iov.size()), static_cast<off_t>(first * block_size));
+        } while (n < 0 && errno == EINTR);
+        if (n == static_cast<ssize_t>(iov.size() * block_size)) continue;
+
+        // Short read or error: redo the run one block at a time
+        for (size_t k = 0; k < iov.size(); k++) read_block(first + k, static_cast<uint8_t*>(iov[k].iov_base));
+    }
+}
+
+void PreadBackend::write_blocks(const std::vector<std::pair<size_t, const uint8_t*>>& blocks) {
+    for (const auto& b : blocks) transfer(true, const_cast<uint8_t*>(b.second), b.first * block_size, block_size);
+}
+
+// O_DIRECT bypasses the page cache but not the device's write cache
+void PreadBackend::sync_data() {
+    if (fdatasync(fd) == -1) throw std::runtime_error("Disk Sync Error: fdatasync failed");
+}
+
+std::vector<DiskRun> PreadBackend::written_runs() const {
+    return {DiskRun{0, bytes / block_size}};
+}
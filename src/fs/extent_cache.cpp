@@ -0,0 +1,102 @@
+#include "fs/extent_cache.hpp"
+#include <algorithm>
+
+ExtentCache::ExtentCache(size_t slot_count) : slots(slot_count == 0 ? 1 : slot_count) {}
+
+bool ExtentCache::lookup(size_t inode_id, size_t logical, size_t* physical, size_t* run) {
+    Slot& slot = slot_for(inode_id);
+    std::lock_guard<std::mutex> guard(slot.lock);
+    if (slot.valid && slot.inode_id == inode_id) {
+        // Last extent starting at or before `logical`
+        auto it = std::upper_bound(slot.extents.begin(), slot.extents.end(), logical,
+                                   [](size_t l, const Extent& e) { return l < e.logical; });
+        if (it != slot.extents.begin()) {
+            const Extent& e = *(it - 1);
+            if (logical < e.logical + e.length) {
+                *physical = e.physical + (logical - e.logical);
+                if (run != nullptr) *run = e.length - (logical - e.logical);
+                hits++;
+                return true;
+            }
+        }
+    }
+    misses++;
+    return false;
+}
+
+void ExtentCache::insert(size_t inode_id, size_t logical, size_t physical, size_t length) {
+    if (length == 0) return;
+
+    Slot& slot = slot_for(inode_id);
+    std::lock_guard<std::mutex> guard(slot.lock);
+    if (!slot.valid || slot.inode_id != inode_id || slot.extents.size() >= MAX_EXTENTS) {
+        slot.valid = true;
+        slot.inode_id = inode_id;
+        slot.extents.clear();
+    }
+
+    std::vector<Extent>& extents = slot.extents;
+
+    // Fast path: sequential growth extends the last run
+    if (!extents.empty()) {
+        Extent& last = extents.back();
+        if (logical == last.logical + last.length && physical == last.physical + last.length) {
+            last.length += length;
+            return;
+        }
+    }
+
+    auto it = std::upper_bound(extents.begin(), extents.end(), logical,
+                               [](size_t l, const Extent& e) { return l < e.logical; });
+
+    // Already covered (callers only insert what they just read from disk)
+    if (it != extents.begin()) {
+        const Extent& prev = *(it - 1);
+        if (logical + length <= prev.logical + prev.length) return;
+    }
+
+    // A partial overlap means the map disagrees with the disk; start over
+    // rather than reconcile runs.
+    bool overlaps = (it != extents.begin() && logical < (it - 1)->logical + (it - 1)->length) ||
+                    (it != extents.end() && logical + length > it->logical);
+    if (overlaps) {
+        extents.clear();
+        extents.push_back({logical, physical, length});
+        return;
+    }
+
+    it = extents.insert(it, {logical, physical, length});
+
+    // Merge with the neighbours when the runs touch both logically and physically
+    if (it + 1 != extents.end()) {
+        Extent& next = *(it + 1);
+        if (it->logical + it->length == next.logical && it->physical + it->length == next.physical) {
+            it->length += next.length;
+            extents.erase(it + 1);
+        }
+    }
+    if (it != extents.begin()) {
+        Extent& prev = *(it - 1);
+        if (prev.logical + prev.length == it->logical && prev.physical + prev.length == it->physical) {
+            prev.length += it->length;
+            extents.erase(it);
+        }
+    }
+}
+
+void ExtentCache::invalidate(size_t inode_id) {
+    Slot& slot = slot_for(inode_id);
+    std::lock_guard<std::mutex> guard(slot.lock);
+    if (slot.valid && slot.inode_id == inode_id) {
+        slot.valid = false;
+        slot.extents.clear();
+    }
+}
+
+void ExtentCache::clear() {
+    for (auto& slot : slots) {
+        std::lock_guard<std::mutex> guard(slot.lock);
+        slot.valid = false;
+        slot.extents.clear();
+    }
+}
@@ -1,24 +1,51 @@
 #include "fs/filesystem.hpp"
+#include "fs/directory.hpp"
+#include "fs/logger.hpp"
 #include "util/tokenizer.h"
-#include <iostream>
 #include <cstring>
 #include <algorithm> // GEMINI FIX: for std::min
+#include <exception>
+#include <unordered_set>
 
-FileSystem::FileSystem(Disk& disk_allocated) : disk(disk_allocated) {
+FileSystem::FileSystem(Disk& disk_allocated) : disk(disk_allocated), journal(disk_allocated) {
     this->sb = new SuperBlock();
 }
 
-void FileSystem::format() {
-    std::cout << "Formatting Disk...\n";
+// Unmount: the last transaction is committed and the journal left empty
+FileSystem::~FileSystem() {
+    Disk::PinScope pins(disk);
+    set_background_reclaim(false);
+    try {
+        reclaim_all_locked();
+        if (journal.enabled()) {
+            journal.commit();
+            journal.checkpoint();
+        }
+    } catch (const std::exception& e) {
+        Logger::log(LogLevel::Error, "Journal flush on unmount failed: ", e.what());
+    }
+    delete this->sb;
+}
 
-    // 1. Wipe the ENTIRE disk with zeros
-    std::vector<uint8_t> zeros(disk.get_block_size(), 0);
-    for (size_t i = 0; i < disk.get_block_count(); i++) {
-        disk.write_block(i, zeros.data());
+void FileSystem::format(bool lazy) {
+    Disk::PinScope pins(disk);
+    std::unique_lock<std::shared_mutex> tree(tree_lock);
+    Logger::log(LogLevel::Info, "Formatting Disk...");
+    // Trees removed from the old file system die with it
+    reclaim_pending = false;
+
+    // 1. Wipe the ENTIRE disk with zeros (lazy: only the blocks written
+    // below, the rest may keep stale contents)
+    if (!lazy) {
+        std::vector<uint8_t> zeros(disk.get_block_size(), 0);
+        for (size_t i = 0; i < disk.get_block_count(); i++) {
+            disk.write_block(i, zeros.data());
+        }
     }
 
     // 2. Configure the SuperBlock object in memory
     sb->magic_number = 0xF5513001;
+    sb->format_version = FS_FORMAT_VERSION;
     sb->total_blocks = disk.get_block_count();
 
     // Logic for small disks (tests) vs large disks
@@ -34,6 +61,9 @@ void FileSystem::format() {
     size_t group_count = (sb->total_blocks + sb->blocks_per_group - 1) / sb->blocks_per_group;
     sb->total_inodes = group_count * sb->inodes_per_group;
     sb->home_dir_inode = 0; // Temp
+    sb->journal_start = 0;  // Reserved below, once the groups exist
+    sb->journal_blocks = 0;
+    sb->orphan_head = 0;
 
     // 3. Write SuperBlock to Disk SAFELY
     // GEMINI FIX: Create a zeroed 4KB buffer, copy SB into it, then write.
@@ -42,8 +72,30 @@ void FileSystem::format() {
     std::memcpy(sb_buffer.data(), sb, sizeof(SuperBlock));
     disk.write_block(0, sb_buffer.data());
 
-    // 4. Mount to initialize managers
-    mount();
+    // 4. Set up the managers, then write fresh group descriptors
+    attach_groups_locked();
+    for (size_t g = 0; g < block_group_managers.size(); g++) {
+        BlockGroupManager& bgm = block_group_managers[g];
+        // Group 0 holds the root and the journal, so it is always written
+        if (lazy && g == 0) bgm.init_metadata();
+        bgm.init_descriptor(lazy && g != 0);
+        bgm.pin_inode_table();
+    }
+
+    // 4b. Reserve the journal as one run at the start of group 0's data area
+    size_t journal_blocks = std::min<size_t>(std::max<size_t>(sb->total_blocks / 16, 16), 8192);
+    journal_blocks = std::min(journal_blocks, block_group_managers[0].get_free_blocks_count() / 4);
+    if (journal_blocks >= 8) {
+        int run = 0;
+        int journal_start = block_group_managers[0].allocate_block_run(static_cast<int>(journal_blocks), -1, &run, false);
+        if (journal_start != -1) {
+            sb->journal_start = journal_start;
+            sb->journal_blocks = run;
+            // Stale log blocks could pass for transactions of the new journal
+            if (lazy) disk.zero_bytes(journal_start, 0, static_cast<size_t>(run) * disk.get_block_size());
+        }
+    }
+    journal.create(sb->journal_start, sb->journal_blocks);
 
     // 5. Create Root Inode
     int root_id = block_group_managers[0].allocate_inode();
@@ -68,16 +120,26 @@ void FileSystem::format() {
     add_entry_to_dir(root, root_id, "..");
 
     // 8. Write Updated SuperBlock to Disk (Final Update)
-    std::memcpy(sb_buffer.data(), sb, sizeof(SuperBlock)); // Update buffer
-    disk.write_block(0, sb_buffer.data());
+    // Only the struct is rewritten: block 0 also holds group 0's descriptor.
+    std::memcpy(disk.get_ptr(0), sb, sizeof(SuperBlock));
+    journal.checkpoint(); // The fresh file system is durable as a whole
 
-    std::cout << "Disk Formatted. Root Inode ID: " << root_id << "\n";
+    Logger::log(LogLevel::Info, "Disk Formatted. Root Inode ID: ", root_id);
 }
 
 // ==========================================
 // MOUNT: The "Boot Up" (Read Only)
 // ==========================================
-void FileSystem::mount() {
+void FileSystem::mount(MountMode mode) {
+    FS_STATS_TIMER(&op_stats, FsOp::Mount);
+    Disk::PinScope pins(disk);
+    std::unique_lock<std::shared_mutex> tree(tree_lock);
+    mount_locked(mode);
+}
+
+// Caller holds tree_lock exclusively: no other operation is in flight
+void FileSystem::mount_locked(MountMode mode) {
+    reclaim_all_locked(); // Queued work refers to the image as it is now
     uint8_t* buffer = disk.get_ptr(0);
     SuperBlock* disk_sb = reinterpret_cast<SuperBlock*>(buffer);
 
@@ -85,18 +147,164 @@ void FileSystem::mount() {
         throw std::runtime_error("Error: Invalid FileSystem (Bad Magic Number)");
     }
 
+    if (disk_sb->format_version != FS_FORMAT_VERSION) {
+        throw std::runtime_error("Error: Unsupported format version " + std::to_string(disk_sb->format_version) +
+                                 " (expected " + std::to_string(FS_FORMAT_VERSION) + ")");
+    }
+
     std::memcpy(this->sb, disk_sb, sizeof(SuperBlock));
 
+    // Redo committed metadata before anything reads a bitmap or descriptor
+    size_t replayed = journal.recover(sb->journal_start, sb->journal_blocks);
+    if (replayed > 0) {
+        Logger::log(LogLevel::Info, "Journal: replayed ", replayed, " transaction(s).");
+        std::memcpy(this->sb, disk.get_ptr(0), sizeof(SuperBlock)); // Block 0 may be among them
+    }
+
+    attach_groups_locked();
+    int total_groups = static_cast<int>(block_group_managers.size());
+
+    // Every image of this format version has a descriptor per group (the
+    // version check above turns away anything older), so a missing one
+    // means the image is damaged
+    for (int i = 0; i < total_groups; i++) {
+        if (!block_group_managers[i].has_valid_descriptor()) {
+            throw std::runtime_error("Error: Group " + std::to_string(i) + " has no valid descriptor");
+        }
+    }
+    if (mode == MountMode::Fast) {
+        for (auto& bgm : block_group_managers) bgm.pin_inode_table();
+        finish_orphans_locked();
+        Logger::log(LogLevel::Info, "FileSystem Mounted. Groups: ", total_groups);
+        return;
+    }
+
+    // Warm: every group is independent, so they are validated and loaded
+    // side by side
+    std::atomic<size_t> rebuilt{0};
+    parallel_for(block_group_managers.size(), [&](size_t g) {
+        Disk::PinScope pins(disk);
+        BlockGroupManager& bgm = block_group_managers[g];
+        if (!bgm.descriptor_matches_bitmaps()) {
+            bgm.rebuild_descriptor();
+            rebuilt++;
+        }
+        bgm.warm_metadata();
+    });
+    FS_STATS_RECORD(&op_stats, add_descriptors_rebuilt(rebuilt));
+    if (rebuilt > 0) Logger::log(LogLevel::Warning, "Mount: rebuilt ", rebuilt.load(), " stale group descriptor(s).");
+    finish_orphans_locked();
+    Logger::log(LogLevel::Info, "FileSystem Mounted. Groups: ", total_groups, " (warm)");
+}
+
+// One manager per group of *sb; everything cached about the previous
+// layout goes (mount, format)
+void FileSystem::attach_groups_locked() {
     // GEMINI FIX: Use Ceiling Division here too
     int total_groups = (sb->total_blocks + sb->blocks_per_group - 1) / sb->blocks_per_group;
 
     block_group_managers.clear();
     block_group_managers.reserve(total_groups);
+    dcache.clear();
+    open_files.clear(); // Handles do not survive a remount
+    extent_cache.clear();
 
     for (int i = 0; i < total_groups; i++) {
-        block_group_managers.emplace_back(disk, sb, i);
+        block_group_managers.emplace_back(disk, sb, i, &journal, &op_stats);
+    }
+}
+
+void FileSystem::parallel_for(size_t tasks, const std::function<void(size_t)>& fn) {
+    size_t workers = std::min<size_t>(tasks, std::max(1u, std::thread::hardware_concurrency()));
+    std::atomic<size_t> next{0};
+    std::exception_ptr error;
+    std::mutex error_lock;
+
+    auto worker = [&] {
+        for (size_t task = next++; task < tasks; task = next++) {
+            try {
+                fn(task);
+            } catch (...) {
+                std::lock_guard<std::mutex> guard(error_lock);
+                if (!error) error = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < workers; i++) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+    if (error) std::rethrow_exception(error);
+}
+
+void FileSystem::sync(SyncMode mode) {
+    Disk::PinScope pins(disk);
+    std::unique_lock<std::shared_mutex> tree(tree_lock);
+    reclaim_all_locked();
+    // Data and earlier transactions first (the running one is held back),
+    // then the commit, then the home blocks it just released
+    disk.sync_range(0, disk.get_block_count(), mode);
+    journal.commit();
+    disk.sync_range(0, disk.get_block_count(), mode);
+    disk.drop_written(0, disk.get_block_count()); // Nothing writes under the exclusive lock
+}
+
+// Data first, then the journal commit that carries the inode and its block
+// map: after a crash the file is never longer than what reached the disk.
+// Data blocks reused from a free that had not committed yet are held until
+// that commit, so their runs are flushed once more after it.
+void FileSystem::fsync(std::string_view path, SyncMode mode) {
+    Disk::PinScope pins(disk);
+    std::vector<DiskRun> runs;
+    {
+        std::shared_lock<std::shared_mutex> tree(tree_lock);
+        InodeGuard guard;
+        Inode* file = resolve_regular_file(path, 0, LockMode::Shared, guard);
+
+        size_t block_size = disk.get_block_size();
+        size_t blocks = (file->file_size + block_size - 1) / block_size;
+        for (size_t logical = 0; logical < blocks; ) {
+            size_t run = 1;
+            size_t physical = map_file_block(file, logical, &run);
+            run = std::min(run, blocks - logical);
+            if (physical != 0) {
+                disk.sync_range(physical, run, mode);
+                disk.drop_written(physical, run); // Writers need the inode lock exclusively
+                runs.push_back({physical, run});
+            }
+            logical += run;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> tree(tree_lock);
+    journal.commit();
+    for (const DiskRun& run : runs) disk.sync_range(run.first_block, run.count, mode);
+}
+
+// Group commit: the transaction is closed by whichever operation finds it
+// due, once the operations already inside it have drained.
+void FileSystem::begin_metadata_op() {
+    if (journal.should_commit()) {
+        std::unique_lock<std::shared_mutex> tree(tree_lock);
+        if (journal.should_commit()) journal.commit();
     }
-    std::cout << "FileSystem Mounted. Groups: " << total_groups << "\n";
+    // Without the background reclaimer, removed trees are paid off a chunk
+    // per metadata operation
+    if (reclaim_pending && !background_reclaim) {
+        std::unique_lock<std::shared_mutex> tree(tree_lock);
+        reclaim_deferred(RECLAIM_CHUNK);
+    }
+    journal.note_operation();
+}
+
+void FileSystem::journal_inode(size_t inode_id) {
+    block_group_managers[group_of_inode(inode_id)].journal_inode(static_cast<int>(inode_id));
+}
+
+uint8_t* FileSystem::meta_ptr(size_t block_id) {
+    journal.mark_dirty(block_id);
+    return disk.get_ptr(block_id);
 }
 
 // ---------------- HELPERS ----------------
@@ -109,571 +317,1846 @@ Inode* FileSystem::get_global_inode_ptr(size_t global_id) {
     return block_group_managers[group_index].get_inode(global_id);
 }
 
-size_t FileSystem::find_inode_in_dir(Inode* parent_inode, const std::string& name) {
+// Cached lookup: answers repeated (and repeatedly missing) names without
+// touching the directory blocks.
+size_t FileSystem::find_inode_in_dir(Inode* parent_inode, std::string_view name) {
+    size_t child_id = 0;
+    if (dcache.lookup(parent_inode->id, name, &child_id)) return child_id;
+
+    child_id = scan_dir_for_name(parent_inode, name);
+    dcache.insert(parent_inode->id, name, child_id);
+    return child_id;
+}
+
+size_t FileSystem::scan_dir_for_name(Inode* parent_inode, std::string_view name) {
+    // Indexed directory: the name hash selects exactly one bucket block
+    DirIndexBlock* index = get_dir_index(parent_inode);
+    if (index != nullptr) {
+        DirRecord* entry = dir_block_find(get_dir_bucket(parent_inode, index, name), name);
+        return entry ? entry->inode_id : 0;
+    }
+
+    // Linear directory: scan every entry block
     for (int i = 0; i < 12; i++) {
         size_t block_id = parent_inode->direct_blocks[i];
         if (block_id == 0) break;
 
-        uint8_t* buffer = disk.get_ptr(block_id);
-        DirEntry* entry = reinterpret_cast<DirEntry*>(buffer);
-        int max_entries = 4096 / sizeof(DirEntry);
-
-        for (int j = 0; j < max_entries; j++) {
-            if (entry[j].inode_id != 0 &&
-                std::strncmp(entry[j].name, name.c_str(), 255) == 0) {
-                return entry[j].inode_id;
-            }
-        }
+        DirRecord* entry = dir_block_find(disk.get_ptr(block_id), name);
+        if (entry != nullptr) return entry->inode_id;
     }
     return 0;
 }
 
-size_t FileSystem::traverse_path_till_parent(std::vector<std::string>& tokenized_path) {
-    if (tokenized_path.empty()) return sb->home_dir_inode;
+bool FileSystem::lookup_in_dir(size_t dir_id, std::string_view name, size_t* child_id) {
+    FS_STATS_TIMER(&op_stats, FsOp::Lookup);
+    InodeGuard guard(inode_locks, dir_id, LockMode::Shared);
+    Inode* dir = get_global_inode_ptr(dir_id);
+    if (dir->file_type != FS_DIRECTORY) return false;
+    *child_id = find_inode_in_dir(dir, name);
+    return true;
+}
+
+// Copies the target out under the link's lock: the data block may be freed
+// and reused as soon as the lock is dropped. False if not a symlink.
+bool FileSystem::read_symlink_target(size_t inode_id, std::string& target) {
+    InodeGuard guard(inode_locks, inode_id, LockMode::Shared);
+    Inode* link = get_global_inode_ptr(inode_id);
+    if (link->file_type != FS_SYMLINK) return false;
+
+    target = symlink_target(link);
+    return true;
+}
+
+// Fast symlinks keep the target in the inode, others in one data block
+std::string FileSystem::symlink_target(Inode* link) {
+    if (link->flags & INODE_FLAG_INLINE) {
+        return std::string(reinterpret_cast<const char*>(inline_data(link)),
+                           std::min(INODE_INLINE_CAPACITY, link->file_size));
+    }
+    if (link->direct_blocks[0] == 0) return std::string();
+    return std::string(reinterpret_cast<const char*>(disk.get_ptr(link->direct_blocks[0])),
+                       std::min(disk.get_block_size(), link->file_size));
+}
+
+// ".." of a directory, read through its own entry (and so the dcache);
+// root's ".." points at itself.
+size_t FileSystem::parent_of_dir(size_t dir_id) {
+    size_t parent_id = 0;
+    if (!lookup_in_dir(dir_id, "..", &parent_id)) {
+        throw std::runtime_error("Invalid Path: '..' of a non-directory.");
+    }
+    return parent_id;
+}
 
+size_t FileSystem::traverse_path_till_parent(std::string_view path, std::string_view& leaf) {
+    FS_STATS_TIMER(&op_stats, FsOp::PathWalk);
     size_t current_id = sb->home_dir_inode;
-    std::vector<size_t> path_stack;
-    path_stack.push_back(sb->home_dir_inode);
+    PathIterator it(path);
+
+    leaf = std::string_view();
+    if (!it.next(leaf)) return current_id;
 
-    if (tokenized_path.size() == 1) return current_id;
+    // One component of lookahead: `part` is resolved only once we know it
+    // is not the last one.
+    std::string_view next_part;
+    while (it.next(next_part)) {
+        std::string_view part = leaf;
+        leaf = next_part;
 
-    for (size_t i = 0; i < tokenized_path.size() - 1; i++) {
-        std::string& part = tokenized_path[i];
-        
         if (part == ".") {
             continue;
         } else if (part == "..") {
-            if (path_stack.size() > 1) {
-                path_stack.pop_back();
-                current_id = path_stack.back();
-            }
+            current_id = parent_of_dir(current_id);
             continue;
         }
 
-        Inode* current_inode = get_global_inode_ptr(current_id);
-        if (current_inode->file_type != FS_DIRECTORY) {
-            throw std::runtime_error("Invalid Path: '" + part + "' is not a directory.");
+        // Each directory is locked (shared) only for its own lookup, so the
+        // walk never holds more than one inode lock.
+        size_t next_id = 0;
+        if (!lookup_in_dir(current_id, part, &next_id)) {
+            throw std::runtime_error("Invalid Path: '" + std::string(part) + "' is not a directory.");
         }
-        
-        size_t next_id = find_inode_in_dir(current_inode, part);
         if (next_id == 0) {
-            throw std::runtime_error("Path not found: " + part);
+            throw std::runtime_error("Path not found: " + std::string(part));
         }
 
-        Inode* next_inode = get_global_inode_ptr(next_id);
-        if (next_inode->file_type == FS_SYMLINK) {
-            size_t block_size = disk.get_block_size();
-            char target[4096];
-            std::memset(target, 0, sizeof(target));
-            if (next_inode->direct_blocks[0] != 0) {
-                std::memcpy(target, disk.get_ptr(next_inode->direct_blocks[0]), std::min(block_size, next_inode->file_size));
-            }
-            std::string symlink_target(target, next_inode->file_size);
-            
-            auto sym_tokens = tokenize_path(symlink_target, '/');
+        std::string symlink_target;
+        if (read_symlink_target(next_id, symlink_target)) {
             if (!symlink_target.empty() && symlink_target[0] == '/') {
                 current_id = sb->home_dir_inode;
-                path_stack.clear();
-                path_stack.push_back(sb->home_dir_inode);
             }
-            
-            for (auto& tok : sym_tokens) {
-                if (tok == "." || tok.empty()) continue;
+
+            PathIterator sym_it(symlink_target);
+            std::string_view tok;
+            while (sym_it.next(tok)) {
+                if (tok == ".") continue;
                 if (tok == "..") {
-                    if (path_stack.size() > 1) {
-                        path_stack.pop_back();
-                        current_id = path_stack.back();
-                    }
+                    current_id = parent_of_dir(current_id);
                 } else {
-                    Inode* curr = get_global_inode_ptr(current_id);
-                    if (curr->file_type != FS_DIRECTORY) {
+                    size_t found = 0;
+                    if (!lookup_in_dir(current_id, tok, &found)) {
                         throw std::runtime_error("Symlink points to non-directory");
                     }
-                    size_t found = find_inode_in_dir(curr, tok);
-                    if (found == 0) throw std::runtime_error("Symlink target not found: " + tok);
+                    if (found == 0) throw std::runtime_error("Symlink target not found: " + std::string(tok));
                     current_id = found;
-                    path_stack.push_back(current_id);
                 }
             }
         } else {
             current_id = next_id;
-            path_stack.push_back(current_id);
         }
     }
     return current_id;
 }
 
-void FileSystem::add_entry_to_dir(Inode* parent_inode, size_t newfile_id, std::string filename) {
-    int max_entries = 4096 / sizeof(DirEntry);
+size_t FileSystem::lock_entry(std::string_view path, LockMode parent_mode, LockMode target_mode, InodeGuard& guard,
+                              size_t* parent_id, std::string_view* leaf) {
+    std::string_view name;
+    size_t dir_id = traverse_path_till_parent(path, name);
+    if (parent_id != nullptr) *parent_id = dir_id;
+    if (leaf != nullptr) *leaf = name;
+    return lock_entry_at(dir_id, name, path, parent_mode, target_mode, guard);
+}
 
-    for (int i = 0; i < 12; i++) {
-        size_t curr_block_id = parent_inode->direct_blocks[i];
+size_t FileSystem::lock_entry_at(size_t dir_id, std::string_view name, std::string_view path, LockMode parent_mode,
+                                 LockMode target_mode, InodeGuard& guard) {
+    // Look the entry up unlocked, lock (parent, entry) in stripe order, then
+    // confirm the parent still maps the name to the same inode. A concurrent
+    // create/delete in between just costs another round.
+    while (true) {
+        size_t child_id = 0;
+        if (!name.empty() && !lookup_in_dir(dir_id, name, &child_id)) {
+            throw std::runtime_error("Invalid Path: parent of '" + std::string(name) + "' is not a directory.");
+        }
 
-        // Alloc new block if needed
-        if (curr_block_id == 0) {
-            int group_idx = parent_inode->id / sb->inodes_per_group;
-            int new_block = block_group_managers[group_idx].allocate_block();
-            if (new_block == -1) throw std::runtime_error("Disk Full: Cannot grow directory");
+        if (child_id == 0) guard = InodeGuard(inode_locks, dir_id, parent_mode);
+        else guard = InodeGuard(inode_locks, dir_id, parent_mode, child_id, target_mode);
 
-            parent_inode->direct_blocks[i] = new_block;
-            curr_block_id = new_block;
+        Inode* dir = get_global_inode_ptr(dir_id);
+        if (dir->file_type != FS_DIRECTORY || !block_group_managers[group_of_inode(dir_id)].is_inode_allocated(dir_id)) {
+            throw std::runtime_error("Path not found: " + std::string(path));
+        }
+        size_t current = name.empty() ? 0 : find_inode_in_dir(dir, name);
+        if (current == child_id) {
+            // Exclusive means "about to be modified": log the inode blocks
+            if (parent_mode == LockMode::Exclusive) journal_inode(dir_id);
+            if (child_id != 0 && target_mode == LockMode::Exclusive) journal_inode(child_id);
+            return child_id;
         }
+    }
+}
 
-        DirEntry* entry = reinterpret_cast<DirEntry*>(disk.get_ptr(curr_block_id));
-        for (int j = 0; j < max_entries; j++) {
-            if (entry[j].inode_id == 0) {
-                entry[j].inode_id = newfile_id;
+// Per-thread group affinity: every thread that allocates is numbered in
+// order of first use (0 is usually the main thread) and starts its searches
+// that many groups past the preferred one. Concurrent writers then work in
+// different bitmaps and rarely CAS the same words, while a single-threaded
+// caller keeps the plain locality layout.
+size_t FileSystem::start_group(size_t preferred_group) {
+    static std::atomic<size_t> next_slot{0};
+    thread_local size_t slot = next_slot.fetch_add(1, std::memory_order_relaxed);
+    return (preferred_group + slot) % block_group_managers.size();
+}
 
-                // GEMINI FIX: Safe copy
-                std::memset(entry[j].name, 0, sizeof(entry[j].name));
-                size_t len_to_copy = std::min(filename.size(), sizeof(entry[j].name) - 1);
-                std::memcpy(entry[j].name, filename.c_str(), len_to_copy);
-                entry[j].name_len = static_cast<uint8_t>(len_to_copy);
+int FileSystem::allocate_inode_any(size_t preferred_group) {
+    preferred_group = start_group(preferred_group);
+    size_t groups = block_group_managers.size();
+    for (size_t n = 0; n < groups; n++) {
+        BlockGroupManager& bgm = block_group_managers[(preferred_group + n) % groups];
+        if (bgm.get_free_inodes_count() == 0) continue;
+        int id = bgm.allocate_inode();
+        if (id != -1) return id;
+    }
+    return -1;
+}
 
-                parent_inode->file_size += sizeof(DirEntry);
-                return;
-            }
-        }
+int FileSystem::allocate_block_any(size_t preferred_group) {
+    preferred_group = start_group(preferred_group);
+    size_t groups = block_group_managers.size();
+    for (size_t n = 0; n < groups; n++) {
+        BlockGroupManager& bgm = block_group_managers[(preferred_group + n) % groups];
+        if (bgm.get_free_blocks_count() == 0) continue;
+        int id = bgm.allocate_block();
+        if (id != -1) return id;
     }
-    throw std::runtime_error("Directory Full.");
+    return -1;
 }
 
-void FileSystem::create_fs_entry(std::string path, FS_FILE_TYPES type) {
-    auto tokenized_path = tokenize_path(path, '/');
-    if (tokenized_path.empty()) throw std::runtime_error("Path cannot be empty.");
+size_t FileSystem::get_free_block_count() {
+    Disk::PinScope pins(disk);
+    drain_deferred();
+    std::shared_lock<std::shared_mutex> tree(tree_lock);
+    size_t total = 0;
+    for (auto& bgm : block_group_managers) total += bgm.get_free_blocks_count();
+    return total;
+}
 
-    std::string filename = tokenized_path.back();
-    size_t parent_id = traverse_path_till_parent(tokenized_path);
-    Inode* parent_inode = get_global_inode_ptr(parent_id);
+size_t FileSystem::get_free_inode_count() {
+    Disk::PinScope pins(disk);
+    drain_deferred();
+    std::shared_lock<std::shared_mutex> tree(tree_lock);
+    size_t total = 0;
+    for (auto& bgm : block_group_managers) total += bgm.get_free_inodes_count();
+    return total;
+}
 
-    if (find_inode_in_dir(parent_inode, filename) != 0) {
-        throw std::runtime_error("Error: '" + filename + "' already exists.");
-    }
+FsStatsSnapshot FileSystem::stats() {
+    FsStatsSnapshot snapshot = op_stats.snapshot();
+    snapshot.dentry_hits = dcache.get_hits();
+    snapshot.dentry_misses = dcache.get_misses();
+    return snapshot;
+}
 
-    int new_id = -1;
-    for (int i = 0; i < block_group_managers.size(); i++) {
-        new_id = block_group_managers[i].allocate_inode();
-        if (new_id != -1) break;
-    }
-    if (new_id == -1) throw std::runtime_error("Disk Full.");
+void FileSystem::reset_stats() {
+    op_stats.reset();
+    dcache.reset_counters();
+}
 
-    Inode* new_inode = get_global_inode_ptr(new_id);
-    new_inode->id = new_id;
-    new_inode->file_size = 0;
-    new_inode->file_type = type;
-    
-    // Permissions
-    new_inode->uid = current_uid; 
-    new_inode->gid = current_gid;
-    // Directories usually get 755, files get 644
-    new_inode->permissions = (type == FS_DIRECTORY) ? 0755 : 0644;
+void FileSystem::add_entry_to_dir(Inode* parent_inode, size_t newfile_id, std::string_view filename) {
+    if (filename.size() > 255) throw std::runtime_error("File name too long: " + std::string(filename));
+    journal_inode(parent_inode->id);
+
+    DirIndexBlock* index = get_dir_index(parent_inode);
+
+    if (index == nullptr) {
+        // Linear directory: reuse a free slot in the existing blocks. A new
+        // directory gets its first block here; once that is full (or a legacy
+        // multi-block directory runs out of slots) it is converted to an index.
+        for (int i = 0; i < 12; i++) {
+            size_t curr_block_id = parent_inode->direct_blocks[i];
+            if (curr_block_id == 0) {
+                if (i != 0) break;
+                curr_block_id = get_dir_block(parent_inode, 0, true);
+            }
 
-    std::memset(new_inode->direct_blocks, 0, sizeof(new_inode->direct_blocks));
+            if (dir_block_insert(meta_ptr(curr_block_id), newfile_id, filename)) {
+                parent_inode->file_size += dir_record_size(filename.size());
+                dcache.insert(parent_inode->id, filename, newfile_id);
+                return;
+            }
+        }
+
+        convert_dir_to_indexed(parent_inode);
+        index = get_dir_index(parent_inode);
+    }
 
-    add_entry_to_dir(parent_inode, new_id, filename);
+    index_insert(parent_inode, index, newfile_id, filename);
+    parent_inode->file_size += dir_record_size(filename.size());
+    dcache.insert(parent_inode->id, filename, newfile_id);
+}
 
-    if (type == FS_DIRECTORY) {
-        Inode* new_dir_inode = get_global_inode_ptr(new_id);
-        add_entry_to_dir(new_dir_inode, new_id, ".");
-        add_entry_to_dir(new_dir_inode, parent_id, "..");
+size_t FileSystem::remove_entry_from_dir(Inode* parent_inode, std::string_view filename) {
+    size_t removed_id = 0;
+    journal_inode(parent_inode->id);
+
+    DirIndexBlock* index = get_dir_index(parent_inode);
+    if (index != nullptr) {
+        size_t bucket_block = 0;
+        uint8_t* bucket = get_dir_bucket(parent_inode, index, filename, &bucket_block);
+        journal.mark_dirty(parent_inode->direct_blocks[0]);
+        journal.mark_dirty(bucket_block);
+        removed_id = dir_block_remove(bucket, filename);
+        if (removed_id != 0) index->entry_count--;
+    } else {
+        for (int i = 0; i < 12 && removed_id == 0; i++) {
+            if (parent_inode->direct_blocks[i] == 0) break;
+            removed_id = dir_block_remove(meta_ptr(parent_inode->direct_blocks[i]), filename);
+        }
     }
 
-    std::cout << (type == FS_DIRECTORY ? "Directory" : "File") << " '" << filename << "' created.\n";
+    if (removed_id != 0) parent_inode->file_size -= dir_record_size(filename.size());
+    dcache.insert(parent_inode->id, filename, 0); // Now known to be absent
+    return removed_id;
 }
 
-// ---------------- PUBLIC API ----------------
+// ---------------- DIRECTORY INDEX ----------------
+
+// Directory blocks use the common mapping; newly allocated ones come back
+// formatted as one empty DirRecord.
+size_t FileSystem::get_dir_block(Inode* dir, size_t logical_index, bool allocate) {
+    size_t block_id = get_data_block(dir, logical_index, false);
+    if (block_id != 0 || !allocate) return block_id;
 
-void FileSystem::create_file(std::string path) {
-    create_fs_entry(path, FS_FILE_TYPES::FS_FILE);
+    if (logical_index >= max_data_blocks()) throw std::runtime_error("Directory Full.");
+    block_id = get_data_block(dir, logical_index, true);
+    dir_block_init(meta_ptr(block_id));
+    return block_id;
 }
 
-void FileSystem::create_dir(std::string path) {
-    create_fs_entry(path, FS_FILE_TYPES::FS_DIRECTORY);
+DirIndexBlock* FileSystem::get_dir_index(Inode* dir) {
+    if (dir->direct_blocks[0] == 0) return nullptr;
+    DirIndexBlock* index = reinterpret_cast<DirIndexBlock*>(disk.get_ptr(dir->direct_blocks[0]));
+    return (index->magic == DIR_INDEX_MAGIC) ? index : nullptr;
 }
 
-void FileSystem::create_symlink(std::string target, std::string link_path) {
-    auto tokenized_path = tokenize_path(link_path, '/');
-    if (tokenized_path.empty()) throw std::runtime_error("Link path cannot be empty.");
+uint8_t* FileSystem::get_dir_bucket(Inode* dir, DirIndexBlock* index, std::string_view name, size_t* block_id) {
+    uint32_t hash = dir_name_hash(name.data(), name.size());
+    uint32_t slot = hash & ((1u << index->global_depth) - 1);
+    size_t bucket_block = get_dir_block(dir, index->bucket_table[slot], false);
+    if (block_id != nullptr) *block_id = bucket_block;
+    return disk.get_ptr(bucket_block);
+}
 
-    std::string link_name = tokenized_path.back();
-    size_t parent_id = traverse_path_till_parent(tokenized_path);
-    Inode* parent_inode = get_global_inode_ptr(parent_id);
+// Turns a linear directory into an indexed one: block 0 is reused for the
+// index and every existing entry is re-inserted into hash buckets.
+void FileSystem::convert_dir_to_indexed(Inode* dir) {
+    std::vector<std::pair<size_t, std::string>> entries;
+    for_each_dir_entry(dir, [&](DirRecord& entry) {
+        entries.emplace_back(entry.inode_id, std::string(entry.name(), entry.name_len));
+    });
+
+    for (int i = 1; i < 12; i++) {
+        if (dir->direct_blocks[i] != 0) {
+            block_group_managers[dir->direct_blocks[i] / sb->blocks_per_group].free_block(dir->direct_blocks[i]);
+            dir->direct_blocks[i] = 0;
+        }
+    }
+
+    uint8_t* root_block = meta_ptr(dir->direct_blocks[0]);
+    std::memset(root_block, 0, disk.get_block_size());
 
-    if (find_inode_in_dir(parent_inode, link_name) != 0) {
-        throw std::runtime_error("Error: '" + link_name + "' already exists.");
+    DirIndexBlock* index = reinterpret_cast<DirIndexBlock*>(root_block);
+    index->magic = DIR_INDEX_MAGIC;
+    index->global_depth = 0;
+    index->bucket_count = 1;
+    index->bucket_table[0] = 1;
+    index->local_depth[1] = 0;
+    get_dir_block(dir, 1, true);
+
+    for (auto& entry : entries) {
+        index_insert(dir, index, entry.first, entry.second);
     }
+}
 
-    int new_id = -1;
-    for (int i = 0; i < block_group_managers.size(); i++) {
-        new_id = block_group_managers[i].allocate_inode();
-        if (new_id != -1) break;
+void FileSystem::index_insert(Inode* dir, DirIndexBlock* index, size_t inode_id, std::string_view name) {
+    uint32_t hash = dir_name_hash(name.data(), name.size());
+    journal.mark_dirty(dir->direct_blocks[0]); // The index block itself
+    while (true) {
+        uint32_t slot = hash & ((1u << index->global_depth) - 1);
+        uint32_t bucket = index->bucket_table[slot];
+        uint8_t* block = meta_ptr(get_dir_block(dir, bucket, false));
+
+        if (dir_block_insert(block, inode_id, name)) {
+            index->entry_count++;
+            return;
+        }
+        split_dir_bucket(dir, index, bucket);
     }
-    if (new_id == -1) throw std::runtime_error("Disk Full.");
+}
 
-    Inode* new_inode = get_global_inode_ptr(new_id);
-    new_inode->id = new_id;
-    new_inode->file_type = FS_SYMLINK;
-    new_inode->file_size = target.size();
-    new_inode->uid = current_uid;
-    new_inode->gid = current_gid;
-    new_inode->permissions = 0777;
+// Extendible hashing split: the full bucket's entries are divided between
+// it and a new bucket by the next hash bit, doubling the slot table first
+// when the bucket already uses every bit the table has.
+void FileSystem::split_dir_bucket(Inode* dir, DirIndexBlock* index, uint32_t bucket) {
+    uint32_t depth = index->local_depth[bucket];
+    if (depth == index->global_depth) {
+        if (index->global_depth == DIR_INDEX_MAX_DEPTH) throw std::runtime_error("Directory Full.");
+        uint32_t live_slots = 1u << index->global_depth;
+        for (uint32_t i = 0; i < live_slots; i++) {
+            index->bucket_table[i + live_slots] = index->bucket_table[i];
+        }
+        index->global_depth++;
+    }
 
-    std::memset(new_inode->direct_blocks, 0, sizeof(new_inode->direct_blocks));
+    uint32_t new_bucket = index->bucket_count + 1;
+    uint8_t* new_block = meta_ptr(get_dir_block(dir, new_bucket, true));
+    uint8_t* old_block = meta_ptr(get_dir_block(dir, bucket, false));
+    index->bucket_count = new_bucket;
+
+    uint32_t split_bit = 1u << depth;
+    index->local_depth[bucket] = depth + 1;
+    index->local_depth[new_bucket] = depth + 1;
+    for (uint32_t i = 0; i < (1u << index->global_depth); i++) {
+        if (index->bucket_table[i] == bucket && (i & split_bit)) {
+            index->bucket_table[i] = new_bucket;
+        }
+    }
 
-    size_t block_size = disk.get_block_size();
-    size_t required_blocks = (target.size() + block_size - 1) / block_size;
-    
-    if (required_blocks > 1) {
-        throw std::runtime_error("Symlink target too long.");
+    std::vector<std::pair<size_t, std::string>> moving;
+    dir_block_for_each(old_block, [&](DirRecord& entry) {
+        if (dir_name_hash(entry.name(), entry.name_len) & split_bit) {
+            moving.emplace_back(entry.inode_id, std::string(entry.name(), entry.name_len));
+        }
+    });
+    for (auto& entry : moving) {
+        dir_block_remove(old_block, entry.second);
+        dir_block_insert(new_block, entry.first, entry.second);
     }
+}
 
-    size_t block_num = block_group_managers[new_id / sb->inodes_per_group].allocate_block();
-    if (block_num == (size_t)-1) throw std::runtime_error("Disk Full.");
-    
-    new_inode->direct_blocks[0] = block_num;
-    std::memset(disk.get_ptr(block_num), 0, block_size);
-    std::memcpy(disk.get_ptr(block_num), target.c_str(), target.size());
+void FileSystem::for_each_dir_entry(Inode* dir, const std::function<void(DirRecord&)>& fn) {
+    DirIndexBlock* index = get_dir_index(dir);
+    if (index != nullptr) {
+        for (uint32_t bucket = 1; bucket <= index->bucket_count; bucket++) {
+            dir_block_for_each(disk.get_ptr(get_dir_block(dir, bucket, false)), fn);
+        }
+        return;
+    }
 
-    add_entry_to_dir(parent_inode, new_id, link_name);
-    std::cout << "Symlink '" << link_name << "' -> '" << target << "' created.\n";
+    for (int i = 0; i < 12; i++) {
+        if (dir->direct_blocks[i] == 0) break;
+        dir_block_for_each(disk.get_ptr(dir->direct_blocks[i]), fn);
+    }
 }
 
-FileStats FileSystem::get_stats(std::string path) {
-    auto tokenized_path = tokenize_path(path, '/');
-    std::string filename = tokenized_path.back();
-    size_t parent_id = traverse_path_till_parent(tokenized_path);
-    Inode* parent_inode = get_global_inode_ptr(parent_id);
-
-    size_t file_id = find_inode_in_dir(parent_inode, filename);
-    if (file_id == 0) throw std::runtime_error("File not found: " + path);
+void FileSystem::release_dir_blocks(Inode* dir, FreeBatch& batch) {
+    for (int i = 0; i < 12; i++) {
+        if (dir->direct_blocks[i] != 0) {
+            batch.blocks.push_back(dir->direct_blocks[i]);
+            dir->direct_blocks[i] = 0;
+        }
+    }
 
-    Inode* inode = get_global_inode_ptr(file_id);
-    
-    FileStats stats;
-    stats.inode_id = inode->id;
-    stats.uid = inode->uid;
-    stats.gid = inode->gid;
-    stats.permissions = inode->permissions;
-    stats.file_size = inode->file_size;
-    stats.file_type = inode->file_type;
-    
-    if (inode->file_type == FS_SYMLINK) {
-        size_t block_size = disk.get_block_size();
-        if (inode->direct_blocks[0] != 0) {
-            char target[4096];
-            std::memset(target, 0, sizeof(target));
-            std::memcpy(target, disk.get_ptr(inode->direct_blocks[0]), std::min(block_size, inode->file_size));
-            stats.symlink_target = std::string(target, inode->file_size);
+    if (dir->single_indirect != 0) {
+        const size_t pointers_per_block = disk.get_block_size() / sizeof(size_t);
+        size_t* indirect = reinterpret_cast<size_t*>(disk.get_ptr(dir->single_indirect));
+        for (size_t i = 0; i < pointers_per_block; i++) {
+            if (indirect[i] != 0) batch.blocks.push_back(indirect[i]);
         }
+        batch.blocks.push_back(dir->single_indirect);
+        dir->single_indirect = 0;
     }
-    
-    return stats;
 }
 
-void FileSystem::write_file(std::string path, const std::vector<uint8_t>& data) {
-    auto tokenized_path = tokenize_path(path, '/');
-    std::string filename = tokenized_path.back();
-    size_t parent_id = traverse_path_till_parent(tokenized_path);
-    Inode* parent_inode = get_global_inode_ptr(parent_id);
+// ---------------- BLOCK MAPPING ----------------
 
-    size_t file_id = find_inode_in_dir(parent_inode, filename);
-    if (file_id == 0) throw std::runtime_error("File not found: " + path);
+size_t FileSystem::pointers_per_block() {
+    return disk.get_block_size() / sizeof(size_t);
+}
 
-    Inode* file_inode = get_global_inode_ptr(file_id);
-    if (file_inode->file_type != FS_FILE) throw std::runtime_error("Not a file.");
+size_t FileSystem::max_data_blocks() {
+    const size_t p = pointers_per_block();
+    return 12 + p + p * p + p * p * p;
+}
 
-    size_t block_size = disk.get_block_size();
-    size_t required_blocks = (data.size() + block_size - 1) / block_size;
-    
-    const size_t MAX_SINGLE = 12 + 1024;
-    if (required_blocks > MAX_SINGLE) {
-        throw std::runtime_error("File too large (max 4MB for now).");
+// Logical -> physical slot: 12 direct pointers, then the single, double and
+// triple indirect trees. Missing indirect blocks are allocated on the way
+// down when allocate is set; otherwise (or past the triple tree) returns
+// nullptr. If run is non-null it receives how many slots, this one
+// included, follow contiguously in the same pointer array.
+size_t* FileSystem::get_block_slot(Inode* node, size_t logical_index, bool allocate, size_t* run) {
+    if (logical_index < 12) {
+        if (run != nullptr) *run = 12 - logical_index;
+        return &node->direct_blocks[logical_index];
     }
 
-    if (!check_permission(file_inode, 2)) {
-        throw std::runtime_error("Permission denied: No write access to this file.");
+    const size_t p = pointers_per_block();
+    size_t index = logical_index - 12;
+    size_t* root = nullptr;
+    size_t stride = 1; // Data blocks covered by one entry of the top table
+
+    if (index < p) {
+        root = &node->single_indirect;
+    } else if ((index -= p) < p * p) {
+        root = &node->double_indirect;
+        stride = p;
+    } else if ((index -= p * p) < p * p * p) {
+        root = &node->triple_indirect;
+        stride = p * p;
+    } else {
+        return nullptr;
     }
 
-    // Free all existing blocks first
-    release_file_resources(file_inode->id, false);
-    
-    // Allocate indirect block if needed
-    if (required_blocks > 12) {
-        for (size_t g = 0; g < block_group_managers.size(); g++) {
-            size_t bid = block_group_managers[g].allocate_block();
-            if (bid != (size_t)-1) {
-                file_inode->single_indirect = bid;
-                break;
-            }
+    size_t* slot = root;
+    size_t* table = nullptr;
+    while (true) {
+        if (*slot == 0) {
+            if (!allocate) return nullptr;
+            int bid = allocate_block_any(group_of_inode(node->id));
+            if (bid == -1) throw std::runtime_error("Disk Full.");
+            *slot = bid;
         }
-        if (file_inode->single_indirect == 0) throw std::runtime_error("Disk Full.");
-        memset(disk.get_ptr(file_inode->single_indirect), 0, block_size);
+        // Mapping changes only happen on the allocating walk
+        table = reinterpret_cast<size_t*>(allocate ? meta_ptr(*slot) : disk.get_ptr(*slot));
+        slot = table + index / stride;
+        index %= stride;
+        if (stride == 1) break;
+        stride /= p;
     }
-    
-    // Allocate and write blocks
-    for (size_t i = 0; i < required_blocks; ++i) {
-        size_t block_num = 0;
-        bool allocated = false;
-        
-        for (size_t g = 0; g < block_group_managers.size() && !allocated; g++) {
-            size_t bid = block_group_managers[g].allocate_block();
-            if (bid != (size_t)-1) {
-                block_num = bid;
-                allocated = true;
-            }
-        }
-        
-        if (!allocated) throw std::runtime_error("Disk Full.");
-        
-        if (i < 12) {
-            file_inode->direct_blocks[i] = block_num;
-        } else {
-            size_t* indirect = reinterpret_cast<size_t*>(disk.get_ptr(file_inode->single_indirect));
-            indirect[i - 12] = block_num;
-        }
 
-        size_t offset = i * block_size;
-        size_t bytes = std::min(block_size, data.size() - offset);
-        std::memcpy(disk.get_ptr(block_num), data.data() + offset, bytes);
+    if (run != nullptr) *run = p - (slot - table);
+    return slot;
+}
+
+// Returns the physical block behind a logical index, or 0 for a hole when
+// allocate is false. Newly allocated blocks come back zeroed.
+size_t FileSystem::get_data_block(Inode* node, size_t logical_index, bool allocate) {
+    size_t* slot = get_block_slot(node, logical_index, allocate);
+    if (slot == nullptr) {
+        if (allocate) throw std::runtime_error("File too large.");
+        return 0;
     }
 
-    file_inode->file_size = data.size();
-    std::cout << "Written " << data.size() << " bytes to " << filename << "\n";
+    if (*slot == 0 && allocate) {
+        int bid = allocate_block_any(group_of_inode(node->id));
+        if (bid == -1) throw std::runtime_error("Disk Full.");
+        *slot = bid;
+    }
+    return *slot;
 }
 
-void FileSystem::read_direct_block_to_buffer(Inode* file, uint8_t* buffer) {
-    size_t block_size = disk.get_block_size();
-    size_t file_size = file->file_size;
-    size_t blocks_to_read = (file_size + block_size - 1) / block_size;
-    
-    // Read direct blocks
-    size_t direct_count = std::min<size_t>(12, blocks_to_read);
-    for (size_t i = 0; i < direct_count; i++) {
-        if (file->direct_blocks[i] == 0) break;
-        std::memcpy(buffer + (i * block_size), disk.get_ptr(file->direct_blocks[i]), block_size);
-    }
-    
-    if (blocks_to_read <= 12) return;
-    
-    // Read single indirect blocks
-    size_t single_needed = std::min<size_t>(blocks_to_read - 12, 1024);
-    if (file->single_indirect != 0) {
-        size_t* indirect_block = reinterpret_cast<size_t*>(disk.get_ptr(file->single_indirect));
-        for (size_t i = 0; i < single_needed; i++) {
-            if (indirect_block[i] == 0) break;
-            size_t block_idx = 12 + i;
-            std::memcpy(buffer + (block_idx * block_size), disk.get_ptr(indirect_block[i]), block_size);
+// Collects an indirect block and everything below it; depth 0 is a data
+// block. blocks_left is how many of the file's data blocks the subtree can
+// still hold: nothing is mapped past EOF (truncate_inode frees it), so the
+// walk stops there instead of visiting every slot of every table.
+void FileSystem::collect_block_tree(size_t block_id, int depth, size_t blocks_left, FreeBatch& batch) {
+    if (depth > 0) {
+        const size_t p = pointers_per_block();
+        size_t span = 1; // Data blocks under one slot of this table
+        for (int d = 1; d < depth; d++) span *= p;
+
+        size_t* table = reinterpret_cast<size_t*>(disk.get_ptr(block_id));
+        for (size_t i = 0; i < p && i * span < blocks_left; i++) {
+            if (table[i] != 0) collect_block_tree(table[i], depth - 1, std::min(span, blocks_left - i * span), batch);
         }
     }
+    batch.blocks.push_back(block_id);
 }
 
-std::vector<uint8_t> FileSystem::read_file(std::string path) {
-    auto tokenized_path = tokenize_path(path, '/');
-    std::string filename = tokenized_path.back();
-    size_t parent_id = traverse_path_till_parent(tokenized_path);
-    size_t file_id = find_inode_in_dir(get_global_inode_ptr(parent_id), filename);
+// Frees indirect blocks under *slot that map nothing any more (after a
+// truncate). Returns true when *slot itself ended up empty.
+bool FileSystem::prune_block_tree(size_t* slot, int depth) {
+    if (*slot == 0) return true;
+
+    bool empty = true;
+    // Also covers the slots truncate_inode just cleared in this table
+    size_t* table = reinterpret_cast<size_t*>(meta_ptr(*slot));
+    for (size_t i = 0; i < pointers_per_block(); i++) {
+        if (table[i] == 0) continue;
+        if (depth > 1 && prune_block_tree(&table[i], depth - 1)) continue;
+        empty = false;
+    }
+
+    if (empty) {
+        block_group_managers[*slot / sb->blocks_per_group].free_block(*slot);
+        *slot = 0;
+    }
+    return empty;
+}
+
+// ---------------- OFFSET I/O ----------------
+
+Inode* FileSystem::resolve_regular_file(std::string_view path, uint16_t access, LockMode mode, InodeGuard& guard) {
+    size_t parent_id = 0;
+    size_t file_id = lock_entry(path, LockMode::Shared, mode, guard, &parent_id);
+    if (file_id == 0) throw std::runtime_error("File not found: " + std::string(path));
+    // The file is pinned; let other work in the directory proceed
+    guard.unlock_inode(inode_locks, parent_id);
 
-    if (file_id == 0) throw std::runtime_error("File not found.");
     Inode* file_inode = get_global_inode_ptr(file_id);
+    if (file_inode->file_type != FS_FILE) throw std::runtime_error("Not a file.");
 
-    if (!check_permission(file_inode, 4)) {
+    if ((access & 4) && !check_permission(file_inode, 4)) {
         throw std::runtime_error("Permission denied: No read access to this file.");
     }
+    if ((access & 2) && !check_permission(file_inode, 2)) {
+        throw std::runtime_error("Permission denied: No write access to this file.");
+    }
+    return file_inode;
+}
 
-    size_t file_size = file_inode->file_size;
-    size_t block_size = disk.get_block_size();
-    size_t required_blocks = (file_size + block_size - 1) / block_size;
-    size_t buffer_size = required_blocks * block_size;
-    
-    std::vector<uint8_t> buffer(buffer_size);
-    read_direct_block_to_buffer(file_inode, buffer.data());
+// File data lookup. Extent-mapped inodes answer from their inline table;
+// block-mapped ones go through the per-inode extent cache, where a miss
+// walks the tree once and caches the whole physically contiguous run found
+// in that pointer array. Holes are never cached. Inline files have no
+// blocks, so every index is a hole.
+//
+// *run receives how many blocks from logical_index on are physically
+// contiguous (1 for a hole), so callers can copy a whole run at once.
+size_t FileSystem::map_file_block(Inode* file, size_t logical_index, size_t* run) {
+    if (file->flags & INODE_FLAG_INLINE) {
+        *run = 1;
+        return 0;
+    }
+    if (file->flags & INODE_FLAG_EXTENTS) {
+        uint32_t pos = 0;
+        return extent_lookup(file, logical_index, run, &pos);
+    }
 
-    buffer.resize(file_size);
-    return buffer;
+    size_t physical = 0;
+    if (extent_cache.lookup(file->id, logical_index, &physical, run)) return physical;
+
+    size_t slot_run = 0;
+    size_t* slot = get_block_slot(file, logical_index, false, &slot_run);
+    if (slot != nullptr && *slot != 0) {
+        size_t length = 1;
+        while (length < slot_run && slot[length] == *slot + length) length++;
+        extent_cache.insert(file->id, logical_index, *slot, length);
+        *run = length;
+        return *slot;
+    }
+    *run = 1;
+    return 0;
 }
 
-void FileSystem::delete_file(std::string path) {
-    auto tokenized_path = tokenize_path(path, '/');
-    std::string filename = tokenized_path.back();
-    size_t parent_id = traverse_path_till_parent(tokenized_path);
-    Inode* parent_inode = get_global_inode_ptr(parent_id);
+// Fills the hole at logical_index with up to `want` blocks, returned as the
+// physical runs that now back logical_index, logical_index + 1, ... in
+// order. Fewer blocks come back when the hole is shorter or the disk is
+// nearly full; none at all throws.
+std::vector<BlockRun> FileSystem::allocate_file_blocks(Inode* file, size_t logical_index, size_t want, bool zero_fill) {
+    std::vector<BlockRun> runs;
+
+    if (file->flags & INODE_FLAG_EXTENTS) {
+        size_t run = 0;
+        size_t start = extent_allocate(file, logical_index, want, &run, zero_fill);
+        runs.push_back({start, run});
+        return runs;
+    }
 
-    // GATEKEEPER: Check if user can modify the parent directory
-    if (!check_permission(parent_inode, 2)) { 
-        throw std::runtime_error("Permission denied: Cannot modify parent directory.");
+    // Block pointers: claim every consecutive hole in this pointer array
+    size_t slot_run = 0;
+    size_t* slot = get_block_slot(file, logical_index, true, &slot_run);
+    size_t holes = 1;
+    size_t limit = std::min(want, slot_run);
+    while (holes < limit && slot[holes] == 0) holes++;
+
+    // Place the data right after the previous logical block when possible
+    size_t goal = 0;
+    if (logical_index > 0) {
+        size_t prev_run = 0;
+        size_t prev = map_file_block(file, logical_index - 1, &prev_run);
+        if (prev != 0) goal = prev + 1;
     }
 
-    // Reuse find logic but we need the entry pointer to zero it out
-    int max_entries = 4096 / sizeof(DirEntry);
-    for (int i = 0; i < 12; i++) {
-        if (parent_inode->direct_blocks[i] == 0) break;
-        DirEntry* entry = reinterpret_cast<DirEntry*>(disk.get_ptr(parent_inode->direct_blocks[i]));
-
-        for (int j = 0; j < max_entries; j++) {
-            if (entry[j].inode_id != 0) {
-                std::string entry_name(entry[j].name, entry[j].name_len);
-                if (entry_name == filename) {
-                    release_file_resources(entry[j].inode_id, true);
-                    std::memset(&entry[j], 0, sizeof(DirEntry));
-                    parent_inode->file_size -= sizeof(DirEntry);
-                    std::cout << "Deleted " << filename << "\n";
-                    return;
-                }
-            }
-        }
+    runs = allocate_blocks_any(group_of_inode(file->id), holes, goal, zero_fill);
+    if (runs.empty()) throw std::runtime_error("Disk Full.");
+
+    size_t logical = logical_index;
+    for (const BlockRun& r : runs) {
+        for (size_t k = 0; k < r.length; k++) slot[logical - logical_index + k] = r.start + k;
+        extent_cache.insert(file->id, logical, r.start, r.length);
+        logical += r.length;
     }
-    throw std::runtime_error("File not found.");
+    return runs;
 }
 
-void FileSystem::release_file_resources(size_t inode_id, bool free_inode_too) {
-    Inode* node = get_global_inode_ptr(inode_id);
-    
-    // Free direct blocks
-    for (int i = 0; i < 12; i++) {
-        if (node->direct_blocks[i] != 0) {
-            block_group_managers[node->direct_blocks[i] / sb->blocks_per_group].free_block(node->direct_blocks[i]);
-            node->direct_blocks[i] = 0;
-        }
-    }
-    
-    // Free single indirect blocks
-    if (node->single_indirect != 0) {
-        size_t* indirect = reinterpret_cast<size_t*>(disk.get_ptr(node->single_indirect));
-        for (size_t i = 0; i < 1024; i++) {
-            if (indirect[i] != 0) {
-                block_group_managers[indirect[i] / sb->blocks_per_group].free_block(indirect[i]);
-            }
-        }
-        block_group_managers[node->single_indirect / sb->blocks_per_group].free_block(node->single_indirect);
-        node->single_indirect = 0;
+// ---------------- EXTENT-MAPPED FILES ----------------
+
+InodeExtentTable* FileSystem::extent_table(Inode* file) {
+    return reinterpret_cast<InodeExtentTable*>(file->direct_blocks);
+}
+
+int FileSystem::allocate_run_any(size_t preferred_group, size_t max_len, size_t goal_block, int* run_len, bool zero_fill) {
+    int len = static_cast<int>(std::min<size_t>(max_len, sb->blocks_per_group));
+
+    // The goal's own group first, so a run can continue the previous extent
+    if (goal_block != 0 && goal_block < sb->total_blocks) {
+        int start = block_group_managers[goal_block / sb->blocks_per_group].allocate_block_run(len, goal_block, run_len, zero_fill);
+        if (start != -1) return start;
     }
-    
-    // Free double indirect blocks
-    if (node->double_indirect != 0) {
-        size_t* double_block = reinterpret_cast<size_t*>(disk.get_ptr(node->double_indirect));
-        for (size_t i = 0; i < 1024; i++) {
-            if (double_block[i] != 0) {
-                size_t* single_block = reinterpret_cast<size_t*>(disk.get_ptr(double_block[i]));
-                for (size_t j = 0; j < 1024; j++) {
-                    if (single_block[j] != 0) {
-                        block_group_managers[single_block[j] / sb->blocks_per_group].free_block(single_block[j]);
-                    }
-                }
-                block_group_managers[double_block[i] / sb->blocks_per_group].free_block(double_block[i]);
-            }
-        }
-        block_group_managers[node->double_indirect / sb->blocks_per_group].free_block(node->double_indirect);
-        node->double_indirect = 0;
+
+    preferred_group = start_group(preferred_group);
+    size_t groups = block_group_managers.size();
+    for (size_t n = 0; n < groups; n++) {
+        BlockGroupManager& bgm = block_group_managers[(preferred_group + n) % groups];
+        if (bgm.get_free_blocks_count() == 0) continue;
+        int start = bgm.allocate_block_run(len, -1, run_len, zero_fill);
+        if (start != -1) return start;
     }
-    
-    // Free triple indirect blocks
-    if (node->triple_indirect != 0) {
-        size_t* triple_block = reinterpret_cast<size_t*>(disk.get_ptr(node->triple_indirect));
-        for (size_t i = 0; i < 1024; i++) {
-            if (triple_block[i] != 0) {
-                size_t* double_block = reinterpret_cast<size_t*>(disk.get_ptr(triple_block[i]));
-                for (size_t j = 0; j < 1024; j++) {
-                    if (double_block[j] != 0) {
-                        size_t* single_block = reinterpret_cast<size_t*>(disk.get_ptr(double_block[j]));
-                        for (size_t k = 0; k < 1024; k++) {
-                            if (single_block[k] != 0) {
-                                block_group_managers[single_block[k] / sb->blocks_per_group].free_block(single_block[k]);
-                            }
-                        }
-                        block_group_managers[double_block[j] / sb->blocks_per_group].free_block(double_block[j]);
-                    }
-                }
-                block_group_managers[triple_block[i] / sb->blocks_per_group].free_block(triple_block[i]);
-            }
+    return -1;
+}
+
+// Up to n blocks as a list of runs: the goal's group first, then the others
+// starting at the preferred group.
+std::vector<BlockRun> FileSystem::allocate_blocks_any(size_t preferred_group, size_t n, size_t goal_block, bool zero_fill) {
+    std::vector<BlockRun> runs;
+    size_t got = 0;
+
+    auto take = [&](BlockGroupManager& bgm, int goal) {
+        for (const BlockRun& r : bgm.allocate_blocks(n - got, goal, zero_fill)) {
+            runs.push_back(r);
+            got += r.length;
         }
-        block_group_managers[node->triple_indirect / sb->blocks_per_group].free_block(node->triple_indirect);
-        node->triple_indirect = 0;
+    };
+
+    if (goal_block != 0 && goal_block < sb->total_blocks) {
+        take(block_group_managers[goal_block / sb->blocks_per_group], static_cast<int>(goal_block));
     }
-    
-    if (free_inode_too) {
-        block_group_managers[inode_id / sb->inodes_per_group].free_inode(inode_id);
+
+    preferred_group = start_group(preferred_group);
+    size_t groups = block_group_managers.size();
+    for (size_t i = 0; i < groups && got < n; i++) {
+        BlockGroupManager& bgm = block_group_managers[(preferred_group + i) % groups];
+        if (bgm.get_free_blocks_count() == 0) continue;
+        take(bgm, -1);
     }
+    return runs;
 }
 
-void FileSystem::recursive_resource_release(size_t dir_inode_id) {
-    Inode* dir = get_global_inode_ptr(dir_inode_id);
-    int max = 4096 / sizeof(DirEntry);
-    for (int i=0; i<12; i++) {
-        if (dir->direct_blocks[i] == 0) break;
-        DirEntry* entry = reinterpret_cast<DirEntry*>(disk.get_ptr(dir->direct_blocks[i]));
-        for (int j=0; j<max; j++) {
-            if (entry[j].inode_id != 0) {
-                std::string entry_name(entry[j].name, entry[j].name_len);
-                if (entry_name == "." || entry_name == "..") continue;
-                
-                Inode* child = get_global_inode_ptr(entry[j].inode_id);
-                if (child->file_type == FS_DIRECTORY) recursive_resource_release(entry[j].inode_id);
-                else release_file_resources(entry[j].inode_id, true);
-            }
+// Looks logical_index up in the inline table. On a miss *pos is the index
+// of the first extent starting after it (the insertion point).
+size_t FileSystem::extent_lookup(Inode* file, size_t logical_index, size_t* run, uint32_t* pos) {
+    InodeExtentTable* table = extent_table(file);
+    for (*pos = 0; *pos < table->count; (*pos)++) {
+        InodeExtent& e = table->extents[*pos];
+        if (logical_index < e.logical) break;
+        if (logical_index < static_cast<size_t>(e.logical) + e.length) {
+            *run = e.length - (logical_index - e.logical);
+            return e.physical + (logical_index - e.logical);
         }
-        // Free the directory block itself
-        block_group_managers[dir->direct_blocks[i] / sb->blocks_per_group].free_block(dir->direct_blocks[i]);
     }
-    block_group_managers[dir_inode_id / sb->inodes_per_group].free_inode(dir_inode_id);
+    *run = 1;
+    return 0;
 }
 
-void FileSystem::delete_dir(std::string path) {
-    auto tokenized_path = tokenize_path(path, '/');
-    std::string dirname = tokenized_path.back();
-    size_t parent_id = traverse_path_till_parent(tokenized_path);
-    Inode* parent_inode = get_global_inode_ptr(parent_id);
+// Allocates a run of up to `want` blocks for the hole at logical_index. The
+// run is placed right after the previous extent when possible so it merges
+// into it. If the table is full the inode is converted to block pointers
+// and the new run is mapped there.
+size_t FileSystem::extent_allocate(Inode* file, size_t logical_index, size_t want, size_t* run, bool zero_fill) {
+    InodeExtentTable* table = extent_table(file);
+    uint32_t pos = 0;
+    extent_lookup(file, logical_index, run, &pos);
+
+    // Never allocate over the start of the next extent
+    if (pos < table->count) want = std::min<size_t>(want, table->extents[pos].logical - logical_index);
+    want = std::max<size_t>(want, 1);
+
+    InodeExtent* prev = (pos > 0) ? &table->extents[pos - 1] : nullptr;
+    size_t goal = 0;
+    if (prev != nullptr && static_cast<size_t>(prev->logical) + prev->length == logical_index) {
+        goal = prev->physical + prev->length;
+    }
 
-    // You need write permission (2) on the parent to remove a subdirectory
-    if (!check_permission(parent_inode, 2)) {
+    int got = 0;
+    int start = allocate_run_any(group_of_inode(file->id), want, goal, &got, zero_fill);
+    if (start == -1) throw std::runtime_error("Disk Full.");
+    *run = got;
+
+    if (goal != 0 && static_cast<size_t>(start) == goal) {
+        prev->length += got;
+    } else if (table->count < INODE_MAX_EXTENTS) {
+        for (uint32_t i = table->count; i > pos; i--) table->extents[i] = table->extents[i - 1];
+        table->extents[pos] = {static_cast<uint32_t>(logical_index), static_cast<uint32_t>(got), static_cast<uint64_t>(start)};
+        table->count++;
+    } else {
+        convert_extents_to_blocks(file);
+        for (int i = 0; i < got; i++) {
+            *get_block_slot(file, logical_index + i, true) = start + i;
+        }
+    }
+    return start;
+}
+
+// Moves every extent into the classic direct/indirect layout. Used when a
+// file gets too fragmented for the inline table.
+void FileSystem::convert_extents_to_blocks(Inode* file) {
+    InodeExtentTable table;
+    std::memcpy(&table, extent_table(file), sizeof(InodeExtentTable));
+
+    std::memset(file->direct_blocks, 0, sizeof(file->direct_blocks));
+    file->single_indirect = 0;
+    file->double_indirect = 0;
+    file->triple_indirect = 0;
+    file->flags &= ~INODE_FLAG_EXTENTS;
+    invalidate_block_maps(file->id);
+
+    for (uint32_t i = 0; i < table.count; i++) {
+        const InodeExtent& e = table.extents[i];
+        for (uint32_t k = 0; k < e.length; k++) {
+            *get_block_slot(file, static_cast<size_t>(e.logical) + k, true) = e.physical + k;
+        }
+    }
+}
+
+// Frees every block at or past logical block `keep_blocks`.
+void FileSystem::truncate_extents(Inode* file, size_t keep_blocks) {
+    InodeExtentTable* table = extent_table(file);
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < table->count; i++) {
+        InodeExtent e = table->extents[i];
+        size_t first_freed = (keep_blocks > e.logical) ? keep_blocks - e.logical : 0;
+        if (first_freed < e.length) free_block_range(e.physical + first_freed, e.length - first_freed);
+        if (first_freed == 0) continue;
+        e.length = static_cast<uint32_t>(std::min<size_t>(e.length, first_freed));
+        table->extents[kept++] = e;
+    }
+    table->count = kept;
+}
+
+// ---------------- INLINE FILES ----------------
+
+// Moves the contents into a freshly allocated data block once the file
+// outgrows the inode. If no block can be had the file stays inline.
+void FileSystem::convert_inline_to_blocks(Inode* file) {
+    uint8_t data[INODE_INLINE_CAPACITY];
+    size_t size = std::min(file->file_size, INODE_INLINE_CAPACITY);
+    std::memcpy(data, inline_data(file), size);
+    std::memset(inline_data(file), 0, INODE_INLINE_CAPACITY);
+    file->flags &= ~INODE_FLAG_INLINE;
+    if (size == 0) return;
+
+    try {
+        BlockRun r = allocate_file_blocks(file, 0, 1, false).front();
+        disk.write_bytes(r.start, 0, data, size);
+        disk.zero_bytes(r.start, size, disk.get_block_size() - size);
+    } catch (...) {
+        std::memset(inline_data(file), 0, INODE_INLINE_CAPACITY);
+        std::memcpy(inline_data(file), data, size);
+        file->flags |= INODE_FLAG_INLINE;
+        throw;
+    }
+}
+
+// Copies from the blocks covering [offset, offset + len), stopping at EOF.
+// Holes read back as zeros.
+size_t FileSystem::read_inode_range(Inode* file, size_t offset, uint8_t* buf, size_t len) {
+    FS_STATS_TIMER(&op_stats, FsOp::Read);
+    if (offset >= file->file_size) return 0;
+    len = std::min(len, file->file_size - offset);
+    FS_STATS_RECORD(&op_stats, add_bytes_read(len));
+
+    if (file->flags & INODE_FLAG_INLINE) {
+        std::memcpy(buf, inline_data(file) + offset, len);
+        return len;
+    }
+
+    size_t block_size = disk.get_block_size();
+    for (size_t done = 0; done < len; ) {
+        size_t pos = offset + done;
+        size_t in_block = pos % block_size;
+
+        // One copy per physically contiguous run
+        size_t run = 1;
+        size_t block_id = map_file_block(file, pos / block_size, &run);
+        size_t chunk = std::min(run * block_size - in_block, len - done);
+
+        if (block_id == 0) std::memset(buf + done, 0, chunk);
+        else disk.read_bytes(block_id, in_block, buf + done, chunk);
+        done += chunk;
+    }
+    return len;
+}
+
+// Writes only the blocks covering [offset, offset + len) and grows
+// file_size as data lands. Holes are filled with one allocation for all the
+// blocks the write still needs; those blocks skip the zero-fill because the
+// copy overwrites them, and only the bytes outside the copy are cleared.
+// Inline files are written in place until a write reaches past the inode.
+size_t FileSystem::write_inode_range(Inode* file, size_t offset, const uint8_t* buf, size_t len) {
+    FS_STATS_TIMER(&op_stats, FsOp::Write);
+    size_t block_size = disk.get_block_size();
+    if (len != 0 && (offset + len + block_size - 1) / block_size > max_data_blocks()) {
+        throw std::runtime_error("File too large.");
+    }
+
+    if ((file->flags & INODE_FLAG_INLINE) && len != 0) {
+        if (offset + len <= INODE_INLINE_CAPACITY) {
+            std::memcpy(inline_data(file) + offset, buf, len);
+            file->file_size = std::max(file->file_size, offset + len);
+            FS_STATS_RECORD(&op_stats, add_bytes_written(len));
+            return len;
+        }
+        convert_inline_to_blocks(file);
+    }
+
+    for (size_t done = 0; done < len; ) {
+        size_t pos = offset + done;
+        size_t in_block = pos % block_size;
+
+        size_t run = 1;
+        size_t block_id = map_file_block(file, pos / block_size, &run);
+        if (block_id != 0) {
+            size_t chunk = std::min(run * block_size - in_block, len - done);
+            disk.write_bytes(block_id, in_block, buf + done, chunk);
+            done += chunk;
+            file->file_size = std::max(file->file_size, pos + chunk);
+            continue;
+        }
+
+        size_t blocks_left = (in_block + (len - done) + block_size - 1) / block_size;
+        for (const BlockRun& r : allocate_file_blocks(file, pos / block_size, blocks_left, false)) {
+            size_t run_bytes = r.length * block_size;
+            size_t chunk = std::min(run_bytes - in_block, len - done);
+
+            disk.zero_bytes(r.start, 0, in_block);
+            disk.write_bytes(r.start, in_block, buf + done, chunk);
+            disk.zero_bytes(r.start, in_block + chunk, run_bytes - in_block - chunk);
+
+            done += chunk;
+            file->file_size = std::max(file->file_size, offset + done);
+            in_block = 0;
+        }
+    }
+    FS_STATS_RECORD(&op_stats, add_bytes_written(len));
+    return len;
+}
+
+// Shrinking frees every block past the new end and zeroes the tail of the
+// last one, so bytes beyond EOF always read back as zeros if the file grows
+// again. Growing only moves file_size; the gap is a hole.
+void FileSystem::truncate_inode(Inode* file, size_t new_size) {
+    size_t block_size = disk.get_block_size();
+    size_t new_blocks = (new_size + block_size - 1) / block_size;
+    if (new_blocks > max_data_blocks()) throw std::runtime_error("File too large.");
+
+    if (file->flags & INODE_FLAG_INLINE) {
+        if (new_size <= INODE_INLINE_CAPACITY) {
+            if (new_size < file->file_size) {
+                std::memset(inline_data(file) + new_size, 0, file->file_size - new_size);
+            }
+            file->file_size = new_size;
+            return;
+        }
+        convert_inline_to_blocks(file);
+    }
+
+    invalidate_block_maps(file->id);
+    if (file->flags & INODE_FLAG_EXTENTS) {
+        truncate_extents(file, new_blocks);
+    } else {
+        size_t old_blocks = (file->file_size + block_size - 1) / block_size;
+        for (size_t i = new_blocks; i < old_blocks; i++) {
+            size_t* slot = get_block_slot(file, i, false);
+            if (slot == nullptr || *slot == 0) continue;
+            block_group_managers[*slot / sb->blocks_per_group].free_block(*slot);
+            *slot = 0;
+        }
+
+        // Drop indirect blocks that no longer map anything
+        prune_block_tree(&file->single_indirect, 1);
+        prune_block_tree(&file->double_indirect, 2);
+        prune_block_tree(&file->triple_indirect, 3);
+    }
+
+    size_t tail = new_size % block_size;
+    if (new_size < file->file_size && tail != 0) {
+        size_t run = 1;
+        size_t block_id = map_file_block(file, new_blocks - 1, &run);
+        if (block_id != 0) {
+            disk.zero_bytes(block_id, tail, block_size - tail);
+        }
+    }
+
+    file->file_size = new_size;
+}
+
+// ---------------- READAHEAD ----------------
+
+// Hints the physical runs behind [start, end) of the file, clipped to EOF,
+// as a few merged runs. Holes and inline files have nothing to read.
+void FileSystem::prefetch_file_range(Inode* file, size_t start, size_t end) {
+    if (file->flags & INODE_FLAG_INLINE) return;
+    end = std::min(end, file->file_size);
+    if (end <= start) return;
+
+    size_t block_size = disk.get_block_size();
+    std::vector<DiskRun> runs;
+    size_t hinted = 0;
+    size_t last = (end - 1) / block_size;
+    for (size_t logical = start / block_size; logical <= last; ) {
+        size_t run = 1;
+        size_t physical = map_file_block(file, logical, &run);
+        run = std::min(run, last - logical + 1);
+        if (physical != 0) {
+            if (!runs.empty() && runs.back().first_block + runs.back().count == physical) runs.back().count += run;
+            else runs.push_back({physical, run});
+            hinted += run;
+        }
+        logical += run;
+    }
+    if (runs.empty()) return;
+    disk.prefetch(runs);
+    FS_STATS_RECORD(&op_stats, add_readahead(hinted));
+}
+
+// The end of the range a read without handle state should hint from
+// `offset`: the read itself when it spans READAHEAD_LARGE_BLOCKS or more,
+// else nothing (offset). Smaller reads are not worth the system call.
+size_t FileSystem::plan_large_read(Inode* file, size_t offset, size_t len) {
+    if (offset >= file->file_size) return offset;
+    size_t end = offset + std::min(len, file->file_size - offset);
+    return (end - offset >= READAHEAD_LARGE_BLOCKS * disk.get_block_size()) ? end : offset;
+}
+
+// Like the kernel's per-file readahead: a read starting where the previous
+// one on this handle ended is sequential, and whenever it comes within half
+// a window of the hinted range the next window is hinted and the window
+// doubles. Any other read resets the window and only hints itself if it
+// is large and was not just hinted. Returns the end of the range to hint;
+// *hint_start its start.
+size_t FileSystem::plan_readahead(int handle, Inode* file, size_t offset, size_t len, size_t* hint_start) {
+    *hint_start = offset;
+    size_t block_size = disk.get_block_size();
+    size_t end = (offset >= file->file_size) ? offset : offset + std::min(len, file->file_size - offset);
+
+    std::lock_guard<std::mutex> table(open_files_lock);
+    Readahead& ra = get_open_file(handle).ra;
+    bool sequential = offset == ra.next;
+    ra.next = end;
+    if (!sequential) {
+        ra.window = 0;
+        if (offset >= ra.start && end <= ra.end) return offset;
+        size_t hint_end = plan_large_read(file, offset, len);
+        ra.start = offset;
+        ra.end = (hint_end > offset) ? hint_end : end;
+        return hint_end;
+    }
+    if (end + ra.window / 2 < ra.end) return offset; // Still well inside the hinted range
+
+    ra.window = (ra.window == 0) ? READAHEAD_MIN_BLOCKS * block_size
+                                 : std::min(ra.window * 2, READAHEAD_MAX_BLOCKS * block_size);
+    *hint_start = std::max(offset, ra.end);
+    ra.start = std::min(ra.start, *hint_start);
+    ra.end = std::max(ra.end, end) + ra.window;
+    return ra.end;
+}
+
+size_t FileSystem::read_at(std::string_view path, size_t offset, uint8_t* buf, size_t len) {
+    Disk::PinScope pins(disk);
+    std::shared_lock<std::shared_mutex> tree(tree_lock);
+    InodeGuard guard;
+    Inode* file = resolve_regular_file(path, 4, LockMode::Shared, guard);
+    prefetch_file_range(file, offset, plan_large_read(file, offset, len));
+    return read_inode_range(file, offset, buf, len);
+}
+
+size_t FileSystem::write_at(std::string_view path, size_t offset, const uint8_t* buf, size_t len) {
+    Disk::PinScope pins(disk);
+    begin_metadata_op();
+    std::shared_lock<std::shared_mutex> tree(tree_lock);
+    InodeGuard guard;
+    return write_inode_range(resolve_regular_file(path, 2, LockMode::Exclusive, guard), offset, buf, len);
+}
+
+size_t FileSystem::append(std::string_view path, const uint8_t* buf, size_t len) {
+    Disk::PinScope pins(disk);
+    begin_metadata_op();
+    std::shared_lock<std::shared_mutex> tree(tree_lock);
+    InodeGuard guard;
+    Inode* file = resolve_regular_file(path, 2, LockMode::Exclusive, guard);
+    return write_inode_range(file, file->file_size, buf, len);
+}
+
+void FileSystem::truncate(std::string_view path, size_t new_size) {
+    Disk::PinScope pins(disk);
+    begin_metadata_op();
+    std::shared_lock<std::shared_mutex> tree(tree_lock);
+    InodeGuard guard;
+    truncate_inode(resolve_regular_file(path, 2, LockMode::Exclusive, guard), new_size);
+}
+
+// ---------------- OPEN FILE TABLE ----------------
+// The table has its own mutex, taken innermost. Handle I/O locks the inode
+// first and then re-checks the handle, since delete_file may have dropped it
+// in between. One handle's offset is not meant to be shared by threads:
+// concurrent read()/write() on it may see the same position (use read_at /
+// write_at for that).
+
+FileSystem::OpenFile& FileSystem::get_open_file(int handle) {
+    if (handle < 0 || static_cast<size_t>(handle) >= open_files.size() || !open_files[handle].in_use) {
+        throw std::runtime_error("Bad file handle.");
+    }
+    return open_files[handle];
+}
+
+// Cached maps only go stale when blocks are freed (truncate, rewrite,
+// delete); newly allocated blocks are picked up on the next miss.
+void FileSystem::invalidate_block_maps(size_t inode_id) {
+    extent_cache.invalidate(inode_id);
+}
+
+// A deleted file's inode may be handed out again, so its handles die with it.
+void FileSystem::drop_open_handles(size_t inode_id) {
+    std::lock_guard<std::mutex> table(open_files_lock);
+    for (auto& of : open_files) {
+        if (of.in_use && of.inode_id == inode_id) {
+            of.in_use = false;
+        }
+    }
+}
+
+int FileSystem::open(std::string_view path, int flags) {
+    Disk::PinScope pins(disk);
+    if ((flags & (FS_OPEN_READ | FS_OPEN_WRITE)) == 0) {
+        throw std::runtime_error("Open flags must include read or write access.");
+    }
+
+    std::shared_lock<std::shared_mutex> tree(tree_lock);
+
+    // Permissions are checked here, once, for every access the handle allows.
+    // The inode stays locked until the handle is in the table, so a racing
+    // delete either precedes open() or drops the new handle.
+    uint16_t access = ((flags & FS_OPEN_READ) ? 4 : 0) | ((flags & FS_OPEN_WRITE) ? 2 : 0);
+    InodeGuard guard;
+    Inode* file = resolve_regular_file(path, access, LockMode::Shared, guard);
+
+    std::lock_guard<std::mutex> table(open_files_lock);
+
+    // Lowest free slot, like POSIX descriptors
+    size_t slot = 0;
+    while (slot < open_files.size() && open_files[slot].in_use) slot++;
+    if (slot == open_files.size()) open_files.emplace_back();
+
+    OpenFile& of = open_files[slot];
+    of.in_use = true;
+    of.inode_id = file->id;
+    of.flags = flags;
+    of.offset = 0;
+    of.ra = Readahead();
+    return static_cast<int>(slot);
+}
+
+void FileSystem::close(int handle) {
+    std::lock_guard<std::mutex> table(open_files_lock);
+    get_open_file(handle).in_use = false;
+}
+
+Inode* FileSystem::lock_handle(int handle, int required_flag, LockMode mode, InodeGuard& guard, size_t* offset) {
+    size_t inode_id;
+    {
+        std::lock_guard<std::mutex> table(open_files_lock);
+        OpenFile& of = get_open_file(handle);
+        if (!(of.flags & required_flag)) {
+            throw std::runtime_error(required_flag == FS_OPEN_READ ? "Handle not open for reading."
+                                                                   : "Handle not open for writing.");
+        }
+        inode_id = of.inode_id;
+    }
+
+    guard = InodeGuard(inode_locks, inode_id, mode);
+
+    std::lock_guard<std::mutex> table(open_files_lock);
+    OpenFile& of = get_open_file(handle);
+    if (of.inode_id != inode_id) throw std::runtime_error("Bad file handle.");
+    if (offset != nullptr) *offset = of.offset;
+    if (mode == LockMode::Exclusive) journal_inode(inode_id);
+    return get_global_inode_ptr(inode_id);
+}
+
+void FileSystem::set_handle_offset(int handle, size_t offset) {
+    std::lock_guard<std::mutex> table(open_files_lock);
+    get_open_file(handle).offset = offset;
+}
+
+size_t FileSystem::read_at(int handle, size_t offset, uint8_t* buf, size_t len) {
+    Disk::PinScope pins(disk);
+    std::shared_lock<std::shared_mutex> tree(tree_lock);
+    InodeGuard guard;
+    Inode* file = lock_handle(handle, FS_OPEN_READ, LockMode::Shared, guard);
+    size_t hint_start = 0;
+    size_t hint_end = plan_readahead(handle, file, offset, len, &hint_start);
+    prefetch_file_range(file, hint_start, hint_end);
+    return read_inode_range(file, offset, buf, len);
+}
+
+size_t FileSystem::write_at(int handle, size_t offset, const uint8_t* buf, size_t len) {
+    Disk::PinScope pins(disk);
+    begin_metadata_op();
+    std::shared_lock<std::shared_mutex> tree(tree_lock);
+    InodeGuard guard;
+    return write_inode_range(lock_handle(handle, FS_OPEN_WRITE, LockMode::Exclusive, guard), offset, buf, len);
+}
+
+size_t FileSystem::read(int handle, uint8_t* buf, size_t len) {
+    Disk::PinScope pins(disk);
+    std::shared_lock<std::shared_mutex> tree(tree_lock);
+    InodeGuard guard;
+    size_t offset = 0;
+    Inode* file = lock_handle(handle, FS_OPEN_READ, LockMode::Shared, guard, &offset);
+    size_t hint_start = 0;
+    size_t hint_end = plan_readahead(handle, file, offset, len, &hint_start);
+    prefetch_file_range(file, hint_start, hint_end);
+    size_t n = read_inode_range(file, offset, buf, len);
+    set_handle_offset(handle, offset + n);
+    return n;
+}
+
+size_t FileSystem::write(int handle, const uint8_t* buf, size_t len) {
+    Disk::PinScope pins(disk);
+    begin_metadata_op();
+    std::shared_lock<std::shared_mutex> tree(tree_lock);
+    InodeGuard guard;
+    size_t offset = 0;
+    Inode* file = lock_handle(handle, FS_OPEN_WRITE, LockMode::Exclusive, guard, &offset);
+
+    int flags;
+    {
+        std::lock_guard<std::mutex> table(open_files_lock);
+        flags = get_open_file(handle).flags;
+    }
+    if (flags & FS_OPEN_APPEND) offset = file->file_size;
+
+    size_t n = write_inode_range(file, offset, buf, len);
+    set_handle_offset(handle, offset + n);
+    return n;
+}
+
+void FileSystem::seek(int handle, size_t offset) {
+    set_handle_offset(handle, offset);
+}
+
+// ---------------- ZERO-COPY I/O ----------------
+
+namespace {
+// What holes in a read view point at
+const uint8_t zero_block[4096] = {};
+}
+
+void ReadLease::release() {
+    if (disk != nullptr) {
+        for (size_t block_id : pinned) disk->unpin_block(block_id);
+    }
+    pinned.clear();
+    views.clear();
+    bytes = 0;
+    guard.unlock();
+    if (tree.owns_lock()) tree.unlock();
+}
+
+ReadLease& ReadLease::operator=(ReadLease&& other) noexcept {
+    if (this != &other) {
+        release();
+        tree = std::move(other.tree);
+        guard = std::move(other.guard);
+        disk = other.disk;
+        pinned = std::move(other.pinned);
+        views = std::move(other.views);
+        bytes = other.bytes;
+        other.pinned.clear();
+        other.bytes = 0;
+    }
+    return *this;
+}
+
+// One view per physically contiguous run on a resident image; behind a
+// cache frames are not contiguous, so one per block, each pinned.
+void FileSystem::fill_read_lease(ReadLease& lease, Inode* file, size_t offset, size_t len) {
+    if (offset >= file->file_size) return;
+    len = std::min(len, file->file_size - offset);
+    lease.disk = &disk;
+    lease.bytes = len;
+    FS_STATS_RECORD(&op_stats, add_bytes_read(len));
+
+    auto add_view = [&](const uint8_t* data, size_t n) {
+        iovec* last = lease.views.empty() ? nullptr : &lease.views.back();
+        if (last != nullptr && static_cast<const uint8_t*>(last->iov_base) + last->iov_len == data && data != zero_block) {
+            last->iov_len += n;
+        } else {
+            lease.views.push_back({const_cast<uint8_t*>(data), n});
+        }
+    };
+
+    if (file->flags & INODE_FLAG_INLINE) {
+        add_view(inline_data(file) + offset, len);
+        return;
+    }
+
+    size_t block_size = disk.get_block_size();
+    bool cached = disk.get_cache() != nullptr;
+    for (size_t done = 0; done < len; ) {
+        size_t pos = offset + done;
+        size_t in_block = pos % block_size;
+
+        size_t run = 1;
+        size_t block_id = map_file_block(file, pos / block_size, &run);
+        if (cached || block_id == 0) run = 1;
+        size_t chunk = std::min(run * block_size - in_block, len - done);
+
+        if (block_id == 0) {
+            add_view(zero_block + in_block, chunk);
+        } else {
+            const uint8_t* data = disk.pin_block(block_id);
+            if (cached) lease.pinned.push_back(block_id);
+            add_view(data + in_block, chunk);
+        }
+        done += chunk;
+    }
+}
+
+ReadLease FileSystem::read_view(std::string_view path, size_t offset, size_t len) {
+    Disk::PinScope pins(disk);
+    ReadLease lease;
+    lease.tree = std::shared_lock<std::shared_mutex>(tree_lock);
+    Inode* file = resolve_regular_file(path, 4, LockMode::Shared, lease.guard);
+    prefetch_file_range(file, offset, plan_large_read(file, offset, len));
+    fill_read_lease(lease, file, offset, len);
+    return lease;
+}
+
+ReadLease FileSystem::read_view(int handle, size_t offset, size_t len) {
+    Disk::PinScope pins(disk);
+    ReadLease lease;
+    lease.tree = std::shared_lock<std::shared_mutex>(tree_lock);
+    Inode* file = lock_handle(handle, FS_OPEN_READ, LockMode::Shared, lease.guard);
+    size_t hint_start = 0;
+    size_t hint_end = plan_readahead(handle, file, offset, len, &hint_start);
+    prefetch_file_range(file, hint_start, hint_end);
+    fill_read_lease(lease, file, offset, len);
+    return lease;
+}
+
+// The size limit is checked for the whole list first, so a list that does
+// not fit writes nothing
+size_t FileSystem::write_inode_iovecs(Inode* file, size_t offset, const iovec* iov, int iovcnt) {
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; i++) total += iov[i].iov_len;
+    size_t block_size = disk.get_block_size();
+    if (total != 0 && (offset + total + block_size - 1) / block_size > max_data_blocks()) {
+        throw std::runtime_error("File too large.");
+    }
+
+    size_t done = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        done += write_inode_range(file, offset + done, static_cast<const uint8_t*>(iov[i].iov_base), iov[i].iov_len);
+    }
+    return done;
+}
+
+size_t FileSystem::writev(int handle, const iovec* iov, int iovcnt) {
+    Disk::PinScope pins(disk);
+    begin_metadata_op();
+    std::shared_lock<std::shared_mutex> tree(tree_lock);
+    InodeGuard guard;
+    size_t offset = 0;
+    Inode* file = lock_handle(handle, FS_OPEN_WRITE, LockMode::Exclusive, guard, &offset);
+
+    int flags;
+    {
+        std::lock_guard<std::mutex> table(open_files_lock);
+        flags = get_open_file(handle).flags;
+    }
+    if (flags & FS_OPEN_APPEND) offset = file->file_size;
+
+    size_t n = write_inode_iovecs(file, offset, iov, iovcnt);
+    set_handle_offset(handle, offset + n);
+    return n;
+}
+
+size_t FileSystem::pwritev(int handle, size_t offset, const iovec* iov, int iovcnt) {
+    Disk::PinScope pins(disk);
+    begin_metadata_op();
+    std::shared_lock<std::shared_mutex> tree(tree_lock);
+    InodeGuard guard;
+    return write_inode_iovecs(lock_handle(handle, FS_OPEN_WRITE, LockMode::Exclusive, guard), offset, iov, iovcnt);
+}
+
+void FileSystem::create_fs_entry(std::string_view path, FS_FILE_TYPES type, uint32_t flags) {
+    begin_metadata_op();
+    std::shared_lock<std::shared_mutex> tree(tree_lock);
+    std::string_view filename;
+    size_t parent_id = 0;
+    InodeGuard guard;
+    size_t existing = lock_entry(path, LockMode::Exclusive, LockMode::Exclusive, guard, &parent_id, &filename);
+    if (filename.empty()) throw std::runtime_error("Path cannot be empty.");
+    if (existing != 0) {
+        throw std::runtime_error("Error: '" + std::string(filename) + "' already exists.");
+    }
+    Inode* parent_inode = get_global_inode_ptr(parent_id);
+
+    int new_id = allocate_inode_any(group_of_inode(parent_id));
+    if (new_id == -1) throw std::runtime_error("Disk Full.");
+
+    link_new_inode(parent_inode, new_id, type, flags, filename);
+    Logger::log(LogLevel::Info, (type == FS_DIRECTORY ? "Directory" : "File"), " '", filename, "' created.");
+}
+
+// Builds a freshly allocated inode and links it into the (exclusively
+// locked) parent. On failure the inode and any blocks it got are released.
+void FileSystem::link_new_inode(Inode* parent_inode, size_t new_id, FS_FILE_TYPES type, uint32_t flags,
+                                std::string_view filename) {
+    size_t parent_id = parent_inode->id;
+    Inode* new_inode = get_global_inode_ptr(new_id);
+    new_inode->id = new_id;
+    new_inode->file_size = 0;
+    new_inode->file_type = type;
+    
+    // Permissions
+    new_inode->uid = current_uid; 
+    new_inode->gid = current_gid;
+    // Directories usually get 755, files get 644
+    new_inode->permissions = (type == FS_DIRECTORY) ? 0755 : 0644;
+
+    // Regular files start inline unless they asked for extents
+    std::memset(new_inode->direct_blocks, 0, sizeof(new_inode->direct_blocks));
+    if (type == FS_FILE && !(flags & INODE_FLAG_EXTENTS)) flags |= INODE_FLAG_INLINE;
+    new_inode->flags = flags;
+
+    // The new inode is fully built before it is linked: nobody can reach it
+    // until the parent entry exists, so it needs no lock of its own.
+    try {
+        if (type == FS_DIRECTORY) {
+            add_entry_to_dir(new_inode, new_id, ".");
+            add_entry_to_dir(new_inode, parent_id, "..");
+        }
+        add_entry_to_dir(parent_inode, new_id, filename);
+    } catch (...) {
+        if (type == FS_DIRECTORY) {
+            FreeBatch batch;
+            release_dir_blocks(new_inode, batch);
+            free_batch(batch);
+        }
+        block_group_managers[group_of_inode(new_id)].free_inode(new_id);
+        throw;
+    }
+}
+
+// ---------------- DEFERRED RECLAIM ----------------
+
+void FileSystem::set_orphan_head(size_t inode_id) {
+    sb->orphan_head = inode_id;
+    reinterpret_cast<SuperBlock*>(meta_ptr(0))->orphan_head = inode_id;
+}
+
+void FileSystem::push_orphan(size_t inode_id) {
+    Inode* node = get_global_inode_ptr(inode_id);
+    journal_inode(inode_id);
+    node->next_orphan = sb->orphan_head;
+    set_orphan_head(inode_id);
+}
+
+size_t FileSystem::pop_orphan() {
+    size_t inode_id = sb->orphan_head;
+    Inode* node = get_global_inode_ptr(inode_id);
+    journal_inode(inode_id);
+    set_orphan_head(node->next_orphan);
+    node->next_orphan = 0;
+    return inode_id;
+}
+
+// Caller holds tree_lock exclusively and has just unlinked dir_id. The push
+// lands in the unlink's transaction.
+void FileSystem::defer_tree(size_t dir_id) {
+    push_orphan(dir_id);
+    {
+        std::lock_guard<std::mutex> lock(deferred_lock);
+        reclaim_pending = true;
+    }
+    deferred_cv.notify_one();
+}
+
+// Pops inodes off the orphan chain until max_inodes have been freed: a
+// directory's children are pushed in its place before its own blocks go,
+// a file releases its blocks. Everything collected goes back to the
+// bitmaps in one free_batch, in the same transaction as the pops.
+size_t FileSystem::reclaim_deferred(size_t max_inodes) {
+    FreeBatch batch;
+    size_t freed = 0;
+    try {
+        while (freed < max_inodes && sb->orphan_head != 0) {
+            size_t inode_id = pop_orphan();
+            Inode* node = get_global_inode_ptr(inode_id);
+            if (node->file_type == FS_DIRECTORY) {
+                for_each_dir_entry(node, [&](DirRecord& entry) {
+                    std::string_view entry_name(entry.name(), entry.name_len);
+                    if (entry_name != "." && entry_name != "..") push_orphan(entry.inode_id);
+                });
+                release_dir_blocks(node, batch);
+                batch.inodes.push_back(inode_id);
+            } else if (node->file_type != FS_FREE) {
+                release_file_resources(inode_id, true, &batch);
+            } else {
+                Logger::log(LogLevel::Warning, "Reclaim: orphan chain names free inode ", inode_id);
+            }
+            freed++;
+        }
+        reclaim_pending = sb->orphan_head != 0;
+    } catch (...) {
+        free_batch(batch);
+        throw;
+    }
+    free_batch(batch);
+    return freed;
+}
+
+// Trees unlinked before a crash or an unclean unmount are still chained
+void FileSystem::finish_orphans_locked() {
+    if (sb->orphan_head == 0) return;
+    Logger::log(LogLevel::Info, "Mount: finishing the reclaim of removed trees.");
+    reclaim_pending = true;
+    reclaim_all_locked();
+}
+
+void FileSystem::reclaim_all_locked() {
+    while (reclaim_pending) reclaim_deferred(RECLAIM_CHUNK);
+}
+
+void FileSystem::drain_deferred() {
+    if (!reclaim_pending) return;
+    std::unique_lock<std::shared_mutex> tree(tree_lock);
+    reclaim_all_locked();
+}
+
+void FileSystem::reclaimer_loop() {
+    std::unique_lock<std::mutex> lock(deferred_lock);
+    while (true) {
+        deferred_cv.wait(lock, [&] { return reclaimer_stop || reclaim_pending; });
+        if (reclaimer_stop) return;
+        lock.unlock();
+        try {
+            Disk::PinScope pins(disk);
+            begin_metadata_op();
+            std::unique_lock<std::shared_mutex> tree(tree_lock);
+            reclaim_deferred(RECLAIM_CHUNK);
+        } catch (const std::exception& e) {
+            Logger::log(LogLevel::Error, "Deferred reclaim failed: ", e.what());
+        }
+        lock.lock();
+    }
+}
+
+void FileSystem::set_background_reclaim(bool enabled) {
+    if (enabled == reclaimer.joinable()) return;
+    if (enabled) {
+        reclaimer_stop = false;
+        reclaimer = std::thread(&FileSystem::reclaimer_loop, this);
+        background_reclaim = true;
+        return;
+    }
+
+    background_reclaim = false;
+    {
+        std::lock_guard<std::mutex> lock(deferred_lock);
+        reclaimer_stop = true;
+    }
+    deferred_cv.notify_all();
+    reclaimer.join();
+}
+
+void FileSystem::reclaim_deferred_frees() {
+    Disk::PinScope pins(disk);
+    drain_deferred();
+}
+
+// ---------------- PUBLIC API ----------------
+
+void FileSystem::create_file(std::string_view path, bool use_extents) {
+    Disk::PinScope pins(disk);
+    create_fs_entry(path, FS_FILE_TYPES::FS_FILE, use_extents ? INODE_FLAG_EXTENTS : 0);
+}
+
+void FileSystem::create_dir(std::string_view path) {
+    Disk::PinScope pins(disk);
+    create_fs_entry(path, FS_FILE_TYPES::FS_DIRECTORY);
+}
+
+void FileSystem::create_symlink(std::string_view target, std::string_view link_path) {
+    Disk::PinScope pins(disk);
+    begin_metadata_op();
+    std::shared_lock<std::shared_mutex> tree(tree_lock);
+    std::string_view link_name;
+    size_t parent_id = 0;
+    InodeGuard guard;
+    size_t existing = lock_entry(link_path, LockMode::Exclusive, LockMode::Exclusive, guard, &parent_id, &link_name);
+    if (link_name.empty()) throw std::runtime_error("Link path cannot be empty.");
+    if (existing != 0) {
+        throw std::runtime_error("Error: '" + std::string(link_name) + "' already exists.");
+    }
+    Inode* parent_inode = get_global_inode_ptr(parent_id);
+
+    size_t block_size = disk.get_block_size();
+    if (target.size() > block_size) {
+        throw std::runtime_error("Symlink target too long.");
+    }
+
+    int new_id = allocate_inode_any(group_of_inode(parent_id));
+    if (new_id == -1) throw std::runtime_error("Disk Full.");
+
+    Inode* new_inode = get_global_inode_ptr(new_id);
+    new_inode->id = new_id;
+    new_inode->file_type = FS_SYMLINK;
+    new_inode->file_size = target.size();
+    new_inode->uid = current_uid;
+    new_inode->gid = current_gid;
+    new_inode->permissions = 0777;
+
+    std::memset(new_inode->direct_blocks, 0, sizeof(new_inode->direct_blocks));
+    new_inode->flags = 0;
+
+    if (target.size() <= INODE_INLINE_CAPACITY) {
+        // Fast symlink: the target lives in the inode, no data block
+        new_inode->flags = INODE_FLAG_INLINE;
+        std::memcpy(inline_data(new_inode), target.data(), target.size());
+    } else {
+        int block_num = allocate_block_any(group_of_inode(new_id));
+        if (block_num == -1) {
+            block_group_managers[group_of_inode(new_id)].free_inode(new_id);
+            throw std::runtime_error("Disk Full.");
+        }
+
+        new_inode->direct_blocks[0] = block_num;
+        std::memset(meta_ptr(block_num), 0, block_size);
+        std::memcpy(disk.get_ptr(block_num), target.data(), target.size());
+    }
+
+    // Linked last, as in create_fs_entry
+    try {
+        add_entry_to_dir(parent_inode, new_id, link_name);
+    } catch (...) {
+        release_file_resources(new_id, true);
+        throw;
+    }
+    Logger::log(LogLevel::Info, "Symlink '", link_name, "' -> '", target, "' created.");
+}
+
+FileStats FileSystem::get_stats(std::string_view path) {
+    Disk::PinScope pins(disk);
+    std::shared_lock<std::shared_mutex> tree(tree_lock);
+    InodeGuard guard;
+    size_t file_id = lock_entry(path, LockMode::Shared, LockMode::Shared, guard);
+    if (file_id == 0) throw std::runtime_error("File not found: " + std::string(path));
+
+    return fill_stats(get_global_inode_ptr(file_id));
+}
+
+// Caller holds the inode's lock
+FileStats FileSystem::fill_stats(Inode* inode) {
+    FileStats stats;
+    stats.inode_id = inode->id;
+    stats.uid = inode->uid;
+    stats.gid = inode->gid;
+    stats.permissions = inode->permissions;
+    stats.file_size = inode->file_size;
+    stats.file_type = inode->file_type;
+    stats.flags = inode->flags;
+    
+    if (inode->file_type == FS_SYMLINK) stats.symlink_target = symlink_target(inode);
+    
+    return stats;
+}
+
+void FileSystem::write_file(std::string_view path, const std::vector<uint8_t>& data) {
+    Disk::PinScope pins(disk);
+    begin_metadata_op();
+    std::shared_lock<std::shared_mutex> tree(tree_lock);
+    std::string_view filename;
+    PathIterator it(path);
+    for (std::string_view part; it.next(part);) filename = part;
+
+    size_t block_size = disk.get_block_size();
+    size_t required_blocks = (data.size() + block_size - 1) / block_size;
+    if (required_blocks > max_data_blocks()) {
+        throw std::runtime_error("File too large.");
+    }
+
+    InodeGuard guard;
+    Inode* file_inode = resolve_regular_file(path, 2, LockMode::Exclusive, guard);
+
+    // Free all existing blocks first, then lay the new data out from block 0
+    release_file_resources(file_inode->id, false);
+    file_inode->file_size = 0;
+    write_inode_range(file_inode, 0, data.data(), data.size());
+    Logger::log(LogLevel::Info, "Written ", data.size(), " bytes to ", filename);
+}
+
+std::vector<uint8_t> FileSystem::read_file(std::string_view path) {
+    Disk::PinScope pins(disk);
+    std::shared_lock<std::shared_mutex> tree(tree_lock);
+    size_t parent_id = 0;
+    InodeGuard guard;
+    size_t file_id = lock_entry(path, LockMode::Shared, LockMode::Shared, guard, &parent_id);
+
+    if (file_id == 0) throw std::runtime_error("File not found.");
+    guard.unlock_inode(inode_locks, parent_id);
+    Inode* file_inode = get_global_inode_ptr(file_id);
+
+    if (!check_permission(file_inode, 4)) {
+        throw std::runtime_error("Permission denied: No read access to this file.");
+    }
+
+    std::vector<uint8_t> buffer(file_inode->file_size);
+    prefetch_file_range(file_inode, 0, plan_large_read(file_inode, 0, buffer.size()));
+    read_inode_range(file_inode, 0, buffer.data(), buffer.size());
+    return buffer;
+}
+
+void FileSystem::delete_file(std::string_view path) {
+    Disk::PinScope pins(disk);
+    begin_metadata_op();
+    std::shared_lock<std::shared_mutex> tree(tree_lock);
+    std::string_view filename;
+    size_t parent_id = 0;
+    InodeGuard guard;
+    size_t file_id = lock_entry(path, LockMode::Exclusive, LockMode::Exclusive, guard, &parent_id, &filename);
+    Inode* parent_inode = get_global_inode_ptr(parent_id);
+
+    // GATEKEEPER: Check if user can modify the parent directory
+    if (!check_permission(parent_inode, 2)) { 
         throw std::runtime_error("Permission denied: Cannot modify parent directory.");
     }
 
-    int max_entries = 4096 / sizeof(DirEntry);
+    if (file_id == 0) throw std::runtime_error("File not found.");
+
+    // Cached children of a removed directory would outlive its inode
+    if (get_global_inode_ptr(file_id)->file_type == FS_DIRECTORY) dcache.clear();
+
+    release_file_resources(file_id, true);
+    remove_entry_from_dir(parent_inode, filename);
+    Logger::log(LogLevel::Info, "Deleted ", filename);
+}
+
+void FileSystem::release_file_resources(size_t inode_id, bool free_inode_too, FreeBatch* batch) {
+    if (batch == nullptr) {
+        FreeBatch local;
+        release_file_resources(inode_id, free_inode_too, &local);
+        free_batch(local);
+        return;
+    }
+
+    Inode* node = get_global_inode_ptr(inode_id);
+    journal_inode(inode_id);
+    invalidate_block_maps(inode_id);
+    if (free_inode_too) {
+        drop_open_handles(inode_id);
+        batch->inodes.push_back(inode_id);
+    }
+
+    // Inline: nothing to free. Extent-mapped: free the runs. Either way the
+    // inode keeps its layout flag.
+    if (node->flags & INODE_FLAG_INLINE) {
+        std::memset(inline_data(node), 0, INODE_INLINE_CAPACITY);
+        return;
+    }
+    if (node->flags & INODE_FLAG_EXTENTS) {
+        truncate_extents(node, 0);
+        return;
+    }
+
+    // Free direct blocks
     for (int i = 0; i < 12; i++) {
-        if (parent_inode->direct_blocks[i] == 0) break;
-        DirEntry* entry = reinterpret_cast<DirEntry*>(disk.get_ptr(parent_inode->direct_blocks[i]));
-
-        for (int j = 0; j < max_entries; j++) {
-            if (entry[j].inode_id != 0) {
-                std::string entry_name(entry[j].name, entry[j].name_len);
-                if (entry_name == dirname) {
-                    Inode* target = get_global_inode_ptr(entry[j].inode_id);
-                    if (target->file_type != FS_DIRECTORY) throw std::runtime_error("Not a directory.");
-
-                    recursive_resource_release(entry[j].inode_id);
-                    std::memset(&entry[j], 0, sizeof(DirEntry));
-                    parent_inode->file_size -= sizeof(DirEntry);
-                    std::cout << "Deleted directory " << dirname << "\n";
-                    return;
-                }
-            }
+        if (node->direct_blocks[i] != 0) {
+            batch->blocks.push_back(node->direct_blocks[i]);
+            node->direct_blocks[i] = 0;
+        }
+    }
+
+    // Free the single, double and triple indirect trees, up to EOF. A
+    // directory's size counts its records, not its blocks (index buckets
+    // stay mapped when emptied), so its trees are walked in full.
+    const size_t p = pointers_per_block();
+    size_t block_size = disk.get_block_size();
+    size_t blocks = (node->file_size + block_size - 1) / block_size;
+    size_t left = blocks > 12 ? blocks - 12 : 0;
+    if (node->file_type == FS_DIRECTORY) left = SIZE_MAX;
+    size_t* roots[3] = {&node->single_indirect, &node->double_indirect, &node->triple_indirect};
+    size_t span = p;
+    for (int depth = 1; depth <= 3; depth++) {
+        if (*roots[depth - 1] != 0) {
+            collect_block_tree(*roots[depth - 1], depth, std::min(left, span), *batch);
+            *roots[depth - 1] = 0;
         }
+        left -= std::min(left, span);
+        span *= p;
+    }
+
+    // A file being rewritten (write_file) starts over inline
+    if (!free_inode_too && node->file_type == FS_FILE) node->flags |= INODE_FLAG_INLINE;
+}
+
+void FileSystem::free_block_range(size_t first_block, size_t count) {
+    while (count > 0) {
+        size_t group = first_block / sb->blocks_per_group;
+        size_t in_group = std::min(count, (group + 1) * sb->blocks_per_group - first_block);
+        block_group_managers[group].free_block_run(static_cast<int>(first_block), static_cast<int>(in_group));
+        first_block += in_group;
+        count -= in_group;
     }
-    throw std::runtime_error("Directory not found.");
 }
 
-std::vector<FileEntry> FileSystem::list_dir(std::string path, bool include_special) {
-    auto tokenized_path = tokenize_path(path, '/');
+void FileSystem::free_batch(FreeBatch& batch) {
+    std::sort(batch.blocks.begin(), batch.blocks.end());
+    for (size_t i = 0; i < batch.blocks.size(); ) {
+        size_t run = 1;
+        while (i + run < batch.blocks.size() && batch.blocks[i + run] == batch.blocks[i] + run) run++;
+        free_block_range(batch.blocks[i], run);
+        i += run;
+    }
+    for (size_t inode_id : batch.inodes) block_group_managers[group_of_inode(inode_id)].free_inode(inode_id);
+    batch.blocks.clear();
+    batch.inodes.clear();
+}
+
+// Takes the tree lock exclusively: nothing may be walking through the
+// subtree while it is unlinked. Unlinked, it is unreachable, so it can be
+// reclaimed later without per-inode locks (see defer_tree).
+void FileSystem::delete_dir(std::string_view path) {
+    Disk::PinScope pins(disk);
+    begin_metadata_op();
+    std::unique_lock<std::shared_mutex> tree(tree_lock);
+    std::string_view dirname;
+    size_t parent_id = traverse_path_till_parent(path, dirname);
+    Inode* parent_inode = get_global_inode_ptr(parent_id);
+
+    // You need write permission (2) on the parent to remove a subdirectory
+    if (!check_permission(parent_inode, 2)) {
+        throw std::runtime_error("Permission denied: Cannot modify parent directory.");
+    }
+
+    size_t dir_id = find_inode_in_dir(parent_inode, dirname);
+    if (dir_id == 0) throw std::runtime_error("Directory not found.");
+
+    Inode* target = get_global_inode_ptr(dir_id);
+    if (target->file_type != FS_DIRECTORY) throw std::runtime_error("Not a directory.");
+
+    remove_entry_from_dir(parent_inode, dirname);
+    // The whole subtree's entries are gone; their inodes will be reused
+    dcache.clear();
+    defer_tree(dir_id);
+    Logger::log(LogLevel::Info, "Deleted directory ", dirname);
+}
+
+std::vector<FileEntry> FileSystem::list_dir(std::string_view path, bool include_special) {
+    Disk::PinScope pins(disk);
+    // GEMINI FIX: Do not pop_back().
+    // traverse_path_till_parent automatically returns the parent of the LAST token.
+    // Input: "a/b" -> Returns Inode("a")
+    // Then we find "b" inside "a".
+    std::shared_lock<std::shared_mutex> tree(tree_lock);
+    std::string_view dirname;
+    size_t parent_id = 0;
     size_t target_id;
+    InodeGuard guard;
 
     // CASE 1: Root Directory "/"
-    if (tokenized_path.empty()) {
+    if (PathIterator(path).next(dirname) == false) {
         target_id = sb->home_dir_inode;
+        guard = InodeGuard(inode_locks, target_id, LockMode::Shared);
     }
     // CASE 2: Any other directory
     else {
-        // GEMINI FIX: Do not pop_back().
-        // traverse_path_till_parent automatically returns the parent of the LAST token.
-        // Input: ["a", "b"] -> Returns Inode("a")
-        // Then we find "b" inside "a".
-        std::string dirname = tokenized_path.back();
-        size_t parent_id = traverse_path_till_parent(tokenized_path);
-
-        Inode* parent_inode = get_global_inode_ptr(parent_id);
-        target_id = find_inode_in_dir(parent_inode, dirname);
+        target_id = lock_entry(path, LockMode::Shared, LockMode::Shared, guard, &parent_id, &dirname);
     }
 
     if (target_id == 0) throw std::runtime_error("Directory not found.");
+    if (parent_id != 0) guard.unlock_inode(inode_locks, parent_id);
 
     Inode* dir = get_global_inode_ptr(target_id);
     if (dir->file_type != FS_DIRECTORY) throw std::runtime_error("Not a directory.");
@@ -683,53 +2166,249 @@ std::vector<FileEntry> FileSystem::list_dir(std::string path, bool include_speci
     }
 
     std::vector<FileEntry> results;
-    int max = 4096 / sizeof(DirEntry);
+    std::vector<size_t> item_ids;
 
-    // Scan all blocks of the directory
-    for (int i = 0; i < 12; i++) {
-        if (dir->direct_blocks[i] == 0) break;
+    // Scan all entries of the directory (every block or every bucket)
+    for_each_dir_entry(dir, [&](DirRecord& entry) {
+        std::string_view entry_name(entry.name(), entry.name_len);
+        if (!include_special && (entry_name == "." || entry_name == "..")) {
+            return;
+        }
+        results.push_back({std::string(entry_name), 0, 0, 0, false, false});
+        item_ids.push_back(entry.inode_id);
+    });
+
+    // Attributes are read after the directory is released, one inode lock
+    // at a time, so the listing never holds two locks out of stripe order.
+    guard.unlock();
+    for (size_t i = 0; i < results.size(); i++) {
+        InodeGuard item_guard(inode_locks, item_ids[i], LockMode::Shared);
+        Inode* item_inode = get_global_inode_ptr(item_ids[i]);
+        results[i].uid = item_inode->uid;
+        results[i].gid = item_inode->gid;
+        results[i].permissions = item_inode->permissions;
+        results[i].is_directory = item_inode->file_type == FS_DIRECTORY;
+        results[i].is_symlink = item_inode->file_type == FS_SYMLINK;
+    }
+    return results;
+}
+
+// ---------------- BATCH OPERATIONS ----------------
+
+// Names are linked as single entries of the directory: no path syntax
+static void check_batch_name(const std::string& name) {
+    if (name.empty() || name == "." || name == ".." || name.find('/') != std::string::npos) {
+        throw std::runtime_error("Invalid entry name: '" + name + "'");
+    }
+    if (name.size() > 255) throw std::runtime_error("File name too long: " + name);
+}
+
+// Resolves a batch's directory (path walk, symlinks followed as usual) and
+// locks it in `mode`. Re-run for every chunk, so a concurrent rename or
+// delete of the directory is noticed; the walk is amortized over the chunk.
+Inode* FileSystem::lock_batch_dir(std::string_view path, LockMode mode, InodeGuard& guard) {
+    std::string_view leaf;
+    size_t parent_id = 0;
+    size_t dir_id = lock_entry(path, LockMode::Shared, mode, guard, &parent_id, &leaf);
+    if (leaf.empty()) {
+        // "/": nothing above it to hold, drop the shared lock before upgrading
+        guard = InodeGuard();
+        dir_id = parent_id;
+        guard = InodeGuard(inode_locks, dir_id, mode);
+        if (mode == LockMode::Exclusive) journal_inode(dir_id);
+    }
+    if (dir_id == 0) throw std::runtime_error("Path not found: " + std::string(path));
+
+    Inode* dir = get_global_inode_ptr(dir_id);
+    if (dir->file_type != FS_DIRECTORY) throw std::runtime_error("Not a directory: " + std::string(path));
+    return dir;
+}
 
-        DirEntry* entry = reinterpret_cast<DirEntry*>(disk.get_ptr(dir->direct_blocks[i]));
-        for (int j = 0; j < max; j++) {
-            if (entry[j].inode_id != 0) {
-                std::string entry_name(entry[j].name, entry[j].name_len);
-                if (!include_special && (entry_name == "." || entry_name == "..")) {
-                    continue;
+// All or nothing: on a short allocation the inodes already claimed go back
+std::vector<int> FileSystem::allocate_inodes_any(size_t preferred_group, size_t n) {
+    std::vector<int> ids;
+    ids.reserve(n);
+    preferred_group = start_group(preferred_group);
+    size_t groups = block_group_managers.size();
+    for (size_t i = 0; i < groups && ids.size() < n; i++) {
+        BlockGroupManager& bgm = block_group_managers[(preferred_group + i) % groups];
+        while (ids.size() < n && bgm.get_free_inodes_count() > 0) {
+            int len = 0;
+            int first = bgm.allocate_inode_run(static_cast<int>(n - ids.size()), &len);
+            if (first == -1) break;
+            for (int id = first; id < first + len; id++) ids.push_back(id);
+        }
+    }
+    if (ids.size() < n) {
+        for (int id : ids) block_group_managers[group_of_inode(id)].free_inode(id);
+        ids.clear();
+    }
+    return ids;
+}
+
+std::vector<size_t> FileSystem::create_many(std::string_view parent, const std::vector<std::string>& names,
+                                            FS_FILE_TYPES type) {
+    Disk::PinScope pins(disk);
+    if (type == FS_SYMLINK) throw std::runtime_error("create_many: use create_symlink for links.");
+
+    std::vector<size_t> created;
+    created.reserve(names.size());
+    std::unordered_set<std::string_view> batch_names; // Duplicates inside the batch
+    for (size_t first = 0; first < names.size(); first += BATCH_CHUNK) {
+        size_t count = std::min(BATCH_CHUNK, names.size() - first);
+        begin_metadata_op();
+        std::shared_lock<std::shared_mutex> tree(tree_lock);
+        InodeGuard guard;
+        Inode* dir = lock_batch_dir(parent, LockMode::Exclusive, guard);
+        if (!check_permission(dir, 2)) {
+            throw std::runtime_error("Permission denied: Cannot modify parent directory.");
+        }
+
+        // The chunk is checked before anything is allocated for it; the
+        // names ahead of a bad one are still created, then its error thrown
+        std::exception_ptr error;
+        size_t valid = 0;
+        for (; valid < count; valid++) {
+            const std::string& name = names[first + valid];
+            try {
+                check_batch_name(name);
+                if (!batch_names.insert(name).second || find_inode_in_dir(dir, name) != 0) {
+                    throw std::runtime_error("Error: '" + name + "' already exists.");
                 }
-                Inode* item_inode = get_global_inode_ptr(entry[j].inode_id);
-                results.push_back({
-                    entry_name,
-                    item_inode->uid,
-                    item_inode->gid,
-                    item_inode->permissions,
-                    item_inode->file_type == FS_DIRECTORY,
-                    item_inode->file_type == FS_SYMLINK
-                });
+            } catch (...) {
+                error = std::current_exception();
+                break;
+            }
+        }
+        count = valid;
+
+        std::vector<int> ids;
+        if (count > 0) {
+            ids = allocate_inodes_any(group_of_inode(dir->id), count);
+            if (ids.empty()) throw std::runtime_error("Disk Full.");
+        }
+        for (size_t i = 0; i < count; i++) {
+            try {
+                link_new_inode(dir, ids[i], type, 0, names[first + i]);
+            } catch (...) {
+                for (size_t j = i + 1; j < count; j++) block_group_managers[group_of_inode(ids[j])].free_inode(ids[j]);
+                throw;
             }
+            created.push_back(ids[i]);
         }
+        if (error) std::rethrow_exception(error);
     }
-    return results;
+
+    Logger::log(LogLevel::Info, "Created ", created.size(), " entries in '", parent, "'.");
+    return created;
+}
+
+// Consecutive paths with the same parent share one walk to it
+std::vector<FileStats> FileSystem::stat_many(const std::vector<std::string>& paths) {
+    Disk::PinScope pins(disk);
+    std::vector<FileStats> result;
+    result.reserve(paths.size());
+
+    for (size_t first = 0; first < paths.size(); first += BATCH_CHUNK) {
+        size_t count = std::min(BATCH_CHUNK, paths.size() - first);
+        std::shared_lock<std::shared_mutex> tree(tree_lock);
+        std::string_view cached_parent;
+        size_t cached_dir = 0;
+        bool have_parent = false;
+
+        for (size_t i = first; i < first + count; i++) {
+            std::string_view path = paths[i];
+            std::string_view trimmed = path.substr(0, path.find_last_not_of('/') + 1);
+            size_t slash = trimmed.rfind('/');
+            std::string_view parent = (slash == std::string_view::npos) ? std::string_view() : trimmed.substr(0, slash);
+
+            std::string_view leaf;
+            size_t dir_id = 0;
+            if (have_parent && parent == cached_parent && !trimmed.empty()) {
+                dir_id = cached_dir;
+                leaf = trimmed.substr(slash == std::string_view::npos ? 0 : slash + 1);
+            } else {
+                dir_id = traverse_path_till_parent(path, leaf);
+                cached_parent = parent;
+                cached_dir = dir_id;
+                have_parent = true;
+            }
+
+            InodeGuard guard;
+            // Like get_stats, "/" itself is not an entry
+            size_t file_id = lock_entry_at(dir_id, leaf, path, LockMode::Shared, LockMode::Shared, guard);
+            if (file_id == 0) {
+                FileStats missing{};
+                missing.inode_id = 0;
+                result.push_back(missing);
+                continue;
+            }
+            result.push_back(fill_stats(get_global_inode_ptr(file_id)));
+        }
+    }
+    return result;
+}
+
+// Runs each chunk under the exclusive tree lock, like delete_dir: the
+// victims are freed without taking their own locks.
+size_t FileSystem::unlink_many(std::string_view parent, const std::vector<std::string>& names) {
+    Disk::PinScope pins(disk);
+    size_t removed = 0;
+    for (size_t first = 0; first < names.size(); first += BATCH_CHUNK) {
+        size_t count = std::min(BATCH_CHUNK, names.size() - first);
+        begin_metadata_op();
+        std::unique_lock<std::shared_mutex> tree(tree_lock);
+        InodeGuard guard;
+        Inode* dir = lock_batch_dir(parent, LockMode::Exclusive, guard);
+        if (!check_permission(dir, 2)) {
+            throw std::runtime_error("Permission denied: Cannot modify parent directory.");
+        }
+
+        // The chunk's blocks go back to the bitmaps together, also when a
+        // name fails half way
+        FreeBatch batch;
+        try {
+            for (size_t i = first; i < first + count; i++) {
+                check_batch_name(names[i]);
+                size_t file_id = find_inode_in_dir(dir, names[i]);
+                if (file_id == 0) continue;
+                if (get_global_inode_ptr(file_id)->file_type == FS_DIRECTORY) {
+                    throw std::runtime_error("Is a directory: '" + names[i] + "' (use delete_dir)");
+                }
+                release_file_resources(file_id, true, &batch);
+                remove_entry_from_dir(dir, names[i]);
+                removed++;
+            }
+        } catch (...) {
+            free_batch(batch);
+            throw;
+        }
+        free_batch(batch);
+    }
+
+    Logger::log(LogLevel::Info, "Deleted ", removed, " entries from '", parent, "'.");
+    return removed;
 }
 
 void FileSystem::login(uint16_t uid, uint16_t gid) {
     this->current_uid = uid;
     this->current_gid = gid;
-    std::cout << "Logged in as User: " << uid << " Group: " << gid << "\n";
+    Logger::log(LogLevel::Info, "Logged in as User: ", uid, " Group: ", gid);
 }
 
 void FileSystem::logout() {
     this->current_uid = 0; // Revert to root or a "guest" state
     this->current_gid = 0;
-    std::cout << "Logged out. Current user is now Root.\n";
+    Logger::log(LogLevel::Info, "Logged out. Current user is now Root.");
 }
 
-void FileSystem::chmod(std::string path, uint16_t mode) {
-    std::vector<std::string> tokens = tokenize_path(path, '/');
-    size_t parent_id = traverse_path_till_parent(tokens);
-    std::string filename = tokens.back();
-
-    size_t file_id = find_inode_in_dir(get_global_inode_ptr(parent_id), filename);
-    if (file_id == 0) throw std::runtime_error("File not found: " + path);
+void FileSystem::chmod(std::string_view path, uint16_t mode) {
+    Disk::PinScope pins(disk);
+    begin_metadata_op();
+    std::shared_lock<std::shared_mutex> tree(tree_lock);
+    InodeGuard guard;
+    size_t file_id = lock_entry(path, LockMode::Shared, LockMode::Exclusive, guard);
+    if (file_id == 0) throw std::runtime_error("File not found: " + std::string(path));
 
     Inode* file_inode = get_global_inode_ptr(file_id);
 
@@ -738,33 +2417,33 @@ void FileSystem::chmod(std::string path, uint16_t mode) {
     }
 
     file_inode->permissions = mode;
-    std::cout << "Permissions changed to 0" << std::oct << mode << "\n";
+    Logger::log(LogLevel::Info, "Permissions changed to 0", std::oct, mode);
 }
 
-void FileSystem::chown(std::string path, uint16_t uid) {
+void FileSystem::chown(std::string_view path, uint16_t uid) {
+    Disk::PinScope pins(disk);
     if (current_uid != 0) {
         throw std::runtime_error("Permission denied: Only root can change ownership.");
     }
 
-    std::vector<std::string> tokens = tokenize_path(path, '/');
-    size_t parent_id = traverse_path_till_parent(tokens);
-    std::string filename = tokens.back();
-
-    size_t file_id = find_inode_in_dir(get_global_inode_ptr(parent_id), filename);
-    if (file_id == 0) throw std::runtime_error("File not found: " + path);
+    begin_metadata_op();
+    std::shared_lock<std::shared_mutex> tree(tree_lock);
+    InodeGuard guard;
+    size_t file_id = lock_entry(path, LockMode::Shared, LockMode::Exclusive, guard);
+    if (file_id == 0) throw std::runtime_error("File not found: " + std::string(path));
 
     Inode* file_inode = get_global_inode_ptr(file_id);
     file_inode->uid = uid;
-    std::cout << "Owner changed to UID " << uid << "\n";
+    Logger::log(LogLevel::Info, "Owner changed to UID ", uid);
 }
 
-void FileSystem::chgrp(std::string path, uint16_t gid) {
-    std::vector<std::string> tokens = tokenize_path(path, '/');
-    size_t parent_id = traverse_path_till_parent(tokens);
-    std::string filename = tokens.back();
-
-    size_t file_id = find_inode_in_dir(get_global_inode_ptr(parent_id), filename);
-    if (file_id == 0) throw std::runtime_error("File not found: " + path);
+void FileSystem::chgrp(std::string_view path, uint16_t gid) {
+    Disk::PinScope pins(disk);
+    begin_metadata_op();
+    std::shared_lock<std::shared_mutex> tree(tree_lock);
+    InodeGuard guard;
+    size_t file_id = lock_entry(path, LockMode::Shared, LockMode::Exclusive, guard);
+    if (file_id == 0) throw std::runtime_error("File not found: " + std::string(path));
 
     Inode* file_inode = get_global_inode_ptr(file_id);
 
@@ -773,7 +2452,7 @@ void FileSystem::chgrp(std::string path, uint16_t gid) {
     }
 
     file_inode->gid = gid;
-    std::cout << "Group changed to GID " << gid << "\n";
+    Logger::log(LogLevel::Info, "Group changed to GID ", gid);
 }
 
 bool FileSystem::check_permission(Inode* node, uint16_t access_type) {
@@ -0,0 +1,308 @@
+#include "fs/filesystem.hpp"
+#include "fs/bitmap_scan.hpp"
+#include "fs/directory.hpp"
+#include "fs/logger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <map>
+
+// ==========================================
+// CONSISTENCY CHECK (fsck)
+// ==========================================
+// Two passes, each one task per initialized group on a pool of threads:
+//   1. every allocated inode claims the blocks its map points at in a
+//      shared bitmap of owned blocks (a claim that finds the bit already
+//      set is a duplicate), and every directory entry bumps its target's
+//      link count or is recorded as dangling;
+//   2. every group compares its on-disk block bitmap with the owned bits,
+//      its inode bitmap with the link counts and its descriptor with both.
+// The passes only read the image, so the workers need no locks beyond the
+// atomics of the shared state. Repair runs afterwards on the calling thread.
+
+struct FileSystem::CheckState {
+    std::vector<std::atomic<uint64_t>> owned; // Bit per block
+    std::vector<std::atomic<uint32_t>> links; // Entries naming each inode
+
+    std::atomic<size_t> inodes_in_use{0};
+    std::atomic<size_t> blocks_in_use{0};
+    std::atomic<size_t> leaked_blocks{0};
+    std::atomic<size_t> missing_blocks{0};
+    std::atomic<size_t> duplicate_blocks{0};
+    std::atomic<size_t> bad_pointers{0};
+    std::atomic<size_t> bad_counters{0};
+
+    std::mutex lock; // Guards the lists below
+    std::vector<std::pair<size_t, std::string>> dangling; // (directory, entry name)
+    std::vector<size_t> orphans;
+
+    CheckState(size_t blocks, size_t inodes) : owned((blocks + 63) / 64), links(inodes) {}
+
+    // True the first time a block is claimed
+    bool claim(size_t block_id) {
+        uint64_t bit = uint64_t(1) << (block_id % 64);
+        return (owned[block_id / 64].fetch_or(bit, std::memory_order_relaxed) & bit) == 0;
+    }
+    bool is_owned(size_t block_id) const {
+        return (owned[block_id / 64].load(std::memory_order_relaxed) >> (block_id % 64)) & 1;
+    }
+};
+
+namespace {
+bool is_live_type(FS_FILE_TYPES type) {
+    return type == FS_FILE || type == FS_DIRECTORY || type == FS_SYMLINK;
+}
+}
+
+CheckReport FileSystem::check(bool repair) {
+    auto start = std::chrono::steady_clock::now();
+    Disk::PinScope pins(disk);
+    std::unique_lock<std::shared_mutex> tree(tree_lock);
+    reclaim_all_locked(); // Queued trees are still allocated but already unlinked
+
+    CheckState state(sb->total_blocks, sb->total_inodes);
+    CheckReport report;
+
+    // The journal region is allocated from group 0 like any file's blocks
+    for (size_t b = sb->journal_start; b < sb->journal_start + sb->journal_blocks; b++) {
+        if (!check_block_pointer(b)) state.bad_pointers++;
+        else if (!state.claim(b)) state.duplicate_blocks++;
+    }
+
+    size_t groups = block_group_managers.size();
+    parallel_for(groups, [&](size_t g) { check_group_inodes(state, g); });
+    parallel_for(groups, [&](size_t g) { check_group_bitmaps(state, g); });
+
+    for (auto& bgm : block_group_managers) {
+        if (bgm.is_initialized()) report.groups_checked++;
+    }
+    size_t root_id = sb->home_dir_inode;
+    report.root_ok = root_id < sb->total_inodes && block_group_managers[group_of_inode(root_id)].is_inode_allocated(root_id) &&
+                     get_global_inode_ptr(root_id)->file_type == FS_DIRECTORY;
+    report.inodes_in_use = state.inodes_in_use;
+    report.blocks_in_use = state.blocks_in_use;
+    report.leaked_blocks = state.leaked_blocks;
+    report.missing_blocks = state.missing_blocks;
+    report.duplicate_blocks = state.duplicate_blocks;
+    report.bad_pointers = state.bad_pointers;
+    report.dangling_entries = state.dangling.size();
+    report.orphan_inodes = state.orphans.size();
+    report.bad_counters = state.bad_counters;
+
+    if (repair && !report.clean()) repair_check(state, report);
+
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    Logger::log(report.clean() ? LogLevel::Info : LogLevel::Warning, "Check: ", report.groups_checked, " group(s), ",
+                report.inodes_in_use, " inode(s), ", report.blocks_in_use, " block(s) in use; ",
+                report.clean() ? "clean" : (report.repaired ? "repaired" : "PROBLEMS FOUND"));
+    return report;
+}
+
+// ---------------- PASS 1: INODES ----------------
+
+// A block an inode may point at: inside the disk, past its group's metadata
+// and in a group that has been initialized (nothing was handed out of a
+// lazy one).
+bool FileSystem::check_block_pointer(size_t block_id) {
+    if (block_id >= sb->total_blocks) return false;
+    BlockGroupManager& bgm = block_group_managers[block_id / sb->blocks_per_group];
+    return bgm.is_initialized() && static_cast<int>(block_id % sb->blocks_per_group) >= bgm.first_data_block_bit();
+}
+
+// Claims block_id and, for an indirect table (depth > 0), everything it
+// points at. Unlike collect_block_tree it does not trust file_size: every
+// non-zero slot is visited. Returns the bad pointers found below.
+size_t FileSystem::check_block_tree(CheckState& state, size_t block_id, int depth) {
+    if (!check_block_pointer(block_id)) {
+        state.bad_pointers++;
+        return 1;
+    }
+    if (!state.claim(block_id)) state.duplicate_blocks++;
+    if (depth == 0) return 0;
+
+    size_t bad = 0;
+    const size_t* table = reinterpret_cast<const size_t*>(disk.get_ptr(block_id));
+    for (size_t i = 0; i < pointers_per_block(); i++) {
+        if (table[i] != 0) bad += check_block_tree(state, table[i], depth - 1);
+    }
+    return bad;
+}
+
+// Claims every block the inode's map holds; returns the bad pointers
+size_t FileSystem::check_inode_blocks(CheckState& state, Inode* node) {
+    if (node->flags & INODE_FLAG_INLINE) return 0;
+
+    if (node->flags & INODE_FLAG_EXTENTS) {
+        InodeExtentTable* table = extent_table(node);
+        if (table->count > INODE_MAX_EXTENTS) {
+            state.bad_pointers++;
+            return 1;
+        }
+        size_t bad = 0;
+        for (uint32_t i = 0; i < table->count; i++) {
+            const InodeExtent& e = table->extents[i];
+            for (size_t b = e.physical; b < e.physical + e.length; b++) {
+                if (!check_block_pointer(b)) {
+                    state.bad_pointers++;
+                    bad++;
+                    break;
+                }
+                if (!state.claim(b)) state.duplicate_blocks++;
+            }
+        }
+        return bad;
+    }
+
+    size_t bad = 0;
+    for (int i = 0; i < 12; i++) {
+        if (node->direct_blocks[i] != 0) bad += check_block_tree(state, node->direct_blocks[i], 0);
+    }
+    size_t roots[3] = {node->single_indirect, node->double_indirect, node->triple_indirect};
+    for (int depth = 1; depth <= 3; depth++) {
+        if (roots[depth - 1] != 0) bad += check_block_tree(state, roots[depth - 1], depth);
+    }
+    return bad;
+}
+
+// Only called for directories whose block map checked out, so every block
+// read here is a valid one. An index bucket with no block behind it is
+// counted as a bad pointer.
+void FileSystem::check_dir_entries(CheckState& state, Inode* dir) {
+    std::vector<std::string> dangling;
+    auto visit = [&](DirRecord& entry) {
+        std::string_view name(entry.name(), entry.name_len);
+        if (name == "." || name == "..") return;
+        size_t child = entry.inode_id;
+        bool live = child < sb->total_inodes && block_group_managers[group_of_inode(child)].is_inode_allocated(child) &&
+                    is_live_type(get_global_inode_ptr(child)->file_type);
+        if (live) state.links[child].fetch_add(1, std::memory_order_relaxed);
+        else dangling.emplace_back(name);
+    };
+
+    DirIndexBlock* index = get_dir_index(dir);
+    if (index != nullptr) {
+        uint32_t buckets = std::min(index->bucket_count, DIR_INDEX_MAX_SLOTS);
+        for (uint32_t bucket = 1; bucket <= buckets; bucket++) {
+            size_t block_id = get_data_block(dir, bucket, false);
+            if (block_id == 0) {
+                state.bad_pointers++;
+                continue;
+            }
+            dir_block_for_each(disk.get_ptr(block_id), visit);
+        }
+    } else {
+        for (int i = 0; i < 12 && dir->direct_blocks[i] != 0; i++) {
+            dir_block_for_each(disk.get_ptr(dir->direct_blocks[i]), visit);
+        }
+    }
+
+    if (dangling.empty()) return;
+    std::lock_guard<std::mutex> guard(state.lock);
+    for (auto& name : dangling) state.dangling.emplace_back(dir->id, std::move(name));
+}
+
+void FileSystem::check_group_inodes(CheckState& state, size_t group) {
+    BlockGroupManager& bgm = block_group_managers[group];
+    if (!bgm.is_initialized()) return; // Nothing can be allocated in it yet
+
+    const uint8_t* bitmap = bgm.inode_bitmap();
+    size_t in_use = 0;
+    for (int local = bgm.first_inode_bit(); local < static_cast<int>(sb->inodes_per_group); local++) {
+        if (!bitmap_test_bit_atomic(bitmap, local)) continue;
+        in_use++;
+
+        // One scope per inode: a large group would otherwise pin every
+        // block it reads until the group is done
+        Disk::PinScope pins(disk);
+        size_t inode_id = group * sb->inodes_per_group + local;
+        Inode* node = get_global_inode_ptr(inode_id);
+        if (!is_live_type(node->file_type)) continue; // Stale slot: an orphan with nothing to claim
+
+        size_t bad = check_inode_blocks(state, node);
+        if (node->file_type == FS_DIRECTORY && bad == 0) check_dir_entries(state, node);
+    }
+    state.inodes_in_use += in_use;
+}
+
+// ---------------- PASS 2: BITMAPS ----------------
+
+void FileSystem::check_group_bitmaps(CheckState& state, size_t group) {
+    BlockGroupManager& bgm = block_group_managers[group];
+    if (!bgm.is_initialized()) return;
+    Disk::PinScope pins(disk);
+
+    size_t group_start = group * sb->blocks_per_group;
+    const uint8_t* block_bits = bgm.block_bitmap();
+    int data_start = bgm.first_data_block_bit();
+    int block_count = bgm.blocks_in_group();
+    size_t owned = 0, leaked = 0, missing = 0;
+    for (int local = data_start; local < block_count; local++) {
+        bool expected = state.is_owned(group_start + local);
+        bool marked = bitmap_test_bit_atomic(block_bits, local);
+        owned += expected;
+        leaked += marked && !expected;
+        missing += expected && !marked;
+    }
+    state.blocks_in_use += owned;
+    state.leaked_blocks += leaked;
+    state.missing_blocks += missing;
+
+    const uint8_t* inode_bits = bgm.inode_bitmap();
+    std::vector<size_t> orphans;
+    for (int local = bgm.first_inode_bit(); local < static_cast<int>(sb->inodes_per_group); local++) {
+        size_t inode_id = group * sb->inodes_per_group + local;
+        if (inode_id == sb->home_dir_inode || !bitmap_test_bit_atomic(inode_bits, local)) continue;
+        if (state.links[inode_id].load(std::memory_order_relaxed) == 0) orphans.push_back(inode_id);
+    }
+
+    if (!bgm.descriptor_matches_bitmaps()) state.bad_counters++;
+
+    if (orphans.empty()) return;
+    std::lock_guard<std::mutex> guard(state.lock);
+    state.orphans.insert(state.orphans.end(), orphans.begin(), orphans.end());
+}
+
+// ---------------- REPAIR ----------------
+
+// Order matters: the bitmaps are made to match what the inodes own first,
+// so the ordinary free paths then release orphans' blocks exactly once;
+// dangling entries go before the orphans, whose trees could contain them.
+void FileSystem::repair_check(CheckState& state, CheckReport& report) {
+    for (size_t g = 0; g < block_group_managers.size(); g++) {
+        BlockGroupManager& bgm = block_group_managers[g];
+        if (!bgm.is_initialized()) continue;
+        uint8_t* bits = bgm.block_bitmap();
+        size_t group_start = g * sb->blocks_per_group;
+        for (int local = bgm.first_data_block_bit(); local < bgm.blocks_in_group(); local++) {
+            if (state.is_owned(group_start + local)) bits[local / 8] |= (1 << (local % 8));
+            else bits[local / 8] &= ~(1 << (local % 8));
+        }
+        bgm.rebuild_descriptor();
+    }
+
+    std::map<size_t, std::vector<std::string>> by_dir;
+    for (auto& entry : state.dangling) by_dir[entry.first].push_back(entry.second);
+    for (auto& dir : by_dir) {
+        Inode* parent = get_global_inode_ptr(dir.first);
+        for (auto& name : dir.second) remove_entry_from_dir(parent, name);
+    }
+    dcache.clear();
+
+    // A damaged or shared map cannot be freed safely: those orphans stay
+    if (report.bad_pointers == 0 && report.duplicate_blocks == 0) {
+        FreeBatch batch;
+        for (size_t inode_id : state.orphans) {
+            Inode* node = get_global_inode_ptr(inode_id);
+            if (node->file_type == FS_DIRECTORY) defer_tree(inode_id);
+            else if (is_live_type(node->file_type)) release_file_resources(inode_id, true, &batch);
+            else batch.inodes.push_back(inode_id);
+        }
+        free_batch(batch);
+        reclaim_all_locked();
+    } else if (!state.orphans.empty()) {
+        Logger::log(LogLevel::Warning, "Check: ", state.orphans.size(),
+                    " orphan(s) left allocated: damaged or shared block maps");
+    }
+
+    journal.checkpoint();
+    report.repaired = true;
+}
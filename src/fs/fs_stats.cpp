@@ -0,0 +1,79 @@
+#include "fs/fs_stats.hpp"
+#include <algorithm>
+
+const char* fs_op_name(FsOp op) {
+    switch (op) {
+        case FsOp::Lookup: return "lookup";
+        case FsOp::PathWalk: return "path_walk";
+        case FsOp::AllocateInode: return "alloc_inode";
+        case FsOp::AllocateBlock: return "alloc_block";
+        case FsOp::Read: return "read";
+        case FsOp::Write: return "write";
+        case FsOp::Mount: return "mount";
+        case FsOp::Count: break;
+    }
+    return "unknown";
+}
+
+uint64_t HistogramSnapshot::percentile(double p) const {
+    if (count == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(p / 100.0 * count + 0.5);
+    rank = std::max<uint64_t>(1, std::min(rank, count));
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= rank) return std::min(max, (uint64_t(2) << i) - 1);
+    }
+    return max;
+}
+
+void Log2Histogram::record(uint64_t value) {
+    size_t bucket = value < 2 ? 0 : 63 - __builtin_clzll(value);
+    bucket = std::min(bucket, HistogramSnapshot::BUCKETS - 1);
+    buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t seen = max.load(std::memory_order_relaxed);
+    while (value > seen && !max.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {}
+}
+
+// Not atomic as a whole: counters recorded during the copy may be split
+// between fields, which is fine for monitoring
+HistogramSnapshot Log2Histogram::snapshot() const {
+    HistogramSnapshot s;
+    s.count = count.load(std::memory_order_relaxed);
+    s.sum = sum.load(std::memory_order_relaxed);
+    s.max = max.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < HistogramSnapshot::BUCKETS; i++) s.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+    return s;
+}
+
+void Log2Histogram::reset() {
+    count.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+    for (auto& b : buckets) b.store(0, std::memory_order_relaxed);
+}
+
+FsStatsSnapshot FsStats::snapshot() const {
+    FsStatsSnapshot s;
+    s.enabled = FS_ENABLE_STATS;
+    for (size_t i = 0; i < static_cast<size_t>(FsOp::Count); i++) s.ops[i] = ops[i].snapshot();
+    s.bytes_read = bytes_read.load(std::memory_order_relaxed);
+    s.bytes_written = bytes_written.load(std::memory_order_relaxed);
+    s.readahead_blocks = readahead_blocks.load(std::memory_order_relaxed);
+    s.descriptors_rebuilt = descriptors_rebuilt.load(std::memory_order_relaxed);
+    s.bitmap_scan_bits = bitmap_scan_bits.snapshot();
+    return s;
+}
+
+void FsStats::reset() {
+    for (auto& h : ops) h.reset();
+    bytes_read.store(0, std::memory_order_relaxed);
+    bytes_written.store(0, std::memory_order_relaxed);
+    readahead_blocks.store(0, std::memory_order_relaxed);
+    descriptors_rebuilt.store(0, std::memory_order_relaxed);
+    bitmap_scan_bits.reset();
+}
@@ -0,0 +1,75 @@
+#include "fs/inode_locks.hpp"
+#include <utility>
+
+InodeLockTable::InodeLockTable(size_t stripe_count) : stripes(stripe_count == 0 ? 1 : stripe_count) {}
+
+// ==========================================
+// INODE GUARD
+// ==========================================
+void InodeGuard::acquire(Held& h) {
+    if (h.exclusive) h.lock->lock();
+    else h.lock->lock_shared();
+}
+
+void InodeGuard::release(Held& h) {
+    if (h.lock == nullptr) return;
+    if (h.exclusive) h.lock->unlock();
+    else h.lock->unlock_shared();
+    h.lock = nullptr;
+}
+
+InodeGuard::InodeGuard(InodeLockTable& table, size_t inode_id, LockMode mode) {
+    held[0] = {&table.lock_for(inode_id), mode == LockMode::Exclusive, table.stripe_of(inode_id)};
+    acquire(held[0]);
+}
+
+InodeGuard::InodeGuard(InodeLockTable& table, size_t a, LockMode mode_a, size_t b, LockMode mode_b) {
+    Held first = {&table.lock_for(a), mode_a == LockMode::Exclusive, table.stripe_of(a)};
+    Held second = {&table.lock_for(b), mode_b == LockMode::Exclusive, table.stripe_of(b)};
+
+    if (first.stripe == second.stripe) {
+        first.exclusive = first.exclusive || second.exclusive;
+        held[0] = first;
+        acquire(held[0]);
+        return;
+    }
+
+    if (first.stripe > second.stripe) std::swap(first, second);
+    held[0] = first;
+    held[1] = second;
+    acquire(held[0]);
+    acquire(held[1]);
+}
+
+InodeGuard::InodeGuard(InodeGuard&& other) noexcept {
+    for (int i = 0; i < 2; i++) {
+        held[i] = other.held[i];
+        other.held[i].lock = nullptr;
+    }
+}
+
+InodeGuard& InodeGuard::operator=(InodeGuard&& other) noexcept {
+    if (this != &other) {
+        unlock();
+        for (int i = 0; i < 2; i++) {
+            held[i] = other.held[i];
+            other.held[i].lock = nullptr;
+        }
+    }
+    return *this;
+}
+
+void InodeGuard::unlock_inode(InodeLockTable& table, size_t inode_id) {
+    size_t stripe = table.stripe_of(inode_id);
+    // A stripe shared by both inodes is only ever recorded once, in held[0],
+    // and must stay locked for the other one.
+    if (held[1].lock == nullptr) return;
+    for (auto& h : held) {
+        if (h.lock != nullptr && h.stripe == stripe) release(h);
+    }
+}
+
+void InodeGuard::unlock() {
+    release(held[1]);
+    release(held[0]);
+}
@@ -0,0 +1,207 @@
+#include "fs/disk_backend.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// ==========================================
+// IO_URING (raw system calls)
+// ==========================================
+static int io_uring_setup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+template <typename T>
+static T* ring_field(void* ring, uint32_t offset) {
+    return reinterpret_cast<T*>(static_cast<uint8_t*>(ring) + offset);
+}
+
+IoUringBackend::~IoUringBackend() {
+    if (sqes != nullptr) munmap(sqes, sqes_bytes);
+    if (cq_ring != nullptr && cq_ring != sq_ring) munmap(cq_ring, cq_ring_bytes);
+    if (sq_ring != nullptr) munmap(sq_ring, sq_ring_bytes);
+    if (ring_fd != -1) close(ring_fd);
+}
+
+void IoUringBackend::setup_ring() {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    ring_fd = io_uring_setup(QUEUE_DEPTH, &params);
+    if (ring_fd < 0) {
+        ring_fd = -1;
+        throw std::runtime_error("io_uring is not available on this system");
+    }
+
+    sq_ring_bytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_bytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) sq_ring_bytes = cq_ring_bytes = std::max(sq_ring_bytes, cq_ring_bytes);
+
+    void* sq = mmap(nullptr, sq_ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if (sq == MAP_FAILED) throw std::runtime_error("io_uring: failed to map the submission ring");
+    sq_ring = sq;
+
+    if (single_mmap) {
+        cq_ring = sq_ring;
+    } else {
+        void* cq = mmap(nullptr, cq_ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+        if (cq == MAP_FAILED) throw std::runtime_error("io_uring: failed to map the completion ring");
+        cq_ring = cq;
+    }
+
+    sqes_bytes = params.sq_entries * sizeof(io_uring_sqe);
+    void* entries = mmap(nullptr, sqes_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if (entries == MAP_FAILED) throw std::runtime_error("io_uring: failed to map the submission entries");
+    sqes = entries;
+
+    sq_tail = ring_field<unsigned>(sq_ring, params.sq_off.tail);
+    sq_mask = ring_field<unsigned>(sq_ring, params.sq_off.ring_mask);
+    sq_array = ring_field<unsigned>(sq_ring, params.sq_off.array);
+    cq_head = ring_field<unsigned>(cq_ring, params.cq_off.head);
+    cq_tail = ring_field<unsigned>(cq_ring, params.cq_off.tail);
+    cq_mask = ring_field<unsigned>(cq_ring, params.cq_off.ring_mask);
+    cqes = ring_field<void>(cq_ring, params.cq_off.cqes);
+}
+
+uint8_t* IoUringBackend::open(const char* filename, size_t bytes, size_t block_size, bool load_image) {
+    setup_ring();
+    open_file(filename, bytes, block_size);
+    if (!load_image) return nullptr;
+    allocate_image();
+
+    std::vector<Request> reads;
+    for (size_t offset = 0; offset < bytes; offset += MAX_IO_BYTES) {
+        reads.push_back({IORING_OP_READ, offset, std::min(MAX_IO_BYTES, bytes - offset), image + offset});
+    }
+    submit_and_wait(reads);
+    return image;
+}
+
+// The kernel reads the SQ tail and writes the CQ tail; both sides of each
+// ring index are published with release/acquire ordering.
+void IoUringBackend::submit_and_wait(const std::vector<Request>& requests) {
+    std::lock_guard<std::mutex> guard(ring_lock);
+    io_uring_sqe* sq_entries = static_cast<io_uring_sqe*>(sqes);
+    io_uring_cqe* cq_entries = static_cast<io_uring_cqe*>(cqes);
+
+    for (size_t first = 0; first < requests.size(); first += QUEUE_DEPTH) {
+        size_t batch = std::min<size_t>(QUEUE_DEPTH, requests.size() - first);
+
+        unsigned tail = __atomic_load_n(sq_tail, __ATOMIC_RELAXED);
+        for (size_t i = 0; i < batch; i++) {
+            const Request& r = requests[first + i];
+            unsigned index = tail & *sq_mask;
+            io_uring_sqe* sqe = &sq_entries[index];
+            std::memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = r.opcode;
+            sqe->fd = fd;
+            if (r.opcode == IORING_OP_FSYNC) {
+                sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+            } else {
+                sqe->addr = reinterpret_cast<uint64_t>(r.buf);
+                sqe->len = static_cast<uint32_t>(r.len);
+                sqe->off = r.offset;
+            }
+            sqe->user_data = first + i;
+            sq_array[index] = index;
+            tail++;
+        }
+        __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+
+        // Every request that went out is reaped before anything is thrown:
+        // a completion left in the ring would be matched against the next
+        // call's requests, and its I/O could still touch a freed buffer
+        std::exception_ptr error;
+        size_t submitted = 0;
+        while (submitted < batch) {
+            int ret = io_uring_enter(ring_fd, static_cast<unsigned>(batch - submitted),
+                                     static_cast<unsigned>(batch - submitted), IORING_ENTER_GETEVENTS);
+            if (ret < 0 && errno == EINTR) continue;
+            if (ret < 0) {
+                // Take the unsubmitted entries back so no later call sends them
+                __atomic_store_n(sq_tail, tail - static_cast<unsigned>(batch - submitted), __ATOMIC_RELEASE);
+                error = std::make_exception_ptr(std::runtime_error("io_uring: submission failed"));
+                break;
+            }
+            submitted += ret;
+        }
+
+        // Reap exactly the completions of what was submitted
+        size_t reaped = 0;
+        while (reaped < submitted) {
+            unsigned head = __atomic_load_n(cq_head, __ATOMIC_RELAXED);
+            if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+                if (io_uring_enter(ring_fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+                    throw std::runtime_error("io_uring: waiting for completions failed");
+                }
+                continue;
+            }
+
+            const io_uring_cqe& cqe = cq_entries[head & *cq_mask];
+            const Request& r = requests[cqe.user_data];
+            int res = cqe.res;
+            __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+            reaped++;
+            if (error) continue; // Only the first failure is reported
+
+            if (res < 0) {
+                error = std::make_exception_ptr(std::runtime_error(std::string("io_uring: I/O failed: ") + std::strerror(-res)));
+                continue;
+            }
+            if (r.opcode == IORING_OP_FSYNC || static_cast<size_t>(res) == r.len) continue;
+
+            // Short transfer: finish it synchronously
+            try {
+                transfer(r.opcode == IORING_OP_WRITE, r.buf + res, r.offset + res, r.len - res);
+            } catch (...) {
+                error = std::current_exception();
+            }
+        }
+        if (error) std::rethrow_exception(error);
+    }
+}
+
+void IoUringBackend::write_back(const std::vector<DiskRun>& runs, SyncMode mode) {
+    if (runs.empty()) return;
+    std::vector<Request> writes;
+    for (const DiskRun& run : runs) {
+        size_t offset = run.first_block * block_size;
+        size_t end = offset + run.count * block_size;
+        for (; offset < end; offset += MAX_IO_BYTES) {
+            writes.push_back({IORING_OP_WRITE, offset, std::min(MAX_IO_BYTES, end - offset), image + offset});
+        }
+    }
+    submit_and_wait(writes);
+    // Every write above has completed, so the datasync covers them all
+    if (mode == SyncMode::Wait) sync_data();
+}
+
+// One submission for all of them instead of a pread per block
+void IoUringBackend::read_blocks(const std::vector<std::pair<size_t, uint8_t*>>& blocks) {
+    std::vector<Request> reads;
+    for (const auto& b : blocks) reads.push_back({IORING_OP_READ, b.first * block_size, block_size, b.second});
+    submit_and_wait(reads);
+}
+
+void IoUringBackend::write_blocks(const std::vector<std::pair<size_t, const uint8_t*>>& blocks) {
+    std::vector<Request> writes;
+    for (const auto& b : blocks) {
+        writes.push_back({IORING_OP_WRITE, b.first * block_size, block_size, const_cast<uint8_t*>(b.second)});
+    }
+    submit_and_wait(writes);
+}
+
+void IoUringBackend::sync_data() {
+    submit_and_wait({{IORING_OP_FSYNC, 0, 0, nullptr}});
+}
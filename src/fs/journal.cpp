@@ -0,0 +1,328 @@
+#include "fs/journal.hpp"
+#include "fs/logger.hpp"
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+
+// ==========================================
+// CHECKSUM
+// ==========================================
+static const uint64_t FNV_OFFSET = 0xCBF29CE484222325ULL;
+static const uint64_t FNV_PRIME = 0x100000001B3ULL;
+
+static uint64_t fnv1a(uint64_t hash, const void* data, size_t len) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+// ==========================================
+// DIRTY TRACKING
+// ==========================================
+void Journal::reset_tracking(size_t total_blocks) {
+    size_t words = (total_blocks + 63) / 64;
+    std::vector<std::atomic<uint64_t>>(words).swap(dirty);
+    std::vector<std::atomic<uint64_t>>(words).swap(revoked);
+    dirty_count = 0;
+    pending_ops = 0;
+    logged.clear();
+    disk.release_all_holds();
+}
+
+void Journal::mark_dirty(size_t block_id) {
+    disk.mark_dirty(block_id);
+    if (!enabled() || in_region(block_id)) return;
+    disk.hold(block_id);
+    uint64_t bit = 1ULL << (block_id % 64);
+    // Dirtying after a free means the block is metadata again
+    revoked[block_id / 64].fetch_and(~bit, std::memory_order_relaxed);
+    uint64_t before = dirty[block_id / 64].fetch_or(bit, std::memory_order_relaxed);
+    if (!(before & bit)) dirty_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+// The block keeps its committed contents on disk until the free commits:
+// whatever reuses it meanwhile stays in memory
+void Journal::revoke(size_t block_id) {
+    if (!enabled() || in_region(block_id)) return;
+    disk.hold(block_id);
+    revoked[block_id / 64].fetch_or(1ULL << (block_id % 64), std::memory_order_relaxed);
+}
+
+bool Journal::should_commit() const {
+    if (!enabled()) return false;
+    return pending_ops.load(std::memory_order_relaxed) >= COMMIT_OPS ||
+           dirty_count.load(std::memory_order_relaxed) >= capacity / COMMIT_FILL_DIVISOR;
+}
+
+// Takes every set bit out of `bits`, in block order
+std::vector<size_t> Journal::drain(std::vector<std::atomic<uint64_t>>& bits) {
+    std::vector<size_t> blocks;
+    for (size_t w = 0; w < bits.size(); w++) {
+        uint64_t word = bits[w].exchange(0, std::memory_order_relaxed);
+        while (word != 0) {
+            blocks.push_back(w * 64 + __builtin_ctzll(word));
+            word &= word - 1;
+        }
+    }
+    return blocks;
+}
+
+// ==========================================
+// REGION MANAGEMENT
+// ==========================================
+void Journal::write_super() {
+    JournalSuper js;
+    std::memset(&js, 0, sizeof(js));
+    js.header.magic = JOURNAL_MAGIC;
+    js.header.type = JOURNAL_SUPER;
+    js.header.sequence = first_sequence;
+    js.first_sequence = first_sequence;
+
+    uint8_t* block = disk.get_ptr(start);
+    std::memset(block, 0, disk.get_block_size());
+    std::memcpy(block, &js, sizeof(js));
+    disk.mark_dirty(start);
+    disk.sync_range(start, 1);
+}
+
+void Journal::create(size_t start_block, size_t blocks) {
+    start = start_block;
+    capacity = blocks;
+    head = 1;
+    sequence = 1;
+    first_sequence = 1;
+    reset_tracking(disk.get_block_count());
+    if (enabled()) write_super();
+}
+
+void Journal::checkpoint_committed(const std::vector<size_t>& running) {
+    // The running blocks hold uncommitted changes in memory, so their newest
+    // logged images go home instead, straight from the log
+    {
+        Disk::PinScope pins(disk);
+        std::vector<std::pair<size_t, const uint8_t*>> images;
+        for (size_t block : running) {
+            auto it = logged.find(block);
+            if (it != logged.end()) images.emplace_back(block, disk.get_ptr(start + it->second));
+        }
+        disk.write_through(images);
+    }
+    // Everything else that is dirty is unheld, so committed
+    disk.sync_range(0, disk.get_block_count());
+    disk.drop_written(0, disk.get_block_count());
+
+    // Only now may the log forget
+    head = 1;
+    first_sequence = sequence;
+    logged.clear();
+    write_super();
+}
+
+void Journal::checkpoint() {
+    if (!enabled()) return;
+    commit();
+    // Nothing is held any more, so every dirty block goes home
+    disk.sync_all();
+    checkpoint_committed({});
+}
+
+// ==========================================
+// COMMIT
+// ==========================================
+void Journal::commit() {
+    if (!enabled()) return;
+
+    std::vector<size_t> revokes = drain(revoked);
+    std::vector<size_t> images;
+    for (size_t block : drain(dirty)) {
+        // A freed block is logged as a revoke only (see the header)
+        if (!std::binary_search(revokes.begin(), revokes.end(), block)) images.push_back(block);
+    }
+    dirty_count = 0;
+    pending_ops = 0;
+    if (images.empty() && revokes.empty()) return;
+
+    const size_t per_block = JOURNAL_TAGS_PER_BLOCK;
+    size_t descriptor_blocks = (images.size() + per_block - 1) / per_block;
+    size_t revoke_blocks = (revokes.size() + per_block - 1) / per_block;
+    size_t needed = descriptor_blocks + images.size() + revoke_blocks + 1;
+
+    std::vector<size_t> running = images;
+    running.insert(running.end(), revokes.begin(), revokes.end());
+    if (head + needed > capacity) {
+        // Out of room: the earlier transactions go home and the log starts
+        // over, then this one is logged as usual
+        checkpoint_committed(running);
+        if (head + needed > capacity) {
+            Logger::log(LogLevel::Warning, "Journal: transaction of ", images.size(),
+                        " blocks exceeds the region, written in place without atomicity");
+            disk.release_holds(running);
+            disk.sync_range(0, disk.get_block_count());
+            return;
+        }
+    }
+
+    size_t block_size = disk.get_block_size();
+    size_t pos = head;
+    uint64_t hash = FNV_OFFSET;
+
+    auto tag_block = [&](uint32_t type, const std::vector<size_t>& list, size_t first, size_t count) {
+        JournalTagBlock* tb = reinterpret_cast<JournalTagBlock*>(disk.get_ptr(start + pos));
+        std::memset(tb, 0, block_size);
+        tb->header = {JOURNAL_MAGIC, type, sequence};
+        tb->count = static_cast<uint32_t>(count);
+        for (size_t i = 0; i < count; i++) {
+            tb->blocks[i] = list[first + i];
+            hash = fnv1a(hash, &tb->blocks[i], sizeof(uint64_t));
+        }
+        pos++;
+    };
+
+    // Pin scopes per block keep a large commit within a buffer cache
+    for (size_t first = 0; first < images.size(); first += per_block) {
+        Disk::PinScope pins(disk);
+        size_t count = std::min(per_block, images.size() - first);
+        tag_block(JOURNAL_DESCRIPTOR, images, first, count);
+        for (size_t i = 0; i < count; i++) {
+            Disk::PinScope image_pins(disk);
+            disk.copy_block(start + pos, images[first + i]);
+            hash = fnv1a(hash, disk.get_ptr(start + pos), block_size);
+            pos++;
+        }
+    }
+    for (size_t first = 0; first < revokes.size(); first += per_block) {
+        Disk::PinScope pins(disk);
+        tag_block(JOURNAL_REVOKE, revokes, first, std::min(per_block, revokes.size() - first));
+    }
+
+    JournalCommit* commit = reinterpret_cast<JournalCommit*>(disk.get_ptr(start + pos));
+    std::memset(commit, 0, block_size);
+    commit->header = {JOURNAL_MAGIC, JOURNAL_COMMIT, sequence};
+    commit->image_count = static_cast<uint32_t>(images.size());
+    commit->revoke_count = static_cast<uint32_t>(revokes.size());
+    commit->checksum = hash;
+    pos++;
+
+    // The single sync of the group. If it is torn, the checksum rejects the
+    // transaction at replay.
+    disk.mark_dirty(start + head, pos - head);
+    disk.sync_range(start + head, pos - head);
+    disk.drop_written(start + head, pos - head);
+
+    // Committed: the blocks may go home from now on
+    size_t image_pos = head;
+    for (size_t i = 0; i < images.size(); i++) {
+        if (i % per_block == 0) image_pos++; // Its descriptor block
+        logged[images[i]] = image_pos++;
+    }
+    for (size_t block : revokes) logged.erase(block);
+    disk.release_holds(running);
+
+    head = pos;
+    sequence++;
+    commit_count++;
+    logged_blocks += images.size();
+}
+
+// ==========================================
+// REPLAY
+// ==========================================
+size_t Journal::recover(size_t start_block, size_t blocks) {
+    start = start_block;
+    capacity = blocks;
+    head = 1;
+    reset_tracking(disk.get_block_count());
+    if (!enabled()) return 0;
+
+    const JournalSuper* js = reinterpret_cast<const JournalSuper*>(disk.get_ptr(start));
+    if (js->header.magic != JOURNAL_MAGIC || js->header.type != JOURNAL_SUPER) {
+        sequence = first_sequence = 1;
+        write_super();
+        return 0;
+    }
+    first_sequence = js->first_sequence;
+    sequence = first_sequence;
+
+    struct Transaction {
+        uint64_t sequence;
+        std::vector<std::pair<size_t, size_t>> images; // (home block, journal block)
+        std::vector<size_t> revokes;
+    };
+    std::vector<Transaction> committed;
+
+    // Pass 1: collect transactions until the log stops making sense
+    size_t block_size = disk.get_block_size();
+    size_t pos = 1;
+    while (pos < capacity) {
+        Transaction tx;
+        tx.sequence = sequence;
+        uint64_t hash = FNV_OFFSET;
+        bool complete = false;
+
+        size_t p = pos;
+        while (p < capacity) {
+            Disk::PinScope pins(disk);
+            const JournalBlockHeader* hdr = reinterpret_cast<const JournalBlockHeader*>(disk.get_ptr(start + p));
+            if (hdr->magic != JOURNAL_MAGIC || hdr->sequence != sequence) break;
+
+            if (hdr->type == JOURNAL_DESCRIPTOR || hdr->type == JOURNAL_REVOKE) {
+                const JournalTagBlock* tb = reinterpret_cast<const JournalTagBlock*>(hdr);
+                bool descriptor = hdr->type == JOURNAL_DESCRIPTOR;
+                if (tb->count > JOURNAL_TAGS_PER_BLOCK || (descriptor && p + 1 + tb->count > capacity)) break;
+
+                // Same order as commit(): the tags, then the images they name
+                for (uint32_t i = 0; i < tb->count; i++) hash = fnv1a(hash, &tb->blocks[i], sizeof(uint64_t));
+                for (uint32_t i = 0; i < tb->count; i++) {
+                    if (descriptor) {
+                        Disk::PinScope image_pins(disk);
+                        hash = fnv1a(hash, disk.get_ptr(start + p + 1 + i), block_size);
+                        tx.images.emplace_back(tb->blocks[i], p + 1 + i);
+                    } else {
+                        tx.revokes.push_back(tb->blocks[i]);
+                    }
+                }
+                p += 1 + (descriptor ? tb->count : 0);
+            } else if (hdr->type == JOURNAL_COMMIT) {
+                const JournalCommit* c = reinterpret_cast<const JournalCommit*>(hdr);
+                complete = c->checksum == hash && c->image_count == tx.images.size() &&
+                           c->revoke_count == tx.revokes.size();
+                p++;
+                break;
+            } else {
+                break;
+            }
+        }
+
+        if (!complete) break;
+        committed.push_back(std::move(tx));
+        pos = p;
+        sequence++;
+    }
+
+    // Pass 2: apply images in order, skipping any block that a later
+    // transaction freed
+    std::unordered_map<size_t, uint64_t> last_revoke;
+    for (const Transaction& tx : committed) {
+        for (size_t block : tx.revokes) last_revoke[block] = tx.sequence;
+    }
+
+    size_t total = disk.get_block_count();
+    for (const Transaction& tx : committed) {
+        for (const auto& image : tx.images) {
+            if (image.first >= total || in_region(image.first)) continue;
+            auto it = last_revoke.find(image.first);
+            if (it != last_revoke.end() && it->second > tx.sequence) continue;
+            disk.copy_block(image.first, start + image.second);
+        }
+    }
+
+    // Make the replay durable before the journal forgets it
+    if (!committed.empty()) disk.sync_range(0, total);
+    first_sequence = sequence;
+    write_super();
+    return committed.size();
+}
@@ -0,0 +1,20 @@
+#include "fs/logger.hpp"
+#include <mutex>
+
+static std::mutex sink_lock;
+static Logger::Sink current_sink;
+
+void Logger::set_sink(Sink sink, LogLevel min_level) {
+    std::lock_guard<std::mutex> guard(sink_lock);
+    current_sink = std::move(sink);
+    threshold.store(static_cast<int>(current_sink ? min_level : LogLevel::Silent), std::memory_order_relaxed);
+}
+
+void Logger::clear_sink() {
+    set_sink(nullptr);
+}
+
+void Logger::deliver(LogLevel level, const std::string& message) {
+    std::lock_guard<std::mutex> guard(sink_lock);
+    if (current_sink && enabled(level)) current_sink(level, message);
+}
@@ -1,11 +1,18 @@
 #include "fs/filesystem.hpp"
 #include "fs/disk.hpp"
+#include "fs/logger.hpp"
+#include <atomic>
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <map>
 #include <string>
+#include <thread>
 #include <vector>
 #include <sstream>
 #include <limits>
 #include <iomanip>
+#include <sys/stat.h>
 
 // Helper to split command line arguments
 std::vector<std::string> parse_command(const std::string& input) {
@@ -46,10 +53,452 @@ std::string format_size(size_t size) {
     return std::string(buf);
 }
 
-int main() {
-    // 1. User Input for Disk Size
+// Latencies as p50 / p99 / max, each a power-of-two bucket bound
+void print_stats(const FsStatsSnapshot& s, std::ostream& out) {
+    if (!s.enabled) {
+        out << "Statistics are not compiled in (build with -DFS_STATS=ON).\n";
+        return;
+    }
+    out << "  " << std::left << std::setw(12) << "operation" << std::right << std::setw(10) << "count"
+              << std::setw(12) << "mean(ns)" << std::setw(12) << "p50(ns)" << std::setw(12) << "p99(ns)"
+              << std::setw(12) << "max(ns)" << "\n";
+    for (size_t i = 0; i < static_cast<size_t>(FsOp::Count); i++) {
+        const HistogramSnapshot& h = s.ops[i];
+        out << "  " << std::left << std::setw(12) << fs_op_name(static_cast<FsOp>(i)) << std::right
+                  << std::setw(10) << h.count << std::setw(12) << static_cast<uint64_t>(h.mean())
+                  << std::setw(12) << h.percentile(50) << std::setw(12) << h.percentile(99)
+                  << std::setw(12) << h.max << "\n";
+    }
+    out << "  Bytes read: " << s.bytes_read << ", written: " << s.bytes_written
+              << ", readahead blocks: " << s.readahead_blocks << "\n";
+    out << "  Mounts: " << s.op(FsOp::Mount).count << ", slowest " << s.op(FsOp::Mount).max / 1000
+              << " us, descriptors rebuilt: " << s.descriptors_rebuilt << "\n";
+    out << "  Bitmap scans: " << s.bitmap_scan_bits.count << ", mean " << std::fixed << std::setprecision(1)
+              << s.bitmap_scan_bits.mean() << " bits, p99 " << s.bitmap_scan_bits.percentile(99) << ", max "
+              << s.bitmap_scan_bits.max << "\n";
+    out << "  Dentry cache: " << s.dentry_hits << " hits, " << s.dentry_misses << " misses ("
+              << s.dentry_hit_rate() * 100 << "% hit rate)\n";
+    out << std::defaultfloat;
+}
+
+// Runs one parsed command line, writing its output to out. Returns false
+// for 'exit'; failures are thrown. Only an interactive session is asked to
+// confirm a format.
+bool run_command(FileSystem& fs, const std::string& line, const std::vector<std::string>& args,
+                 std::ostream& out, bool interactive) {
+    const std::string& cmd = args[0];
+    if (cmd == "exit") {
+        out << "[System] Syncing to disk and exiting...\n";
+        return false;
+    }
+    // --- NEW: LOGIN COMMAND ---
+    else if (cmd == "login") {
+        if (args.size() < 3) throw std::runtime_error("Usage: login <uid> <gid>");
+        uint16_t new_uid = std::stoi(args[1]);
+        uint16_t new_gid = std::stoi(args[2]);
+        fs.login(new_uid, new_gid);
+    }
+    // --- NEW: LOGOUT COMMAND ---
+    else if (cmd == "logout") {
+        fs.logout();
+    }
+    // --- NEW: WHOAMI COMMAND ---
+    else if (cmd == "whoami") {
+        out << "Current UID: " << fs.get_current_user() << "\n";
+    }
+    else if (cmd == "format") {
+        // A trace has no one to ask
+        std::string confirm = "y";
+        if (interactive) {
+            out << "[Warning] This will erase all data. Confirm? (y/n): ";
+            std::getline(std::cin, confirm);
+        }
+        if (confirm == "y") {
+            // "format lazy" skips zeroing the image
+            fs.format(args.size() > 1 && args[1] == "lazy");
+        } else {
+            out << "Format cancelled.\n";
+        }
+    }
+    else if (cmd == "mount") {
+        fs.mount();
+    }
+    else if (cmd == "sync") {
+        fs.sync();
+        out << "Journal committed.\n";
+    }
+    else if (cmd == "fsync") {
+        if (args.size() < 2) throw std::runtime_error("Usage: fsync <path>");
+        fs.fsync(args[1]);
+        out << "Flushed " << args[1] << "\n";
+    }
+    else if (cmd == "ls") {
+        bool long_format = false;
+        std::string path = "/";
+        
+        for (size_t i = 1; i < args.size(); i++) {
+            if (args[i] == "-l") long_format = true;
+            else if (args[i] == "-la" || args[i] == "-al") {
+                long_format = true;
+            }
+            else path = args[i];
+        }
+        
+        auto entries = fs.list_dir(path, true);
+
+        out << "Listing '" << path << "':\n";
+        if (entries.empty()) out << "(empty)\n";
+        for (const auto& entry : entries) {
+            if (!long_format) {
+                out << entry.name << "\n";
+            } else {
+                if (entry.name == "." || entry.name == "..") continue;
+                out << format_permissions(entry.permissions, entry.is_directory, entry.is_symlink)
+                  << " " << entry.uid 
+                  << " " << entry.gid 
+                  << " " << std::setw(5) << std::left << (long_format ? format_size(0) : "0")
+                  << " " << entry.name << "\n";
+            }
+        }
+    }
+    else if (cmd == "mkdir") {
+        if (args.size() < 2) throw std::runtime_error("Usage: mkdir <path>");
+        fs.create_dir(args[1]);
+    }
+    else if (cmd == "touch") {
+        if (args.size() < 2) throw std::runtime_error("Usage: touch [-e] <path>");
+        if (args[1] == "-e") {
+            if (args.size() < 3) throw std::runtime_error("Usage: touch [-e] <path>");
+            fs.create_file(args[2], true); // Extent-mapped
+        } else {
+            fs.create_file(args[1]);
+        }
+    }
+    else if (cmd == "rm") {
+        if (args.size() < 2) throw std::runtime_error("Usage: rm <path>");
+        fs.delete_file(args[1]);
+    }
+    else if (cmd == "rmdir") {
+        if (args.size() < 2) throw std::runtime_error("Usage: rmdir <path>");
+        fs.delete_dir(args[1]);
+    }
+    else if (cmd == "write") {
+        if (args.size() < 3) throw std::runtime_error("Usage: write <path> <content>");
+
+        std::string content;
+        size_t first_space = line.find(' ', line.find(' ') + 1);
+        if (first_space != std::string::npos) {
+            content = line.substr(first_space + 1);
+        }
+
+        std::vector<uint8_t> data(content.begin(), content.end());
+        fs.write_file(args[1], data);
+    }
+    else if (cmd == "append") {
+        if (args.size() < 3) throw std::runtime_error("Usage: append <path> <content>");
+
+        std::string content;
+        size_t first_space = line.find(' ', line.find(' ') + 1);
+        if (first_space != std::string::npos) {
+            content = line.substr(first_space + 1);
+        }
+
+        fs.append(args[1], reinterpret_cast<const uint8_t*>(content.data()), content.size());
+    }
+    else if (cmd == "truncate") {
+        if (args.size() < 3) throw std::runtime_error("Usage: truncate <path> <size>");
+        fs.truncate(args[1], std::stoull(args[2]));
+    }
+    else if (cmd == "read") {
+        if (args.size() < 2) throw std::runtime_error("Usage: read <path>");
+
+        std::vector<uint8_t> data = fs.read_file(args[1]);
+        std::string text(data.begin(), data.end());
+        out << text << "\n";
+    }
+    else if (cmd == "chmod") {
+        if (args.size() < 3) throw std::runtime_error("Usage: chmod <path> <mode>");
+        uint16_t mode = std::stoi(args[2], nullptr, 8);
+        fs.chmod(args[1], mode);
+    }
+    else if (cmd == "chown") {
+        if (args.size() < 3) throw std::runtime_error("Usage: chown <path> <uid>");
+        uint16_t uid = std::stoi(args[2]);
+        fs.chown(args[1], uid);
+    }
+    else if (cmd == "chgrp") {
+        if (args.size() < 3) throw std::runtime_error("Usage: chgrp <path> <gid>");
+        uint16_t gid = std::stoi(args[2]);
+        fs.chgrp(args[1], gid);
+    }
+    else if (cmd == "ln") {
+        if (args.size() < 4) throw std::runtime_error("Usage: ln -s <target> <link_path>");
+        if (args[1] != "-s") throw std::runtime_error("Only symbolic links supported. Use: ln -s <target> <link_path>");
+        fs.create_symlink(args[2], args[3]);
+    }
+    else if (cmd == "stat") {
+        if (args.size() < 2) throw std::runtime_error("Usage: stat <path>");
+        FileStats stats = fs.get_stats(args[1]);
+        out << "  Inode: " << stats.inode_id << "\n";
+        out << "  Size: " << stats.file_size << "\n";
+        out << "  UID: " << stats.uid << "\n";
+        out << "  GID: " << stats.gid << "\n";
+        out << "  Permissions: " << format_permissions(stats.permissions, stats.file_type == FS_DIRECTORY, stats.file_type == FS_SYMLINK) << "\n";
+        std::string type_str = "unknown";
+        if (stats.file_type == FS_FILE) type_str = "file";
+        else if (stats.file_type == FS_DIRECTORY) type_str = "directory";
+        else if (stats.file_type == FS_SYMLINK) type_str = "symlink";
+        out << "  Type: " << type_str << "\n";
+        if (stats.file_type == FS_FILE) {
+            std::string layout = "blocks";
+            if (stats.flags & INODE_FLAG_INLINE) layout = "inline";
+            else if (stats.flags & INODE_FLAG_EXTENTS) layout = "extents";
+            out << "  Layout: " << layout << "\n";
+        }
+        if (!stats.symlink_target.empty()) {
+            out << "  Target: " << stats.symlink_target << "\n";
+        }
+    }
+    else if (cmd == "fsck") {
+        // The summary line comes through the logger
+        CheckReport r = fs.check(args.size() > 1 && args[1] == "repair");
+        if (!r.clean()) {
+            out << "  leaked " << r.leaked_blocks << ", missing " << r.missing_blocks << ", duplicate "
+                      << r.duplicate_blocks << ", bad pointers " << r.bad_pointers << ", dangling "
+                      << r.dangling_entries << ", orphans " << r.orphan_inodes << ", bad counters "
+                      << r.bad_counters << (r.root_ok ? "" : ", ROOT DAMAGED") << "\n";
+            if (!r.repaired) out << "  Run 'fsck repair' to fix.\n";
+        }
+    }
+    else if (cmd == "stats") {
+        if (args.size() > 1 && args[1] == "reset") {
+            fs.reset_stats();
+            out << "Statistics reset.\n";
+        } else {
+            print_stats(fs.stats(), out);
+        }
+    }
+    else {
+        throw std::runtime_error("Unknown command: " + cmd);
+    }
+    return true;
+}
+
+// ==========================================
+// BATCH REPLAY
+// ==========================================
+// Trace format: one REPL command per line; blank lines and lines starting
+// with '#' are skipped. A leading "@N" tags a line with stream N (untagged
+// lines are stream 0). Each stream replays in order on one worker thread;
+// with --threads=T the streams are dealt round-robin to T workers, so a
+// trace recorded from several clients replays them side by side.
+//
+// login, logout, format and mount change what every stream sees (the
+// current user is per file system, not per stream), so they are barriers:
+// whatever precedes them in the trace finishes, they run alone, and the
+// streams resume after them. Results never depend on thread timing.
+struct TraceCommand {
+    size_t stream;
+    std::string line; // Without its tag: write / append take content from it
+    std::vector<std::string> args;
+};
+
+std::vector<TraceCommand> load_trace(std::istream& in) {
+    std::vector<TraceCommand> trace;
+    std::string line;
+    size_t line_no = 0;
+    while (std::getline(in, line)) {
+        line_no++;
+        size_t first = line.find_first_not_of(" \t");
+        if (first == std::string::npos || line[first] == '#') continue;
+
+        size_t stream = 0;
+        if (line[first] == '@') {
+            size_t end = line.find_first_of(" \t", first);
+            try {
+                stream = std::stoul(line.substr(first + 1, end - first - 1));
+            } catch (const std::exception&) {
+                throw std::runtime_error("Trace line " + std::to_string(line_no) + ": bad stream tag");
+            }
+            first = end == std::string::npos ? end : line.find_first_not_of(" \t", end);
+            if (first == std::string::npos) continue;
+        }
+        line.erase(0, first);
+        std::vector<std::string> args = parse_command(line);
+        trace.push_back({stream, std::move(line), std::move(args)});
+    }
+    return trace;
+}
+
+// Per command name: latency of every run, failures included
+struct CommandTiming {
+    Log2Histogram latency; // Nanoseconds
+    std::atomic<uint64_t> errors{0};
+};
+
+bool is_barrier(const std::string& cmd) {
+    return cmd == "login" || cmd == "logout" || cmd == "format" || cmd == "mount";
+}
+
+// Replays the trace with command output discarded and prints throughput
+// and latency per command type. Latencies are power-of-two bucket bounds,
+// as in 'stats'.
+void run_batch(FileSystem& fs, const std::vector<TraceCommand>& trace, size_t threads) {
+    std::map<size_t, size_t> stream_index; // Stream tag -> dense index
+    std::map<std::string, CommandTiming> timings; // Filled up front: workers only look up
+    for (const TraceCommand& c : trace) {
+        stream_index.try_emplace(c.stream, stream_index.size());
+        timings.try_emplace(c.args[0]);
+    }
+    const size_t stream_count = stream_index.size();
+    threads = std::max<size_t>(1, std::min(threads, stream_count));
+
+    // One element per stream, each written by the one worker replaying it
+    std::vector<char> exited(stream_count, 0);
+
+    // Runs c and records its latency; false once its stream has exited
+    auto replay = [&](const TraceCommand& c, size_t stream, std::ostream& discard) {
+        CommandTiming& t = timings.find(c.args[0])->second;
+        bool more = true;
+        auto start = std::chrono::steady_clock::now();
+        try {
+            more = run_command(fs, c.line, c.args, discard, false);
+        } catch (const std::exception&) {
+            t.errors.fetch_add(1, std::memory_order_relaxed);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        t.latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        if (!more) exited[stream] = 1; // 'exit' ends its stream
+        return more;
+    };
+
+    // The commands between two barriers, per stream; stream s replays on
+    // worker s % threads
+    std::vector<std::vector<const TraceCommand*>> phase(stream_count);
+    auto run_phase = [&] {
+        auto worker = [&](size_t w) {
+            std::ostream discard(nullptr); // Per worker: a failed write still updates the stream state
+            for (size_t s = w; s < stream_count; s += threads) {
+                for (const TraceCommand* c : phase[s]) {
+                    if (exited[s] || !replay(*c, s, discard)) break;
+                }
+            }
+        };
+        std::vector<std::thread> pool;
+        for (size_t w = 1; w < threads; w++) pool.emplace_back(worker, w);
+        worker(0);
+        for (auto& t : pool) t.join();
+        for (auto& commands : phase) commands.clear();
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::ostream discard(nullptr);
+    for (const TraceCommand& c : trace) {
+        size_t s = stream_index[c.stream];
+        if (!is_barrier(c.args[0])) {
+            phase[s].push_back(&c);
+            continue;
+        }
+        run_phase();
+        if (!exited[s]) replay(c, s, discard);
+    }
+    run_phase();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t total = 0;
+    uint64_t errors = 0;
+    std::cout << "  " << std::left << std::setw(10) << "command" << std::right << std::setw(10) << "count"
+              << std::setw(8) << "errors" << std::setw(12) << "ops/s" << std::setw(12) << "mean(ns)"
+              << std::setw(12) << "p50(ns)" << std::setw(12) << "p99(ns)" << std::setw(12) << "max(ns)" << "\n";
+    for (const auto& [name, t] : timings) {
+        HistogramSnapshot h = t.latency.snapshot();
+        uint64_t e = t.errors.load(std::memory_order_relaxed);
+        total += h.count;
+        errors += e;
+        std::cout << "  " << std::left << std::setw(10) << name << std::right << std::setw(10) << h.count
+                  << std::setw(8) << e << std::setw(12) << static_cast<uint64_t>(h.count / seconds)
+                  << std::setw(12) << static_cast<uint64_t>(h.mean()) << std::setw(12) << h.percentile(50)
+                  << std::setw(12) << h.percentile(99) << std::setw(12) << h.max << "\n";
+    }
+    std::cout << "  Replayed " << total << " command(s), " << errors << " error(s), " << stream_count
+              << " stream(s) on " << threads << " thread(s) in " << std::fixed << std::setprecision(1)
+              << seconds * 1000 << " ms: " << static_cast<uint64_t>(total / seconds) << " ops/s\n";
+    std::cout << std::defaultfloat;
+}
+
+int main(int argc, char** argv) {
+    // 0. Options: --backend=mmap|pread|uring, and for pread / uring a
+    // bounded buffer cache: --cache-blocks=N. --image=PATH and --size-mb=N
+    // skip the defaults and the size prompt. --batch=TRACE (or - for stdin)
+    // replays a trace instead of starting the shell, on --threads=N workers.
+    DiskBackendType backend_type = DiskBackendType::Mmap;
+    size_t cache_blocks = 0;
+    std::string image = "my_fs.img";
     size_t size_mb = 0;
-    while (true) {
+    std::string batch;
+    size_t threads = 1;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        try {
+            if (arg.rfind("--backend=", 0) == 0) backend_type = parse_disk_backend(arg.substr(10));
+            else if (arg.rfind("--cache-blocks=", 0) == 0) cache_blocks = std::stoul(arg.substr(15));
+            else if (arg.rfind("--image=", 0) == 0) image = arg.substr(8);
+            else if (arg.rfind("--size-mb=", 0) == 0) size_mb = std::stoul(arg.substr(10));
+            else if (arg.rfind("--batch=", 0) == 0) batch = arg.substr(8);
+            else if (arg.rfind("--threads=", 0) == 0) threads = std::stoul(arg.substr(10));
+            else throw std::runtime_error("Unknown option: " + arg);
+        } catch (const std::invalid_argument&) {
+            std::cerr << "Invalid value: " << arg << "\n";
+            return 1;
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+    }
+    const bool batch_mode = !batch.empty();
+
+    // The library is silent unless someone listens: the REPL shows its
+    // messages, errors and warnings on stderr. A replay keeps stdout for
+    // its report and hears warnings only.
+    if (batch_mode) {
+        Logger::set_sink([](LogLevel, const std::string& message) { std::cerr << message << "\n"; }, LogLevel::Warning);
+    } else {
+        Logger::set_sink([](LogLevel level, const std::string& message) {
+            (level >= LogLevel::Warning ? std::cerr : std::cout) << message << "\n";
+        });
+    }
+    std::ostream& status = batch_mode ? std::cerr : std::cout;
+
+    // The trace is read in full before the disk is touched, so the replay
+    // times the file system and not the input
+    std::vector<TraceCommand> trace;
+    if (batch_mode) {
+        try {
+            if (batch == "-") {
+                trace = load_trace(std::cin);
+            } else {
+                std::ifstream in(batch);
+                if (!in) throw std::runtime_error("Cannot open trace '" + batch + "'");
+                trace = load_trace(in);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    // 1. Disk size: --size-mb, else the image's own size in batch mode
+    // (nobody to prompt, and a resize would change the replayed image),
+    // else ask
+    if (size_mb == 0 && batch_mode) {
+        struct stat st;
+        if (::stat(image.c_str(), &st) != 0 || st.st_size == 0) {
+            std::cerr << "No image '" << image << "' to replay against: pass --size-mb=N to create one\n";
+            return 1;
+        }
+        size_mb = static_cast<size_t>(st.st_size) / (1024 * 1024);
+    }
+    while (size_mb == 0) {
         std::cout << "Enter disk size in MB (must be multiple of 16): ";
 
         if (!(std::cin >> size_mb)) {
@@ -57,53 +506,61 @@ int main() {
             std::cin.clear(); // Clear error flag
             std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); // Discard bad input
             std::cout << "Invalid input. Please enter a number.\n";
+            size_mb = 0;
             continue;
         }
 
-        if (size_mb > 0 && size_mb % 16 == 0) {
-            break; // Input is valid
-        } else {
+        // CRITICAL: Clear the newline left in the buffer by std::cin >>
+        // Otherwise, the first std::getline in the REPL will be skipped.
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        if (size_mb == 0 || size_mb % 16 != 0) {
             std::cout << "Error: Size must be positive and a multiple of 16 (e.g., 16, 32, 64).\n";
+            size_mb = 0;
         }
     }
-
-    // CRITICAL: Clear the newline left in the buffer by std::cin >>
-    // Otherwise, the first std::getline in the REPL will be skipped.
-    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    if (size_mb % 16 != 0) {
+        std::cerr << "Error: Size must be a multiple of 16 MB, got " << size_mb << "\n";
+        return 1;
+    }
 
     const size_t DISK_SIZE = size_mb * 1024 * 1024;
-    const char* DISK_NAME = "my_fs.img";
 
-    std::cout << "\n[System] Initializing " << size_mb << "MB Disk backed by '" << DISK_NAME << "'...\n";
+    status << "\n[System] Initializing " << size_mb << "MB Disk backed by '" << image << "'...\n";
 
     // 2. Initialize Hardware & Driver
     // If the file exists but has a different size, Disk constructor will resize (ftruncate) it.
-    Disk disk(DISK_SIZE, DISK_NAME);
+    Disk disk(DISK_SIZE, image.c_str(), backend_type, cache_blocks);
     FileSystem fs(disk);
+    status << "[System] Disk backend: " << disk.get_backend_name() << "\n";
 
     // 3. Smart Startup: Try to Mount, otherwise Format
     try {
-        std::cout << "[System] Attempting to mount existing file system...\n";
-        fs.mount();
+        status << "[System] Attempting to mount existing file system...\n";
+        fs.mount(MountMode::Warm); // Metadata resident before the first command
 
         // Optional: Check if the mounted FS size matches the physical disk size
         // (If you grew the disk from 16MB to 32MB, you might want to warn the user)
         // For now, we assume if it mounts, it's usable.
-        std::cout << "[System] Mount successful! Data preserved.\n";
+        status << "[System] Mount successful! Data preserved.\n";
 
     } catch (const std::exception& e) {
-        std::cout << "[System] Mount failed or new disk detected (" << e.what() << ").\n";
-        std::cout << "[System] Formatting new file system...\n";
+        status << "[System] Mount failed or new disk detected (" << e.what() << ").\n";
+        status << "[System] Formatting new file system...\n";
         try {
-            fs.format();
+            fs.format(true); // Lazy: groups are initialized as they fill
         } catch (const std::exception& ex) {
             std::cerr << "[Critical Error] Format failed: " << ex.what() << "\n";
             return 1;
         }
     }
 
+    if (batch_mode) {
+        run_batch(fs, trace, threads);
+        return 0;
+    }
+
     std::cout << "\n=== File System REPL ===\n";
-    std::cout << "Commands: ls, touch, mkdir, rm, rmdir, write, read, format, login, logout, whoami, chmod, chown, chgrp, ln, stat, exit\n";
+    std::cout << "Commands: ls, touch, mkdir, rm, rmdir, write, append, truncate, read, format, login, logout, whoami, chmod, chown, chgrp, ln, stat, stats, sync, fsync, fsck, exit\n";
     std::cout << "Note: Changes are automatically saved when you 'exit'.\n";
 
     // 4. REPL Loop
@@ -117,146 +574,10 @@ int main() {
         if (line.empty()) continue;
 
         std::vector<std::string> args = parse_command(line);
-        std::string cmd = args[0];
+        if (args.empty()) continue;
 
         try {
-            if (cmd == "exit") {
-                std::cout << "[System] Syncing to disk and exiting...\n";
-                break;
-            }
-            // --- NEW: LOGIN COMMAND ---
-            else if (cmd == "login") {
-                if (args.size() < 3) throw std::runtime_error("Usage: login <uid> <gid>");
-                uint16_t new_uid = std::stoi(args[1]);
-                uint16_t new_gid = std::stoi(args[2]);
-                fs.login(new_uid, new_gid);
-            }
-            // --- NEW: LOGOUT COMMAND ---
-            else if (cmd == "logout") {
-                fs.logout();
-            }
-            // --- NEW: WHOAMI COMMAND ---
-            else if (cmd == "whoami") {
-                std::cout << "Current UID: " << fs.get_current_user() << "\n";
-            }
-            else if (cmd == "format") {
-                std::cout << "[Warning] This will erase all data. Confirm? (y/n): ";
-                std::string confirm;
-                std::getline(std::cin, confirm);
-                if (confirm == "y") {
-                    fs.format();
-                } else {
-                    std::cout << "Format cancelled.\n";
-                }
-            }
-            else if (cmd == "mount") {
-                fs.mount();
-            }
-            else if (cmd == "ls") {
-                bool long_format = false;
-                std::string path = "/";
-                
-                for (size_t i = 1; i < args.size(); i++) {
-                    if (args[i] == "-l") long_format = true;
-                    else if (args[i] == "-la" || args[i] == "-al") {
-                        long_format = true;
-                    }
-                    else path = args[i];
-                }
-                
-                auto entries = fs.list_dir(path, true);
-
-                std::cout << "Listing '" << path << "':\n";
-                if (entries.empty()) std::cout << "(empty)\n";
-                for (const auto& entry : entries) {
-                    if (!long_format) {
-                        std::cout << entry.name << "\n";
-                    } else {
-                        if (entry.name == "." || entry.name == "..") continue;
-                        std::cout << format_permissions(entry.permissions, entry.is_directory, entry.is_symlink)
-                          << " " << entry.uid 
-                          << " " << entry.gid 
-                          << " " << std::setw(5) << std::left << (long_format ? format_size(0) : "0")
-                          << " " << entry.name << "\n";
-                    }
-                }
-            }
-            else if (cmd == "mkdir") {
-                if (args.size() < 2) throw std::runtime_error("Usage: mkdir <path>");
-                fs.create_dir(args[1]);
-            }
-            else if (cmd == "touch") {
-                if (args.size() < 2) throw std::runtime_error("Usage: touch <path>");
-                fs.create_file(args[1]);
-            }
-            else if (cmd == "rm") {
-                if (args.size() < 2) throw std::runtime_error("Usage: rm <path>");
-                fs.delete_file(args[1]);
-            }
-            else if (cmd == "rmdir") {
-                if (args.size() < 2) throw std::runtime_error("Usage: rmdir <path>");
-                fs.delete_dir(args[1]);
-            }
-            else if (cmd == "write") {
-                if (args.size() < 3) throw std::runtime_error("Usage: write <path> <content>");
-
-                std::string content;
-                size_t first_space = line.find(' ', line.find(' ') + 1);
-                if (first_space != std::string::npos) {
-                    content = line.substr(first_space + 1);
-                }
-
-                std::vector<uint8_t> data(content.begin(), content.end());
-                fs.write_file(args[1], data);
-            }
-            else if (cmd == "read") {
-                if (args.size() < 2) throw std::runtime_error("Usage: read <path>");
-
-                std::vector<uint8_t> data = fs.read_file(args[1]);
-                std::string text(data.begin(), data.end());
-                std::cout << text << "\n";
-            }
-            else if (cmd == "chmod") {
-                if (args.size() < 3) throw std::runtime_error("Usage: chmod <path> <mode>");
-                uint16_t mode = std::stoi(args[2], nullptr, 8);
-                fs.chmod(args[1], mode);
-            }
-            else if (cmd == "chown") {
-                if (args.size() < 3) throw std::runtime_error("Usage: chown <path> <uid>");
-                uint16_t uid = std::stoi(args[2]);
-                fs.chown(args[1], uid);
-            }
-            else if (cmd == "chgrp") {
-                if (args.size() < 3) throw std::runtime_error("Usage: chgrp <path> <gid>");
-                uint16_t gid = std::stoi(args[2]);
-                fs.chgrp(args[1], gid);
-            }
-            else if (cmd == "ln") {
-                if (args.size() < 3) throw std::runtime_error("Usage: ln -s <target> <link_path>");
-                if (args[1] != "-s") throw std::runtime_error("Only symbolic links supported. Use: ln -s <target> <link_path>");
-                fs.create_symlink(args[2], args[3]);
-            }
-            else if (cmd == "stat") {
-                if (args.size() < 2) throw std::runtime_error("Usage: stat <path>");
-                FileStats stats = fs.get_stats(args[1]);
-                std::cout << "  Inode: " << stats.inode_id << "\n";
-                std::cout << "  Size: " << stats.file_size << "\n";
-                std::cout << "  UID: " << stats.uid << "\n";
-                std::cout << "  GID: " << stats.gid << "\n";
-                std::cout << "  Permissions: " << format_permissions(stats.permissions, stats.file_type == FS_DIRECTORY, stats.file_type == FS_SYMLINK) << "\n";
-                std::string type_str = "unknown";
-                if (stats.file_type == FS_FILE) type_str = "file";
-                else if (stats.file_type == FS_DIRECTORY) type_str = "directory";
-                else if (stats.file_type == FS_SYMLINK) type_str = "symlink";
-                std::cout << "  Type: " << type_str << "\n";
-                if (!stats.symlink_target.empty()) {
-                    std::cout << "  Target: " << stats.symlink_target << "\n";
-                }
-            }
-            else {
-                std::cout << "Unknown command: " << cmd << "\n";
-            }
-
+            if (!run_command(fs, line, args, std::cout, true)) break;
         } catch (const std::exception& e) {
             std::cout << "[Error] " << e.what() << "\n";
         }
@@ -1,15 +1,12 @@
 #include "util/tokenizer.h"
-#include <sstream>
 
-std::vector<std::string> tokenize_path(const std::string& input, char delimiter) {
+std::vector<std::string> tokenize_path(std::string_view input, char delimiter) {
     std::vector<std::string> tokens;
-    std::string token;
-    std::stringstream ss(input);
+    PathIterator it(input, delimiter);
+    std::string_view token;
 
-    while(std::getline(ss, token, delimiter)) {
-        if (!token.empty() && token != "/") { // Skip empty tokens and stray slashes
-            tokens.push_back(token);
-        }
+    while (it.next(token)) {
+        tokens.emplace_back(token);
     }
     return tokens;
 }
@@ -0,0 +1,164 @@
+#include "fs/bitmap_scan.hpp"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <random>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+
+#define ASSERT(condition, message) \
+    if (!(condition)) { \
+        std::cerr << "[FAIL] " << message << " (" << #condition << ")\n"; \
+        std::exit(1); \
+    } else { \
+        std::cout << "[PASS] " << message << "\n"; \
+    }
+
+// Reference implementation: the original bit-by-bit loop.
+int naive_find_first_zero(const uint8_t* bitmap, int max_bits, int start_bit) {
+    for (int i = start_bit; i < max_bits; i++) {
+        if ((bitmap[i / 8] & (1 << (i % 8))) == 0) return i;
+    }
+    return -1;
+}
+
+void set_bit(std::vector<uint8_t>& bitmap, int i) {
+    bitmap[i / 8] |= (1 << (i % 8));
+}
+
+// ==========================================
+// BITMAP SCAN TESTS
+// ==========================================
+void test_empty_and_full() {
+    std::cout << "\n=== Bitmap Scan Tests: Empty / Full ===\n";
+    std::vector<uint8_t> bitmap(4096, 0);
+
+    ASSERT(bitmap_find_first_zero(bitmap.data(), 4096, 0) == 0, "Empty bitmap returns bit 0");
+    ASSERT(bitmap_find_first_zero(bitmap.data(), 4096, 77) == 77, "Empty bitmap honours start_bit");
+
+    std::memset(bitmap.data(), 0xFF, bitmap.size());
+    ASSERT(bitmap_find_first_zero(bitmap.data(), 4096, 0) == -1, "Full bitmap returns -1");
+    ASSERT(bitmap_find_first_zero_scalar(bitmap.data(), 4096, 0) == -1, "Scalar: full bitmap returns -1");
+    ASSERT(bitmap_find_first_zero(bitmap.data(), 4096, 4096) == -1, "start_bit == max_bits returns -1");
+}
+
+void test_boundaries() {
+    std::cout << "\n=== Bitmap Scan Tests: Word and Lane Boundaries ===\n";
+    std::vector<uint8_t> bitmap(4096, 0xFF);
+
+    // A single free bit at every interesting offset around 64/256-bit edges.
+    int spots[] = {0, 1, 63, 64, 65, 255, 256, 257, 511, 1000, 4031, 4095};
+    for (int spot : spots) {
+        std::memset(bitmap.data(), 0xFF, bitmap.size());
+        bitmap[spot / 8] &= ~(1 << (spot % 8));
+        ASSERT(bitmap_find_first_zero(bitmap.data(), 4096, 0) == spot,
+               "Dispatched scan finds free bit " + std::to_string(spot));
+        ASSERT(bitmap_find_first_zero_scalar(bitmap.data(), 4096, 0) == spot,
+               "Scalar scan finds free bit " + std::to_string(spot));
+        ASSERT(bitmap_find_first_zero(bitmap.data(), 4096, spot + 1) == -1,
+               "Scan starting past bit " + std::to_string(spot) + " finds nothing");
+    }
+
+    // Free bits beyond max_bits must never be reported.
+    std::memset(bitmap.data(), 0xFF, bitmap.size());
+    bitmap[600 / 8] &= ~(1 << (600 % 8));
+    ASSERT(bitmap_find_first_zero(bitmap.data(), 600, 0) == -1, "Free bit at max_bits is ignored");
+    ASSERT(bitmap_find_first_zero(bitmap.data(), 601, 0) == 600, "Free bit just below max_bits is found");
+    ASSERT(bitmap_find_first_zero_atomic(bitmap.data(), 600, 0) == -1 &&
+           bitmap_find_first_zero_atomic(bitmap.data(), 601, 0) == 600,
+           "Atomic scan honours max_bits");
+}
+
+void test_random_against_reference() {
+    std::cout << "\n=== Bitmap Scan Tests: Random vs Reference (engine: "
+              << bitmap_scan_engine_name() << ") ===\n";
+    std::mt19937 gen(1234);
+    std::uniform_int_distribution<> bit_dis(0, 4095);
+
+    bool all_match = true;
+    for (int round = 0; round < 200 && all_match; round++) {
+        std::vector<uint8_t> bitmap(4096, 0);
+        // Fill from 80% to ~100% to mimic nearly full groups.
+        int fill = 3276 + (round * 4);
+        for (int i = 0; i < fill; i++) set_bit(bitmap, i);
+        for (int i = 0; i < round; i++) set_bit(bitmap, bit_dis(gen));
+
+        int max_bits = 512 + (round * 17) % 3585;
+        int start_bit = bit_dis(gen) % max_bits;
+        int expected = naive_find_first_zero(bitmap.data(), max_bits, start_bit);
+        if (bitmap_find_first_zero(bitmap.data(), max_bits, start_bit) != expected ||
+            bitmap_find_first_zero_scalar(bitmap.data(), max_bits, start_bit) != expected ||
+            bitmap_find_first_zero_atomic(bitmap.data(), max_bits, start_bit) != expected ||
+            bitmap_find_first_zero_atomic_scalar(bitmap.data(), max_bits, start_bit) != expected) {
+            all_match = false;
+        }
+    }
+    ASSERT(all_match, "200 random bitmaps match the bit-by-bit reference");
+}
+
+// ==========================================
+// MAIN
+void test_atomic_claims() {
+    std::cout << "\n=== Bitmap Scan Tests: Atomic Claims ===\n";
+    std::vector<uint64_t> storage(512, 0); // 8-byte aligned, 32768 bits
+    uint8_t* bitmap = reinterpret_cast<uint8_t*>(storage.data());
+
+    ASSERT(bitmap_claim_run(bitmap, 32768, 60, 10) == 10, "Run across a word edge is claimed whole");
+    ASSERT(bitmap_test_bit_atomic(bitmap, 60) && bitmap_test_bit_atomic(bitmap, 69),
+           "Claimed bits read back as set");
+    ASSERT(bitmap_claim_run(bitmap, 32768, 65, 4) == 0, "Claiming a set bit gets nothing");
+    ASSERT(bitmap_claim_run(bitmap, 32768, 50, 100) == 10, "Claim stops at the next set bit");
+    ASSERT(bitmap_claim_run(bitmap, 1000, 995, 64) == 5, "Claim never passes max_bits");
+    ASSERT(bitmap_find_first_zero_atomic(bitmap, 32768, 50) == 70, "Atomic scan skips claimed bits");
+
+    ASSERT(bitmap_release_bit(bitmap, 64) && !bitmap_test_bit_atomic(bitmap, 64), "Release clears a set bit");
+    ASSERT(!bitmap_release_bit(bitmap, 64), "Releasing a clear bit reports it");
+    ASSERT(bitmap_release_run(bitmap, 50, 30) == 19 && bitmap_find_first_zero_atomic(bitmap, 32768, 0) == 0 &&
+           bitmap_find_first_zero_atomic(bitmap, 32768, 50) == 50 && !bitmap_test_bit_atomic(bitmap, 79),
+           "Run release clears across a word edge and counts the set bits");
+
+    // Threads race for single bits: every bit is handed out exactly once
+    std::fill(storage.begin(), storage.end(), 0);
+    const int THREADS = 8;
+    std::vector<std::vector<int>> won(THREADS);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < THREADS; t++) {
+        workers.emplace_back([&, t]() {
+            int start = t * 4096; // Different starting points, like group affinity
+            while (true) {
+                int bit = bitmap_find_first_zero_atomic(bitmap, 32768, start);
+                if (bit == -1) bit = bitmap_find_first_zero_atomic(bitmap, 32768, 0);
+                if (bit == -1) break;
+                if (bitmap_claim_run(bitmap, 32768, bit, 1) == 1) won[t].push_back(bit);
+                start = bit;
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+
+    std::vector<int> owners(32768, 0);
+    size_t total = 0;
+    for (auto& list : won) {
+        total += list.size();
+        for (int bit : list) owners[bit]++;
+    }
+    ASSERT(total == 32768 && std::all_of(owners.begin(), owners.end(), [](int n) { return n == 1; }),
+           "Concurrent claims never hand out a bit twice");
+}
+
+// ==========================================
+int main() {
+    std::cout << "STARTING BITMAP SCAN TEST SUITE\n";
+    std::cout << "===============================\n";
+
+    test_empty_and_full();
+    test_boundaries();
+    test_random_against_reference();
+    test_atomic_claims();
+
+    std::cout << "\n===============================\n";
+    std::cout << "ALL BITMAP SCAN TESTS PASSED.\n";
+    return 0;
+}
@@ -0,0 +1,145 @@
+#include "fs/dentry_cache.hpp"
+#include "fs/filesystem.hpp"
+#include "fs/disk.hpp"
+#include <iostream>
+#include <string>
+#include <cstdio>
+
+#define ASSERT(condition, message) \
+    if (!(condition)) { \
+        std::cerr << "[FAIL] " << message << " (" << #condition << ")\n"; \
+        std::exit(1); \
+    } else { \
+        std::cout << "[PASS] " << message << "\n"; \
+    }
+
+#define ASSERT_THROWS(code, message) \
+    { \
+        bool caught = false; \
+        try { code; } \
+        catch (const std::exception&) { caught = true; } \
+        if (!caught) { \
+            std::cerr << "[FAIL] " << message << " (Expected exception but none thrown)\n"; \
+            std::exit(1); \
+        } else { \
+            std::cout << "[PASS] " << message << "\n"; \
+        } \
+    }
+
+void cleanup_file(const char* filename) {
+    std::remove(filename);
+}
+
+// ==========================================
+// CACHE UNIT TESTS
+// ==========================================
+void test_positive_and_negative_entries() {
+    std::cout << "\n=== Dentry Cache Tests: Positive / Negative ===\n";
+    DentryCache cache(64);
+    size_t child = 123;
+
+    ASSERT(!cache.lookup(1, "a", &child), "Empty cache misses");
+
+    cache.insert(1, "a", 42);
+    ASSERT(cache.lookup(1, "a", &child) && child == 42, "Positive entry hits");
+    ASSERT(!cache.lookup(2, "a", &child), "Same name under another parent misses");
+
+    cache.insert(1, "missing", 0);
+    ASSERT(cache.lookup(1, "missing", &child) && child == 0, "Negative entry hits with id 0");
+
+    cache.insert(1, "missing", 77);
+    ASSERT(cache.lookup(1, "missing", &child) && child == 77, "Insert replaces a negative entry");
+
+    cache.invalidate(1, "a");
+    ASSERT(!cache.lookup(1, "a", &child), "Invalidated entry misses");
+
+    cache.clear();
+    ASSERT(!cache.lookup(1, "missing", &child), "Clear drops every entry");
+}
+
+void test_bounded_capacity() {
+    std::cout << "\n=== Dentry Cache Tests: Bounded Capacity ===\n";
+    DentryCache cache(64);
+    for (size_t i = 0; i < 10000; i++) {
+        cache.insert(1, "name" + std::to_string(i), i + 1);
+    }
+    ASSERT(cache.get_capacity() == 64, "Capacity stays fixed");
+
+    size_t child = 0;
+    size_t resident = 0;
+    for (size_t i = 0; i < 10000; i++) {
+        if (cache.lookup(1, "name" + std::to_string(i), &child)) {
+            if (child != i + 1) resident = 100000; // Wrong mapping: force failure
+            resident++;
+        }
+    }
+    ASSERT(resident > 0 && resident <= 64, "At most capacity entries survive, all correct");
+}
+
+// ==========================================
+// FILESYSTEM COHERENCE TESTS
+// ==========================================
+void test_cache_coherence() {
+    std::cout << "\n=== Dentry Cache Tests: FileSystem Coherence ===\n";
+    const char* TEST_IMG = "test_dcache_coherence.img";
+    cleanup_file(TEST_IMG);
+
+    Disk disk(16 * 1024 * 1024, TEST_IMG);
+    FileSystem fs(disk);
+    fs.format();
+
+    // Negative entry must not hide a later create
+    ASSERT_THROWS(fs.get_stats("/later.txt"), "Missing file reported missing");
+    fs.create_file("/later.txt");
+    ASSERT(fs.get_stats("/later.txt").file_type == FS_FILE, "Create invalidates negative entry");
+
+    // Positive entry must not outlive delete
+    fs.delete_file("/later.txt");
+    ASSERT_THROWS(fs.get_stats("/later.txt"), "Delete invalidates positive entry");
+
+    // Symlink creation is visible through the cache
+    fs.create_dir("/real");
+    ASSERT_THROWS(fs.get_stats("/link"), "Link missing before creation");
+    fs.create_symlink("/real", "/link");
+    ASSERT(fs.get_stats("/link").file_type == FS_SYMLINK, "Symlink visible after creation");
+
+    // Deep lookups, then rm -r and rebuild with different contents; inode
+    // numbers get reused, so stale children would resolve to wrong files.
+    fs.create_dir("/a");
+    fs.create_dir("/a/b");
+    fs.create_file("/a/b/old.txt");
+    fs.write_file("/a/b/old.txt", {'o', 'l', 'd'});
+    ASSERT(fs.read_file("/a/b/old.txt").size() == 3, "Deep file readable");
+
+    fs.delete_dir("/a");
+    ASSERT_THROWS(fs.read_file("/a/b/old.txt"), "Deleted subtree no longer resolves");
+
+    fs.create_dir("/a");
+    fs.create_dir("/a/b");
+    fs.create_file("/a/b/new.txt");
+    ASSERT_THROWS(fs.read_file("/a/b/old.txt"), "Old name stays gone after rebuild");
+    ASSERT(fs.read_file("/a/b/new.txt").empty(), "New file resolves in rebuilt subtree");
+
+    cleanup_file(TEST_IMG);
+}
+
+// ==========================================
+// MAIN
+// ==========================================
+int main() {
+    std::cout << "STARTING DENTRY CACHE TEST SUITE\n";
+    std::cout << "================================\n";
+
+    try {
+        test_positive_and_negative_entries();
+        test_bounded_capacity();
+        test_cache_coherence();
+    } catch (const std::exception& e) {
+        std::cerr << "\n[CRITICAL FAILURE] Uncaught Exception: " << e.what() << "\n";
+        return 1;
+    }
+
+    std::cout << "\n================================\n";
+    std::cout << "ALL DENTRY CACHE TESTS PASSED.\n";
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include "fs/extent_cache.hpp"
+#include <iostream>
+#include <cstdlib>
+
+#define ASSERT(condition, message) \
+    if (!(condition)) { \
+        std::cerr << "[FAIL] " << message << " (" << #condition << ")\n"; \
+        std::exit(1); \
+    } else { \
+        std::cout << "[PASS] " << message << "\n"; \
+    }
+
+// ==========================================
+// EXTENT CACHE TESTS
+// ==========================================
+void test_run_merging() {
+    std::cout << "\n=== Extent Cache Tests: Runs ===\n";
+    ExtentCache cache(16);
+    size_t phys = 0, run = 0;
+
+    ASSERT(!cache.lookup(7, 0, &phys), "Empty cache misses");
+
+    // Sequential growth extends one run
+    for (size_t i = 0; i < 100; i++) cache.insert(7, i, 500 + i);
+    ASSERT(cache.lookup(7, 42, &phys, &run) && phys == 542 && run == 58, "Sequential inserts form one run");
+
+    // A discontiguous block starts a new run
+    cache.insert(7, 100, 9000);
+    ASSERT(cache.lookup(7, 100, &phys, &run) && phys == 9000 && run == 1, "Physical gap starts a new run");
+    ASSERT(cache.lookup(7, 99, &phys, &run) && phys == 599 && run == 1, "Previous run is unchanged");
+
+    // Filling a hole between two runs merges them
+    cache.insert(7, 200, 700, 10);
+    cache.insert(7, 210, 710, 5);
+    cache.insert(7, 190, 690, 10);
+    ASSERT(cache.lookup(7, 190, &phys, &run) && phys == 690 && run == 25, "Adjacent runs merge both ways");
+    ASSERT(!cache.lookup(7, 150, &phys), "Unmapped logical block misses");
+}
+
+void test_slots_and_invalidation() {
+    std::cout << "\n=== Extent Cache Tests: Slots ===\n";
+    ExtentCache cache(4);
+    size_t phys = 0;
+
+    cache.insert(1, 0, 100, 8);
+    cache.insert(2, 0, 200, 8);
+    ASSERT(cache.lookup(1, 3, &phys) && phys == 103, "Inode 1 cached");
+    ASSERT(cache.lookup(2, 3, &phys) && phys == 203, "Inode 2 cached independently");
+
+    // Inode 5 maps to inode 1's slot and evicts it
+    cache.insert(5, 0, 300);
+    ASSERT(!cache.lookup(1, 3, &phys), "Colliding inode replaces the slot owner");
+    ASSERT(cache.lookup(5, 0, &phys) && phys == 300, "New owner is cached");
+
+    cache.invalidate(2);
+    ASSERT(!cache.lookup(2, 3, &phys), "Invalidated inode misses");
+
+    cache.clear();
+    ASSERT(!cache.lookup(5, 0, &phys), "Clear drops everything");
+}
+
+// ==========================================
+// MAIN
+// ==========================================
+int main() {
+    std::cout << "STARTING EXTENT CACHE TEST SUITE\n";
+    std::cout << "================================\n";
+
+    test_run_merging();
+    test_slots_and_invalidation();
+
+    std::cout << "\n================================\n";
+    std::cout << "ALL EXTENT CACHE TESTS PASSED.\n";
+    return 0;
+}
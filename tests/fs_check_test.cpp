@@ -0,0 +1,167 @@
+#include "fs/filesystem.hpp"
+#include "fs/disk.hpp"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdio>
+
+#define ASSERT(condition, message) \
+    if (!(condition)) { \
+        std::cerr << "[FAIL] " << message << " (" << #condition << ")\n"; \
+        std::exit(1); \
+    } else { \
+        std::cout << "[PASS] " << message << "\n"; \
+    }
+
+const char* TEST_IMG = "test_check.img";
+const size_t DISK_SIZE = 64 * 1024 * 1024;
+
+// On-disk group layout (see BlockGroupManager)
+const size_t INODE_BITMAP_BLOCK = 1;
+const size_t BLOCK_BITMAP_BLOCK = 2;
+
+const SuperBlock* superblock(Disk& disk) {
+    return reinterpret_cast<const SuperBlock*>(disk.get_ptr(0));
+}
+
+// Flips the bitmap bit of a global block or inode id behind the file system's back
+void flip_bit(Disk& disk, size_t bitmap_block, size_t id, size_t per_group) {
+    uint8_t* bitmap = disk.get_ptr((id / per_group) * superblock(disk)->blocks_per_group + bitmap_block);
+    size_t local = id % per_group;
+    bitmap[local / 8] ^= static_cast<uint8_t>(1 << (local % 8));
+}
+
+void populate(FileSystem& fs) {
+    fs.create_dir("/docs");
+    fs.create_dir("/docs/big");
+    for (int i = 0; i < 300; i++) fs.create_file("/docs/big/f" + std::to_string(i)); // Indexed directory
+    fs.create_file("/docs/tiny.txt");
+    fs.write_file("/docs/tiny.txt", std::vector<uint8_t>(40, 't'));        // Inline
+    fs.create_file("/docs/large.bin");
+    fs.write_file("/docs/large.bin", std::vector<uint8_t>(600 * 4096, 'l')); // Double indirect
+    fs.create_file("/docs/runs.bin", true);
+    fs.write_file("/docs/runs.bin", std::vector<uint8_t>(20 * 4096, 'e'));   // Extents
+    fs.create_symlink("/docs/tiny.txt", "/short");
+    fs.create_symlink("/" + std::string(200, 'x'), "/long");                  // Target in a block
+    fs.delete_file("/docs/big/f7");
+}
+
+// ==========================================
+// CHECK TESTS
+// ==========================================
+void test_clean_image() {
+    std::cout << "\n=== Check Tests: Clean Image ===\n";
+    std::remove(TEST_IMG);
+    Disk disk(DISK_SIZE, TEST_IMG);
+    FileSystem fs(disk);
+    fs.format(true);
+    populate(fs);
+
+    CheckReport report = fs.check();
+    ASSERT(report.clean(), "A freshly populated image is consistent");
+    ASSERT(report.inodes_in_use == 1 + 2 + 299 + 3 + 2, "Every allocated inode is counted");
+    // 4 groups of 4096 blocks, each starting with 259 metadata blocks
+    ASSERT(report.blocks_in_use + fs.get_free_block_count() == 4 * (4096 - 259),
+           "Owned and free blocks add up to the data area");
+
+    fs.delete_dir("/docs");
+    ASSERT(fs.check().clean(), "Still consistent once a removed tree is reclaimed");
+}
+
+void test_bitmap_repair() {
+    std::cout << "\n=== Check Tests: Bitmap Repair ===\n";
+    std::remove(TEST_IMG);
+    Disk disk(DISK_SIZE, TEST_IMG);
+    FileSystem fs(disk);
+    fs.format(true);
+    populate(fs);
+    fs.sync();
+
+    // One free block marked used, one used block (the journal's first) marked free
+    const SuperBlock* sb = superblock(disk);
+    flip_bit(disk, BLOCK_BITMAP_BLOCK, sb->blocks_per_group - 1, sb->blocks_per_group);
+    flip_bit(disk, BLOCK_BITMAP_BLOCK, sb->journal_start, sb->blocks_per_group);
+
+    CheckReport report = fs.check();
+    ASSERT(report.leaked_blocks == 1, "Leaked block found");
+    ASSERT(report.missing_blocks == 1, "Owned block marked free found");
+    ASSERT(!report.repaired, "Nothing is changed without repair");
+
+    report = fs.check(true);
+    ASSERT(report.repaired && report.leaked_blocks == 1, "Repair reports what it fixed");
+    ASSERT(fs.check().clean(), "Clean after repair");
+    ASSERT(fs.read_file("/docs/large.bin").size() == 600 * 4096, "Data survives the repair");
+}
+
+void test_orphans_and_dangling_entries() {
+    std::cout << "\n=== Check Tests: Orphans and Dangling Entries ===\n";
+    std::remove(TEST_IMG);
+    size_t reclaimed_free_blocks = 0;
+    size_t reclaimed_free_inodes = 0;
+    std::vector<uint8_t> crashed;
+    {
+        Disk disk(DISK_SIZE, TEST_IMG);
+        FileSystem fs(disk);
+        fs.format(true);
+        populate(fs);
+        fs.create_file("/keep");
+
+        // A crash between delete_dir and the deferred reclaim leaves the
+        // tree allocated and unlinked (fsync commits without reclaiming).
+        // Mount would finish it from the orphan chain, so the chain (and the
+        // journal holding it) is lost below, as in a damaged image.
+        fs.delete_dir("/docs");
+        fs.fsync("/keep");
+        size_t bytes = disk.get_block_count() * disk.get_block_size();
+        crashed.assign(disk.get_ptr(0), disk.get_ptr(0) + bytes);
+
+        reclaimed_free_blocks = fs.get_free_block_count();
+        reclaimed_free_inodes = fs.get_free_inode_count();
+    }
+
+    Disk disk(DISK_SIZE, TEST_IMG);
+    std::memcpy(disk.get_ptr(0), crashed.data(), crashed.size());
+    SuperBlock* sb = reinterpret_cast<SuperBlock*>(disk.get_ptr(0));
+    sb->orphan_head = 0;
+    std::memset(disk.get_ptr(sb->journal_start), 0, 4096); // Or replay would bring the chain back
+    FileSystem fs(disk);
+    fs.mount();
+
+    // And an entry whose inode was freed under it
+    fs.create_file("/stale");
+    size_t stale_id = fs.get_stats("/stale").inode_id;
+    flip_bit(disk, INODE_BITMAP_BLOCK, stale_id, superblock(disk)->inodes_per_group);
+
+    CheckReport report = fs.check();
+    ASSERT(report.orphan_inodes == 1, "The unlinked tree is one orphan");
+    ASSERT(report.dangling_entries == 1, "Entry naming a free inode found");
+    ASSERT(report.bad_counters == 1, "Stale free inode counter found");
+
+    report = fs.check(true);
+    ASSERT(report.repaired, "Repaired");
+    ASSERT(fs.check().clean(), "Clean after repair");
+    ASSERT(fs.get_free_block_count() == reclaimed_free_blocks, "The orphaned tree's blocks are freed");
+    ASSERT(fs.get_free_inode_count() == reclaimed_free_inodes, "The orphaned tree's inodes are freed");
+    ASSERT(fs.list_dir("/").size() == 3, "Dangling entry removed, the rest kept");
+    ASSERT(fs.get_stats("/short").symlink_target == "/docs/tiny.txt", "Live entries are untouched");
+}
+
+int main() {
+    std::cout << "STARTING FILESYSTEM CHECK TEST SUITE\n";
+    std::cout << "====================================\n";
+
+    try {
+        test_clean_image();
+        test_bitmap_repair();
+        test_orphans_and_dangling_entries();
+    } catch (const std::exception& e) {
+        std::cerr << "\n[CRITICAL FAILURE] Uncaught Exception: " << e.what() << "\n";
+        return 1;
+    }
+
+    std::remove(TEST_IMG);
+    std::cout << "\n====================================\n";
+    std::cout << "ALL CHECK TESTS PASSED.\n";
+    return 0;
+}
@@ -0,0 +1,228 @@
+#include "fs/filesystem.hpp"
+#include "fs/disk.hpp"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdio>
+#include <thread>
+#include <atomic>
+
+#define ASSERT(condition, message) \
+    if (!(condition)) { \
+        std::cerr << "[FAIL] " << message << " (" << #condition << ")\n"; \
+        std::exit(1); \
+    } else { \
+        std::cout << "[PASS] " << message << "\n"; \
+    }
+
+const char* TEST_IMG = "test_concurrency.img";
+const int THREADS = 8;
+
+// Runs fn(thread_index) on THREADS threads; returns how many threads threw.
+template <typename Fn>
+int run_threads(Fn fn) {
+    std::atomic<int> failures{0};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < THREADS; t++) {
+        workers.emplace_back([&, t]() {
+            try {
+                fn(t);
+            } catch (const std::exception& e) {
+                std::cerr << "[THREAD " << t << "] " << e.what() << "\n";
+                failures++;
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+    return failures.load();
+}
+
+// ==========================================
+// CONCURRENCY TESTS
+// ==========================================
+void test_parallel_directories() {
+    std::cout << "\n=== Concurrency Tests: Private Directories ===\n";
+    std::remove(TEST_IMG);
+    Disk disk(64 * 1024 * 1024, TEST_IMG);
+    FileSystem fs(disk);
+    fs.format();
+
+    size_t free_blocks = fs.get_free_block_count();
+    size_t free_inodes = fs.get_free_inode_count();
+
+    // Each thread owns a directory: create, write, read back, delete
+    int failures = run_threads([&](int t) {
+        std::string dir = "/t" + std::to_string(t);
+        fs.create_dir(dir);
+        for (int i = 0; i < 40; i++) {
+            std::string path = dir + "/f" + std::to_string(i);
+            fs.create_file(path, i % 2 == 1);
+            std::vector<uint8_t> data(1000 + i * 700, static_cast<uint8_t>(t * 40 + i));
+            fs.write_file(path, data);
+            if (fs.read_file(path) != data) throw std::runtime_error("Read back mismatch in " + path);
+        }
+        for (int i = 0; i < 40; i += 2) fs.delete_file(dir + "/f" + std::to_string(i));
+    });
+    ASSERT(failures == 0, "Threads in separate directories run without errors");
+
+    bool listings_ok = true;
+    for (int t = 0; t < THREADS; t++) {
+        listings_ok = listings_ok && fs.list_dir("/t" + std::to_string(t)).size() == 20;
+    }
+    ASSERT(listings_ok, "Every directory keeps exactly its surviving files");
+
+    // Parallel rm -r, reclaimed by the background thread meanwhile
+    fs.set_background_reclaim(true);
+    failures = run_threads([&](int t) {
+        fs.delete_dir("/t" + std::to_string(t));
+        fs.create_file("/done" + std::to_string(t));
+        fs.delete_file("/done" + std::to_string(t));
+    });
+    ASSERT(failures == 0, "Directory trees are removed concurrently");
+    ASSERT(fs.get_free_block_count() == free_blocks, "All blocks are returned after cleanup");
+    ASSERT(fs.get_free_inode_count() == free_inodes, "All inodes are returned after cleanup");
+}
+
+void test_shared_directory() {
+    std::cout << "\n=== Concurrency Tests: Shared Directory ===\n";
+    std::remove(TEST_IMG);
+    Disk disk(64 * 1024 * 1024, TEST_IMG);
+    FileSystem fs(disk);
+    fs.format();
+    fs.create_dir("/shared");
+
+    // Large enough to push the directory through its indexed conversion
+    int failures = run_threads([&](int t) {
+        for (int i = 0; i < 150; i++) {
+            std::string path = "/shared/t" + std::to_string(t) + "_" + std::to_string(i);
+            fs.create_file(path);
+            fs.get_stats(path);
+        }
+    });
+    ASSERT(failures == 0, "Concurrent creates in one directory succeed");
+    ASSERT(fs.list_dir("/shared").size() == THREADS * 150, "No entry is lost or duplicated");
+
+    // Everyone races for the same name: exactly one create wins per round
+    std::atomic<int> wins{0};
+    run_threads([&](int) {
+        for (int round = 0; round < 20; round++) {
+            try {
+                fs.create_file("/shared/contended" + std::to_string(round));
+                wins++;
+            } catch (const std::exception&) {
+            }
+        }
+    });
+    ASSERT(wins == 20, "Racing creates of one name admit a single winner");
+}
+
+void test_readers_and_writers() {
+    std::cout << "\n=== Concurrency Tests: One File ===\n";
+    std::remove(TEST_IMG);
+    Disk disk(64 * 1024 * 1024, TEST_IMG);
+    FileSystem fs(disk);
+    fs.format();
+    fs.create_file("/data");
+
+    const size_t SPAN = 3 * 4096 + 100;
+    std::vector<uint8_t> initial(SPAN, 1);
+    fs.write_at("/data", 0, initial.data(), initial.size());
+
+    // Writers rewrite the whole span with one byte value; readers must never
+    // see a mix of two writes.
+    std::atomic<int> torn{0};
+    int failures = run_threads([&](int t) {
+        std::vector<uint8_t> buf(SPAN);
+        for (int i = 0; i < 200; i++) {
+            if (t % 2 == 0) {
+                std::fill(buf.begin(), buf.end(), static_cast<uint8_t>(t * 31 + i));
+                fs.write_at("/data", 0, buf.data(), buf.size());
+            } else {
+                size_t n = fs.read_at("/data", 0, buf.data(), buf.size());
+                for (size_t b = 1; b < n; b++) {
+                    if (buf[b] != buf[0]) { torn++; break; }
+                }
+            }
+        }
+    });
+    ASSERT(failures == 0, "Readers and writers of one file run without errors");
+    ASSERT(torn == 0, "Reads never observe a partially applied write");
+
+    // Appends through per-thread handles all land, none overwrite another
+    fs.create_file("/log");
+    failures = run_threads([&](int t) {
+        int fd = fs.open("/log", FS_OPEN_WRITE | FS_OPEN_APPEND);
+        uint8_t record[16];
+        std::memset(record, 'a' + t, sizeof(record));
+        for (int i = 0; i < 100; i++) fs.write(fd, record, sizeof(record));
+        fs.close(fd);
+    });
+    ASSERT(failures == 0, "Concurrent appends succeed");
+
+    std::vector<uint8_t> log = fs.read_file("/log");
+    ASSERT(log.size() == THREADS * 100 * 16, "Appended size is the sum of all records");
+    bool records_whole = true;
+    for (size_t r = 0; r < log.size(); r += 16) {
+        for (size_t b = 1; b < 16; b++) records_whole = records_whole && log[r + b] == log[r];
+    }
+    ASSERT(records_whole, "Every appended record is contiguous");
+}
+
+void test_create_delete_races() {
+    std::cout << "\n=== Concurrency Tests: Create/Delete Races ===\n";
+    std::remove(TEST_IMG);
+    Disk disk(64 * 1024 * 1024, TEST_IMG);
+    FileSystem fs(disk);
+    fs.format();
+    fs.create_dir("/race");
+
+    size_t free_blocks = fs.get_free_block_count();
+    size_t free_inodes = fs.get_free_inode_count();
+
+    // Half the threads churn a few names, the rest write and read them;
+    // "not found" / "already exists" are expected outcomes, not failures.
+    run_threads([&](int t) {
+        std::vector<uint8_t> data(5000, static_cast<uint8_t>(t));
+        for (int i = 0; i < 300; i++) {
+            std::string path = "/race/n" + std::to_string(i % 4);
+            try {
+                if (t % 2 == 0) {
+                    if (i % 2 == 0) fs.create_file(path);
+                    else fs.delete_file(path);
+                } else {
+                    fs.write_file(path, data);
+                    fs.read_file(path);
+                }
+            } catch (const std::exception&) {
+            }
+        }
+    });
+
+    for (int i = 0; i < 4; i++) {
+        try { fs.delete_file("/race/n" + std::to_string(i)); } catch (const std::exception&) {}
+    }
+    ASSERT(fs.list_dir("/race").empty(), "Directory is empty after the churn");
+    ASSERT(fs.get_free_block_count() == free_blocks, "No block leaked by racing deletes");
+    ASSERT(fs.get_free_inode_count() == free_inodes, "No inode leaked by racing deletes");
+}
+
+int main() {
+    std::cout << "STARTING FILESYSTEM CONCURRENCY TEST SUITE\n";
+    std::cout << "==========================================\n";
+
+    try {
+        test_parallel_directories();
+        test_shared_directory();
+        test_readers_and_writers();
+        test_create_delete_races();
+    } catch (const std::exception& e) {
+        std::cerr << "\n[CRITICAL FAILURE] Uncaught Exception: " << e.what() << "\n";
+        return 1;
+    }
+
+    std::remove(TEST_IMG);
+    std::cout << "\n==========================================\n";
+    std::cout << "ALL CONCURRENCY TESTS PASSED.\n";
+    return 0;
+}
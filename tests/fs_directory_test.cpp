@@ -1,5 +1,6 @@
 #include "fs/filesystem.hpp"
 #include "fs/disk.hpp"
+#include "util/tokenizer.h"
 #include <iostream>
 #include <vector>
 #include <string>
@@ -113,10 +114,8 @@ void test_directory_entry_limits() {
 
     fs.create_dir("/bigdir");
 
-    // Calculate max entries per block: 4096 / sizeof(DirEntry)
-    // DirEntry has: size_t inode_id (8), uint8_t name_len (1), char name[255] (255)
-    // Total: 264 bytes, so max_entries = 4096 / 264 ≈ 15 per block
-    // With 12 blocks, that's about 180 entries max
+    // Entries are variable-length DirRecords: 12-byte header + name, rounded
+    // up to 8 bytes, so "fileNN.txt" costs 24 bytes (~170 per block).
 
     // Create many files in one directory
     int file_count = 50;
@@ -218,6 +217,290 @@ void test_path_traversal_errors() {
     cleanup_file(TEST_IMG);
 }
 
+void test_indexed_directory() {
+    std::cout << "\n=== Path Tests: Hashed Directory Index ===\n";
+    const char* TEST_IMG = "test_paths_indexed.img";
+    cleanup_file(TEST_IMG);
+
+    const size_t DISK_SIZE = 64 * 1024 * 1024;
+    // Far beyond what 12 linear blocks could hold (~180 entries)
+    const int file_count = 2000;
+    size_t fresh_free_blocks = 0;
+
+    {
+        Disk disk(DISK_SIZE, TEST_IMG);
+        FileSystem fs(disk);
+        fs.format();
+        fresh_free_blocks = fs.get_free_block_count();
+
+        fs.create_dir("/flat");
+        for (int i = 0; i < file_count; i++) {
+            fs.create_file("/flat/entry_" + std::to_string(i));
+        }
+        ASSERT(fs.list_dir("/flat").size() == file_count, "Flat directory holds 2000 entries");
+
+        bool all_found = true;
+        for (int i = 0; i < file_count; i += 97) {
+            if (fs.get_stats("/flat/entry_" + std::to_string(i)).file_type != FS_FILE) all_found = false;
+        }
+        ASSERT(all_found, "Indexed lookup finds entries");
+        ASSERT_THROWS(fs.create_file("/flat/entry_1234"), "Duplicate detected through the index");
+        ASSERT_THROWS(fs.get_stats("/flat/missing"), "Missing name not found through the index");
+
+        // Remove every other entry
+        for (int i = 0; i < file_count; i += 2) {
+            fs.delete_file("/flat/entry_" + std::to_string(i));
+        }
+        ASSERT(fs.list_dir("/flat").size() == file_count / 2, "Removal through the index");
+        ASSERT_THROWS(fs.get_stats("/flat/entry_0"), "Removed entry is gone");
+    }
+
+    // The index lives on disk, so it must survive a remount
+    {
+        Disk disk(DISK_SIZE, TEST_IMG);
+        FileSystem fs(disk);
+        fs.mount();
+
+        ASSERT(fs.list_dir("/flat").size() == file_count / 2, "Indexed directory persisted");
+        ASSERT(fs.get_stats("/flat/entry_1999").file_type == FS_FILE, "Lookup after remount");
+
+        fs.delete_dir("/flat");
+        ASSERT(fs.get_free_block_count() == fresh_free_blocks, "Deleting indexed directory frees index and buckets");
+        ASSERT(fs.list_dir("/").empty(), "Indexed directory deleted");
+    }
+
+    cleanup_file(TEST_IMG);
+}
+
+void test_indexed_directory_unlink() {
+    std::cout << "\n=== Path Tests: Removing an Indexed Directory as a File ===\n";
+    const char* TEST_IMG = "test_paths_indexed_unlink.img";
+    cleanup_file(TEST_IMG);
+
+    Disk disk(64 * 1024 * 1024, TEST_IMG);
+    FileSystem fs(disk);
+    fs.format();
+    size_t fresh_free_blocks = fs.get_free_block_count();
+
+    // Enough buckets to reach the single indirect tree; emptied, the
+    // directory's size no longer covers them
+    fs.create_dir("/idx");
+    for (int i = 0; i < 2000; i++) fs.create_file("/idx/entry_" + std::to_string(i));
+    for (int i = 0; i < 2000; i++) fs.delete_file("/idx/entry_" + std::to_string(i));
+    ASSERT(fs.get_stats("/idx").file_size < 12 * 4096, "Emptied directory is smaller than its direct blocks");
+
+    fs.delete_file("/idx");
+    ASSERT(fs.get_free_block_count() == fresh_free_blocks, "delete_file frees every bucket of an indexed directory");
+    ASSERT(fs.check().clean(), "No blocks leaked");
+
+    cleanup_file(TEST_IMG);
+}
+
+void test_compact_entries() {
+    std::cout << "\n=== Path Tests: Variable-Length Entries ===\n";
+    const char* TEST_IMG = "test_paths_compact.img";
+    cleanup_file(TEST_IMG);
+
+    Disk disk(16 * 1024 * 1024, TEST_IMG);
+    FileSystem fs(disk);
+    fs.format();
+
+    // 150 short names used to need 10 fixed-size blocks; now they share one
+    size_t free_before = fs.get_free_block_count();
+    fs.create_dir("/packed");
+    for (int i = 0; i < 150; i++) {
+        fs.create_file("/packed/f" + std::to_string(i));
+    }
+    ASSERT(fs.get_free_block_count() == free_before - 1, "150 short entries fit in a single directory block");
+
+    // Maximum-length names still round-trip
+    std::string long_name(255, 'n');
+    fs.create_file("/packed/" + long_name);
+    ASSERT(fs.get_stats("/packed/" + long_name).file_type == FS_FILE, "255-character name is stored in full");
+
+    bool found = false;
+    for (const auto& entry : fs.list_dir("/packed")) {
+        if (entry.name == long_name) found = true;
+    }
+    ASSERT(found, "255-character name listed intact");
+
+    // Freed record space is reused by later inserts
+    for (int i = 0; i < 150; i++) fs.delete_file("/packed/f" + std::to_string(i));
+    for (int i = 0; i < 150; i++) fs.create_file("/packed/g" + std::to_string(i));
+    ASSERT(fs.list_dir("/packed").size() == 151, "Deleted records are reclaimed");
+
+    cleanup_file(TEST_IMG);
+}
+
+void test_path_normalization() {
+    std::cout << "\n=== Path Tests: In-Place Component Walk ===\n";
+    PathIterator it("//a///b/./c/");
+    std::string_view part;
+    std::vector<std::string> parts;
+    while (it.next(part)) parts.emplace_back(part);
+    ASSERT((parts == std::vector<std::string>{"a", "b", ".", "c"}), "Empty components are skipped, dots kept");
+    ASSERT(tokenize_path("/", '/').empty(), "Root has no components");
+
+    const char* TEST_IMG = "test_paths_norm.img";
+    cleanup_file(TEST_IMG);
+
+    Disk disk(16 * 1024 * 1024, TEST_IMG);
+    FileSystem fs(disk);
+    fs.format();
+
+    fs.create_dir("/a");
+    fs.create_dir("/a/b");
+    fs.create_file("/a/b/file.txt");
+    fs.write_file("/a/b/file.txt", {'o', 'k'});
+
+    ASSERT(fs.read_file("//a//b///file.txt").size() == 2, "Repeated slashes resolve");
+    ASSERT(fs.read_file("/a/./b/../b/file.txt").size() == 2, "Dot and dot-dot resolve");
+    ASSERT(fs.read_file("/../../a/b/file.txt").size() == 2, "Dot-dot at root stays at root");
+    ASSERT(fs.list_dir("/a/b/").size() == 1, "Trailing slash lists the directory");
+
+    fs.create_symlink("/a/b", "/a/link");
+    ASSERT(fs.read_file("/a/link/../b/file.txt").size() == 2, "Dot-dot after a symlink climbs from its target");
+
+    std::string owned = "/a/b/file.txt";
+    std::string_view view(owned);
+    ASSERT(fs.get_stats(view).file_size == 2, "string_view paths are accepted directly");
+    ASSERT_THROWS(fs.get_stats("/"), "Root itself is not a directory entry");
+
+    cleanup_file(TEST_IMG);
+}
+
+void test_batch_operations() {
+    std::cout << "\n=== Path Tests: Batch Operations ===\n";
+    const char* TEST_IMG = "test_paths_batch.img";
+    cleanup_file(TEST_IMG);
+
+    const size_t DISK_SIZE = 64 * 1024 * 1024;
+    const int file_count = 3000; // Several chunks, and an indexed directory
+    std::vector<std::string> names;
+    for (int i = 0; i < file_count; i++) names.push_back("entry_" + std::to_string(i));
+    size_t free_inodes = 0;
+
+    {
+        Disk disk(DISK_SIZE, TEST_IMG);
+        FileSystem fs(disk);
+        fs.format();
+        fs.create_dir("/bulk");
+        free_inodes = fs.get_free_inode_count();
+
+        std::vector<size_t> ids = fs.create_many("/bulk", names);
+        ASSERT(ids.size() == file_count && fs.list_dir("/bulk").size() == file_count, "create_many adds every name");
+        ASSERT(fs.get_free_inode_count() == free_inodes - file_count, "One inode per created entry");
+
+        ASSERT_THROWS(fs.create_many("/bulk", {"fresh", "entry_5"}), "create_many rejects existing names");
+        ASSERT_THROWS(fs.create_many("/bulk", {"twin", "twin"}), "create_many rejects duplicates in the batch");
+        ASSERT_THROWS(fs.create_many("/bulk", {"a/b"}), "create_many rejects paths as names");
+        ASSERT(fs.stat_many({"/bulk/fresh", "/bulk/twin"})[0].inode_id != 0 &&
+               fs.get_free_inode_count() == free_inodes - file_count - 2,
+               "Names ahead of a rejected one are created");
+        fs.unlink_many("/bulk", {"fresh", "twin"});
+
+        // The bad name in the middle of a chunk: its predecessors exist, the
+        // rest of the batch does not
+        std::vector<std::string> mixed;
+        for (int i = 0; i < 300; i++) mixed.push_back(i == 100 ? "entry_7" : "mixed_" + std::to_string(i));
+        ASSERT_THROWS(fs.create_many("/bulk", mixed), "create_many stops at an existing name mid-chunk");
+        std::vector<FileStats> mixed_stats = fs.stat_many({"/bulk/mixed_0", "/bulk/mixed_99", "/bulk/mixed_101"});
+        ASSERT(mixed_stats[0].inode_id != 0 && mixed_stats[1].inode_id != 0 && mixed_stats[2].inode_id == 0 &&
+               fs.get_free_inode_count() == free_inodes - file_count - 100,
+               "Entries up to the bad name are created, none after it");
+        std::vector<std::string> mixed_created(mixed.begin(), mixed.begin() + 100);
+        ASSERT(fs.unlink_many("/bulk", mixed_created) == 100, "Partially created batch is removable");
+
+        fs.chmod("/bulk", 0755);
+        fs.login(1000, 1000);
+        ASSERT_THROWS(fs.create_many("/bulk", {"intruder"}), "create_many needs write permission on the parent");
+        fs.logout();
+        ASSERT(fs.stat_many({"/bulk/intruder"})[0].inode_id == 0, "Nothing created without permission");
+
+        std::vector<std::string> paths = {"/bulk/entry_0", "/bulk/entry_2999", "/bulk/missing", "/bulk", "/"};
+        std::vector<FileStats> stats = fs.stat_many(paths);
+        ASSERT(stats.size() == paths.size() && stats[0].inode_id == ids[0] && stats[1].inode_id == ids[2999],
+               "stat_many resolves entries of a shared parent");
+        ASSERT(stats[2].inode_id == 0 && stats[4].inode_id == 0, "Missing paths and / yield inode_id 0");
+        ASSERT(stats[3].file_type == FS_DIRECTORY && stats[0].file_type == FS_FILE, "stat_many reports types");
+
+        fs.create_many("/bulk", {"sub1", "sub2"}, FS_DIRECTORY);
+        fs.create_file("/bulk/sub1/inner");
+        ASSERT(fs.list_dir("/bulk/sub1").size() == 1, "Directories made by create_many are usable");
+        ASSERT_THROWS(fs.unlink_many("/bulk", {"sub2"}), "unlink_many refuses directories");
+
+        std::vector<std::string> victims;
+        for (int i = 0; i < file_count; i += 2) victims.push_back(names[i]);
+        victims.push_back("never_existed");
+        ASSERT(fs.unlink_many("/bulk", victims) == file_count / 2, "unlink_many removes the existing names");
+        ASSERT(fs.list_dir("/bulk").size() == file_count / 2 + 2, "Removed entries are gone");
+    }
+    {
+        Disk disk(DISK_SIZE, TEST_IMG);
+        FileSystem fs(disk);
+        fs.mount();
+        ASSERT(fs.list_dir("/bulk").size() == file_count / 2 + 2, "Batch results persist");
+        ASSERT(fs.get_free_inode_count() == free_inodes - file_count / 2 - 3, "Inode counters persist");
+    }
+
+    cleanup_file(TEST_IMG);
+}
+
+void test_deferred_reclaim() {
+    std::cout << "\n=== Path Tests: Deferred Tree Reclaim ===\n";
+    const char* TEST_IMG = "test_paths_reclaim.img";
+    cleanup_file(TEST_IMG);
+
+    Disk disk(64 * 1024 * 1024, TEST_IMG);
+    FileSystem fs(disk);
+    fs.format();
+    size_t free_blocks = fs.get_free_block_count();
+    size_t free_inodes = fs.get_free_inode_count();
+
+    // Files reaching into the double indirect tree, one with a hole
+    auto build_tree = [&]() {
+        fs.create_dir("/tree");
+        std::vector<uint8_t> data(1100 * 4096, 0x42);
+        for (int d = 0; d < 4; d++) {
+            std::string dir = "/tree/d" + std::to_string(d);
+            fs.create_dir(dir);
+            fs.create_dir(dir + "/nested");
+            fs.create_many(dir + "/nested", {"x", "y", "z"});
+            fs.create_file(dir + "/big");
+            fs.write_file(dir + "/big", data);
+        }
+        fs.truncate("/tree/d0/big", 5000);
+        fs.truncate("/tree/d0/big", 2000 * 4096);
+        fs.create_symlink("/tree/d1", "/tree/link");
+    };
+
+    build_tree();
+    fs.delete_dir("/tree");
+    ASSERT(fs.list_dir("/").empty() && fs.stat_many({"/tree"})[0].inode_id == 0, "delete_dir unlinks at once");
+    ASSERT(fs.get_free_block_count() == free_blocks && fs.get_free_inode_count() == free_inodes,
+           "Every block and inode of the tree comes back");
+
+    // Reclaimed by the metadata operations that follow it
+    build_tree();
+    fs.delete_dir("/tree");
+    for (int i = 0; i < 8; i++) fs.create_file("/after" + std::to_string(i));
+    fs.unlink_many("/", {"after0", "after1", "after2", "after3", "after4", "after5", "after6", "after7"});
+    ASSERT(fs.get_free_block_count() == free_blocks && fs.get_free_inode_count() == free_inodes,
+           "Counters stay exact when operations run between delete and reclaim");
+
+    fs.set_background_reclaim(true);
+    build_tree();
+    fs.delete_dir("/tree");
+    fs.reclaim_deferred_frees();
+    ASSERT(fs.get_free_block_count() == free_blocks && fs.get_free_inode_count() == free_inodes,
+           "The background reclaimer frees the tree");
+    build_tree();
+    ASSERT(fs.list_dir("/tree/d3/nested").size() == 3, "The same names can be created again");
+    fs.set_background_reclaim(false);
+
+    cleanup_file(TEST_IMG);
+}
+
 // ==========================================
 // MAIN
 // ==========================================
@@ -231,6 +514,12 @@ int main() {
         test_directory_entry_limits();
         test_complex_tree();
         test_path_traversal_errors();
+        test_indexed_directory();
+        test_indexed_directory_unlink();
+        test_compact_entries();
+        test_path_normalization();
+        test_batch_operations();
+        test_deferred_reclaim();
     } catch (const std::exception& e) {
         std::cerr << "\n[CRITICAL FAILURE] Uncaught Exception: " << e.what() << "\n";
         return 1;
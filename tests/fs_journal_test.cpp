@@ -0,0 +1,340 @@
+#include "fs/filesystem.hpp"
+#include "fs/disk.hpp"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdio>
+
+#define ASSERT(condition, message) \
+    if (!(condition)) { \
+        std::cerr << "[FAIL] " << message << " (" << #condition << ")\n"; \
+        std::exit(1); \
+    } else { \
+        std::cout << "[PASS] " << message << "\n"; \
+    }
+
+const char* TEST_IMG = "test_journal.img";
+const size_t DISK_SIZE = 16 * 1024 * 1024;
+
+// A crashed session is never unmounted: its FileSystem is parked here so the
+// destructor (which commits and checkpoints) does not run. A plain global
+// array keeps them reachable for leak checkers until exit.
+FileSystem* crashed_sessions[8];
+size_t crashed_count = 0;
+// Disks of sessions that crashed mid-flush: never destroyed, so the image
+// file keeps exactly the blocks the test chose to write
+Disk* crashed_disks[4];
+size_t crashed_disk_count = 0;
+
+std::vector<uint8_t> snapshot(Disk& disk) {
+    size_t bytes = disk.get_block_count() * disk.get_block_size();
+    return std::vector<uint8_t>(disk.get_ptr(0), disk.get_ptr(0) + bytes);
+}
+
+// Simulates a crash right after the last commit: none of the in-place
+// metadata writes since `before` reached the disk, only the journal did.
+void lose_home_writes(Disk& disk, const std::vector<uint8_t>& before) {
+    const SuperBlock* sb = reinterpret_cast<const SuperBlock*>(disk.get_ptr(0));
+    size_t block_size = disk.get_block_size();
+    for (size_t b = 0; b < disk.get_block_count(); b++) {
+        if (b >= sb->journal_start && b < sb->journal_start + sb->journal_blocks) continue;
+        std::memcpy(disk.get_ptr(b), before.data() + b * block_size, block_size);
+    }
+}
+
+// Simulates a crash part way through writing home blocks: of the blocks the
+// disk may write (unheld ones whose memory differs from the file), only
+// every `stride`-th starting at `first` reaches the image file.
+size_t write_some_home_blocks(Disk& disk, size_t first, size_t stride) {
+    const SuperBlock* sb = reinterpret_cast<const SuperBlock*>(disk.get_ptr(0));
+    size_t journal_start = sb->journal_start;
+    size_t journal_end = journal_start + sb->journal_blocks;
+    size_t block_size = disk.get_block_size();
+    std::FILE* file = std::fopen(TEST_IMG, "r+b");
+    std::vector<uint8_t> on_file(block_size);
+    size_t candidates = 0;
+    size_t written = 0;
+    for (size_t b = 0; b < disk.get_block_count(); b++) {
+        if ((b >= journal_start && b < journal_end) || disk.is_held(b)) continue;
+        Disk::PinScope pins(disk);
+        const uint8_t* memory = disk.get_ptr(static_cast<int>(b));
+        std::fseek(file, static_cast<long>(b * block_size), SEEK_SET);
+        if (std::fread(on_file.data(), 1, block_size, file) != block_size) break;
+        if (std::memcmp(memory, on_file.data(), block_size) == 0) continue;
+        if (candidates++ % stride != first) continue;
+        std::fseek(file, static_cast<long>(b * block_size), SEEK_SET);
+        std::fwrite(memory, 1, block_size, file);
+        written++;
+    }
+    std::fclose(file);
+    return written;
+}
+
+bool has_entry(FileSystem& fs, const std::string& dir, const std::string& name) {
+    for (const auto& e : fs.list_dir(dir)) {
+        if (e.name == name) return true;
+    }
+    return false;
+}
+
+// ==========================================
+// JOURNAL TESTS
+// ==========================================
+void test_replay_after_crash() {
+    std::cout << "\n=== Journal Tests: Replay ===\n";
+    std::remove(TEST_IMG);
+    Disk disk(DISK_SIZE, TEST_IMG);
+    FileSystem* fs = new FileSystem(disk);
+    fs->format();
+    std::vector<uint8_t> formatted = snapshot(disk);
+
+    fs->create_dir("/docs");
+    for (int i = 0; i < 100; i++) fs->create_file("/docs/f" + std::to_string(i));
+    fs->create_symlink("/docs/f1", "/link");
+    fs->chmod("/docs/f7", 0600);
+    fs->delete_file("/docs/f3");
+    size_t free_blocks = fs->get_free_block_count();
+    size_t free_inodes = fs->get_free_inode_count();
+    fs->sync();
+
+    lose_home_writes(disk, formatted);
+    crashed_sessions[crashed_count++] = fs;
+
+    FileSystem remounted(disk);
+    remounted.mount();
+    ASSERT(remounted.list_dir("/docs").size() == 99, "Directory entries are replayed");
+    ASSERT(has_entry(remounted, "/docs", "f99") && !has_entry(remounted, "/docs", "f3"),
+           "Creates and deletes come back in order");
+    ASSERT(remounted.get_stats("/docs/f7").permissions == 0600, "Inode updates are replayed");
+    ASSERT(remounted.get_stats("/link").symlink_target == "/docs/f1", "Symlink data block is replayed");
+    ASSERT(remounted.get_free_block_count() == free_blocks, "Block bitmaps and counters are replayed");
+    ASSERT(remounted.get_free_inode_count() == free_inodes, "Inode bitmaps and counters are replayed");
+
+    remounted.create_file("/docs/after");
+    ASSERT(has_entry(remounted, "/docs", "after"), "Replayed file system accepts new work");
+}
+
+void test_uncommitted_work_is_dropped() {
+    std::cout << "\n=== Journal Tests: Uncommitted Work ===\n";
+    std::remove(TEST_IMG);
+    Disk disk(DISK_SIZE, TEST_IMG);
+    FileSystem* fs = new FileSystem(disk);
+    fs->format();
+    std::vector<uint8_t> formatted = snapshot(disk);
+
+    fs->create_file("/kept");
+    fs->sync();
+    fs->create_file("/lost");
+
+    lose_home_writes(disk, formatted);
+    crashed_sessions[crashed_count++] = fs;
+
+    FileSystem remounted(disk);
+    remounted.mount();
+    ASSERT(has_entry(remounted, "/", "kept"), "Work before sync() survives");
+    ASSERT(!has_entry(remounted, "/", "lost"), "Work after the last commit is not replayed");
+}
+
+void test_torn_commit_is_ignored() {
+    std::cout << "\n=== Journal Tests: Torn Commit ===\n";
+    std::remove(TEST_IMG);
+    Disk disk(DISK_SIZE, TEST_IMG);
+    FileSystem* fs = new FileSystem(disk);
+    fs->format();
+    std::vector<uint8_t> formatted = snapshot(disk);
+    size_t free_inodes = fs->get_free_inode_count();
+
+    fs->create_file("/torn");
+    fs->sync();
+
+    // Damage one logged image: the commit checksum no longer matches
+    const SuperBlock* sb = reinterpret_cast<const SuperBlock*>(disk.get_ptr(0));
+    disk.get_ptr(sb->journal_start + 2)[100] ^= 0xFF;
+
+    lose_home_writes(disk, formatted);
+    crashed_sessions[crashed_count++] = fs;
+
+    FileSystem remounted(disk);
+    remounted.mount();
+    ASSERT(!has_entry(remounted, "/", "torn"), "A transaction failing its checksum is not applied");
+    ASSERT(remounted.get_free_inode_count() == free_inodes, "The file system stays at the formatted state");
+}
+
+// Uncommitted metadata never reaches the file, even when the disk writes
+// back everything else it holds
+void test_home_blocks_wait_for_commit() {
+    std::cout << "\n=== Journal Tests: Write-Ahead Order ===\n";
+    std::remove(TEST_IMG);
+    {
+        Disk disk(DISK_SIZE, TEST_IMG);
+        FileSystem fs(disk);
+        fs.format();
+        fs.create_dir("/d");
+    }
+    {
+        Disk disk(DISK_SIZE, TEST_IMG); // Its destructor writes every unheld block
+        FileSystem* fs = new FileSystem(disk);
+        fs->mount();
+        fs->create_file("/x");
+        fs->sync();
+        fs->create_file("/d/y");
+        crashed_sessions[crashed_count++] = fs;
+    }
+
+    Disk disk(DISK_SIZE, TEST_IMG);
+    FileSystem fs(disk);
+    fs.mount();
+    ASSERT(fs.check().clean(), "No half-written transaction is left after the crash");
+    ASSERT(has_entry(fs, "/", "x") && !has_entry(fs, "/d", "y"), "The image holds exactly the synced work");
+    fs.create_file("/z");
+    fs.create_file("/d/y");
+    ASSERT(fs.get_stats("/z").inode_id != fs.get_stats("/d/y").inode_id, "New files get distinct inodes");
+    ASSERT(fs.check().clean(), "Still consistent after new work");
+}
+
+// A crash while committed home blocks are being written back leaves any
+// subset of them on disk; replay must complete every such subset. The run
+// is long enough to wrap the journal, and is repeated under a small cache.
+void test_partial_home_writes() {
+    std::cout << "\n=== Journal Tests: Partial Home Writes ===\n";
+    struct Setup {
+        DiskBackendType backend;
+        size_t cache_blocks;
+        size_t first;
+        size_t stride;
+    };
+    const Setup setups[] = {{DiskBackendType::Mmap, 0, 0, 2}, {DiskBackendType::Mmap, 0, 1, 3},
+                            {DiskBackendType::Pread, 48, 1, 2}};
+
+    for (const Setup& setup : setups) {
+        std::remove(TEST_IMG);
+        {
+            Disk disk(DISK_SIZE, TEST_IMG);
+            FileSystem fs(disk);
+            fs.format();
+            for (int d = 0; d < 8; d++) fs.create_dir("/a" + std::to_string(d));
+        }
+
+        Disk* disk = new Disk(DISK_SIZE, TEST_IMG, setup.backend, setup.cache_blocks);
+        crashed_disks[crashed_disk_count++] = disk;
+        FileSystem* fs = new FileSystem(*disk);
+        crashed_sessions[crashed_count++] = fs;
+        fs->mount();
+
+        auto path = [](int i) { return "/a" + std::to_string(i % 8) + "/f" + std::to_string(i); };
+        const int SYNCED = 400;
+        for (int i = 0; i < 700; i++) {
+            fs->create_file(path(i));
+            if (i % 3 == 0) fs->write_file(path(i), std::vector<uint8_t>(5000, static_cast<uint8_t>(i)));
+            if (i % 7 == 6) fs->delete_file(path(i - 2));
+            if (i == SYNCED - 1) fs->sync();
+        }
+        size_t written = write_some_home_blocks(*disk, setup.first, setup.stride);
+
+        Disk remounted_disk(DISK_SIZE, TEST_IMG);
+        FileSystem remounted(remounted_disk);
+        remounted.mount();
+        std::string label = std::string(disk->get_backend_name()) + ", " + std::to_string(written) + " home blocks: ";
+        ASSERT(remounted.check().clean(), label + "replay completes a partial set of home writes");
+
+        bool synced_present = true;
+        for (int i = 0; i < SYNCED; i++) {
+            bool deleted = (i + 2) % 7 == 6 && i + 2 < SYNCED;
+            size_t slash = path(i).rfind('/');
+            if (has_entry(remounted, path(i).substr(0, slash), path(i).substr(slash + 1)) == deleted) synced_present = false;
+        }
+        ASSERT(synced_present, label + "every file created before sync() is there, every deleted one gone");
+        remounted.create_file("/after");
+        ASSERT(remounted.check().clean(), label + "consistent after new work");
+    }
+}
+
+// delete_dir only unlinks; the tree waits on the orphan chain, which is
+// committed with the unlink. A crash before or part way through the
+// reclaim must not leak the tree: mount() finishes it.
+void test_removed_tree_survives_crash() {
+    std::cout << "\n=== Journal Tests: Removed Tree ===\n";
+    for (bool partly_reclaimed : {false, true}) {
+        std::remove(TEST_IMG);
+        size_t free_blocks = 0;
+        size_t free_inodes = 0;
+        {
+            Disk disk(DISK_SIZE, TEST_IMG);
+            FileSystem fs(disk);
+            fs.format();
+            fs.create_file("/keep");
+            free_blocks = fs.get_free_block_count();
+            free_inodes = fs.get_free_inode_count();
+            fs.create_dir("/t");
+            for (int d = 0; d < 3; d++) {
+                std::string dir = "/t/d" + std::to_string(d);
+                fs.create_dir(dir);
+                for (int i = 0; i < 150; i++) fs.create_file(dir + "/f" + std::to_string(i));
+                fs.write_file(dir + "/f0", std::vector<uint8_t>(20000, 'x'));
+            }
+        }
+        {
+            Disk disk(DISK_SIZE, TEST_IMG); // Its destructor writes every unheld block
+            FileSystem* fs = new FileSystem(disk);
+            fs->mount();
+            fs->delete_dir("/t");
+            fs->fsync("/keep"); // Commits the unlink without reclaiming
+            if (partly_reclaimed) {
+                fs->create_file("/other"); // Pays off one reclaim chunk first
+                fs->fsync("/keep");
+                free_inodes--;
+            }
+            crashed_sessions[crashed_count++] = fs;
+        }
+
+        Disk disk(DISK_SIZE, TEST_IMG);
+        FileSystem fs(disk);
+        fs.mount();
+        std::string label = partly_reclaimed ? "Partly reclaimed tree: " : "Unlinked tree: ";
+        ASSERT(fs.check().clean(), label + "mount finishes the reclaim");
+        ASSERT(fs.get_free_block_count() == free_blocks && fs.get_free_inode_count() == free_inodes,
+               label + "every block and inode of the tree is free again");
+    }
+}
+
+void test_clean_unmount() {
+    std::cout << "\n=== Journal Tests: Clean Unmount ===\n";
+    std::remove(TEST_IMG);
+    {
+        Disk disk(DISK_SIZE, TEST_IMG);
+        FileSystem fs(disk);
+        fs.format();
+        for (int i = 0; i < 300; i++) fs.create_file("/n" + std::to_string(i));
+        fs.write_file("/n0", std::vector<uint8_t>(10000, 'x'));
+    }
+
+    Disk disk(DISK_SIZE, TEST_IMG);
+    FileSystem fs(disk);
+    fs.mount();
+    ASSERT(fs.list_dir("/").size() == 300, "Group commits across many operations persist");
+    ASSERT(fs.read_file("/n0") == std::vector<uint8_t>(10000, 'x'), "File data persists across unmount");
+}
+
+int main() {
+    std::cout << "STARTING FILESYSTEM JOURNAL TEST SUITE\n";
+    std::cout << "======================================\n";
+
+    try {
+        test_replay_after_crash();
+        test_uncommitted_work_is_dropped();
+        test_torn_commit_is_ignored();
+        test_home_blocks_wait_for_commit();
+        test_partial_home_writes();
+        test_removed_tree_survives_crash();
+        test_clean_unmount();
+    } catch (const std::exception& e) {
+        std::cerr << "\n[CRITICAL FAILURE] Uncaught Exception: " << e.what() << "\n";
+        return 1;
+    }
+
+    std::remove(TEST_IMG);
+    std::cout << "\n======================================\n";
+    std::cout << "ALL JOURNAL TESTS PASSED.\n";
+    return 0;
+}
@@ -1,5 +1,6 @@
 #include "fs/filesystem.hpp"
 #include "fs/disk.hpp"
+#include "fs/logger.hpp"
 #include <iostream>
 #include <vector>
 #include <string>
@@ -119,6 +120,34 @@ void test_file_creation() {
     cleanup_file(TEST_IMG);
 }
 
+void test_logger() {
+    std::cout << "\n=== FS Tests: Logger ===\n";
+    const char* TEST_IMG = "test_fs_logger.img";
+    cleanup_file(TEST_IMG);
+
+    Disk disk(16 * 1024 * 1024, TEST_IMG);
+    FileSystem fs(disk);
+    fs.format();
+
+    std::vector<std::string> messages;
+    Logger::set_sink([&](LogLevel, const std::string& message) { messages.push_back(message); });
+    fs.create_file("/logged.txt");
+    fs.chmod("/logged.txt", 0600);
+    ASSERT(messages.size() == 2 && messages[0] == "File 'logged.txt' created.", "A sink receives operation messages");
+    ASSERT(messages[1] == "Permissions changed to 0600", "Messages are formatted in full");
+
+    Logger::set_sink([&](LogLevel, const std::string& message) { messages.push_back(message); }, LogLevel::Warning);
+    fs.delete_file("/logged.txt");
+    ASSERT(messages.size() == 2, "Messages below the threshold are dropped");
+    ASSERT(!Logger::enabled(LogLevel::Info) && Logger::enabled(LogLevel::Error), "Threshold is reported");
+
+    Logger::clear_sink();
+    fs.create_file("/quiet.txt");
+    ASSERT(messages.size() == 2 && !Logger::enabled(LogLevel::Error), "Without a sink the library is silent");
+
+    cleanup_file(TEST_IMG);
+}
+
 void test_file_write_read() {
     std::cout << "\n=== FS Tests: File Write/Read ===\n";
     const char* TEST_IMG = "test_fs_write.img";
@@ -379,6 +408,489 @@ void test_mixed_operations() {
 // ==========================================
 // MAIN
 // ==========================================
+void test_offset_io() {
+    std::cout << "\n=== FS Tests: Offset Read/Write ===\n";
+    const char* TEST_IMG = "test_fs_offset.img";
+    cleanup_file(TEST_IMG);
+
+    Disk disk(16 * 1024 * 1024, TEST_IMG);
+    FileSystem fs(disk);
+    fs.format();
+    fs.create_file("/log.txt");
+
+    // Appends touch only the tail: no blocks are reallocated along the way
+    std::string line = "entry\n";
+    size_t free_before = fs.get_free_block_count();
+    for (int i = 0; i < 1000; i++) {
+        fs.append("/log.txt", reinterpret_cast<const uint8_t*>(line.data()), line.size());
+    }
+    ASSERT(fs.get_stats("/log.txt").file_size == 6000, "Appends grow the file");
+    ASSERT(fs.get_free_block_count() == free_before - 2, "6000 bytes of appends use exactly 2 blocks");
+
+    // Read a range that straddles the block boundary
+    uint8_t buf[16];
+    size_t n = fs.read_at("/log.txt", 4092, buf, sizeof(buf));
+    ASSERT(n == 16 && buf[0] == line[4092 % 6] && buf[15] == line[4107 % 6], "Cross-block read returns the full range");
+    ASSERT(fs.read_at("/log.txt", 5996, buf, sizeof(buf)) == 4, "Read is clipped at EOF");
+    ASSERT(fs.read_at("/log.txt", 7000, buf, sizeof(buf)) == 0, "Read past EOF returns 0");
+
+    // Overwrite in the middle keeps the size and the surrounding bytes
+    fs.write_at("/log.txt", 4094, reinterpret_cast<const uint8_t*>("XY"), 2);
+    auto whole = fs.read_file("/log.txt");
+    ASSERT(whole.size() == 6000 && whole[4094] == 'X' && whole[4095] == 'Y' && whole[4096] == line[4096 % 6],
+           "In-place overwrite across a boundary");
+
+    // Writing past EOF leaves a zero-filled hole
+    fs.write_at("/log.txt", 20000, reinterpret_cast<const uint8_t*>("Z"), 1);
+    n = fs.read_at("/log.txt", 12000, buf, 8);
+    ASSERT(n == 8 && buf[0] == 0 && buf[7] == 0, "Hole reads back as zeros");
+    ASSERT(fs.get_stats("/log.txt").file_size == 20001, "Sparse write extends the size");
+
+    // Truncate frees blocks and zeroes the tail for later growth
+    fs.truncate("/log.txt", 10);
+    ASSERT(fs.get_free_block_count() == free_before - 1, "Truncate releases trailing blocks");
+    fs.truncate("/log.txt", 100);
+    n = fs.read_at("/log.txt", 0, buf, 16);
+    ASSERT(n == 16 && buf[9] == line[3] && buf[10] == 0, "Regrown range reads as zeros");
+
+    fs.truncate("/log.txt", 0);
+    ASSERT(fs.get_free_block_count() == free_before, "Truncate to zero frees everything");
+
+    // Indirect range and limits
+    std::vector<uint8_t> big(4096 * 20, 'b');
+    fs.write_at("/log.txt", 0, big.data(), big.size());
+    fs.truncate("/log.txt", 4096 * 12);
+    ASSERT(fs.get_free_block_count() == free_before - 12, "Truncate below the indirect range frees the indirect block");
+    const size_t max_blocks = 12 + 512 + 512 * 512 + 512ull * 512 * 512;
+    ASSERT_THROWS(fs.write_at("/log.txt", 4096 * max_blocks, big.data(), 1), "Offset past the triple indirect tree is rejected");
+
+    fs.create_dir("/d");
+    ASSERT_THROWS(fs.append("/d", buf, 1), "Offset I/O on a directory is rejected");
+
+    cleanup_file(TEST_IMG);
+}
+
+void test_file_handles() {
+    std::cout << "\n=== FS Tests: File Handles ===\n";
+    const char* TEST_IMG = "test_fs_handles.img";
+    cleanup_file(TEST_IMG);
+
+    Disk disk(16 * 1024 * 1024, TEST_IMG);
+    FileSystem fs(disk);
+    fs.format();
+    fs.create_file("/data.bin");
+
+    int fd = fs.open("/data.bin", FS_OPEN_READ | FS_OPEN_WRITE);
+    ASSERT(fd == 0, "First handle is 0");
+
+    // Sequential writes advance the handle offset into the indirect range
+    std::vector<uint8_t> chunk(1000);
+    for (int i = 0; i < 100; i++) {
+        std::fill(chunk.begin(), chunk.end(), static_cast<uint8_t>(i));
+        fs.write(fd, chunk.data(), chunk.size());
+    }
+    ASSERT(fs.get_stats("/data.bin").file_size == 100000, "Handle writes extend the file");
+
+    uint8_t buf[1000];
+    fs.seek(fd, 57000);
+    ASSERT(fs.read(fd, buf, sizeof(buf)) == 1000 && buf[0] == 57 && buf[999] == 57, "Seek + read through handle");
+    ASSERT(fs.read_at(fd, 99999, buf, 10) == 1 && buf[0] == 99, "Handle read_at clipped at EOF");
+
+    // Path and handle views stay coherent after blocks are freed and reused
+    fs.truncate("/data.bin", 0);
+    fs.create_file("/other.bin");
+    std::vector<uint8_t> other(60000, 0xEE);
+    fs.write_file("/other.bin", other);
+    ASSERT(fs.read_at(fd, 0, buf, 10) == 0, "Handle sees truncation");
+    fs.write_at(fd, 50000, reinterpret_cast<const uint8_t*>("k"), 1);
+    ASSERT(fs.read_at(fd, 49999, buf, 2) == 2 && buf[0] == 0 && buf[1] == 'k', "Stale block map was dropped");
+
+    // Access mode is fixed at open
+    int ro = fs.open("/data.bin", FS_OPEN_READ);
+    ASSERT(ro == 1, "Second handle is 1");
+    ASSERT_THROWS(fs.write(ro, buf, 1), "Read-only handle rejects writes");
+    fs.close(ro);
+    ASSERT_THROWS(fs.read(ro, buf, 1), "Closed handle is rejected");
+    ASSERT(fs.open("/data.bin", FS_OPEN_READ) == 1, "Lowest free slot is reused");
+
+    // Append mode always writes at EOF
+    int ap = fs.open("/other.bin", FS_OPEN_WRITE | FS_OPEN_APPEND);
+    fs.seek(ap, 0);
+    fs.write(ap, reinterpret_cast<const uint8_t*>("!"), 1);
+    ASSERT(fs.get_stats("/other.bin").file_size == 60001, "Append handle ignores the seek position");
+
+    // Permissions are checked once, at open()
+    fs.chmod("/other.bin", 0600);
+    fs.chown("/other.bin", 0);
+    fs.login(1000, 1000);
+    ASSERT_THROWS(fs.open("/other.bin", FS_OPEN_READ), "Open checks permissions");
+    ASSERT(fs.write(ap, reinterpret_cast<const uint8_t*>("?"), 1) == 1, "Existing handle keeps its access");
+    fs.logout();
+
+    // Deleting the file invalidates its handles
+    fs.delete_file("/data.bin");
+    ASSERT_THROWS(fs.read(fd, buf, 1), "Handle of a deleted file is rejected");
+    ASSERT_THROWS(fs.open("/missing", FS_OPEN_READ), "Opening a missing file fails");
+    ASSERT_THROWS(fs.open("/other.bin", 0), "Open without an access mode fails");
+
+    cleanup_file(TEST_IMG);
+}
+
+void test_multi_level_indirect() {
+    std::cout << "\n=== FS Tests: Double and Triple Indirect Blocks ===\n";
+    const char* TEST_IMG = "test_fs_indirect.img";
+    cleanup_file(TEST_IMG);
+
+    Disk disk(64 * 1024 * 1024, TEST_IMG);
+    FileSystem fs(disk);
+    fs.format();
+    size_t free_before = fs.get_free_block_count();
+
+    // 8MB = 2048 blocks: direct + single (524) + 1524 through double indirect
+    fs.create_file("/big.bin");
+    auto big = generate_data(2048 * 4096);
+    fs.write_file("/big.bin", big);
+    ASSERT(fs.read_file("/big.bin") == big, "8MB file round-trips through double indirect");
+
+    // data blocks + 1 single + 1 double root + 3 second-level tables
+    ASSERT(fs.get_free_block_count() == free_before - 2048 - 1 - 1 - 3, "Indirect overhead is as expected");
+
+    // Random access inside the double indirect range
+    uint8_t buf[64];
+    fs.read_at("/big.bin", 1500 * 4096 + 17, buf, sizeof(buf));
+    ASSERT(std::equal(buf, buf + sizeof(buf), big.begin() + 1500 * 4096 + 17), "Offset read in double indirect range");
+
+    // A single byte in the triple indirect range costs three tables and one block
+    fs.create_file("/sparse.bin");
+    size_t free_mid = fs.get_free_block_count();
+    const size_t triple_start = 12 + 512 + 512 * 512;
+    fs.write_at("/sparse.bin", triple_start * 4096 + 5, reinterpret_cast<const uint8_t*>("T"), 1);
+    ASSERT(fs.get_free_block_count() == free_mid - 4, "Sparse triple indirect write allocates 4 blocks");
+    ASSERT(fs.read_at("/sparse.bin", triple_start * 4096 + 5, buf, 1) == 1 && buf[0] == 'T', "Triple indirect byte reads back");
+    ASSERT(fs.read_at("/sparse.bin", 4096, buf, 8) == 8 && buf[0] == 0, "Leading hole reads as zeros");
+
+    // Truncating into the double range prunes the tables that map nothing
+    fs.truncate("/big.bin", 600 * 4096);
+    ASSERT(fs.get_free_block_count() == free_before - 4 - 600 - 1 - 1 - 1, "Truncate prunes emptied indirect tables");
+    ASSERT(fs.read_file("/big.bin") == std::vector<uint8_t>(big.begin(), big.begin() + 600 * 4096),
+           "Truncated prefix is intact");
+
+    // Remount: the cached map is rebuilt from disk
+    fs.mount();
+    fs.read_at("/big.bin", 599 * 4096, buf, sizeof(buf));
+    ASSERT(std::equal(buf, buf + sizeof(buf), big.begin() + 599 * 4096), "Data readable after remount");
+
+    fs.delete_file("/big.bin");
+    fs.delete_file("/sparse.bin");
+    ASSERT(fs.get_free_block_count() == free_before, "Deleting frees every data and indirect block");
+
+    cleanup_file(TEST_IMG);
+}
+
+void test_extent_files() {
+    std::cout << "\n=== FS Tests: Extent-Mapped Files ===\n";
+    const char* TEST_IMG = "test_fs_extents.img";
+    cleanup_file(TEST_IMG);
+
+    {
+        Disk disk(32 * 1024 * 1024, TEST_IMG);
+        FileSystem fs(disk);
+        fs.format();
+        size_t free_before = fs.get_free_block_count();
+
+        // A contiguous 4MB file needs no pointer blocks at all
+        fs.create_file("/ext.bin", true);
+        ASSERT(fs.get_stats("/ext.bin").flags & INODE_FLAG_EXTENTS, "File created extent-mapped");
+        auto data = generate_data(1024 * 4096);
+        fs.write_file("/ext.bin", data);
+        ASSERT(fs.get_free_block_count() == free_before - 1024, "4MB extent file costs only its data blocks");
+        ASSERT(fs.read_file("/ext.bin") == data, "Extent file round-trips");
+
+        // Appends continue the last extent
+        std::vector<uint8_t> chunk(4096, 0xAB);
+        for (int i = 0; i < 16; i++) fs.append("/ext.bin", chunk.data(), chunk.size());
+        ASSERT(fs.get_free_block_count() == free_before - 1040, "Appends extend the run in place");
+
+        // Sparse write leaves a hole, truncate trims the runs
+        fs.write_at("/ext.bin", 2000 * 4096, chunk.data(), 10);
+        uint8_t buf[16];
+        ASSERT(fs.read_at("/ext.bin", 1500 * 4096, buf, 16) == 16 && buf[0] == 0, "Extent hole reads as zeros");
+        fs.truncate("/ext.bin", 512 * 4096 + 1);
+        ASSERT(fs.get_free_block_count() == free_before - 513, "Truncate frees whole and partial extents");
+        ASSERT(fs.read_at("/ext.bin", 511 * 4096, buf, 16) == 16 && std::equal(buf, buf + 16, data.begin() + 511 * 4096),
+               "Data before the cut survives");
+    }
+
+    // Survives remount
+    {
+        Disk disk(32 * 1024 * 1024, TEST_IMG);
+        FileSystem fs(disk);
+        fs.mount();
+        auto data = generate_data(1024 * 4096);
+        auto back = fs.read_file("/ext.bin");
+        ASSERT(back.size() == 512 * 4096 + 1 && std::equal(back.begin(), back.end() - 1, data.begin()),
+               "Extent map persists across remount");
+
+        // Interleaved appends fragment both files past the inline table;
+        // the extent file falls back to block pointers without losing data
+        fs.create_file("/frag.bin", true);
+        fs.create_file("/other.bin");
+        std::vector<uint8_t> expect;
+        for (int i = 0; i < 20; i++) {
+            std::vector<uint8_t> piece(4096, static_cast<uint8_t>(i));
+            fs.append("/frag.bin", piece.data(), piece.size());
+            fs.append("/other.bin", piece.data(), piece.size());
+            expect.insert(expect.end(), piece.begin(), piece.end());
+        }
+        ASSERT(!(fs.get_stats("/frag.bin").flags & INODE_FLAG_EXTENTS), "Fragmented file converted to block pointers");
+        ASSERT(fs.read_file("/frag.bin") == expect, "Converted file keeps its data");
+
+        size_t free_before = fs.get_free_block_count();
+        fs.delete_file("/ext.bin");
+        ASSERT(fs.get_free_block_count() == free_before + 513, "Deleting an extent file frees its runs");
+    }
+
+    cleanup_file(TEST_IMG);
+}
+
+void test_inline_data() {
+    std::cout << "\n=== FS Tests: Inline Data and Fast Symlinks ===\n";
+    const char* TEST_IMG = "test_fs_inline.img";
+    cleanup_file(TEST_IMG);
+
+    {
+        Disk disk(16 * 1024 * 1024, TEST_IMG);
+        FileSystem fs(disk);
+        fs.format();
+        size_t free_before = fs.get_free_block_count();
+
+        // Tiny files live in the inode
+        fs.create_file("/tiny.txt");
+        std::vector<uint8_t> small(100, 's');
+        fs.write_file("/tiny.txt", small);
+        ASSERT(fs.get_stats("/tiny.txt").flags & INODE_FLAG_INLINE, "Small file stays inline");
+        ASSERT(fs.get_free_block_count() == free_before, "Inline file uses no data block");
+        ASSERT(fs.read_file("/tiny.txt") == small, "Inline file round-trips");
+
+        // Growing past the inode moves the data into a block
+        std::vector<uint8_t> more(50, 'm');
+        fs.append("/tiny.txt", more.data(), more.size());
+        ASSERT(!(fs.get_stats("/tiny.txt").flags & INODE_FLAG_INLINE), "Outgrown file leaves inline");
+        ASSERT(fs.get_free_block_count() == free_before - 1, "Converted file takes one block");
+        std::vector<uint8_t> expect = small;
+        expect.insert(expect.end(), more.begin(), more.end());
+        ASSERT(fs.read_file("/tiny.txt") == expect, "Conversion keeps the data");
+
+        // Rewriting a small file returns it to inline
+        fs.write_file("/tiny.txt", small);
+        ASSERT(fs.get_stats("/tiny.txt").flags & INODE_FLAG_INLINE, "Rewritten small file is inline again");
+        ASSERT(fs.get_free_block_count() == free_before, "Rewrite frees the old block");
+
+        // Shrink then grow: the cut bytes read back as zeros
+        fs.truncate("/tiny.txt", 10);
+        fs.truncate("/tiny.txt", 40);
+        uint8_t buf[40];
+        ASSERT(fs.read_at("/tiny.txt", 0, buf, 40) == 40 && buf[9] == 's' && buf[10] == 0 && buf[39] == 0,
+               "Inline truncate zeroes the tail");
+
+        // Short symlink targets need no block; long ones still get one
+        fs.create_symlink("/", "/fast");
+        ASSERT(fs.get_free_block_count() == free_before, "Fast symlink uses no data block");
+        ASSERT(fs.get_stats("/fast").symlink_target == "/", "Fast symlink target reads back");
+        ASSERT(fs.read_file("/fast/tiny.txt").size() == 40, "Path walk follows a fast symlink");
+
+        std::string long_target = "/" + std::string(200, 'x');
+        fs.create_symlink(long_target, "/slow");
+        ASSERT(fs.get_free_block_count() == free_before - 1, "Long symlink target takes a block");
+        ASSERT(fs.get_stats("/slow").symlink_target == long_target, "Long symlink target reads back");
+        fs.sync();
+    }
+
+    // Survives remount
+    {
+        Disk disk(16 * 1024 * 1024, TEST_IMG);
+        FileSystem fs(disk);
+        fs.mount();
+        ASSERT(fs.read_file("/tiny.txt").size() == 40, "Inline file persists across remount");
+        ASSERT(fs.get_stats("/fast").symlink_target == "/", "Fast symlink persists across remount");
+        size_t free_before = fs.get_free_block_count();
+        fs.delete_file("/fast");
+        fs.delete_file("/tiny.txt");
+        ASSERT(fs.get_free_block_count() == free_before, "Deleting inline inodes frees no blocks");
+    }
+
+    cleanup_file(TEST_IMG);
+}
+
+void test_readahead() {
+    std::cout << "\n=== FS Tests: Sequential Readahead ===\n";
+    const char* TEST_IMG = "test_fs_readahead.img";
+    cleanup_file(TEST_IMG);
+
+    auto data = generate_data(256 * 4096);
+    {
+        Disk disk(16 * 1024 * 1024, TEST_IMG);
+        FileSystem fs(disk);
+        fs.format();
+        fs.create_file("/seq.bin");
+        fs.write_file("/seq.bin", data);
+    }
+
+    // Cold cache: small sequential reads through a handle should mostly hit
+    // blocks loaded ahead of them
+    {
+        Disk disk(16 * 1024 * 1024, TEST_IMG, DiskBackendType::Pread, 1024);
+        FileSystem fs(disk);
+        fs.mount();
+        BufferCache* cache = disk.get_cache();
+
+        int fd = fs.open("/seq.bin", FS_OPEN_READ);
+        size_t misses_before = cache->get_misses();
+        std::vector<uint8_t> back;
+        uint8_t buf[4096];
+        for (size_t n; (n = fs.read(fd, buf, sizeof(buf))) > 0; ) back.insert(back.end(), buf, buf + n);
+        fs.close(fd);
+        ASSERT(back == data, "Sequential reads with readahead return the file");
+        ASSERT(cache->get_prefetched() >= 200, "Sequential reads load the blocks ahead");
+        ASSERT(cache->get_misses() - misses_before < 16, "Most sequential reads hit prefetched blocks");
+    }
+
+    // Reads that jump around hint nothing
+    {
+        Disk disk(16 * 1024 * 1024, TEST_IMG, DiskBackendType::Pread, 1024);
+        FileSystem fs(disk);
+        fs.mount();
+        BufferCache* cache = disk.get_cache();
+
+        int fd = fs.open("/seq.bin", FS_OPEN_READ);
+        uint8_t buf[4096];
+        bool all_match = true;
+        for (size_t block = 255; block > 0; block -= 5) {
+            fs.read_at(fd, block * 4096, buf, sizeof(buf));
+            all_match = all_match && std::equal(buf, buf + sizeof(buf), data.begin() + block * 4096);
+        }
+        fs.close(fd);
+        ASSERT(all_match, "Backward reads return the right blocks");
+        ASSERT(cache->get_prefetched() == 0, "Backward reads are not read ahead");
+    }
+
+    cleanup_file(TEST_IMG);
+}
+
+void test_zero_copy_io() {
+    std::cout << "\n=== FS Tests: Zero-Copy Views and Gather Writes ===\n";
+    const char* TEST_IMG = "test_fs_zerocopy.img";
+    cleanup_file(TEST_IMG);
+
+    auto gather = [](const ReadLease& lease) {
+        std::vector<uint8_t> out;
+        for (const iovec& v : lease.iovecs()) {
+            const uint8_t* p = static_cast<const uint8_t*>(v.iov_base);
+            out.insert(out.end(), p, p + v.iov_len);
+        }
+        return out;
+    };
+
+    auto data = generate_data(40 * 4096 + 123);
+    {
+        Disk disk(16 * 1024 * 1024, TEST_IMG);
+        FileSystem fs(disk);
+        fs.format();
+        fs.create_file("/big.bin");
+        fs.write_file("/big.bin", data);
+
+        {
+            ReadLease lease = fs.read_view("/big.bin");
+            ASSERT(lease.size() == data.size() && gather(lease) == data, "Read view covers the whole file");
+            ASSERT(lease.iovecs().size() < 4, "Contiguous blocks share one view");
+        }
+
+        // Holes and inline files
+        fs.create_file("/sparse.bin");
+        fs.write_at("/sparse.bin", 3 * 4096, data.data(), 10);
+        ReadLease sparse = fs.read_view("/sparse.bin", 4000, 200);
+        std::vector<uint8_t> expect(200, 0);
+        ASSERT(sparse.size() == 200 && gather(sparse) == expect, "Holes read as zeros through a view");
+        sparse.release();
+
+        fs.create_file("/tiny.txt");
+        fs.write_file("/tiny.txt", std::vector<uint8_t>(data.begin(), data.begin() + 50));
+        ASSERT(gather(fs.read_view("/tiny.txt", 10)) == std::vector<uint8_t>(data.begin() + 10, data.begin() + 50),
+               "Inline files can be viewed");
+
+        // Gather writes land back to back
+        fs.create_file("/out.bin");
+        int fd = fs.open("/out.bin", FS_OPEN_READ | FS_OPEN_WRITE | FS_OPEN_APPEND);
+        std::string a = "header:", b(5000, 'b'), c = ":trailer";
+        iovec parts[3] = {{&a[0], a.size()}, {&b[0], b.size()}, {&c[0], c.size()}};
+        ASSERT(fs.writev(fd, parts, 3) == a.size() + b.size() + c.size(), "writev writes every buffer");
+        ASSERT(fs.writev(fd, parts, 1) == a.size(), "writev appends with FS_OPEN_APPEND");
+        fs.pwritev(fd, 0, parts + 2, 1);
+        ReadLease view = fs.read_view(fd, 0, SIZE_MAX);
+        std::vector<uint8_t> out = gather(view);
+        std::string joined = a + b + c + a;
+        std::copy(c.begin(), c.end(), joined.begin());
+        ASSERT(std::string(out.begin(), out.end()) == joined, "pwritev overwrites in place");
+        view.release();
+        fs.close(fd);
+    }
+
+    // Behind a buffer cache the views stay pinned while the lease lives
+    {
+        Disk disk(16 * 1024 * 1024, TEST_IMG, DiskBackendType::Pread, 8);
+        FileSystem fs(disk);
+        fs.mount();
+        ReadLease lease = fs.read_view("/big.bin");
+        std::vector<uint8_t> filler(4096, 0x11);
+        for (int i = 0; i < 64; i++) disk.write_block(3000 + i, filler.data()); // Churn the cache
+        ASSERT(gather(lease) == data, "Cached views survive eviction pressure");
+        ReadLease moved = std::move(lease);
+        ASSERT(lease.size() == 0 && moved.size() == data.size(), "Leases move");
+    }
+
+    cleanup_file(TEST_IMG);
+}
+
+void test_stats() {
+    std::cout << "\n=== FS Tests: Operation Statistics ===\n";
+    const char* TEST_IMG = "test_fs_stats.img";
+    cleanup_file(TEST_IMG);
+
+    Disk disk(16 * 1024 * 1024, TEST_IMG);
+    FileSystem fs(disk);
+    fs.format();
+    if (!fs.stats().enabled) {
+        std::cout << "  -> Built without FS_STATS, skipping\n";
+        cleanup_file(TEST_IMG);
+        return;
+    }
+
+    fs.reset_stats();
+    fs.create_dir("/a");
+    fs.create_file("/a/f");
+    std::vector<uint8_t> data(10000, 0x5A);
+    fs.write_at("/a/f", 0, data.data(), data.size());
+    fs.read_at("/a/f", 100, data.data(), 5000);
+    fs.get_stats("/a/f");
+
+    FsStatsSnapshot s = fs.stats();
+    ASSERT(s.bytes_written == 10000 && s.bytes_read == 5000, "Byte counters match the I/O");
+    ASSERT(s.op(FsOp::Write).count == 1 && s.op(FsOp::Read).count == 1, "One write and one read recorded");
+    ASSERT(s.op(FsOp::AllocateInode).count == 2 && s.op(FsOp::AllocateBlock).count >= 2, "Allocations recorded");
+    ASSERT(s.op(FsOp::PathWalk).count >= 4 && s.op(FsOp::Lookup).count >= s.op(FsOp::PathWalk).count,
+           "Path walks and lookups recorded");
+    ASSERT(s.bitmap_scan_bits.count > 0 && s.dentry_hits + s.dentry_misses > 0, "Scan lengths and dentry counters");
+
+    const HistogramSnapshot& w = s.op(FsOp::Write);
+    ASSERT(w.percentile(50) <= w.max && w.percentile(99) == w.max && w.mean() == w.sum, "Percentiles are bounded by max");
+
+    fs.reset_stats();
+    s = fs.stats();
+    ASSERT(s.op(FsOp::Write).count == 0 && s.bytes_written == 0 && s.dentry_hits == 0, "reset_stats clears everything");
+
+    cleanup_file(TEST_IMG);
+}
+
 int main() {
     std::cout << "STARTING FILESYSTEM OPERATIONS TEST SUITE\n";
     std::cout << "=========================================\n";
@@ -386,13 +898,22 @@ int main() {
     try {
         test_format_and_mount();
         test_file_creation();
+        test_logger();
         test_file_write_read();
         test_file_deletion();
         test_max_file_size();
+        test_multi_level_indirect();
+        test_extent_files();
+        test_inline_data();
+        test_readahead();
+        test_zero_copy_io();
         test_directory_creation();
         test_directory_listing();
         test_directory_deletion();
         test_mixed_operations();
+        test_offset_io();
+        test_file_handles();
+        test_stats();
     } catch (const std::exception& e) {
         std::cerr << "\n[CRITICAL FAILURE] Uncaught Exception: " << e.what() << "\n";
         return 1;
@@ -14,6 +14,19 @@
         std::cout << "[PASS] " << message << "\n"; \
     }
 
+#define ASSERT_THROWS(code, message) \
+    { \
+        bool caught = false; \
+        try { code; } \
+        catch (const std::exception&) { caught = true; } \
+        if (!caught) { \
+            std::cerr << "[FAIL] " << message << " (Expected exception but none thrown)\n"; \
+            std::exit(1); \
+        } else { \
+            std::cout << "[PASS] " << message << "\n"; \
+        } \
+    }
+
 void cleanup_file(const char* filename) {
     std::remove(filename);
 }
@@ -295,6 +308,287 @@ void test_metadata_persistence() {
     cleanup_file(TEST_IMG);
 }
 
+void test_free_space_persistence() {
+    std::cout << "\n=== Persistence Tests: Group Descriptor Counters ===\n";
+    const char* TEST_IMG = "test_persist_counters.img";
+    cleanup_file(TEST_IMG);
+
+    const size_t DISK_SIZE = 32 * 1024 * 1024;
+    size_t free_blocks_before = 0;
+    size_t free_inodes_before = 0;
+
+    // Session 1: Consume some space and remember the counters
+    {
+        Disk disk(DISK_SIZE, TEST_IMG);
+        FileSystem fs(disk);
+        fs.format();
+
+        size_t fresh_blocks = fs.get_free_block_count();
+        size_t fresh_inodes = fs.get_free_inode_count();
+
+        fs.create_file("/a.bin");
+        fs.write_file("/a.bin", generate_random_data(5 * 4096, 7));
+
+        ASSERT(fs.get_free_block_count() == fresh_blocks - 5, "Writing 5 blocks decrements free block count by 5");
+        ASSERT(fs.get_free_inode_count() == fresh_inodes - 1, "Creating a file decrements free inode count by 1");
+
+        free_blocks_before = fs.get_free_block_count();
+        free_inodes_before = fs.get_free_inode_count();
+    }
+
+    // Session 2: Counters must be loaded from disk, not recomputed to a different value
+    {
+        Disk disk(DISK_SIZE, TEST_IMG);
+        FileSystem fs(disk);
+        fs.mount();
+
+        ASSERT(fs.get_free_block_count() == free_blocks_before, "Free block count persisted");
+        ASSERT(fs.get_free_inode_count() == free_inodes_before, "Free inode count persisted");
+
+        fs.delete_file("/a.bin");
+        ASSERT(fs.get_free_block_count() == free_blocks_before + 5, "Delete returns blocks to the counters");
+        ASSERT(fs.get_free_inode_count() == free_inodes_before + 1, "Delete returns the inode to the counters");
+    }
+
+    cleanup_file(TEST_IMG);
+}
+
+void test_lazy_format() {
+    std::cout << "\n=== Persistence Tests: Lazy Format ===\n";
+    const char* TEST_IMG = "test_persist_lazy.img";
+    cleanup_file(TEST_IMG);
+
+    const size_t DISK_SIZE = 64 * 1024 * 1024; // 4 groups
+    size_t full_blocks = 0;
+    size_t full_inodes = 0;
+    {
+        Disk disk(DISK_SIZE, TEST_IMG);
+        FileSystem fs(disk);
+        fs.format();
+        full_blocks = fs.get_free_block_count();
+        full_inodes = fs.get_free_inode_count();
+    }
+    // Scribble over the whole image: a lazy format must not rely on zeros
+    {
+        Disk disk(DISK_SIZE, TEST_IMG);
+        std::memset(disk.get_ptr(0), 0xA5, DISK_SIZE);
+    }
+
+    std::vector<uint8_t> data = generate_random_data(24 * 1024 * 1024, 31); // Spills past group 0
+    {
+        Disk disk(DISK_SIZE, TEST_IMG);
+        FileSystem fs(disk);
+        fs.format(true);
+        ASSERT(fs.get_free_block_count() == full_blocks && fs.get_free_inode_count() == full_inodes,
+               "Lazy format reports the same free space as a full one");
+
+        // Group descriptors sit 1024 bytes into each group's first block
+        auto group_flags = [&](size_t group) {
+            return reinterpret_cast<GroupDescriptor*>(disk.get_ptr(group * 4096) + 1024)->flags;
+        };
+        ASSERT(!(group_flags(0) & GROUP_FLAG_UNINIT) && (group_flags(3) & GROUP_FLAG_UNINIT),
+               "Only group 0 is initialized by a lazy format");
+
+        fs.create_dir("/d");
+        fs.create_file("/d/big");
+        fs.write_file("/d/big", data);
+        ASSERT(!(group_flags(1) & GROUP_FLAG_UNINIT), "A group is initialized by its first allocation");
+        ASSERT(fs.read_file("/d/big") == data, "Data in lazily initialized groups reads back");
+    }
+    {
+        Disk disk(DISK_SIZE, TEST_IMG);
+        FileSystem fs(disk);
+        fs.mount();
+        ASSERT(fs.read_file("/d/big") == data, "Lazily formatted image survives a remount");
+
+        fs.delete_file("/d/big");
+        ASSERT(fs.get_free_block_count() == full_blocks - 1 && fs.get_free_inode_count() == full_inodes - 1,
+               "Freeing everything restores the counters (only /d remains)");
+    }
+
+    cleanup_file(TEST_IMG);
+}
+
+void test_fsync() {
+    std::cout << "\n=== Persistence Tests: fsync ===\n";
+    const char* TEST_IMG = "test_persist_fsync.img";
+    cleanup_file(TEST_IMG);
+
+    const size_t DISK_SIZE = 32 * 1024 * 1024;
+    std::vector<uint8_t> data = generate_random_data(20 * 4096, 11);
+    {
+        Disk disk(DISK_SIZE, TEST_IMG);
+        FileSystem fs(disk);
+        fs.format();
+        fs.create_file("/synced.bin");
+        fs.create_file("/other.bin");
+        fs.sync();
+        ASSERT(disk.get_dirty_count() == 0, "sync() leaves no dirty block");
+
+        fs.write_file("/synced.bin", data);
+        fs.write_file("/other.bin", generate_random_data(8 * 4096, 12));
+        size_t dirty = disk.get_dirty_count();
+        fs.fsync("/synced.bin");
+        ASSERT(disk.get_dirty_count() <= dirty - 20, "fsync flushes the file's data blocks");
+        ASSERT(disk.get_dirty_count() >= 8, "fsync leaves other files' data alone");
+
+        fs.fsync("/other.bin", SyncMode::Async);
+        ASSERT_THROWS(fs.fsync("/missing"), "fsync of a missing file throws");
+    }
+
+    {
+        Disk disk(DISK_SIZE, TEST_IMG);
+        FileSystem fs(disk);
+        fs.mount();
+        ASSERT(fs.read_file("/synced.bin") == data, "fsynced data persists");
+    }
+
+    cleanup_file(TEST_IMG);
+}
+
+void test_backend_round_trip() {
+    std::cout << "\n=== Persistence Tests: Disk Backends ===\n";
+    const char* TEST_IMG = "test_persist_backend.img";
+    cleanup_file(TEST_IMG);
+
+    const size_t DISK_SIZE = 32 * 1024 * 1024;
+    std::vector<uint8_t> data = generate_random_data(40000, 21);
+    {
+        Disk disk(DISK_SIZE, TEST_IMG, DiskBackendType::Pread);
+        FileSystem fs(disk);
+        fs.format();
+        fs.create_dir("/d");
+        fs.create_file("/d/f");
+        fs.write_file("/d/f", data);
+    }
+    {
+        Disk disk(DISK_SIZE, TEST_IMG);
+        FileSystem fs(disk);
+        fs.mount();
+        ASSERT(fs.read_file("/d/f") == data, "A file system written through pread mounts from mmap");
+    }
+
+    // Again through a buffer cache far smaller than the working set
+    std::vector<uint8_t> more = generate_random_data(300000, 22);
+    {
+        Disk disk(DISK_SIZE, TEST_IMG, DiskBackendType::Pread, 32);
+        FileSystem fs(disk);
+        fs.mount();
+        ASSERT(fs.read_file("/d/f") == data, "Mounted through the buffer cache");
+        for (int i = 0; i < 40; i++) fs.create_file("/d/g" + std::to_string(i));
+        fs.create_file("/d/big");
+        fs.write_file("/d/big", more);
+        fs.delete_file("/d/g7");
+        ASSERT(fs.read_file("/d/big") == more, "Large file reads back through the cache");
+        ASSERT(disk.get_cache()->get_resident() <= 32 && disk.get_cache()->get_evictions() > 0,
+               "The cache stays bounded while evicting");
+    }
+    {
+        Disk disk(DISK_SIZE, TEST_IMG);
+        FileSystem fs(disk);
+        fs.mount();
+        ASSERT(fs.read_file("/d/big") == more && fs.get_stats("/d/g39").file_size == 0,
+               "Work done through the cache persists");
+        ASSERT_THROWS(fs.get_stats("/d/g7"), "Deletes done through the cache persist");
+    }
+
+    cleanup_file(TEST_IMG);
+}
+
+void test_format_version_check() {
+    std::cout << "\n=== Persistence Tests: Format Version ===\n";
+    const char* TEST_IMG = "test_persist_version.img";
+    cleanup_file(TEST_IMG);
+
+    const size_t DISK_SIZE = 16 * 1024 * 1024;
+    {
+        Disk disk(DISK_SIZE, TEST_IMG);
+        FileSystem fs(disk);
+        fs.format();
+        SuperBlock* sb = reinterpret_cast<SuperBlock*>(disk.get_ptr(0));
+        ASSERT(sb->format_version == FS_FORMAT_VERSION, "Format stamps the current format version");
+
+        // Pretend this image was written with the old fixed-size entries
+        sb->format_version = 0;
+    }
+    {
+        Disk disk(DISK_SIZE, TEST_IMG);
+        FileSystem fs(disk);
+        bool caught = false;
+        try {
+            fs.mount();
+        } catch (const std::runtime_error&) {
+            caught = true;
+        }
+        ASSERT(caught, "Mount rejects an image with a different format version");
+    }
+    {
+        // Current version, but group 0 lost its descriptor
+        Disk disk(DISK_SIZE, TEST_IMG);
+        FileSystem fs(disk);
+        fs.format();
+        reinterpret_cast<GroupDescriptor*>(disk.get_ptr(0) + 1024)->magic = 0;
+    }
+    for (MountMode mode : {MountMode::Fast, MountMode::Warm}) {
+        Disk disk(DISK_SIZE, TEST_IMG);
+        FileSystem fs(disk);
+        bool caught = false;
+        try {
+            fs.mount(mode);
+        } catch (const std::runtime_error&) {
+            caught = true;
+        }
+        ASSERT(caught, "Mount rejects a group without a descriptor");
+    }
+
+    cleanup_file(TEST_IMG);
+}
+
+void test_warm_mount() {
+    std::cout << "\n=== Persistence Tests: Warm Mount ===\n";
+    const char* TEST_IMG = "test_persist_warm.img";
+    cleanup_file(TEST_IMG);
+
+    const size_t DISK_SIZE = 64 * 1024 * 1024;
+    std::vector<uint8_t> data = generate_random_data(200000, 29);
+    size_t free_blocks = 0;
+    {
+        Disk disk(DISK_SIZE, TEST_IMG);
+        FileSystem fs(disk);
+        fs.format(true);
+        fs.create_dir("/w");
+        fs.create_file("/w/f");
+        fs.write_file("/w/f", data);
+        free_blocks = fs.get_free_block_count();
+    }
+    {
+        // A descriptor whose counter went stale (e.g. written without its bitmap)
+        Disk disk(DISK_SIZE, TEST_IMG);
+        GroupDescriptor* gd = reinterpret_cast<GroupDescriptor*>(disk.get_ptr(0) + 1024);
+        gd->free_blocks_count += 7;
+    }
+    {
+        Disk disk(DISK_SIZE, TEST_IMG);
+        FileSystem fs(disk);
+        fs.mount(MountMode::Warm);
+        ASSERT(fs.get_free_block_count() == free_blocks, "Warm mount rebuilds a stale descriptor");
+        FsStatsSnapshot s = fs.stats();
+        ASSERT(!s.enabled || (s.descriptors_rebuilt == 1 && s.op(FsOp::Mount).count == 1),
+               "Mount time and rebuilt descriptors are recorded");
+        ASSERT(fs.read_file("/w/f") == data, "Files read back after a warm mount");
+    }
+    {
+        Disk disk(DISK_SIZE, TEST_IMG, DiskBackendType::Pread, 64);
+        FileSystem fs(disk);
+        fs.mount(MountMode::Warm);
+        ASSERT(disk.get_cache()->get_resident() > 0, "Group metadata is loaded into the cache");
+        ASSERT(fs.read_file("/w/f") == data, "Warm mount through the buffer cache");
+        ASSERT(fs.stats().descriptors_rebuilt == 0, "A consistent image needs no rebuild");
+    }
+
+    cleanup_file(TEST_IMG);
+}
+
 // ==========================================
 // MAIN
 // ==========================================
@@ -308,6 +602,12 @@ int main() {
         test_complex_tree_persistence();
         test_multi_session_operations();
         test_metadata_persistence();
+        test_free_space_persistence();
+        test_lazy_format();
+        test_fsync();
+        test_backend_round_trip();
+        test_format_version_check();
+        test_warm_mount();
     } catch (const std::exception& e) {
         std::cerr << "\n[CRITICAL FAILURE] Uncaught Exception: " << e.what() << "\n";
         return 1;
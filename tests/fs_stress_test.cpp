@@ -1,9 +1,11 @@
 #include "fs/filesystem.hpp"
 #include "fs/disk.hpp"
+#include "fs/block_group_manager.hpp"
 #include <iostream>
 #include <vector>
 #include <string>
 #include <cstdio>
+#include <cstring>
 #include <random>
 #include <chrono>
 
@@ -140,11 +142,15 @@ void test_disk_full_scenarios() {
 
     ASSERT(count > 0, "Disk filled up successfully");
 
-    // Delete all to free space
+    // Delete all to free space (including the last file, whose create may
+    // have succeeded before its write ran out of blocks)
     for (int i = 0; i < count; i++) {
         std::string name = "/f" + std::to_string(i);
         fs.delete_file(name);
     }
+    try {
+        fs.delete_file("/f" + std::to_string(count));
+    } catch (const std::runtime_error&) {}
 
     ASSERT(fs.list_dir("/").empty(), "All files deleted after filling disk");
 
@@ -207,9 +213,111 @@ void test_multiple_block_groups() {
     cleanup_file(TEST_IMG);
 }
 
+void test_full_group_skipping() {
+    std::cout << "\n=== Stress Tests: Allocation Skips Full Groups ===\n";
+    const char* TEST_IMG = "test_stress_fullgroups.img";
+    cleanup_file(TEST_IMG);
+
+    Disk disk(32 * 1024 * 1024, TEST_IMG);  // 2 block groups
+    FileSystem fs(disk);
+    fs.format();
+
+    // 4 x 85 files of 12 blocks is more than group 0 can hold, so later
+    // writes must land in group 1 via the descriptor counters.
+    const int dirs = 4;
+    const int files_per_dir = 85;
+    const size_t file_bytes = 12 * 4096;
+    for (int d = 0; d < dirs; d++) {
+        fs.create_dir("/g" + std::to_string(d));
+        for (int f = 0; f < files_per_dir; f++) {
+            fs.create_file("/g" + std::to_string(d) + "/f" + std::to_string(f));
+        }
+    }
+
+    size_t free_before = fs.get_free_block_count();
+    for (int d = 0; d < dirs; d++) {
+        for (int f = 0; f < files_per_dir; f++) {
+            fs.write_file("/g" + std::to_string(d) + "/f" + std::to_string(f),
+                          generate_random_data(file_bytes, d * files_per_dir + f));
+        }
+    }
+    ASSERT(fs.get_free_block_count() == free_before - dirs * files_per_dir * 12,
+           "Free block counter tracks allocations across groups");
+
+    bool intact = true;
+    for (int d = 0; d < dirs; d++) {
+        for (int f = 0; f < files_per_dir; f++) {
+            auto data = fs.read_file("/g" + std::to_string(d) + "/f" + std::to_string(f));
+            if (data != generate_random_data(file_bytes, d * files_per_dir + f)) intact = false;
+        }
+    }
+    ASSERT(intact, "Files written after group 0 filled read back correctly");
+
+    for (int d = 0; d < dirs; d++) {
+        for (int f = 0; f < files_per_dir; f++) {
+            fs.delete_file("/g" + std::to_string(d) + "/f" + std::to_string(f));
+        }
+    }
+    ASSERT(fs.get_free_block_count() == free_before, "All blocks returned after delete");
+
+    cleanup_file(TEST_IMG);
+}
+
 // ==========================================
 // EDGE CASE TESTS
 // ==========================================
+void test_run_allocation() {
+    std::cout << "\n=== Stress Tests: Contiguous Run Allocation ===\n";
+    const char* TEST_IMG = "test_stress_runs.img";
+    cleanup_file(TEST_IMG);
+
+    Disk disk(16 * 1024 * 1024, TEST_IMG);
+    {
+        FileSystem fs(disk);
+        fs.format();
+    }
+    SuperBlock* sb = reinterpret_cast<SuperBlock*>(disk.get_ptr(0));
+    BlockGroupManager bgm(disk, sb, 0);
+    size_t free_before = bgm.get_free_blocks_count();
+
+    // One call, one run, counters updated once
+    auto runs = bgm.allocate_blocks(300);
+    ASSERT(runs.size() == 1 && runs[0].length == 300, "300 blocks come back as a single run");
+    ASSERT(bgm.get_free_blocks_count() == free_before - 300, "Free count drops by the run length");
+
+    // Goal block is honoured when free
+    size_t goal = runs[0].start + 1000;
+    auto at_goal = bgm.allocate_blocks(10, static_cast<int>(goal));
+    ASSERT(at_goal.size() == 1 && at_goal[0].start == goal, "Run starts at the goal block");
+
+    // A goal inside a used range falls back to the hint and the gap is
+    // handed out as a short list of runs
+    for (size_t b = runs[0].start + 100; b < runs[0].start + 200; b++) bgm.free_block(static_cast<int>(b));
+    auto split = bgm.allocate_blocks(150, static_cast<int>(runs[0].start + 100));
+    size_t total = 0;
+    for (const auto& r : split) total += r.length;
+    ASSERT(split.size() >= 2 && split[0].start == runs[0].start + 100 && split[0].length == 100 && total == 150,
+           "Gap is filled first, the rest continues elsewhere");
+
+    // Skipping the zero-fill leaves the old bytes, the default clears them
+    std::memset(disk.get_ptr(split[0].start), 0x5A, 4096);
+    bgm.free_block(static_cast<int>(split[0].start));
+    auto raw = bgm.allocate_blocks(1, static_cast<int>(split[0].start), false);
+    ASSERT(disk.get_ptr(raw[0].start)[0] == 0x5A, "zero_fill = false skips the memset");
+    bgm.free_block(static_cast<int>(raw[0].start));
+    auto zeroed = bgm.allocate_blocks(1, static_cast<int>(raw[0].start));
+    ASSERT(disk.get_ptr(zeroed[0].start)[0] == 0, "Default allocation zero-fills");
+
+    // Exhausting the group stops short instead of failing
+    size_t left = bgm.get_free_blocks_count();
+    auto rest = bgm.allocate_blocks(left + 50);
+    total = 0;
+    for (const auto& r : rest) total += r.length;
+    ASSERT(total == left && bgm.get_free_blocks_count() == 0, "Request larger than the group returns what is left");
+
+    cleanup_file(TEST_IMG);
+}
+
 void test_empty_operations() {
     std::cout << "\n=== Edge Case Tests: Empty Operations ===\n";
     const char* TEST_IMG = "test_edge_empty.img";
@@ -251,15 +359,20 @@ void test_boundary_conditions() {
     auto data = fs.read_file("/exact_block.txt");
     ASSERT(data.size() == 4096, "Exact block size file");
 
-    // File at max boundary (49152 bytes = 12 blocks)
+    // File at the direct-block boundary (49152 bytes = 12 blocks)
     fs.create_file("/max_file.txt");
     fs.write_file("/max_file.txt", generate_random_data(49152, 2));
     data = fs.read_file("/max_file.txt");
-    ASSERT(data.size() == 49152, "Max size file (48KB)");
+    ASSERT(data.size() == 49152, "Direct-only file (48KB)");
+
+    // One byte over spills into the single indirect block
+    auto spill = generate_random_data(49153, 3);
+    fs.write_file("/max_file.txt", spill);
+    ASSERT(fs.read_file("/max_file.txt") == spill, "49153 bytes round-trip through the indirect block");
 
-    // One byte over max
-    std::vector<uint8_t> too_big(49153);
-    ASSERT_THROWS(fs.write_file("/max_file.txt", too_big), "Cannot write 49153 bytes");
+    // Larger than the whole disk
+    std::vector<uint8_t> too_big(17 * 1024 * 1024);
+    ASSERT_THROWS(fs.write_file("/max_file.txt", too_big), "Cannot write more than the disk holds");
 
     cleanup_file(TEST_IMG);
 }
@@ -374,6 +487,8 @@ int main() {
         test_mass_file_creation();
         test_disk_full_scenarios();
         test_multiple_block_groups();
+        test_full_group_skipping();
+        test_run_allocation();
         test_empty_operations();
         test_boundary_conditions();
         test_special_filenames();